@@ -0,0 +1,70 @@
+#include <bench/bench.h>
+#include <test/util/setup_common.h>
+#include <util/strencodings.h>
+#include <validation.h>
+
+#include <thread>
+#include <vector>
+
+namespace {
+
+/*
+    Stores 42 at slot 0, the runtime code returns the value of slot 0:
+    PUSH1 0 SLOAD PUSH1 0 MSTORE PUSH1 32 PUSH1 0 RETURN
+*/
+const std::vector<unsigned char> CODE = ParseHex("602a600055600b6011600039600b6000f3600054600052602060" "00f3");
+
+constexpr size_t CALLS_PER_THREAD = 100;
+
+dev::Address DeployContract(ChainstateManager& chainman)
+{
+    LOCK(cs_main);
+    CBlock block;
+    CMutableTransaction tx;
+    tx.vout.push_back(CTxOut(0, CScript() << OP_DUP << OP_HASH160 << ParseHex("abababababababababababababababababababab") << OP_EQUALVERIFY << OP_CHECKSIG));
+    block.vtx.push_back(MakeTransactionRef(CTransaction(tx)));
+
+    YodyTransaction txEth(0, 1, 500000, CODE, 0);
+    txEth.forceSender(dev::Address("0101010101010101010101010101010101010101"));
+    txEth.setHashWith(dev::h256(ParseHex("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa")));
+    txEth.setNVout(0);
+    txEth.setVersion(VersionVM::GetEVMDefault());
+
+    CChain& chain = chainman.ActiveChain();
+    ByteCodeExec exec(block, std::vector<YodyTransaction>(1, txEth), DEFAULT_BLOCK_GAS_LIMIT_DGP, chain.Tip(), chain);
+    exec.performByteCode();
+    return exec.getResult()[0].execRes.newAddress;
+}
+
+void ContractCall(benchmark::Bench& bench, size_t threads)
+{
+    const auto test_setup = MakeNoLogFileContext<const TestingSetup>();
+    ChainstateManager& chainman = *test_setup->m_node.chainman;
+    const dev::Address contract = DeployContract(chainman);
+
+    bench.batch(threads * CALLS_PER_THREAD).unit("call").run([&] {
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back([&] {
+                for (size_t j = 0; j < CALLS_PER_THREAD; ++j) {
+                    std::unique_ptr<CallContractSnapshot> snapshot = WITH_LOCK(cs_main, return std::make_unique<CallContractSnapshot>(chainman.ActiveChainstate()));
+                    std::vector<ResultExecute> res = snapshot->Call(contract, std::vector<unsigned char>());
+                    assert(res.size() == 1 && res[0].execRes.excepted == dev::eth::TransactionException::None);
+                }
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    });
+}
+
+} // namespace
+
+static void ContractCall1Thread(benchmark::Bench& bench) { ContractCall(bench, 1); }
+static void ContractCall4Threads(benchmark::Bench& bench) { ContractCall(bench, 4); }
+static void ContractCall16Threads(benchmark::Bench& bench) { ContractCall(bench, 16); }
+
+BENCHMARK(ContractCall1Thread);
+BENCHMARK(ContractCall4Threads);
+BENCHMARK(ContractCall16Threads);
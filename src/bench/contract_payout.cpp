@@ -0,0 +1,68 @@
+#include <bench/bench.h>
+#include <test/util/setup_common.h>
+#include <util/strencodings.h>
+#include <validation.h>
+
+#include <vector>
+
+namespace {
+
+/*
+    Pays 1 satoshi to each of the addresses 0x1001 to 0x11f4 on any call:
+        for (i = 500; i != 0; i--) call(gas: 0, to: 0x1000 + i, value: 1)
+*/
+const std::vector<unsigned char> CODE = ParseHex("602080600b6000396000f3"
+                                                 "6101f45b6000600060006000600185611000016000f150600190038060035700");
+
+const dev::Address SENDER("0101010101010101010101010101010101010101");
+
+constexpr size_t NUM_RECIPIENTS = 500;
+
+YodyTransaction MakeTransaction(const dev::u256& value, const dev::Address& to, const std::vector<unsigned char>& data, const dev::h256& hashWith)
+{
+    YodyTransaction tx = to == dev::Address() ? YodyTransaction(value, 1, 30000000, data, 0) : YodyTransaction(value, 1, 30000000, to, data, 0);
+    tx.forceSender(SENDER);
+    tx.setHashWith(hashWith);
+    tx.setNVout(0);
+    tx.setVersion(VersionVM::GetEVMDefault());
+    return tx;
+}
+
+std::vector<ResultExecute> Execute(ChainstateManager& chainman, const CBlock& block, const YodyTransaction& tx)
+{
+    CChain& chain = chainman.ActiveChain();
+    ByteCodeExec exec(block, std::vector<YodyTransaction>(1, tx), DEFAULT_BLOCK_GAS_LIMIT_DGP, chain.Tip(), chain);
+    exec.performByteCode();
+    return exec.getResult();
+}
+
+/** Execute a call which pays out to 500 addresses, up to the condensing transaction with its 500 outputs */
+void ContractPayout(benchmark::Bench& bench)
+{
+    const auto test_setup = MakeNoLogFileContext<const TestingSetup>();
+    ChainstateManager& chainman = *test_setup->m_node.chainman;
+
+    LOCK(cs_main);
+    CBlock block;
+    CMutableTransaction coinbase;
+    coinbase.vout.push_back(CTxOut(0, CScript() << OP_DUP << OP_HASH160 << ParseHex("abababababababababababababababababababab") << OP_EQUALVERIFY << OP_CHECKSIG));
+    block.vtx.push_back(MakeTransactionRef(CTransaction(coinbase)));
+
+    const dev::Address contract = Execute(chainman, block, MakeTransaction(0, dev::Address(), CODE, dev::h256(ParseHex("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"))))[0].execRes.newAddress;
+    const YodyTransaction payout = MakeTransaction(NUM_RECIPIENTS, contract, {}, dev::h256(ParseHex("bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb")));
+
+    // Every run pays out from the same state
+    const dev::h256 hashStateRoot = globalState->rootHash();
+    const dev::h256 hashUTXORoot = globalState->rootHashUTXO();
+    bench.unit("payout").run([&] {
+        std::vector<ResultExecute> res = Execute(chainman, block, payout);
+        assert(res.size() == 1 && res[0].execRes.excepted == dev::eth::TransactionException::None);
+        assert(res[0].tx.vout.size() == NUM_RECIPIENTS);
+        globalState->setRoot(hashStateRoot);
+        globalState->setRootUTXO(hashUTXORoot);
+    });
+}
+
+} // namespace
+
+BENCHMARK(ContractPayout);
@@ -0,0 +1,197 @@
+#include <bench/bench.h>
+#include <libevm/EVMC.h>
+#include <test/util/setup_common.h>
+#include <util/convert.h>
+#include <util/strencodings.h>
+#include <validation.h>
+#include <yody/storageresults.h>
+
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace {
+
+/*
+    Minimal ERC20 token, the deployer holds the supply. The runtime code only has transfer(address,uint256),
+    which moves the balances kept at sha3(address . 0) and emits the Transfer event.
+*/
+const std::vector<unsigned char> CODE = ParseHex("6fffffffffffffffffffffffffffffffff3360005260006020526040600020556083602c60003960836000f3"
+                                                 "60003560e01c63a9059cbb14601357600080fd5b3360005260006020526040600020805460243580821060"
+                                                 "7e579003905560043560005260406000208054602435019055602435600052600435337fddf252ad1be2c8"
+                                                 "9b69c2b068fc378daa952ba7f163c4a11628f55a4df523b3ef60206000a3600160005260206000f35b6000"
+                                                 "80fd");
+
+const dev::Address SENDER("0101010101010101010101010101010101010101");
+
+constexpr size_t NUM_TRANSFERS = 10000;
+
+constexpr size_t NUM_RECEIPTS = 1000;
+
+/** Allocations made with operator new by the thread, while it is counted */
+thread_local uint64_t* t_allocation_count{nullptr};
+
+/** Counts the allocations made by the current thread during its lifetime, the other threads and benchmarks are not counted */
+class AllocationCounter
+{
+public:
+    AllocationCounter() { t_allocation_count = &m_count; }
+    ~AllocationCounter() { t_allocation_count = nullptr; }
+    AllocationCounter(const AllocationCounter&) = delete;
+    AllocationCounter& operator=(const AllocationCounter&) = delete;
+
+    uint64_t Count() const { return m_count; }
+
+private:
+    uint64_t m_count{0};
+};
+
+dev::Address DeployToken(ChainstateManager& chainman)
+{
+    LOCK(cs_main);
+    CBlock block;
+    CMutableTransaction tx;
+    tx.vout.push_back(CTxOut(0, CScript() << OP_DUP << OP_HASH160 << ParseHex("abababababababababababababababababababab") << OP_EQUALVERIFY << OP_CHECKSIG));
+    block.vtx.push_back(MakeTransactionRef(CTransaction(tx)));
+
+    YodyTransaction txEth(0, 1, 500000, CODE, 0);
+    txEth.forceSender(SENDER);
+    txEth.setHashWith(dev::h256(ParseHex("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa")));
+    txEth.setNVout(0);
+    txEth.setVersion(VersionVM::GetEVMDefault());
+
+    CChain& chain = chainman.ActiveChain();
+    ByteCodeExec exec(block, std::vector<YodyTransaction>(1, txEth), DEFAULT_BLOCK_GAS_LIMIT_DGP, chain.Tip(), chain);
+    exec.performByteCode();
+    return exec.getResult()[0].execRes.newAddress;
+}
+
+/** Call transfer on the token from the holder of the supply, with or without the code analysis cache */
+void ERC20Transfer(benchmark::Bench& bench, size_t analysis_cache)
+{
+    const auto test_setup = MakeNoLogFileContext<const TestingSetup>();
+    ChainstateManager& chainman = *test_setup->m_node.chainman;
+    const dev::Address token = DeployToken(chainman);
+
+    std::vector<unsigned char> data = ParseHex("a9059cbb000000000000000000000000"
+                                               "0202020202020202020202020202020202020202"
+                                               "0000000000000000000000000000000000000000000000000000000000000001");
+
+    dev::eth::CodeAnalysisCache& cache = dev::eth::EVMC::analysisCache();
+    cache.clear();
+    cache.setCapacity(analysis_cache);
+    bench.batch(NUM_TRANSFERS).unit("transfer").run([&] {
+        std::unique_ptr<CallContractSnapshot> snapshot = WITH_LOCK(cs_main, return std::make_unique<CallContractSnapshot>(chainman.ActiveChainstate()));
+        for (size_t i = 0; i < NUM_TRANSFERS; ++i) {
+            std::vector<ResultExecute> res = snapshot->Call(token, data, SENDER);
+            assert(res.size() == 1 && res[0].execRes.excepted == dev::eth::TransactionException::None);
+        }
+    });
+    cache.setCapacity(dev::eth::c_defaultCodeAnalysisCacheSize);
+}
+
+/** Execute transfers on the token as ConnectBlock does, up to their receipts staged in StorageResults, and count the allocations per Transfer event */
+void ERC20TransferReceipts(benchmark::Bench& bench)
+{
+    const auto test_setup = MakeNoLogFileContext<const TestingSetup>();
+    ChainstateManager& chainman = *test_setup->m_node.chainman;
+    const dev::Address token = DeployToken(chainman);
+    StorageResults results((test_setup->m_path_root / "results").string());
+
+    LOCK(cs_main);
+    CChain& chain = chainman.ActiveChain();
+    CBlock block;
+    CMutableTransaction coinbase;
+    coinbase.vout.push_back(CTxOut(0, CScript() << OP_DUP << OP_HASH160 << ParseHex("abababababababababababababababababababab") << OP_EQUALVERIFY << OP_CHECKSIG));
+    block.vtx.push_back(MakeTransactionRef(CTransaction(coinbase)));
+
+    std::vector<unsigned char> data = ParseHex("a9059cbb000000000000000000000000"
+                                               "0202020202020202020202020202020202020202"
+                                               "0000000000000000000000000000000000000000000000000000000000000001");
+    std::vector<YodyTransaction> transfers;
+    for (size_t i = 0; i < NUM_RECEIPTS; ++i) {
+        YodyTransaction txEth(0, 1, 100000, token, data, 0);
+        txEth.forceSender(SENDER);
+        txEth.setHashWith(dev::sha3(dev::rlp(i)));
+        txEth.setNVout(0);
+        txEth.setVersion(VersionVM::GetEVMDefault());
+        transfers.push_back(txEth);
+    }
+
+    // Every run transfers from the same state
+    const dev::h256 hashStateRoot = globalState->rootHash();
+    const dev::h256 hashUTXORoot = globalState->rootHashUTXO();
+    uint64_t allocations = 0;
+    uint64_t events = 0;
+    bench.batch(NUM_RECEIPTS).unit("transfer").run([&] {
+        AllocationCounter counter;
+        for (size_t i = 0; i < NUM_RECEIPTS; ++i) {
+            ByteCodeExec exec(block, std::vector<YodyTransaction>(1, transfers[i]), DEFAULT_BLOCK_GAS_LIMIT_DGP, chain.Tip(), chain);
+            exec.performByteCode();
+            ByteCodeExecResult bcer;
+            exec.processingResults(bcer);
+
+            ResultExecute& res = exec.getResult()[0];
+            assert(res.execRes.excepted == dev::eth::TransactionException::None && res.txRec.log().size() == 1);
+            events += res.txRec.log().size();
+            const uint64_t gasUsed = uint64_t(res.execRes.gasUsed);
+            std::vector<TransactionReceiptInfo> tri;
+            tri.push_back(TransactionReceiptInfo{
+                block.GetHash(),
+                uint32_t(chain.Height() + 1),
+                h256Touint(transfers[i].getHashWith()),
+                uint32_t(i + 1),
+                transfers[i].from(),
+                transfers[i].to(),
+                gasUsed,
+                gasUsed,
+                res.execRes.newAddress,
+                res.txRec.takeLog(),
+                res.execRes.excepted,
+                exceptedMessage(res.execRes.excepted, res.execRes.output),
+                transfers[i].getNVout(),
+                res.txRec.bloom(),
+                res.txRec.stateRoot(),
+                res.txRec.utxoRoot(),
+            });
+            results.addResult(transfers[i].getHashWith(), std::move(tri));
+        }
+        allocations += counter.Count();
+
+        // The staged receipts are dropped like the ones of a block which failed to connect
+        results.clearCacheResult();
+        globalState->setRoot(hashStateRoot);
+        globalState->setRootUTXO(hashUTXORoot);
+    });
+    if (bench.output() && events) {
+        *bench.output() << "ERC20TransferReceipts: " << double(allocations) / events << " allocations per Transfer event" << std::endl;
+    }
+}
+
+} // namespace
+
+// Allocates like the default operator new, the allocations are only counted while an AllocationCounter is alive on the thread
+void* operator new(size_t size)
+{
+    if (t_allocation_count) {
+        ++*t_allocation_count;
+    }
+    for (;;) {
+        if (void* p = std::malloc(size ? size : 1)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+static void ERC20TransferAnalysisCache(benchmark::Bench& bench) { ERC20Transfer(bench, dev::eth::c_defaultCodeAnalysisCacheSize); }
+static void ERC20TransferNoAnalysisCache(benchmark::Bench& bench) { ERC20Transfer(bench, 0); }
+
+BENCHMARK(ERC20TransferAnalysisCache);
+BENCHMARK(ERC20TransferNoAnalysisCache);
+BENCHMARK(ERC20TransferReceipts);
@@ -0,0 +1,94 @@
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <key.h>
+#include <node/blockstorage.h>
+#include <script/sign.h>
+#include <script/signingprovider.h>
+#include <script/standard.h>
+#include <test/util/mining.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+#include <util/strencodings.h>
+#include <validation.h>
+
+#include <vector>
+
+namespace {
+
+/*
+    Emits one log with a topic and a word of data, and deploys no code:
+    PUSH1 42 PUSH1 0 MSTORE PUSH32 topic PUSH1 32 PUSH1 0 LOG1 STOP
+*/
+const std::vector<unsigned char> CODE = ParseHex("602a6000527f"
+                                                 "dddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddd"
+                                                 "60206000a100");
+
+constexpr size_t NUM_BLOCKS = 10;
+constexpr size_t TXS_PER_BLOCK = 20;
+
+/** Mine blocks with contracts emitting logs, and reconnect them the way they are connected in IBD */
+void ConnectContractBlocks(benchmark::Bench& bench, bool log_events)
+{
+    const auto test_setup = MakeNoLogFileContext<const TestingSetup>(CBaseChainParams::REGTEST);
+    // -logevents is only read by init, set the flag ConnectBlock checks directly
+    const bool log_events_prev = fLogEvents;
+    fLogEvents = log_events;
+    const NodeContext& node = test_setup->m_node;
+    ChainstateManager& chainman = *node.chainman;
+    const CChainParams& params = Params();
+
+    CKey key;
+    key.MakeNewKey(true);
+    FillableSigningProvider keystore;
+    keystore.AddKey(key);
+    const CScript coinbase_script = GetScriptForDestination(PKHash(key.GetPubKey()));
+
+    // Mature the coinbases spent by the contract transactions
+    std::vector<CTransactionRef> coinbases;
+    const int maturity = params.GetConsensus().CoinbaseMaturity(0);
+    for (int i = 0; i < maturity + int(NUM_BLOCKS * TXS_PER_BLOCK); ++i) {
+        MineBlock(node, coinbase_script);
+        if (coinbases.size() < NUM_BLOCKS * TXS_PER_BLOCK) {
+            LOCK(cs_main);
+            CBlock block;
+            assert(ReadBlockFromDisk(block, chainman.ActiveChain().Tip(), params.GetConsensus()));
+            coinbases.push_back(block.vtx[0]);
+        }
+    }
+
+    CBlockIndex* first_block = nullptr;
+    for (size_t b = 0; b < NUM_BLOCKS; ++b) {
+        for (size_t i = 0; i < TXS_PER_BLOCK; ++i) {
+            const CTransactionRef& coinbase = coinbases[b * TXS_PER_BLOCK + i];
+            CMutableTransaction tx;
+            tx.vin.emplace_back(COutPoint(coinbase->GetHash(), 0));
+            tx.vout.emplace_back(0, CScript() << CScriptNum(VersionVM::GetEVMDefault().toRaw()) << CScriptNum(100000) << CScriptNum(DEFAULT_MIN_GAS_PRICE_DGP) << CODE << OP_CREATE);
+            tx.vout.emplace_back(coinbase->vout[0].nValue - COIN / 10, coinbase_script);
+            assert(SignSignature(keystore, *coinbase, tx, 0, SIGHASH_ALL));
+
+            LOCK(cs_main);
+            const MempoolAcceptResult res = AcceptToMemoryPool(chainman.ActiveChainstate(), *node.mempool, MakeTransactionRef(tx), /* bypass_limits */ false);
+            assert(res.m_result_type == MempoolAcceptResult::ResultType::VALID);
+        }
+        MineBlock(node, coinbase_script);
+        if (!first_block) first_block = WITH_LOCK(cs_main, return chainman.ActiveChain().Tip());
+    }
+
+    bench.batch(NUM_BLOCKS).unit("block").run([&] {
+        BlockValidationState state;
+        assert(chainman.ActiveChainstate().InvalidateBlock(state, first_block));
+        WITH_LOCK(cs_main, chainman.ActiveChainstate().ResetBlockFailureFlags(first_block));
+        assert(chainman.ActiveChainstate().ActivateBestChain(state));
+    });
+
+    fLogEvents = log_events_prev;
+}
+
+} // namespace
+
+static void ConnectBlocksLogEvents(benchmark::Bench& bench) { ConnectContractBlocks(bench, true); }
+static void ConnectBlocksNoLogEvents(benchmark::Bench& bench) { ConnectContractBlocks(bench, false); }
+
+BENCHMARK(ConnectBlocksLogEvents);
+BENCHMARK(ConnectBlocksNoLogEvents);
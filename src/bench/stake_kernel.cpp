@@ -0,0 +1,87 @@
+#include <bench/bench.h>
+#include <chain.h>
+#include <pos.h>
+#include <random.h>
+#include <test/util/setup_common.h>
+
+#include <map>
+#include <vector>
+
+namespace {
+
+constexpr size_t NUM_CANDIDATES = 100000;
+constexpr uint32_t BLOCK_TIME = 1600000000;
+constexpr uint32_t TIME_STEP = 16;
+constexpr size_t NUM_TIMES = 4;
+
+struct StakeCandidates {
+    CBlockIndex index;
+    std::vector<COutPoint> prevouts;
+    std::map<COutPoint, CStakeCache> cache;
+    unsigned int nBits = 0x1a0fffff;
+
+    StakeCandidates()
+    {
+        FastRandomContext rng(true);
+        index.nHeight = 1000000;
+        index.nStakeModifier = rng.rand256();
+        for (size_t i = 0; i < NUM_CANDIDATES; ++i) {
+            COutPoint prevout(rng.rand256(), rng.randrange(4));
+            prevouts.push_back(prevout);
+            cache.emplace(prevout, CStakeCache(BLOCK_TIME - 100000 - rng.randrange(100000), 1 + rng.randrange(100 * COIN)));
+        }
+    }
+};
+
+} // namespace
+
+static void StakeKernelCache100k(benchmark::Bench& bench)
+{
+    const auto test_setup = MakeNoLogFileContext<const BasicTestingSetup>();
+    StakeCandidates candidates;
+
+    bench.batch(NUM_CANDIDATES * NUM_TIMES).unit("kernel").run([&] {
+        size_t solved = 0;
+        for (size_t t = 0; t < NUM_TIMES; ++t) {
+            for (const COutPoint& prevout : candidates.prevouts) {
+                uint256 hashProofOfStake;
+                solved += CheckKernelCache(&candidates.index, candidates.nBits, BLOCK_TIME + t * TIME_STEP, prevout, candidates.cache, hashProofOfStake);
+            }
+        }
+        ankerl::nanobench::doNotOptimizeAway(solved);
+    });
+}
+
+static void StakeKernelBatch100k(benchmark::Bench& bench)
+{
+    const auto test_setup = MakeNoLogFileContext<const BasicTestingSetup>();
+    StakeCandidates candidates;
+    std::vector<CStakeKernel> kernels;
+    PrepareStakeKernels(&candidates.index, candidates.nBits, candidates.prevouts, candidates.cache, kernels);
+    std::vector<uint32_t> blockTimes;
+    for (size_t t = 0; t < NUM_TIMES; ++t) {
+        blockTimes.push_back(BLOCK_TIME + t * TIME_STEP);
+    }
+
+    bench.batch(NUM_CANDIDATES * NUM_TIMES).unit("kernel").run([&] {
+        std::vector<std::tuple<uint256, uint32_t, const CStakeKernel*>> solved;
+        CheckStakeKernels(kernels, 0, kernels.size(), blockTimes, solved);
+        ankerl::nanobench::doNotOptimizeAway(solved);
+    });
+}
+
+static void StakeKernelPrepare100k(benchmark::Bench& bench)
+{
+    const auto test_setup = MakeNoLogFileContext<const BasicTestingSetup>();
+    StakeCandidates candidates;
+
+    bench.batch(NUM_CANDIDATES).unit("kernel").run([&] {
+        std::vector<CStakeKernel> kernels;
+        PrepareStakeKernels(&candidates.index, candidates.nBits, candidates.prevouts, candidates.cache, kernels);
+        ankerl::nanobench::doNotOptimizeAway(kernels);
+    });
+}
+
+BENCHMARK(StakeKernelCache100k);
+BENCHMARK(StakeKernelBatch100k);
+BENCHMARK(StakeKernelPrepare100k);
@@ -224,6 +224,10 @@ struct Params {
     {
         return nCheckpointSpan <= nRBTCheckpointSpan ? nRBTCheckpointSpan : nCheckpointSpan;
     }
+    int MaxCoinbaseMaturity() const
+    {
+        return nCoinbaseMaturity <= nRBTCoinbaseMaturity ? nRBTCoinbaseMaturity : nCoinbaseMaturity;
+    }
 };
 
 } // namespace Consensus
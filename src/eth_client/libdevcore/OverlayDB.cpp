@@ -4,6 +4,7 @@
 #include <thread>
 #include <libdevcore/db.h>
 #include <libdevcore/Common.h>
+#include "RLP.h"
 #include "SHA3.h"
 #include "OverlayDB.h"
 #include "TrieDB.h"
@@ -27,6 +28,61 @@ inline db::Slice toSlice(bytes const& _b)
     return db::Slice(reinterpret_cast<char const*>(&_b[0]), _b.size());
 }
 
+// The reference counts are kept next to the nodes like the aux data, the other keys are
+// of other sizes than the node hashes.
+bytes refKey(h256 const& _h)
+{
+    bytes b = _h.asBytes();
+    b.push_back(254);   // for reference counts
+    return b;
+}
+
+bytes eraKey(std::string const& _prefix, unsigned _era)
+{
+    bytes b = asBytes(_prefix);
+    for (int i = 3; i >= 0; --i)
+        b.push_back(byte(_era >> (i * 8)));
+    return b;
+}
+
+bytes journalKey(unsigned _era)
+{
+    return eraKey("journal", _era);
+}
+
+// The references of the discarded commits are released apart from the journal, which is removed
+// when its block is disconnected while they stay discarded.
+bytes releaseKey(unsigned _era)
+{
+    return eraKey("release", _era);
+}
+
+// The nodes written by an era, whose references are released with the discarded commits if its block
+// is disconnected.
+bytes writtenKey(unsigned _era)
+{
+    return eraKey("written", _era);
+}
+
+h256s readHashList(db::DatabaseFace const& _db, bytes const& _key)
+{
+    std::string const list = _db.lookup(toSlice(_key));
+    if (list.empty())
+        return h256s();
+    return RLP(list).toVector<h256>();
+}
+
+bytes hashList(h256s const& _hashes)
+{
+    RLPStream s(_hashes.size());
+    for (auto const& h: _hashes)
+        s << h;
+    return s.out();
+}
+
+std::string const c_journalingKey = "journaling";
+std::string const c_prunedKey = "pruned";
+
 }  // namespace
 
 OverlayDB::~OverlayDB() = default;
@@ -44,7 +100,13 @@ void OverlayDB::commit()
             for (auto const& i: m_main)
             {
                 if (i.second.second)
+                {
                     writeBatch->insert(toSlice(i.first), toSlice(i.second.first));
+                    if (m_journaling && addReferences(*writeBatch, i.first, i.second.second))
+                        m_written.insert(m_written.end(), i.second.second, i.first);
+                    if (m_nodeCache)
+                        m_nodeCache->insert(i.first, i.second.first);
+                }
 //              cnote << i.first << "#" << m_main[i.first].second;
             }
             for (auto const& i: m_aux)
@@ -113,13 +175,18 @@ std::string OverlayDB::lookup(h256 const& _h) const
     std::string ret = StateCacheDB::lookup(_h);
     if (!ret.empty() || !m_db)
         return ret;
+    if (m_nodeCache && m_nodeCache->lookup(_h, ret))
+        return ret;
 
-    return m_db->lookup(toSlice(_h));
+    ret = m_db->lookup(toSlice(_h));
+    if (m_nodeCache && !ret.empty())
+        m_nodeCache->insert(_h, ret);
+    return ret;
 }
 
 bool OverlayDB::exists(h256 const& _h) const
 {
-    if (StateCacheDB::exists(_h))
+    if (StateCacheDB::exists(_h) || (m_nodeCache && m_nodeCache->contains(_h)))
         return true;
     return m_db && m_db->exists(toSlice(_h));
 }
@@ -128,7 +195,9 @@ void OverlayDB::kill(h256 const& _h)
 {
     if (!StateCacheDB::kill(_h))
     {
-        if (m_db)
+        if (m_journaling)
+            m_killed.push_back(_h);
+        else if (m_db)
         {
             if (!m_db->exists(toSlice(_h)))
             {
@@ -144,4 +213,164 @@ void OverlayDB::kill(h256 const& _h)
     }
 }
 
+bool OverlayDB::addReferences(db::WriteBatchFace& _batch, h256 const& _h, unsigned _count) const
+{
+    // The empty trie and the nodes written before the journaling are never deleted
+    if (_h == EmptyTrie)
+        return false;
+    bytes const key = refKey(_h);
+    std::string const refs = m_db->lookup(toSlice(key));
+    if (!refs.empty())
+        _count += RLP(refs).toInt<unsigned>();
+    else if (m_db->exists(toSlice(_h)))
+        return false;
+    _batch.insert(toSlice(key), toSlice(rlp(_count)));
+    return true;
+}
+
+void OverlayDB::addWritten(h256s const& _written)
+{
+    if (!m_db || !m_journaling || _written.empty())
+        return;
+    std::unordered_map<h256, unsigned> counts;
+    for (auto const& h: _written)
+        counts[h]++;
+    auto writeBatch = m_db->createWriteBatch();
+    for (auto const& i: counts)
+        if (addReferences(*writeBatch, i.first, i.second))
+            m_written.insert(m_written.end(), i.second, i.first);
+    m_db->commit(std::move(writeBatch));
+}
+
+void OverlayDB::clearJournal()
+{
+    m_killed.clear();
+    m_discarded.insert(m_discarded.end(), m_written.begin(), m_written.end());
+    m_written.clear();
+}
+
+void OverlayDB::setJournaling()
+{
+    if (m_db && !m_db->exists(toSlice(c_journalingKey)))
+        m_db->insert(toSlice(c_journalingKey), toSlice(rlp(1)));
+    m_journaling = true;
+}
+
+bool OverlayDB::journaled() const
+{
+    return m_db && m_db->exists(toSlice(c_journalingKey));
+}
+
+void OverlayDB::writeJournal(unsigned _era)
+{
+    if (!m_db || !m_journaling)
+    {
+        keepWritten();
+        return;
+    }
+    if (!m_killed.empty())
+    {
+        m_db->insert(toSlice(journalKey(_era)), toSlice(hashList(m_killed)));
+        m_killed.clear();
+    }
+    // The nodes written by the era keep their references unless the era is removed
+    if (!m_written.empty())
+    {
+        h256s written = readHashList(*m_db, writtenKey(_era));
+        written.insert(written.end(), m_written.begin(), m_written.end());
+        m_db->insert(toSlice(writtenKey(_era)), toSlice(hashList(written)));
+        keepWritten();
+    }
+    if (!m_discarded.empty())
+    {
+        h256s released = readReleased(_era);
+        released.insert(released.end(), m_discarded.begin(), m_discarded.end());
+        m_db->insert(toSlice(releaseKey(_era)), toSlice(hashList(released)));
+        m_discarded.clear();
+    }
+}
+
+h256s OverlayDB::readJournal(unsigned _era) const
+{
+    if (!m_db)
+        return h256s();
+    return readHashList(*m_db, journalKey(_era));
+}
+
+h256s OverlayDB::readReleased(unsigned _era) const
+{
+    return readHashList(*m_db, releaseKey(_era));
+}
+
+void OverlayDB::removeJournal(unsigned _era)
+{
+    if (!m_db)
+        return;
+    auto writeBatch = m_db->createWriteBatch();
+    writeBatch->kill(toSlice(journalKey(_era)));
+
+    // The nodes written by the era are no longer used by the chain, release them when the era is pruned
+    h256s const written = readHashList(*m_db, writtenKey(_era));
+    if (!written.empty())
+    {
+        h256s released = readReleased(_era);
+        released.insert(released.end(), written.begin(), written.end());
+        writeBatch->insert(toSlice(releaseKey(_era)), toSlice(hashList(released)));
+        writeBatch->kill(toSlice(writtenKey(_era)));
+    }
+    m_db->commit(std::move(writeBatch));
+}
+
+void OverlayDB::prune(unsigned _era)
+{
+    if (!m_db || !m_journaling)
+        return;
+
+    // Release the journals not pruned yet, the first prune only has the journal of its era
+    unsigned from = _era;
+    std::string const pruned = m_db->lookup(toSlice(c_prunedKey));
+    if (!pruned.empty())
+    {
+        unsigned const last = RLP(pruned).toInt<unsigned>();
+        if (last >= _era)
+            return;
+        from = last + 1;
+    }
+
+    auto writeBatch = m_db->createWriteBatch();
+    std::unordered_map<h256, unsigned> released;
+    for (unsigned era = from; era <= _era; ++era)
+    {
+        for (auto const& h: readJournal(era))
+            released[h]++;
+        for (auto const& h: readReleased(era))
+            released[h]++;
+        writeBatch->kill(toSlice(journalKey(era)));
+        writeBatch->kill(toSlice(releaseKey(era)));
+        writeBatch->kill(toSlice(writtenKey(era)));
+    }
+
+    for (auto const& i: released)
+    {
+        if (i.first == EmptyTrie)
+            continue;
+        bytes const key = refKey(i.first);
+        std::string const refs = m_db->lookup(toSlice(key));
+        if (refs.empty())
+            continue;
+        unsigned const count = RLP(refs).toInt<unsigned>();
+        if (count > i.second)
+            writeBatch->insert(toSlice(key), toSlice(rlp(count - i.second)));
+        else
+        {
+            writeBatch->kill(toSlice(key));
+            writeBatch->kill(toSlice(i.first));
+            if (m_nodeCache)
+                m_nodeCache->remove(i.first);
+        }
+    }
+    writeBatch->insert(toSlice(c_prunedKey), toSlice(rlp(_era)));
+    m_db->commit(std::move(writeBatch));
+}
+
 }
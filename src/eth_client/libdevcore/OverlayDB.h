@@ -9,6 +9,7 @@
 #include <libdevcore/Common.h>
 #include <libdevcore/Log.h>
 #include <libdevcore/StateCacheDB.h>
+#include <libdevcore/TrieNodeCache.h>
 
 namespace dev
 {
@@ -41,10 +42,54 @@ public:
 
 	bytes lookupAux(h256 const& _h) const;
 
+	/// Keep the nodes read from and written to the database in @a _cache, which can be shared with other databases.
+	void setNodeCache(std::shared_ptr<TrieNodeCache> const& _cache) { m_nodeCache = _cache; }
+
+	/// Count the references to the nodes written, and journal the nodes killed so they can be
+	/// deleted once no recent root uses them. The database stays journaled once it is set.
+	void setJournaling();
+	bool journaling() const { return m_journaling; }
+	/// @returns true if the database was written with journaling.
+	bool journaled() const;
+
+	/// Write the nodes killed since the journal was last written or cleared as the journal of @a _era,
+	/// and release with it the references of the commits discarded by clearJournal. The nodes written
+	/// since are recorded with the era.
+	void writeJournal(unsigned _era);
+	/// @returns the nodes killed in @a _era.
+	h256s readJournal(unsigned _era) const;
+	/// Drop the nodes killed since the journal was last written, the changes were not kept. The references
+	/// counted by their commits are released with the next journal written, their states are discarded.
+	void clearJournal();
+	/// @returns the nodes killed since the journal was last written or cleared.
+	h256s const& killed() const { return m_killed; }
+	/// Journal nodes killed by changes which were not made through this object, like reused executions.
+	void addKilled(h256s const& _killed) { m_killed.insert(m_killed.end(), _killed.begin(), _killed.end()); }
+	/// @returns the nodes referenced by the commits since the journal was last written or cleared.
+	h256s const& written() const { return m_written; }
+	/// Reference nodes written by changes which were not made through this object, like reused executions.
+	void addWritten(h256s const& _written);
+	/// Keep the references of the commits since the journal was last written, for changes made outside of an era.
+	void keepWritten() { m_written.clear(); }
+	/// Remove the journal of @a _era, when the changes of the era are reverted. The references of the
+	/// nodes written by the era are released when it is pruned.
+	void removeJournal(unsigned _era);
+	/// Release the nodes killed up to @a _era and delete the nodes with no reference left.
+	void prune(unsigned _era);
+
 private:
 	using StateCacheDB::clear;
 
+	bool addReferences(db::WriteBatchFace& _batch, h256 const& _h, unsigned _count) const;
+	h256s readReleased(unsigned _era) const;
+
     std::shared_ptr<db::DatabaseFace> m_db;
+	std::shared_ptr<TrieNodeCache> m_nodeCache;
+
+	bool m_journaling = false;
+	h256s m_killed;
+	h256s m_written;
+	h256s m_discarded;
 };
 
 }
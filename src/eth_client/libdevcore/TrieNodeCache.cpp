@@ -0,0 +1,121 @@
+// Aleth: Ethereum C++ client, tools and libraries.
+// Copyright 2014-2019 Aleth Authors.
+// Licensed under the GNU General Public License, Version 3.
+#include "TrieNodeCache.h"
+
+namespace dev
+{
+namespace
+{
+// Bytes used by an entry besides its value: the list and index nodes and the hash
+size_t const c_entryOverhead = 128;
+}  // namespace
+
+TrieNodeCache::TrieNodeCache(size_t _capacity, unsigned _shards)
+  : m_capacity(_capacity),
+    m_shardCount(_shards ? _shards : 1),
+    m_shardCapacity(_capacity / m_shardCount),
+    m_shards(new Shard[m_shardCount])
+{}
+
+bool TrieNodeCache::lookup(h256 const& _h, std::string& o_value)
+{
+    Shard& s = shard(_h);
+    Guard l(s.x);
+    auto it = s.index.find(_h);
+    if (it == s.index.end())
+    {
+        m_misses++;
+        return false;
+    }
+    s.entries.splice(s.entries.begin(), s.entries, it->second);
+    o_value = it->second->second;
+    m_hits++;
+    return true;
+}
+
+bool TrieNodeCache::contains(h256 const& _h) const
+{
+    Shard& s = shard(_h);
+    Guard l(s.x);
+    return s.index.count(_h);
+}
+
+void TrieNodeCache::insert(h256 const& _h, std::string const& _value)
+{
+    // Large values like code would push out many nodes
+    size_t const entrySize = _value.size() + c_entryOverhead;
+    if (entrySize > m_shardCapacity / 8)
+        return;
+
+    Shard& s = shard(_h);
+    Guard l(s.x);
+    auto it = s.index.find(_h);
+    if (it != s.index.end())
+    {
+        s.entries.splice(s.entries.begin(), s.entries, it->second);
+        return;
+    }
+    s.entries.emplace_front(_h, _value);
+    s.index.emplace(_h, s.entries.begin());
+    s.size += entrySize;
+    evict(s);
+}
+
+void TrieNodeCache::remove(h256 const& _h)
+{
+    Shard& s = shard(_h);
+    Guard l(s.x);
+    auto it = s.index.find(_h);
+    if (it == s.index.end())
+        return;
+    s.size -= it->second->second.size() + c_entryOverhead;
+    s.entries.erase(it->second);
+    s.index.erase(it);
+}
+
+void TrieNodeCache::clear()
+{
+    for (unsigned i = 0; i < m_shardCount; ++i)
+    {
+        Guard l(m_shards[i].x);
+        m_shards[i].entries.clear();
+        m_shards[i].index.clear();
+        m_shards[i].size = 0;
+    }
+}
+
+size_t TrieNodeCache::size() const
+{
+    size_t ret = 0;
+    for (unsigned i = 0; i < m_shardCount; ++i)
+    {
+        Guard l(m_shards[i].x);
+        ret += m_shards[i].size;
+    }
+    return ret;
+}
+
+size_t TrieNodeCache::count() const
+{
+    size_t ret = 0;
+    for (unsigned i = 0; i < m_shardCount; ++i)
+    {
+        Guard l(m_shards[i].x);
+        ret += m_shards[i].index.size();
+    }
+    return ret;
+}
+
+void TrieNodeCache::evict(Shard& _shard)
+{
+    while (_shard.size > m_shardCapacity && !_shard.entries.empty())
+    {
+        auto const& last = _shard.entries.back();
+        _shard.size -= last.second.size() + c_entryOverhead;
+        _shard.index.erase(last.first);
+        _shard.entries.pop_back();
+    }
+}
+
+}
@@ -0,0 +1,64 @@
+// Aleth: Ethereum C++ client, tools and libraries.
+// Copyright 2014-2019 Aleth Authors.
+// Licensed under the GNU General Public License, Version 3.
+#pragma once
+
+#include "Common.h"
+#include "FixedHash.h"
+#include "Guards.h"
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+namespace dev
+{
+
+/**
+ * @brief Least recently used cache of the committed trie nodes, keyed by node hash and bounded in bytes.
+ * It is split in shards with a lock each, so the databases sharing it can read it from several threads.
+ */
+class TrieNodeCache
+{
+public:
+    explicit TrieNodeCache(size_t _capacity, unsigned _shards = 16);
+
+    /// @returns true and sets @a o_value if the node is in the cache.
+    bool lookup(h256 const& _h, std::string& o_value);
+    bool contains(h256 const& _h) const;
+    void insert(h256 const& _h, std::string const& _value);
+    void remove(h256 const& _h);
+    void clear();
+
+    /// @returns the maximum number of bytes used by the nodes.
+    size_t capacity() const { return m_capacity; }
+    /// @returns the number of bytes used by the nodes.
+    size_t size() const;
+    size_t count() const;
+    uint64_t hits() const { return m_hits; }
+    uint64_t misses() const { return m_misses; }
+
+private:
+    using Entries = std::list<std::pair<h256, std::string>>;
+
+    struct Shard
+    {
+        mutable Mutex x;
+        Entries entries;    ///< Most recently used first.
+        std::unordered_map<h256, Entries::iterator> index;
+        size_t size = 0;
+    };
+
+    Shard& shard(h256 const& _h) const { return m_shards[_h[0] % m_shardCount]; }
+    void evict(Shard& _shard);
+
+    size_t const m_capacity;
+    unsigned const m_shardCount;
+    size_t const m_shardCapacity;
+    std::unique_ptr<Shard[]> m_shards;
+    std::atomic<uint64_t> m_hits{0};
+    std::atomic<uint64_t> m_misses{0};
+};
+
+}
@@ -5,6 +5,7 @@
 
 #include "Account.h"
 #include "SecureTrieDB.h"
+#include "StateSnapshotFace.h"
 #include "ValidationSchemes.h"
 #include <libdevcore/JsonUtils.h>
 #include <libdevcore/OverlayDB.h>
@@ -38,16 +39,25 @@ void Account::resetCode()
     m_version = 0;
 }
 
-u256 Account::originalStorageValue(u256 const& _key, OverlayDB const& _db) const
+u256 Account::originalStorageValue(u256 const& _key, OverlayDB const& _db, Address const& _address, StateSnapshotFace const* _snapshot) const
 {
     auto it = m_storageOriginal.find(_key);
     if (it != m_storageOriginal.end())
         return it->second;
 
-    // Not in the original values cache - go to the DB.
-    SecureTrieDB<h256, OverlayDB> const memdb(const_cast<OverlayDB*>(&_db), m_storageRoot);
-    std::string const payload = memdb.at(_key);
-    auto const value = payload.size() ? RLP(payload).toInt<u256>() : 0;
+    u256 value;
+    if (_snapshot)
+    {
+        // The snapshot holds the storage of the root the account was loaded from, unless the storage was cleared since
+        value = m_storageRoot == EmptyTrie ? 0 : _snapshot->storage(_address, _key);
+    }
+    else
+    {
+        // Not in the original values cache - go to the DB.
+        SecureTrieDB<h256, OverlayDB> const memdb(const_cast<OverlayDB*>(&_db), m_storageRoot);
+        std::string const payload = memdb.at(_key);
+        value = payload.size() ? RLP(payload).toInt<u256>() : 0;
+    }
     m_storageOriginal[_key] = value;
     return value;
 }
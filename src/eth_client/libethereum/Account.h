@@ -19,6 +19,8 @@ class OverlayDB;
 namespace eth
 {
 
+class StateSnapshotFace;
+
 /**
  * Models the state of a single Ethereum account.
  * Used to cache a portion of the full Ethereum state. State keeps a mapping of Address's to Accounts.
@@ -122,18 +124,20 @@ public:
 
     /// @returns account's storage value corresponding to the @_key
     /// taking into account overlayed modifications
-    u256 storageValue(u256 const& _key, OverlayDB const& _db) const
+    u256 storageValue(u256 const& _key, OverlayDB const& _db, Address const& _address = Address(), StateSnapshotFace const* _snapshot = nullptr) const
     {
         auto mit = m_storageOverlay.find(_key);
         if (mit != m_storageOverlay.end())
             return mit->second;
 
-        return originalStorageValue(_key, _db);
+        return originalStorageValue(_key, _db, _address, _snapshot);
     }
 
     /// @returns account's original storage value corresponding to the @_key
-    /// not taking into account overlayed modifications
-    u256 originalStorageValue(u256 const& _key, OverlayDB const& _db) const;
+    /// not taking into account overlayed modifications.
+    /// The value is read from @a _snapshot instead of the storage trie when given, it must hold the
+    /// state the account at @a _address was loaded from.
+    u256 originalStorageValue(u256 const& _key, OverlayDB const& _db, Address const& _address = Address(), StateSnapshotFace const* _snapshot = nullptr) const;
 
     /// @returns the storage overlay as a simple hash map.
     std::unordered_map<u256, u256> const& storageOverlay() const { return m_storageOverlay; }
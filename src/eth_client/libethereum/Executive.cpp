@@ -34,7 +34,7 @@ u256 Executive::gasUsed() const
 void Executive::accrueSubState(SubState& _parentContext)
 {
     if (m_ext)
-        _parentContext += m_ext->sub;
+        _parentContext += std::move(m_ext->sub);
 }
 
 void Executive::initialize(Transaction const& _transaction)
@@ -329,7 +329,7 @@ bool Executive::go(OnOpFunc const& _onOp)
                 }
                 if (m_res)
                     m_res->output = out.toVector(); // copy output to execution result
-                m_s.setCode(m_ext->myAddress, out.toVector(), m_ext->version);
+                m_s.setCode(m_ext->myAddress, out.takeBytes(), m_ext->version);
             }
             else
                 m_output = vm->exec(m_gas, *m_ext, _onOp);
@@ -373,8 +373,8 @@ bool Executive::go(OnOpFunc const& _onOp)
         }
 
         if (m_res && m_output)
-            // Copy full output:
-            m_res->output = m_output.toVector();
+            // The output of the outermost call is only used by the result
+            m_res->output = m_output.takeBytes();
 
 #if ETH_TIMED_EXECUTIONS
         cnote << "VM took:" << t.elapsed() << "; gas used: " << (sgas - m_endGas);
@@ -412,7 +412,7 @@ bool Executive::finalize()
 
     // Logs...
     if (m_ext)
-        m_logs = m_ext->sub.logs;
+        m_logs = std::move(m_ext->sub.logs);
 
     if (m_res) // Collect results
     {
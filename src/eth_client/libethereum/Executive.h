@@ -68,6 +68,8 @@ public:
     /// @returns the log entries created by this operation.
     /// @warning Only valid after finalise().
     LogEntries const& logs() const { return m_logs; }
+    /// Moves the log entries out, for the receipt of the transaction.
+    LogEntries takeLogs() { return std::move(m_logs); }
     /// @returns total gas used in the transaction/operation.
     /// @warning Only valid after finalise().
     u256 gasUsed() const;
@@ -101,10 +101,18 @@ OverlayDB State::openDB(fs::path const& _basePath, h256 const& _genesisHash, Wit
 
 void State::populateFrom(AccountMap const& _map)
 {
+    // The accounts are written to the trie directly, the snapshot can not follow them
+    m_snapshotInSync = false;
     eth::commit(_map, m_state);
     commit(State::CommitBehaviour::KeepEmptyAccounts);
 }
 
+void State::setSnapshot(std::shared_ptr<StateSnapshotFace> const& _snapshot)
+{
+    m_snapshot = _snapshot;
+    m_snapshotInSync = m_snapshot && m_snapshot->root() == m_state.root();
+}
+
 u256 const& State::requireAccountStartNonce() const
 {
     if (m_accountStartNonce == Invalid256)
@@ -147,6 +155,8 @@ State& State::operator=(State const& _s)
     m_touched = _s.m_touched;
     m_unrevertablyTouched = _s.m_unrevertablyTouched;
     m_accountStartNonce = _s.m_accountStartNonce;
+    m_snapshot.reset();
+    m_snapshotInSync = false;
     return *this;
 }
 
@@ -157,6 +167,9 @@ Account const* State::account(Address const& _a) const
 
 Account* State::account(Address const& _addr)
 {
+    if (m_recordAccessed)
+        m_accessedAccounts.insert(_addr);
+
     auto it = m_cache.find(_addr);
     if (it != m_cache.end())
         return &it->second;
@@ -165,7 +178,8 @@ Account* State::account(Address const& _addr)
         return nullptr;
 
     // Populate basic info.
-    string stateBack = m_state.at(_addr);
+    StateSnapshotFace const* snap = snapshot();
+    string stateBack = snap ? snap->account(_addr) : m_state.at(_addr);
     if (stateBack.empty())
     {
         m_nonExistingAccountsCache.insert(_addr);
@@ -211,7 +225,17 @@ void State::commit(CommitBehaviour _commitBehaviour)
 {
     if (_commitBehaviour == CommitBehaviour::RemoveEmptyAccounts)
         removeEmptyAccounts();
+    if (m_recordCommitted)
+    {
+        for (auto const& i : m_cache)
+            if (i.second.isDirty())
+                m_committedAccounts.insert(i.first);
+    }
     m_touched += dev::eth::commit(m_cache, m_state);
+    if (m_snapshotInSync)
+        m_snapshot->commit(m_state.root(), m_cache, m_state);
+    else if (m_snapshot)
+        m_snapshotInSync = m_snapshot->root() == m_state.root();
     m_changeLog.clear();
     m_cache.clear();
     m_unchangedCacheEntries.clear();
@@ -291,11 +315,18 @@ std::pair<State::AddressMap, h256> State::addresses(
 
 void State::setRoot(h256 const& _r)
 {
+    if (m_recordCommitted && _r != m_state.root())
+        m_rootReplaced = true;
     m_cache.clear();
     m_unchangedCacheEntries.clear();
     m_nonExistingAccountsCache.clear();
 //  m_touched.clear();
     m_state.setRoot(_r);
+    if (m_snapshot)
+    {
+        m_snapshot->setRoot(_r);
+        m_snapshotInSync = m_snapshot->root() == _r;
+    }
 }
 
 bool State::addressInUse(Address const& _id) const
@@ -432,7 +463,7 @@ u256 State::getNonce(Address const& _addr) const
 u256 State::storage(Address const& _id, u256 const& _key) const
 {
     if (Account const* a = account(_id))
-        return a->storageValue(_key, m_db);
+        return a->storageValue(_key, m_db, _id, snapshot());
     else
         return 0;
 }
@@ -446,7 +477,7 @@ void State::setStorage(Address const& _contract, u256 const& _key, u256 const& _
 u256 State::originalStorageValue(Address const& _contract, u256 const& _key) const
 {
     if (Account const* a = account(_contract))
-        return a->originalStorageValue(_key, m_db);
+        return a->originalStorageValue(_key, m_db, _contract, snapshot());
     else
         return 0;
 }
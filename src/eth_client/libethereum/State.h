@@ -6,6 +6,7 @@
 
 #include "Account.h"
 #include "SecureTrieDB.h"
+#include "StateSnapshotFace.h"
 #include "Transaction.h"
 #include "TransactionReceipt.h"
 #include <libdevcore/Common.h>
@@ -175,6 +176,10 @@ public:
     /// Populate the state from the given AccountMap. Just uses dev::eth::commit().
     void populateFrom(AccountMap const& _map);
 
+    /// Read the accounts and storage from @a _snapshot while the state is at the snapshot root, and apply
+    /// the commits made from that root to it. Copies of the state do not share the snapshot.
+    void setSnapshot(std::shared_ptr<StateSnapshotFace> const& _snapshot);
+
     /// @returns the set containing all addresses currently in use in Ethereum.
     /// @warning This is slowslowslow. Don't use it unless you want to lock the object for seconds or minutes at a time.
     /// @throws InterfaceNotSupported if compiled without ETH_FATDB.
@@ -310,6 +315,17 @@ public:
 
     ChangeLog const& changeLog() const { return m_changeLog; }
 
+    /// Records the addresses of the accounts accessed from now on when @a _record is set, including
+    /// the accounts which do not exist. The addresses recorded before are dropped.
+    void recordAccessedAccounts(bool _record) { m_recordAccessed = _record; m_accessedAccounts.clear(); }
+    std::set<Address> const& accessedAccounts() const { return m_accessedAccounts; }
+
+    /// Records the addresses of the accounts committed from now on when @a _record is set, and whether
+    /// the root was set meanwhile. The addresses recorded before are dropped.
+    void recordCommittedAccounts(bool _record) { m_recordCommitted = _record; m_committedAccounts.clear(); m_rootReplaced = false; }
+    std::set<Address> const& committedAccounts() const { return m_committedAccounts; }
+    bool rootReplaced() const { return m_rootReplaced; }
+
     virtual ~State(){}
 
 protected:
@@ -327,6 +343,9 @@ protected:
     /// Purges non-modified entries in m_cache if it grows too large.
     void clearCacheIfTooLarge() const;
 
+    /// @returns the snapshot if it holds the current state root, null otherwise.
+    StateSnapshotFace const* snapshot() const { return m_snapshotInSync ? m_snapshot.get() : nullptr; }
+
     void createAccount(Address const& _address, Account const&& _account);
 
     /// @returns true when normally halted; false when exceptionally halted; throws when internal VM
@@ -351,6 +370,16 @@ protected:
 
     u256 m_accountStartNonce;
 
+    /// Flat copy of the accounts and storage, used while it is at the same root as m_state.
+    std::shared_ptr<StateSnapshotFace> m_snapshot;
+    bool m_snapshotInSync = false;
+
+    bool m_recordAccessed = false;
+    std::set<Address> m_accessedAccounts;
+    bool m_recordCommitted = false;
+    std::set<Address> m_committedAccounts;
+    bool m_rootReplaced = false;
+
     friend std::ostream& operator<<(std::ostream& _out, State const& _s);
     ChangeLog m_changeLog;
 };
@@ -0,0 +1,46 @@
+// Aleth: Ethereum C++ client, tools and libraries.
+// Copyright 2014-2019 Aleth Authors.
+// Licensed under the GNU General Public License, Version 3.
+
+/// @file
+/// Interface for a flat snapshot of the accounts and storage of the state
+#pragma once
+
+#include "Account.h"
+#include "SecureTrieDB.h"
+#include <libdevcore/OverlayDB.h>
+
+
+namespace dev
+{
+
+namespace eth
+{
+
+/**
+* @brief Interface for a flat copy of the accounts and storage of the state at one root,
+* keyed by address and by address and slot, read before the state trie.
+*/
+class StateSnapshotFace
+{
+public:
+	virtual ~StateSnapshotFace() {}
+
+	/// @returns the root of the state the snapshot holds the accounts of
+	virtual h256 root() const = 0;
+
+	/// @returns the RLP of the account as stored in the state trie, or an empty string if it does not exist
+	virtual std::string account(Address const& _address) const = 0;
+
+	/// @returns the value of the storage slot @a _key of the account, zero if it is not set
+	virtual u256 storage(Address const& _address, u256 const& _key) const = 0;
+
+	/// Apply the accounts of @a _cache which were committed from the snapshot root to @a _state, of root @a _root
+	virtual void commit(h256 const& _root, std::unordered_map<Address, Account> const& _cache, SecureTrieDB<Address, OverlayDB> const& _state) = 0;
+
+	/// Drop the changes committed after @a _root, when the snapshot went through that root
+	virtual void setRoot(h256 const& _root) = 0;
+};
+
+}
+}
@@ -35,18 +35,18 @@ TransactionReceipt::TransactionReceipt(bytesConstRef _rlp)
 
 }
 
-TransactionReceipt::TransactionReceipt(h256 const& _root, u256 const& _gasUsed, LogEntries const& _log):
+TransactionReceipt::TransactionReceipt(h256 const& _root, u256 const& _gasUsed, LogEntries _log):
 	m_statusCodeOrStateRoot(_root),
 	m_gasUsed(_gasUsed),
 	m_bloom(eth::bloom(_log)),
-	m_log(_log)
+	m_log(std::move(_log))
 {}
 
-TransactionReceipt::TransactionReceipt(uint8_t _status, u256 const& _gasUsed, LogEntries const& _log):
+TransactionReceipt::TransactionReceipt(uint8_t _status, u256 const& _gasUsed, LogEntries _log):
 	m_statusCodeOrStateRoot(_status),
 	m_gasUsed(_gasUsed),
 	m_bloom(eth::bloom(_log)),
-	m_log(_log)
+	m_log(std::move(_log))
 {}
 
 void TransactionReceipt::streamRLP(RLPStream& _s) const
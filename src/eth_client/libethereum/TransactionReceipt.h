@@ -24,8 +24,8 @@ class TransactionReceipt
 {
 public:
 	TransactionReceipt(bytesConstRef _rlp);
-	TransactionReceipt(h256 const& _root, u256 const& _gasUsed, LogEntries const& _log);
-	TransactionReceipt(uint8_t _status, u256 const& _gasUsed, LogEntries const& _log);
+	TransactionReceipt(h256 const& _root, u256 const& _gasUsed, LogEntries _log);
+	TransactionReceipt(uint8_t _status, u256 const& _gasUsed, LogEntries _log);
 
 	/// @returns true if the receipt has a status code.  Otherwise the receipt has a state root (pre-EIP658).
 	bool hasStatusCode() const;
@@ -38,6 +38,8 @@ public:
 	u256 const& cumulativeGasUsed() const { return m_gasUsed; }
 	LogBloom const& bloom() const { return m_bloom; }
 	LogEntries const& log() const { return m_log; }
+	/// Moves the log entries out, the bloom is kept.
+	LogEntries takeLog() { return std::move(m_log); }
 
 	void streamRLP(RLPStream& _s) const;
 
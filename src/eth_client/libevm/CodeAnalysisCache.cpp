@@ -0,0 +1,121 @@
+// Aleth: Ethereum C++ client, tools and libraries.
+// Copyright 2014-2019 Aleth Authors.
+// Licensed under the GNU General Public License, Version 3.
+#include "CodeAnalysisCache.h"
+
+#include <evmone/lib/evmone/analysis.hpp>
+
+namespace dev
+{
+namespace eth
+{
+namespace
+{
+// Bytes used by an entry besides its analysis: the list and index nodes and the analysis object
+size_t const c_entryOverhead = 128 + sizeof(evmone::AdvancedCodeAnalysis);
+
+size_t analysisSize(evmone::AdvancedCodeAnalysis const& _analysis)
+{
+    return _analysis.instrs.capacity() * sizeof(_analysis.instrs[0]) +
+           _analysis.push_values.capacity() * sizeof(_analysis.push_values[0]) +
+           _analysis.jumpdest_offsets.capacity() * sizeof(_analysis.jumpdest_offsets[0]) +
+           _analysis.jumpdest_targets.capacity() * sizeof(_analysis.jumpdest_targets[0]) +
+           c_entryOverhead;
+}
+}  // namespace
+
+CodeAnalysisCache::CodeAnalysisCache(size_t _capacity, unsigned _shards)
+  : m_capacity(_capacity), m_shardCount(_shards ? _shards : 1), m_shards(new Shard[m_shardCount])
+{}
+
+CodeAnalysisCache::AnalysisPtr CodeAnalysisCache::get(
+    h256 const& _codeHash, evmc_revision _rev, bytesConstRef _code)
+{
+    Key const key{_codeHash, _rev};
+    Shard& s = shard(_codeHash);
+    {
+        Guard l(s.x);
+        auto it = s.index.find(key);
+        if (it != s.index.end())
+        {
+            s.entries.splice(s.entries.begin(), s.entries, it->second.first);
+            m_hits++;
+            return it->second.first->second;
+        }
+    }
+    m_misses++;
+
+    // The code is analysed without the lock, another thread may add the same analysis meanwhile
+    AnalysisPtr analysis =
+        std::make_shared<evmone::AdvancedCodeAnalysis const>(evmone::analyze(_rev, _code.data(), _code.size()));
+    size_t const shardCapacity = m_capacity / m_shardCount;
+    size_t const entrySize = analysisSize(*analysis);
+    if (entrySize > shardCapacity / 8)
+        return analysis;
+
+    Guard l(s.x);
+    if (s.index.count(key))
+        return analysis;
+    s.entries.emplace_front(key, analysis);
+    s.index.emplace(key, std::make_pair(s.entries.begin(), entrySize));
+    s.size += entrySize;
+    evict(s, shardCapacity);
+    return analysis;
+}
+
+void CodeAnalysisCache::clear()
+{
+    for (unsigned i = 0; i < m_shardCount; ++i)
+    {
+        Guard l(m_shards[i].x);
+        m_shards[i].entries.clear();
+        m_shards[i].index.clear();
+        m_shards[i].size = 0;
+    }
+}
+
+void CodeAnalysisCache::setCapacity(size_t _capacity)
+{
+    m_capacity = _capacity;
+    for (unsigned i = 0; i < m_shardCount; ++i)
+    {
+        Guard l(m_shards[i].x);
+        evict(m_shards[i], _capacity / m_shardCount);
+    }
+}
+
+size_t CodeAnalysisCache::size() const
+{
+    size_t ret = 0;
+    for (unsigned i = 0; i < m_shardCount; ++i)
+    {
+        Guard l(m_shards[i].x);
+        ret += m_shards[i].size;
+    }
+    return ret;
+}
+
+size_t CodeAnalysisCache::count() const
+{
+    size_t ret = 0;
+    for (unsigned i = 0; i < m_shardCount; ++i)
+    {
+        Guard l(m_shards[i].x);
+        ret += m_shards[i].index.size();
+    }
+    return ret;
+}
+
+void CodeAnalysisCache::evict(Shard& _shard, size_t _capacity)
+{
+    while (_shard.size > _capacity && !_shard.entries.empty())
+    {
+        auto it = _shard.index.find(_shard.entries.back().first);
+        _shard.size -= it->second.second;
+        _shard.index.erase(it);
+        _shard.entries.pop_back();
+    }
+}
+
+}  // namespace eth
+}  // namespace dev
@@ -0,0 +1,79 @@
+// Aleth: Ethereum C++ client, tools and libraries.
+// Copyright 2014-2019 Aleth Authors.
+// Licensed under the GNU General Public License, Version 3.
+#pragma once
+
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+
+#include <evmc/evmc.h>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+namespace evmone
+{
+struct AdvancedCodeAnalysis;
+}
+
+namespace dev
+{
+namespace eth
+{
+/**
+ * @brief Least recently used cache of the evmone code analyses, keyed by code hash and revision and
+ * bounded in bytes. The analyses are shared with the executions using them, so an evicted analysis
+ * stays valid until they end. It is split in shards with a lock each, like the trie node cache.
+ */
+class CodeAnalysisCache
+{
+public:
+    using AnalysisPtr = std::shared_ptr<evmone::AdvancedCodeAnalysis const>;
+
+    explicit CodeAnalysisCache(size_t _capacity, unsigned _shards = 16);
+
+    /// @returns the analysis of @a _code, analysing it when it is not in the cache.
+    AnalysisPtr get(h256 const& _codeHash, evmc_revision _rev, bytesConstRef _code);
+    void clear();
+
+    /// Sets the maximum number of bytes used by the analyses, 0 disables the cache.
+    void setCapacity(size_t _capacity);
+    size_t capacity() const { return m_capacity; }
+    /// @returns the number of bytes used by the analyses.
+    size_t size() const;
+    size_t count() const;
+    uint64_t hits() const { return m_hits; }
+    uint64_t misses() const { return m_misses; }
+
+private:
+    using Key = std::pair<h256, evmc_revision>;
+    using Entries = std::list<std::pair<Key, AnalysisPtr>>;
+
+    struct KeyHash
+    {
+        size_t operator()(Key const& _k) const { return std::hash<h256>()(_k.first) ^ _k.second; }
+    };
+
+    struct Shard
+    {
+        mutable Mutex x;
+        Entries entries;    ///< Most recently used first.
+        std::unordered_map<Key, std::pair<Entries::iterator, size_t>, KeyHash> index;
+        size_t size = 0;
+    };
+
+    Shard& shard(h256 const& _h) const { return m_shards[_h[0] % m_shardCount]; }
+    void evict(Shard& _shard, size_t _capacity);
+
+    std::atomic<size_t> m_capacity;
+    unsigned const m_shardCount;
+    std::unique_ptr<Shard[]> m_shards;
+    std::atomic<uint64_t> m_hits{0};
+    std::atomic<uint64_t> m_misses{0};
+};
+
+}  // namespace eth
+}  // namespace dev
@@ -6,6 +6,9 @@
 #include <libdevcore/Log.h>
 #include <libevm/VMFactory.h>
 
+#include <evmone/lib/evmone/analysis.hpp>
+#include <evmone/lib/evmone/execution.hpp>
+
 namespace dev
 {
 namespace eth
@@ -37,7 +40,7 @@ evmc_revision toRevision(EVMSchedule const& _schedule) noexcept
 }  // namespace
 
 EVMC::EVMC(evmc_vm* _vm, std::vector<std::pair<std::string, std::string>> const& _options) noexcept
-  : evmc::VM(_vm)
+  : evmc::VM(_vm), m_useAnalysisCache(_options.empty())
 {
     assert(_vm != nullptr);
     assert(is_abi_compatible());
@@ -86,19 +89,29 @@ owning_bytes_ref EVMC::exec(u256& io_gas, ExtVMFace& _ext, const OnOpFunc& _onOp
         toEvmC(_ext.caller), _ext.data.data(), _ext.data.size(), toEvmC(_ext.value),
         toEvmC(0x0_cppui256)};
     EvmCHost host{_ext};
-    auto r = execute(host, mode, msg, _ext.code.data(), _ext.code.size());
-    // FIXME: Copy the output for now, but copyless version possible.
-    auto output = owning_bytes_ref{{&r.output_data[0], &r.output_data[r.output_size]}, 0, r.output_size};
+    evmc::result r{evmc_result{}};
+    if (m_useAnalysisCache && !_ext.isCreate && _ext.codeHash)
+    {
+        // The analysis of the deployed code is reused by the next calls to it, not the init code
+        auto analysis = analysisCache().get(_ext.codeHash, mode, &_ext.code);
+        evmone::AdvancedExecutionState state{
+            msg, mode, host.get_interface(), host.to_context(), _ext.code.data(), _ext.code.size()};
+        r = evmc::result{evmone::execute(state, *analysis)};
+    }
+    else
+        r = execute(host, mode, msg, _ext.code.data(), _ext.code.size());
+    auto const status = r.status_code;
+    auto const gasLeft = r.gas_left;
 
-    switch (r.status_code)
+    switch (status)
     {
     case EVMC_SUCCESS:
-        io_gas = r.gas_left;
-        return output;
+        io_gas = gasLeft;
+        return owning_bytes_ref{std::move(r)};
 
     case EVMC_REVERT:
-        io_gas = r.gas_left;
-        throw RevertInstruction{std::move(output)};
+        io_gas = gasLeft;
+        throw RevertInstruction{owning_bytes_ref{std::move(r)}};
 
     case EVMC_OUT_OF_GAS:
     case EVMC_FAILURE:
@@ -129,13 +142,19 @@ owning_bytes_ref EVMC::exec(u256& io_gas, ExtVMFace& _ext, const OnOpFunc& _onOp
     case EVMC_REJECTED:
     case EVMC_INTERNAL_ERROR:
     default:
-        if (r.status_code <= EVMC_INTERNAL_ERROR)
-            BOOST_THROW_EXCEPTION(InternalVMError{} << errinfo_evmcStatusCode(r.status_code));
+        if (status <= EVMC_INTERNAL_ERROR)
+            BOOST_THROW_EXCEPTION(InternalVMError{} << errinfo_evmcStatusCode(status));
         else
             // These cases aren't really internal errors, just more specific
             // error codes returned by the VM. Map all of them to OOG.
             BOOST_THROW_EXCEPTION(OutOfGas());
     }
 }
+
+CodeAnalysisCache& EVMC::analysisCache()
+{
+    static CodeAnalysisCache s_cache{c_defaultCodeAnalysisCacheSize};
+    return s_cache;
+}
 }  // namespace eth
 }  // namespace dev
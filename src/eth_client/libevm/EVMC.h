@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <libevm/CodeAnalysisCache.h>
 #include <libevm/VMFace.h>
 #include <string>
 #include <utility>
@@ -13,6 +14,9 @@ namespace dev
 {
 namespace eth
 {
+/// Default size of the code analysis cache, in bytes.
+constexpr size_t c_defaultCodeAnalysisCacheSize = 32 * 1024 * 1024;
+
 /// The wrapper implementing the VMFace interface with a EVMC VM as a backend.
 class EVMC : public evmc::VM, public VMFace
 {
@@ -20,6 +24,13 @@ public:
     EVMC(evmc_vm* _vm, std::vector<std::pair<std::string, std::string>> const& _options) noexcept;
 
     owning_bytes_ref exec(u256& io_gas, ExtVMFace& _ext, OnOpFunc const& _onOp) final;
+
+    /// @returns the cache of the code analyses shared by the instances, used when no EVMC
+    /// option is set since the options may select another interpreter or a tracer.
+    static CodeAnalysisCache& analysisCache();
+
+private:
+    bool m_useAnalysisCache;
 };
 }  // namespace eth
 }  // namespace dev
@@ -54,20 +54,33 @@ public:
         retarget(&m_bytes[_begin], _size);
     }
 
+    /// References the output of an EVMC result, which is released with this object.
+    explicit owning_bytes_ref(evmc::result&& _result) : m_result(std::move(_result))
+    {
+        retarget(m_result->output_data, m_result->output_size);
+    }
+
     owning_bytes_ref(owning_bytes_ref const&) = delete;
     owning_bytes_ref(owning_bytes_ref&&) = default;
     owning_bytes_ref& operator=(owning_bytes_ref const&) = delete;
     owning_bytes_ref& operator=(owning_bytes_ref&&) = default;
 
     /// Moves the bytes vector out of here. The object cannot be used any more.
+    /// The output of an EVMC result is copied, since it is not held in a vector.
     bytes&& takeBytes()
     {
+        if (m_result)
+        {
+            m_bytes = toBytes();
+            m_result.reset();
+        }
         reset();  // Reset reference just in case.
         return std::move(m_bytes);
     }
 
 private:
     bytes m_bytes;
+    boost::optional<evmc::result> m_result;
 };
 
 struct SubState
@@ -84,6 +97,17 @@ struct SubState
         return *this;
     }
 
+    /// Moves the logs of a finished sub-call instead of copying them.
+    SubState& operator+=(SubState&& _s)
+    {
+        selfdestructs += _s.selfdestructs;
+        refunds += _s.refunds;
+        logs.insert(logs.end(), std::make_move_iterator(_s.logs.begin()),
+            std::make_move_iterator(_s.logs.end()));
+        _s.logs.clear();
+        return *this;
+    }
+
     void clear()
     {
         selfdestructs.clear();
@@ -0,0 +1,590 @@
+#include <index/addressindex.h>
+
+#include <chainparams.h>
+#include <node/blockstorage.h>
+#include <node/ui_interface.h>
+#include <script/standard.h>
+#include <shutdown.h>
+#include <undo.h>
+#include <util/system.h>
+#include <util/translation.h>
+#include <validation.h>
+
+constexpr uint8_t DB_BEST_BLOCK{'B'};
+constexpr uint8_t DB_ADDRESSINDEX{'a'};
+constexpr uint8_t DB_ADDRESSUNSPENTINDEX{'u'};
+constexpr uint8_t DB_TIMESTAMPINDEX{'S'};
+constexpr uint8_t DB_BLOCKHASHINDEX{'z'};
+constexpr uint8_t DB_SPENTINDEX{'p'};
+constexpr uint8_t DB_ADDRESSWEIGHTINDEX{'w'};
+
+/** Block tree DB key of the locator the legacy index was in sync with, while it is migrated */
+constexpr uint8_t DB_ADDRESSINDEX_BLOCK{'A'};
+
+std::unique_ptr<AddressIndex> g_address_index;
+
+namespace {
+
+/** Outputs created below this height are never immature again, their value is only counted in the total */
+int AddressWeightRecentHeight(int height) {
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    return height - consensusParams.MaxCoinbaseMaturity() - consensusParams.MaxCheckpointSpan();
+}
+
+void UpdateAddressWeight(CAddressWeightValue& weight, const CAddressUnspentValue& value, bool fAdd, int height) {
+    CAmount amount = fAdd ? value.satoshis : -value.satoshis;
+    weight.total += amount;
+    if (value.blockHeight > AddressWeightRecentHeight(height)) {
+        CAmount& recent = weight.recent[value.blockHeight];
+        recent += amount;
+        if (recent == 0)
+            weight.recent.erase(value.blockHeight);
+    }
+}
+
+/** Get the index type and hash of the address an output pays to */
+bool GetAddressKey(const COutPoint& prevout, const CScript& scriptPubKey, int& type, uint256& hashBytes)
+{
+    CTxDestination dest;
+    if (!ExtractDestination(prevout, scriptPubKey, dest))
+        return false;
+    valtype bytesID(std::visit(DataVisitor(), dest));
+    if (bytesID.empty())
+        return false;
+    valtype addressBytes(32);
+    std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
+    type = dest.index();
+    hashBytes = uint256(addressBytes);
+    return true;
+}
+
+/** Move the entries with the given prefix from the block tree DB to the address index DB */
+template <typename K, typename V>
+bool MigrateEntries(CDBWrapper& newdb, CDBWrapper& olddb, uint8_t prefix, bool& interrupted)
+{
+    const size_t batch_size = 1 << 24; // 16 MiB
+    CDBBatch batch_newdb(newdb);
+    CDBBatch batch_olddb(olddb);
+
+    // Sync new DB changes to disk before deleting from old DB.
+    auto write = [&]() {
+        newdb.WriteBatch(batch_newdb, /*fSync=*/ true);
+        olddb.WriteBatch(batch_olddb);
+        batch_newdb.Clear();
+        batch_olddb.Clear();
+    };
+
+    std::pair<uint8_t, K> key;
+    std::unique_ptr<CDBIterator> cursor(olddb.NewIterator());
+    for (cursor->Seek(prefix); cursor->Valid(); cursor->Next()) {
+        if (ShutdownRequested()) {
+            interrupted = true;
+            break;
+        }
+        if (!cursor->GetKey(key) || key.first != prefix) {
+            break;
+        }
+        V value;
+        if (!cursor->GetValue(value)) {
+            return error("%s: cannot parse address index record with prefix %c", __func__, prefix);
+        }
+        batch_newdb.Write(key, value);
+        batch_olddb.Erase(key);
+
+        // The cursor is a consistent view of the old DB, so it is OK to delete while iterating
+        if (batch_newdb.SizeEstimate() > batch_size || batch_olddb.SizeEstimate() > batch_size) {
+            write();
+        }
+    }
+    write();
+    olddb.CompactRange(prefix, uint8_t(prefix + 1));
+    return true;
+}
+
+} // namespace
+
+AddressIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(gArgs.GetDataDirNet() / "indexes" / "address", n_cache_size, f_memory, f_wipe)
+{}
+
+bool AddressIndex::DB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount>>& vect)
+{
+    CDBBatch batch(*this);
+    for (const auto& item : vect)
+        batch.Write(std::make_pair(DB_ADDRESSINDEX, item.first), item.second);
+    return WriteBatch(batch);
+}
+
+bool AddressIndex::DB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount>>& vect)
+{
+    CDBBatch batch(*this);
+    for (const auto& item : vect)
+        batch.Erase(std::make_pair(DB_ADDRESSINDEX, item.first));
+    return WriteBatch(batch);
+}
+
+bool AddressIndex::DB::ReadAddressIndex(const uint256& addressHash, int type,
+                                        std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex,
+                                        int start, int end)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    if (start > 0 && end > 0) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
+    } else {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
+
+    while (pcursor->Valid()) {
+        std::pair<uint8_t, CAddressIndexKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.hashBytes == addressHash) {
+            if (end > 0 && key.second.blockHeight > end) {
+                break;
+            }
+            CAmount nValue;
+            if (pcursor->GetValue(nValue)) {
+                addressIndex.push_back(std::make_pair(key.second, nValue));
+                pcursor->Next();
+            } else {
+                return error("failed to get address index value");
+            }
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool AddressIndex::DB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& vect, int height)
+{
+    CDBBatch batch(*this);
+    std::map<std::pair<uint256, size_t>, CAddressUnspentValue> updated;
+    std::map<std::pair<unsigned int, uint256>, CAddressWeightValue> weights;
+    for (const auto& [key, value] : vect) {
+        // The address weight is updated with the difference to the previous value of the output
+        CAddressUnspentValue previous;
+        auto itUpdated = updated.find(std::make_pair(key.txhash, key.index));
+        if (itUpdated != updated.end()) {
+            previous = itUpdated->second;
+        } else {
+            Read(std::make_pair(DB_ADDRESSUNSPENTINDEX, key), previous);
+        }
+
+        auto itWeight = weights.find(std::make_pair(key.type, key.hashBytes));
+        if (itWeight == weights.end()) {
+            itWeight = weights.emplace(std::make_pair(key.type, key.hashBytes), CAddressWeightValue()).first;
+            Read(std::make_pair(DB_ADDRESSWEIGHTINDEX, CAddressIndexIteratorKey(key.type, key.hashBytes)), itWeight->second);
+        }
+        if (!previous.IsNull()) {
+            UpdateAddressWeight(itWeight->second, previous, false, height);
+        }
+
+        if (value.IsNull()) {
+            batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, key));
+        } else {
+            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, key), value);
+            UpdateAddressWeight(itWeight->second, value, true, height);
+        }
+        updated[std::make_pair(key.txhash, key.index)] = value;
+    }
+
+    for (auto& item : weights) {
+        CAddressWeightValue& weight = item.second;
+        weight.recent.erase(weight.recent.begin(), weight.recent.upper_bound(AddressWeightRecentHeight(height)));
+        CAddressIndexIteratorKey key(item.first.first, item.first.second);
+        if (weight.IsNull()) {
+            batch.Erase(std::make_pair(DB_ADDRESSWEIGHTINDEX, key));
+        } else {
+            batch.Write(std::make_pair(DB_ADDRESSWEIGHTINDEX, key), weight);
+        }
+    }
+    return WriteBatch(batch);
+}
+
+bool AddressIndex::DB::ReadAddressUnspentIndex(const uint256& addressHash, int type,
+                                               std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspentOutputs)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+
+    while (pcursor->Valid()) {
+        std::pair<uint8_t, CAddressUnspentKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash) {
+            CAddressUnspentValue nValue;
+            if (pcursor->GetValue(nValue)) {
+                unspentOutputs.push_back(std::make_pair(key.second, nValue));
+                pcursor->Next();
+            } else {
+                return error("failed to get address unspent value");
+            }
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool AddressIndex::DB::ReadAddressWeight(const uint256& addressHash, int type, CAddressWeightValue& weight) const
+{
+    // An address without unspent outputs has no entry
+    if (!Read(std::make_pair(DB_ADDRESSWEIGHTINDEX, CAddressIndexIteratorKey(type, addressHash)), weight))
+        weight.SetNull();
+    return true;
+}
+
+bool AddressIndex::DB::BuildAddressWeightIndex(int height)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    CDBBatch batch(*this);
+
+    // The unspent outputs are sorted by address, sum them one address at a time
+    CAddressIndexIteratorKey current;
+    CAddressWeightValue weight;
+    auto write = [&]() {
+        if (!weight.IsNull()) {
+            batch.Write(std::make_pair(DB_ADDRESSWEIGHTINDEX, current), weight);
+        }
+        weight.SetNull();
+    };
+
+    pcursor->Seek(DB_ADDRESSUNSPENTINDEX);
+
+    while (pcursor->Valid()) {
+        if (ShutdownRequested()) return false;
+        std::pair<uint8_t, CAddressUnspentKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX) {
+            CAddressUnspentValue value;
+            if (!pcursor->GetValue(value))
+                return error("failed to get address unspent value");
+            if (key.second.type != current.type || key.second.hashBytes != current.hashBytes) {
+                write();
+                current = CAddressIndexIteratorKey(key.second.type, key.second.hashBytes);
+            }
+            UpdateAddressWeight(weight, value, true, height);
+            if (batch.SizeEstimate() > (size_t)nDefaultDbBatchSize) {
+                if (!WriteBatch(batch))
+                    return false;
+                batch.Clear();
+            }
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+    write();
+
+    return WriteBatch(batch);
+}
+
+bool AddressIndex::DB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue>>& vect)
+{
+    CDBBatch batch(*this);
+    for (const auto& [key, value] : vect) {
+        if (value.IsNull()) {
+            batch.Erase(std::make_pair(DB_SPENTINDEX, key));
+        } else {
+            batch.Write(std::make_pair(DB_SPENTINDEX, key), value);
+        }
+    }
+    return WriteBatch(batch);
+}
+
+bool AddressIndex::DB::ReadSpentIndex(const CSpentIndexKey& key, CSpentIndexValue& value) const
+{
+    return Read(std::make_pair(DB_SPENTINDEX, key), value);
+}
+
+bool AddressIndex::DB::WriteTimestampIndex(const CTimestampIndexKey& timestampIndex, const CTimestampBlockIndexValue& logicalts)
+{
+    CDBBatch batch(*this);
+    batch.Write(std::make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
+    batch.Write(std::make_pair(DB_BLOCKHASHINDEX, CTimestampBlockIndexKey(timestampIndex.blockHash)), logicalts);
+    return WriteBatch(batch);
+}
+
+bool AddressIndex::DB::ReadTimestampIndex(unsigned int high, unsigned int low,
+                                          std::vector<std::pair<uint256, unsigned int>>& hashes)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
+
+    while (pcursor->Valid()) {
+        std::pair<uint8_t, CTimestampIndexKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_TIMESTAMPINDEX && key.second.timestamp < high) {
+            hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool AddressIndex::DB::ReadTimestampBlockIndex(const uint256& hash, unsigned int& ltimestamp) const
+{
+    CTimestampBlockIndexValue lts;
+    if (!Read(std::make_pair(DB_BLOCKHASHINDEX, CTimestampBlockIndexKey(hash)), lts))
+        return false;
+
+    ltimestamp = lts.ltimestamp;
+    return true;
+}
+
+bool AddressIndex::DB::MigrateData(CBlockTreeDB& block_tree_db, const CBlockLocator& best_locator, int height)
+{
+    // The prior implementation of the address index was always in sync with the block index and
+    // its presence was indicated with a boolean DB flag, like the prior txindex. The migration
+    // follows TxIndex::DB::MigrateData: the flag is replaced with the locator of the chain the
+    // entries are in sync with, the entries are moved, and the locator is moved last.
+    bool f_legacy_flag = false;
+    block_tree_db.ReadFlag("addrindex", f_legacy_flag);
+    if (f_legacy_flag) {
+        if (!block_tree_db.Write(DB_ADDRESSINDEX_BLOCK, best_locator)) {
+            return error("%s: cannot write block indicator", __func__);
+        }
+        if (!block_tree_db.WriteFlag("addrindex", false)) {
+            return error("%s: cannot write block index db flag", __func__);
+        }
+    }
+
+    CBlockLocator locator;
+    if (!block_tree_db.Read(DB_ADDRESSINDEX_BLOCK, locator)) {
+        return true;
+    }
+
+    LogPrintf("Upgrading address index database...\n");
+    uiInterface.ShowProgress(_("Upgrading address index database").translated, 0, true);
+
+    bool interrupted = false;
+    if (!MigrateEntries<CAddressIndexKey, CAmount>(*this, block_tree_db, DB_ADDRESSINDEX, interrupted) || interrupted ||
+        !MigrateEntries<CAddressUnspentKey, CAddressUnspentValue>(*this, block_tree_db, DB_ADDRESSUNSPENTINDEX, interrupted) || interrupted ||
+        !MigrateEntries<CAddressIndexIteratorKey, CAddressWeightValue>(*this, block_tree_db, DB_ADDRESSWEIGHTINDEX, interrupted) || interrupted ||
+        !MigrateEntries<CSpentIndexKey, CSpentIndexValue>(*this, block_tree_db, DB_SPENTINDEX, interrupted) || interrupted ||
+        !MigrateEntries<CTimestampIndexKey, int>(*this, block_tree_db, DB_TIMESTAMPINDEX, interrupted) || interrupted ||
+        !MigrateEntries<CTimestampBlockIndexKey, CTimestampBlockIndexValue>(*this, block_tree_db, DB_BLOCKHASHINDEX, interrupted) || interrupted) {
+        if (interrupted) LogPrintf("[CANCELLED].\n");
+        return false;
+    }
+
+    // The weights were added to the legacy index later, build them if the legacy index is older
+    bool f_weight_flag = false;
+    if (!(block_tree_db.ReadFlag("addrweightindex", f_weight_flag) && f_weight_flag) && !BuildAddressWeightIndex(height)) {
+        return error("%s: cannot build the address weight index", __func__);
+    }
+
+    // The new DB is caught up to the locator and the old one has no entry left
+    CDBBatch batch_newdb(*this);
+    batch_newdb.Write(DB_BEST_BLOCK, locator);
+    if (!WriteBatch(batch_newdb, /*fSync=*/ true) || !block_tree_db.Erase(DB_ADDRESSINDEX_BLOCK)) {
+        return error("%s: cannot write the best block", __func__);
+    }
+
+    uiInterface.ShowProgress("", 100, false);
+
+    LogPrintf("[DONE].\n");
+    return true;
+}
+
+AddressIndex::AddressIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(std::make_unique<AddressIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+AddressIndex::~AddressIndex() {}
+
+bool AddressIndex::Init()
+{
+    LOCK(cs_main);
+
+    // Attempt to migrate the address index from the block tree database
+    if (!m_db->MigrateData(*pblocktree, m_chainstate->m_chain.GetLocator(), m_chainstate->m_chain.Height())) {
+        return false;
+    }
+
+    return BaseIndex::Init();
+}
+
+bool AddressIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // The transactions of the genesis block are not connected
+    if (pindex->nHeight == 0) return true;
+
+    CBlockUndo block_undo;
+    if (!UndoReadFromDisk(block_undo, pindex)) {
+        return false;
+    }
+    if (block_undo.vtxundo.size() + 1 != block.vtx.size()) {
+        return error("%s: block and undo data inconsistent", __func__);
+    }
+
+    std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> addressUnspentIndex;
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue>> spentIndex;
+    int type = 0;
+    uint256 hashBytes;
+
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        const uint256& hash = tx.GetHash();
+
+        // The coinbase spends no output
+        if (i > 0) {
+            const CTxUndo& txundo = block_undo.vtxundo[i - 1];
+            for (size_t j = 0; j < tx.vin.size(); j++) {
+                const COutPoint& prevout = tx.vin[j].prevout;
+                const CTxOut& out = txundo.vprevout[j].out;
+                if (!GetAddressKey(prevout, out.scriptPubKey, type, hashBytes)) {
+                    continue;
+                }
+                // record spending activity
+                addressIndex.push_back(std::make_pair(CAddressIndexKey(type, hashBytes, pindex->nHeight, i, hash, j, true), out.nValue * -1));
+                // remove address from unspent index
+                addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(type, hashBytes, prevout.hash, prevout.n), CAddressUnspentValue()));
+                spentIndex.push_back(std::make_pair(CSpentIndexKey(prevout.hash, prevout.n), CSpentIndexValue(hash, j, pindex->nHeight, out.nValue, type, hashBytes)));
+            }
+        }
+
+        for (unsigned int k = 0; k < tx.vout.size(); k++) {
+            const CTxOut& out = tx.vout[k];
+            if (!GetAddressKey({hash, k}, out.scriptPubKey, type, hashBytes)) {
+                continue;
+            }
+            // record receiving activity
+            addressIndex.push_back(std::make_pair(CAddressIndexKey(type, hashBytes, pindex->nHeight, i, hash, k, false), out.nValue));
+            // record unspent output
+            addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(type, hashBytes, hash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight, tx.IsCoinStake())));
+        }
+    }
+
+    if (!m_db->WriteAddressIndex(addressIndex) ||
+        !m_db->UpdateAddressUnspentIndex(addressUnspentIndex, pindex->nHeight) ||
+        !m_db->UpdateSpentIndex(spentIndex)) {
+        return error("%s: failed to write the address index of block %s", __func__, pindex->GetBlockHash().ToString());
+    }
+
+    // The logical timestamps increase along the chain
+    unsigned int logicalTS = pindex->nTime;
+    unsigned int prevLogicalTS = 0;
+    if (pindex->pprev && !m_db->ReadTimestampBlockIndex(pindex->pprev->GetBlockHash(), prevLogicalTS))
+        LogPrint(BCLog::INDEX, "%s: Failed to read previous block's logical timestamp\n", __func__);
+    if (logicalTS <= prevLogicalTS) {
+        logicalTS = prevLogicalTS + 1;
+        LogPrint(BCLog::INDEX, "%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, pindex->nTime, prevLogicalTS, logicalTS);
+    }
+    return m_db->WriteTimestampIndex(CTimestampIndexKey(logicalTS, pindex->GetBlockHash()), CTimestampBlockIndexValue(logicalTS));
+}
+
+bool AddressIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    // Undo the blocks one at a time from the tip, so the weights are updated at their height.
+    // The timestamps of the disconnected blocks are kept, they are filtered as orphans.
+    const Consensus::Params& consensus_params = Params().GetConsensus();
+    for (const CBlockIndex* pindex = current_tip; pindex != new_tip; pindex = pindex->pprev) {
+        CBlock block;
+        CBlockUndo block_undo;
+        if (!ReadBlockFromDisk(block, pindex, consensus_params) || !UndoReadFromDisk(block_undo, pindex)) {
+            return error("%s: Failed to read block %s from disk",
+                         __func__, pindex->GetBlockHash().ToString());
+        }
+        if (block_undo.vtxundo.size() + 1 != block.vtx.size()) {
+            return error("%s: block and undo data inconsistent", __func__);
+        }
+
+        std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> addressUnspentIndex;
+        std::vector<std::pair<CSpentIndexKey, CSpentIndexValue>> spentIndex;
+        int type = 0;
+        uint256 hashBytes;
+
+        for (size_t i = block.vtx.size(); i-- > 0;) {
+            const CTransaction& tx = *block.vtx[i];
+            const uint256& hash = tx.GetHash();
+
+            for (unsigned int k = tx.vout.size(); k-- > 0;) {
+                const CTxOut& out = tx.vout[k];
+                if (!GetAddressKey({hash, k}, out.scriptPubKey, type, hashBytes)) {
+                    continue;
+                }
+                // undo receiving activity
+                addressIndex.push_back(std::make_pair(CAddressIndexKey(type, hashBytes, pindex->nHeight, i, hash, k, false), out.nValue));
+                // undo unspent index
+                addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(type, hashBytes, hash, k), CAddressUnspentValue()));
+            }
+
+            if (i > 0) {
+                const CTxUndo& txundo = block_undo.vtxundo[i - 1];
+                for (size_t j = tx.vin.size(); j-- > 0;) {
+                    const COutPoint& prevout = tx.vin[j].prevout;
+                    const Coin& coin = txundo.vprevout[j];
+                    if (!GetAddressKey(prevout, coin.out.scriptPubKey, type, hashBytes)) {
+                        continue;
+                    }
+                    // undo spending activity
+                    addressIndex.push_back(std::make_pair(CAddressIndexKey(type, hashBytes, pindex->nHeight, i, hash, j, true), coin.out.nValue * -1));
+                    // restore unspent index
+                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(type, hashBytes, prevout.hash, prevout.n), CAddressUnspentValue(coin.out.nValue, coin.out.scriptPubKey, coin.nHeight, coin.fCoinStake)));
+                    // undo spent index
+                    spentIndex.push_back(std::make_pair(CSpentIndexKey(prevout.hash, prevout.n), CSpentIndexValue()));
+                }
+            }
+        }
+
+        if (!m_db->EraseAddressIndex(addressIndex) ||
+            !m_db->UpdateAddressUnspentIndex(addressUnspentIndex, pindex->nHeight) ||
+            !m_db->UpdateSpentIndex(spentIndex)) {
+            return error("%s: failed to rewind the address index of block %s", __func__, pindex->GetBlockHash().ToString());
+        }
+    }
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& AddressIndex::GetDB() const { return *m_db; }
+
+bool AddressIndex::ReadAddressIndex(const uint256& addressHash, int type,
+                                    std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex,
+                                    int start, int end) const
+{
+    return m_db->ReadAddressIndex(addressHash, type, addressIndex, start, end);
+}
+
+bool AddressIndex::ReadAddressUnspentIndex(const uint256& addressHash, int type,
+                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspentOutputs) const
+{
+    return m_db->ReadAddressUnspentIndex(addressHash, type, unspentOutputs);
+}
+
+bool AddressIndex::ReadAddressWeight(const uint256& addressHash, int type, CAddressWeightValue& weight) const
+{
+    return m_db->ReadAddressWeight(addressHash, type, weight);
+}
+
+bool AddressIndex::ReadSpentIndex(const CSpentIndexKey& key, CSpentIndexValue& value) const
+{
+    return m_db->ReadSpentIndex(key, value);
+}
+
+bool AddressIndex::ReadTimestampIndex(unsigned int high, unsigned int low, bool fActiveOnly,
+                                      std::vector<std::pair<uint256, unsigned int>>& hashes, ChainstateManager& chainman) const
+{
+    std::vector<std::pair<uint256, unsigned int>> found;
+    if (!m_db->ReadTimestampIndex(high, low, found))
+        return false;
+
+    if (!fActiveOnly) {
+        hashes.insert(hashes.end(), found.begin(), found.end());
+        return true;
+    }
+    LOCK(cs_main);
+    for (const auto& item : found) {
+        const CBlockIndex* pblockindex = chainman.m_blockman.LookupBlockIndex(item.first);
+        if (pblockindex && chainman.ActiveChain().Contains(pblockindex))
+            hashes.push_back(item);
+    }
+    return true;
+}
@@ -0,0 +1,102 @@
+#ifndef BITCOIN_INDEX_ADDRESSINDEX_H
+#define BITCOIN_INDEX_ADDRESSINDEX_H
+
+#include <chain.h>
+#include <coins.h>
+#include <index/base.h>
+#include <txdb.h>
+
+class ChainstateManager;
+
+/**
+ * AddressIndex keeps the block explorer indexes of -addrindex: the balance changes of every
+ * address by height, the unspent outputs of every address with their aggregated stake weight,
+ * the input spending every output, and the blocks by logical timestamp. It is built in the
+ * background from the block and undo files, so it can be enabled without a reindex.
+ */
+class AddressIndex final : public BaseIndex
+{
+public:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    /// Override base class init to migrate from the block tree database.
+    bool Init() override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "addressindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit AddressIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~AddressIndex() override;
+
+    /// Collect the balance changes of an address, within [start, end] if both are set.
+    bool ReadAddressIndex(const uint256& addressHash, int type,
+                          std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex,
+                          int start = 0, int end = 0) const;
+
+    /// Collect the unspent outputs of an address.
+    bool ReadAddressUnspentIndex(const uint256& addressHash, int type,
+                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspentOutputs) const;
+
+    /// Read the aggregated value of the unspent outputs of an address.
+    bool ReadAddressWeight(const uint256& addressHash, int type, CAddressWeightValue& weight) const;
+
+    /// Look up the input which spent an output. Returns false if the output is not spent.
+    bool ReadSpentIndex(const CSpentIndexKey& key, CSpentIndexValue& value) const;
+
+    /// Collect the blocks with a logical timestamp in [low, high).
+    bool ReadTimestampIndex(unsigned int high, unsigned int low, bool fActiveOnly,
+                            std::vector<std::pair<uint256, unsigned int>>& hashes, ChainstateManager& chainman) const;
+};
+
+/** Access to the address index database (indexes/address/) */
+class AddressIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount>>& vect);
+    bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount>>& vect);
+    bool ReadAddressIndex(const uint256& addressHash, int type,
+                          std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex,
+                          int start = 0, int end = 0);
+
+    /// Write or erase (null value) unspent outputs, and update the weights of their addresses.
+    bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& vect, int height);
+    bool ReadAddressUnspentIndex(const uint256& addressHash, int type,
+                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspentOutputs);
+    bool ReadAddressWeight(const uint256& addressHash, int type, CAddressWeightValue& weight) const;
+
+    /// Sum the weights of all the addresses again from their unspent outputs.
+    bool BuildAddressWeightIndex(int height);
+
+    /// Write or erase (null value) spent outputs.
+    bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue>>& vect);
+    bool ReadSpentIndex(const CSpentIndexKey& key, CSpentIndexValue& value) const;
+
+    bool WriteTimestampIndex(const CTimestampIndexKey& timestampIndex, const CTimestampBlockIndexValue& logicalts);
+    bool ReadTimestampIndex(unsigned int high, unsigned int low,
+                            std::vector<std::pair<uint256, unsigned int>>& hashes);
+    bool ReadTimestampBlockIndex(const uint256& hash, unsigned int& logicalTS) const;
+
+    /// Move the address index from the block tree DB, where it is for older nodes
+    /// which kept it in sync with the chain on block connection.
+    bool MigrateData(CBlockTreeDB& block_tree_db, const CBlockLocator& best_locator, int height);
+};
+
+/// The global address index, used by the address RPCs and super staking. May be null.
+extern std::unique_ptr<AddressIndex> g_address_index;
+
+#endif // BITCOIN_INDEX_ADDRESSINDEX_H
@@ -178,6 +178,8 @@ void BaseIndex::ThreadSync()
                 return;
             }
             if (!WriteBlock(block, pindex)) {
+                // Indexes reading the data of another index stop waiting for it on shutdown
+                if (ShutdownRequested()) return;
                 FatalError("%s: Failed to write block %s to index database",
                            __func__, pindex->GetBlockHash().ToString());
                 return;
@@ -0,0 +1,288 @@
+#include <index/logindex.h>
+#include <index/receiptindex.h>
+#include <serialize.h>
+#include <util/convert.h>
+#include <util/system.h>
+#include <validation.h>
+
+static constexpr uint8_t DB_LOG_TOPIC{'t'};
+static constexpr uint8_t DB_BLOCK_BLOOM{'b'};
+static constexpr uint8_t DB_SECTION_BLOOM{'s'};
+
+std::unique_ptr<LogIndex> g_log_index;
+
+namespace {
+
+struct DBTopicKey {
+    uint8_t position;
+    uint256 topic;
+    int height;
+    uint32_t tx_index;
+
+    DBTopicKey() : position(0), height(0), tx_index(0) {}
+    DBTopicKey(uint8_t position_in, const uint256& topic_in, int height_in, uint32_t tx_index_in) :
+        position(position_in), topic(topic_in), height(height_in), tx_index(tx_index_in) {}
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_LOG_TOPIC);
+        ser_writedata8(s, position);
+        s << topic;
+        ser_writedata32be(s, height);
+        ser_writedata32be(s, tx_index);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        const uint8_t prefix{ser_readdata8(s)};
+        if (prefix != DB_LOG_TOPIC) {
+            throw std::ios_base::failure("Invalid format for logindex DB topic key");
+        }
+        position = ser_readdata8(s);
+        s >> topic;
+        height = ser_readdata32be(s);
+        tx_index = ser_readdata32be(s);
+    }
+};
+
+struct DBTopicValue {
+    uint256 tx_hash;
+    std::vector<uint160> addresses;
+
+    SERIALIZE_METHODS(DBTopicValue, obj) { READWRITE(obj.tx_hash, obj.addresses); }
+};
+
+struct DBHeightKey {
+    int height;
+
+    explicit DBHeightKey(int height_in) : height(height_in) {}
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_BLOCK_BLOOM);
+        ser_writedata32be(s, height);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        const uint8_t prefix{ser_readdata8(s)};
+        if (prefix != DB_BLOCK_BLOOM) {
+            throw std::ios_base::failure("Invalid format for logindex DB height key");
+        }
+        height = ser_readdata32be(s);
+    }
+};
+
+/** Aggregated bloom of a block, with the topic keys written for it so they can be rewound. */
+struct DBBlockValue {
+    uint256 block_hash;
+    std::vector<unsigned char> bloom;
+    std::vector<std::pair<uint8_t, std::pair<uint256, uint32_t>>> topics;
+
+    SERIALIZE_METHODS(DBBlockValue, obj) { READWRITE(obj.block_hash, obj.bloom, obj.topics); }
+};
+
+struct DBSectionKey {
+    int section;
+
+    explicit DBSectionKey(int section_in) : section(section_in) {}
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_SECTION_BLOOM);
+        ser_writedata32be(s, section);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        const uint8_t prefix{ser_readdata8(s)};
+        if (prefix != DB_SECTION_BLOOM) {
+            throw std::ios_base::failure("Invalid format for logindex DB section key");
+        }
+        section = ser_readdata32be(s);
+    }
+};
+
+bool ContainsAny(const dev::eth::LogBloom& bloom, const std::vector<dev::eth::LogBloom>& blooms)
+{
+    for (const dev::eth::LogBloom& b : blooms) {
+        if (bloom.contains(b)) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+LogIndex::LogIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+{
+    fs::path path{gArgs.GetDataDirNet() / "indexes" / "logindex"};
+    fs::create_directories(path);
+
+    m_db = std::make_unique<BaseIndex::DB>(path / "db", n_cache_size, f_memory, f_wipe);
+}
+
+bool LogIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // The receipts of the blocks connected before -logevents was enabled are written by the receipt index
+    if (g_receipt_index && !g_receipt_index->BlockUntilReceipts(block, pindex)) return false;
+
+    DBBlockValue value;
+    value.block_hash = pindex->GetBlockHash();
+    dev::eth::LogBloom block_bloom;
+
+    CDBBatch batch(*m_db);
+    for (size_t i = 0; i < block.vtx.size(); ++i) {
+        const CTransaction& tx = *block.vtx[i];
+        if (!tx.HasCreateOrCall()) continue;
+
+        // The receipts of the block are committed before it is announced, StorageResults guards its own caches
+        std::vector<TransactionReceiptInfo> receipts = pstorageresult->getResult(uintToh256(tx.GetHash()), RECEIPT_LOGS);
+
+        std::set<uint160> addresses;
+        std::set<std::pair<uint8_t, uint256>> topics;
+        for (const TransactionReceiptInfo& receipt : receipts) {
+            for (const dev::eth::LogEntry& log : receipt.logs) {
+                addresses.insert(h160Touint(log.address));
+                for (size_t j = 0; j < log.topics.size(); ++j) {
+                    topics.emplace(j, h256Touint(log.topics[j]));
+                }
+                block_bloom |= log.bloom();
+            }
+        }
+        if (addresses.empty()) continue;
+
+        DBTopicValue topic_value;
+        topic_value.tx_hash = tx.GetHash();
+        topic_value.addresses.assign(addresses.begin(), addresses.end());
+        for (const auto& topic : topics) {
+            batch.Write(DBTopicKey(topic.first, topic.second, pindex->nHeight, i), topic_value);
+            value.topics.emplace_back(topic.first, std::make_pair(topic.second, uint32_t(i)));
+        }
+    }
+
+    if (!block_bloom) return true;
+
+    value.bloom = block_bloom.asBytes();
+    batch.Write(DBHeightKey(pindex->nHeight), value);
+
+    std::vector<unsigned char> section_bytes;
+    dev::eth::LogBloom section_bloom;
+    if (m_db->Read(DBSectionKey(pindex->nHeight / LOG_BLOOM_SECTION_SIZE), section_bytes)) {
+        section_bloom = dev::eth::LogBloom(section_bytes);
+    }
+    section_bloom |= block_bloom;
+    batch.Write(DBSectionKey(pindex->nHeight / LOG_BLOOM_SECTION_SIZE), section_bloom.asBytes());
+
+    return m_db->WriteBatch(batch);
+}
+
+bool LogIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    CDBBatch batch(*m_db);
+    std::unique_ptr<CDBIterator> db_it(m_db->NewIterator());
+
+    // Drop the entries of the disconnected blocks, their receipts may already be gone
+    // so the topic keys to erase are taken from the block entry
+    DBHeightKey key(new_tip->nHeight + 1);
+    for (db_it->Seek(key); db_it->Valid(); db_it->Next()) {
+        if (!db_it->GetKey(key) || key.height > current_tip->nHeight) break;
+
+        DBBlockValue value;
+        if (!db_it->GetValue(value)) {
+            return error("%s: unable to read value in %s at key (%c, %d)",
+                         __func__, GetName(), DB_BLOCK_BLOOM, key.height);
+        }
+        for (const auto& topic : value.topics) {
+            batch.Erase(DBTopicKey(topic.first, topic.second.first, key.height, topic.second.second));
+        }
+        batch.Erase(key);
+    }
+
+    // Rebuild the section bloom the new tip ends in and drop the ones above it
+    int first_section = (new_tip->nHeight + 1) / LOG_BLOOM_SECTION_SIZE;
+    for (int section = first_section; section <= current_tip->nHeight / LOG_BLOOM_SECTION_SIZE; ++section) {
+        batch.Erase(DBSectionKey(section));
+    }
+    dev::eth::LogBloom section_bloom;
+    for (db_it->Seek(DBHeightKey(first_section * LOG_BLOOM_SECTION_SIZE)); db_it->Valid(); db_it->Next()) {
+        if (!db_it->GetKey(key) || key.height > new_tip->nHeight) break;
+
+        DBBlockValue value;
+        if (!db_it->GetValue(value)) {
+            return error("%s: unable to read value in %s at key (%c, %d)",
+                         __func__, GetName(), DB_BLOCK_BLOOM, key.height);
+        }
+        section_bloom |= dev::eth::LogBloom(value.bloom);
+    }
+    if (section_bloom) {
+        batch.Write(DBSectionKey(first_section), section_bloom.asBytes());
+    }
+
+    if (!m_db->WriteBatch(batch)) return false;
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+int LogIndex::BestHeight()
+{
+    const CBlockIndex* pindex = CurrentIndex();
+    return pindex ? pindex->nHeight : -1;
+}
+
+bool LogIndex::LookupTopic(uint8_t position, const uint256& topic, int start_height, int stop_height,
+                           std::vector<LogIndexEntry>& entries) const
+{
+    if (start_height < 0 || start_height > stop_height) return false;
+
+    std::unique_ptr<CDBIterator> db_it(m_db->NewIterator());
+    DBTopicKey key(position, topic, start_height, 0);
+    for (db_it->Seek(key); db_it->Valid(); db_it->Next()) {
+        if (!db_it->GetKey(key) || key.position != position || key.topic != topic || key.height > stop_height) break;
+
+        DBTopicValue value;
+        if (!db_it->GetValue(value)) {
+            return error("%s: unable to read value in %s at topic key (%d, %s, %d)",
+                         __func__, GetName(), key.position, key.topic.ToString(), key.height);
+        }
+        entries.push_back(LogIndexEntry{key.height, key.tx_index, value.tx_hash, std::move(value.addresses)});
+    }
+    return true;
+}
+
+bool LogIndex::LookupBlooms(const std::vector<dev::eth::LogBloom>& blooms, int start_height, int stop_height,
+                            std::vector<int>& heights) const
+{
+    if (start_height < 0 || start_height > stop_height) return false;
+
+    std::unique_ptr<CDBIterator> db_it(m_db->NewIterator());
+    for (int section = start_height / LOG_BLOOM_SECTION_SIZE; section <= stop_height / LOG_BLOOM_SECTION_SIZE; ++section) {
+        std::vector<unsigned char> section_bytes;
+        if (!m_db->Read(DBSectionKey(section), section_bytes) || !ContainsAny(dev::eth::LogBloom(section_bytes), blooms)) {
+            continue;
+        }
+
+        int section_stop = std::min(stop_height, (section + 1) * LOG_BLOOM_SECTION_SIZE - 1);
+        DBHeightKey key(std::max(start_height, section * LOG_BLOOM_SECTION_SIZE));
+        for (db_it->Seek(key); db_it->Valid(); db_it->Next()) {
+            if (!db_it->GetKey(key) || key.height > section_stop) break;
+
+            DBBlockValue value;
+            if (!db_it->GetValue(value)) {
+                return error("%s: unable to read value in %s at key (%c, %d)",
+                             __func__, GetName(), DB_BLOCK_BLOOM, key.height);
+            }
+            if (ContainsAny(dev::eth::LogBloom(value.bloom), blooms)) {
+                heights.push_back(key.height);
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,65 @@
+#ifndef BITCOIN_INDEX_LOGINDEX_H
+#define BITCOIN_INDEX_LOGINDEX_H
+
+#include <chain.h>
+#include <index/base.h>
+#include <libethcore/Common.h>
+#include <uint256.h>
+
+static constexpr bool DEFAULT_LOGINDEX{false};
+
+/** Number of blocks aggregated into one section bloom. */
+static constexpr int LOG_BLOOM_SECTION_SIZE{4096};
+
+/** A transaction that emitted a log matching a lookup. */
+struct LogIndexEntry {
+    int height;
+    uint32_t tx_index;
+    uint256 tx_hash;
+    /// Sorted addresses of all the logs emitted by the transaction
+    std::vector<uint160> addresses;
+};
+
+/**
+ * LogIndex is used to search the EVM logs stored in the receipts database
+ * (-logevents) without scanning every block in the requested range. It records
+ * the transactions that emitted a log by (topic position, topic, height, tx index),
+ * and keeps the aggregated log bloom of every block plus one bloom per section of
+ * LOG_BLOOM_SECTION_SIZE blocks, so address lookups can skip whole sections.
+ */
+class LogIndex final : public BaseIndex
+{
+private:
+    std::unique_ptr<BaseIndex::DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override { return *m_db; }
+
+    const char* GetName() const override { return "logindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit LogIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Height of the last block the index is synced with, -1 if none.
+    int BestHeight();
+
+    /// Collect the transactions with a log whose topic at the given position matches,
+    /// within [start_height, stop_height], ordered by height and position in the block.
+    bool LookupTopic(uint8_t position, const uint256& topic, int start_height, int stop_height,
+                     std::vector<LogIndexEntry>& entries) const;
+
+    /// Collect the heights within [start_height, stop_height] whose aggregated log bloom
+    /// contains at least one of the given blooms.
+    bool LookupBlooms(const std::vector<dev::eth::LogBloom>& blooms, int start_height, int stop_height,
+                      std::vector<int>& heights) const;
+};
+
+/// The global log index, used in searchlogs. May be null.
+extern std::unique_ptr<LogIndex> g_log_index;
+
+#endif // BITCOIN_INDEX_LOGINDEX_H
@@ -0,0 +1,367 @@
+#include <index/receiptindex.h>
+
+#include <chainparams.h>
+#include <coins.h>
+#include <node/blockstorage.h>
+#include <pos.h>
+#include <shutdown.h>
+#include <txdb.h>
+#include <undo.h>
+#include <util/convert.h>
+#include <util/system.h>
+#include <util/thread.h>
+#include <validation.h>
+#include <yody/yodyDGP.h>
+
+std::unique_ptr<ReceiptIndex> g_receipt_index;
+
+namespace {
+
+/** Result of a call to an address without a contract, which ByteCodeExec does not execute */
+ResultExecute UnknownAddressResult()
+{
+    dev::eth::ExecutionResult execRes;
+    execRes.excepted = dev::eth::TransactionException::Unknown;
+    return ResultExecute{execRes, YodyTransactionReceipt(dev::h256(), dev::h256(), dev::u256(), dev::eth::LogEntries()), CTransaction(), {}};
+}
+
+} // namespace
+
+ReceiptIndex::ReceiptIndex(ChainstateManager& chainman, size_t n_cache_size, bool f_memory, bool f_wipe, int n_threads) :
+    m_chainman(chainman), m_replay(f_wipe), m_threads(n_threads)
+{
+    fs::path path{gArgs.GetDataDirNet() / "indexes" / "receiptindex"};
+    fs::create_directories(path);
+
+    m_db = std::make_unique<BaseIndex::DB>(path / "db", n_cache_size, f_memory, f_wipe);
+}
+
+ReceiptIndex::~ReceiptIndex()
+{
+    // The sync thread waits for the replay threads, stop it first
+    Interrupt();
+    Stop();
+
+    {
+        LOCK(m_mutex);
+        m_stop = true;
+    }
+    m_cond_queue.notify_all();
+    for (std::thread& thread : m_replay_threads) {
+        thread.join();
+    }
+}
+
+bool ReceiptIndex::Init()
+{
+    {
+        LOCK(cs_main);
+        // Without a locator, the receipts of the chain were written by ConnectBlock unless the
+        // index was created to replay them, start from the tip or from the genesis block
+        CBlockLocator locator;
+        const CChain& active_chain = m_chainstate->m_chain;
+        if (!m_db->ReadBestBlock(locator) && active_chain.Tip()) {
+            CDBBatch batch(*m_db);
+            m_db->WriteBestBlock(batch, active_chain.GetLocator(m_replay ? active_chain.Genesis() : active_chain.Tip()));
+            if (!m_db->WriteBatch(batch)) {
+                return error("%s: cannot write the locator of %s", __func__, GetName());
+            }
+        }
+    }
+
+    if (!BaseIndex::Init()) {
+        return false;
+    }
+
+    // Init builds the delegation index when the receipts are written already, else it is built once they are
+    bool f_delegation_index = false;
+    m_delegation_index = (pblocktree->ReadFlag("delegationindex", f_delegation_index) && f_delegation_index) || GetSummary().synced;
+
+    for (int i = 0; i < m_threads; i++) {
+        m_replay_threads.emplace_back(&util::TraceThread, "receiptreplay", [this] { ThreadReplay(); });
+    }
+
+    return true;
+}
+
+void ReceiptIndex::ThreadReplay()
+{
+    while (true) {
+        std::shared_ptr<Replay> replay;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_cond_queue.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || !m_queue.empty(); });
+            if (m_stop) return;
+            replay = m_queue.front();
+            m_queue.pop_front();
+        }
+
+        CBlock block;
+        BlockReceipts receipts;
+        bool ok = ReadBlockFromDisk(block, replay->pindex, Params().GetConsensus()) &&
+                  (HasReceipts(block, replay->pindex) || ReplayBlock(block, replay->pindex, receipts));
+
+        {
+            LOCK(m_mutex);
+            replay->ok = ok;
+            replay->receipts = std::move(receipts);
+            replay->done = true;
+        }
+        m_cond_done.notify_all();
+    }
+}
+
+void ReceiptIndex::ScheduleReplays(const CBlockIndex* pindex)
+{
+    if (m_replay_threads.empty()) return;
+
+    std::vector<const CBlockIndex*> next;
+    {
+        LOCK(cs_main);
+        const CChain& active_chain = m_chainstate->m_chain;
+        if (active_chain[pindex->nHeight] != pindex) return;
+        const int stop_height = std::min(active_chain.Height(), pindex->nHeight + RECEIPTINDEX_REPLAY_AHEAD * m_threads);
+        for (int height = pindex->nHeight + 1; height <= stop_height; height++) {
+            next.push_back(active_chain[height]);
+        }
+    }
+
+    {
+        LOCK(m_mutex);
+        // Drop the replays of the blocks which are written or left the active chain
+        for (auto it = m_replays.begin(); it != m_replays.end();) {
+            if (it->second->pindex->nHeight <= pindex->nHeight) {
+                it = m_replays.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (const CBlockIndex* pindex_next : next) {
+            auto inserted = m_replays.emplace(pindex_next->GetBlockHash(), nullptr);
+            if (!inserted.second) continue;
+            inserted.first->second = std::make_shared<Replay>();
+            inserted.first->second->pindex = pindex_next;
+            m_queue.push_back(inserted.first->second);
+        }
+    }
+    m_cond_queue.notify_all();
+}
+
+bool ReceiptIndex::HasReceipts(const CBlock& block, const CBlockIndex* pindex) const
+{
+    // ConnectBlock writes the receipts of all the contract transactions of a block, check the first one
+    for (const CTransactionRef& tx : block.vtx) {
+        if (!tx->HasCreateOrCall() || tx->HasOpSpend()) continue;
+
+        std::vector<TransactionReceiptInfo> receipts = pstorageresult->getResult(uintToh256(tx->GetHash()), RECEIPT_BASE);
+        return !receipts.empty() && receipts[0].blockHash == pindex->GetBlockHash();
+    }
+    return true;
+}
+
+bool ReceiptIndex::ReplayBlock(const CBlock& block, const CBlockIndex* pindex, BlockReceipts& receipts) const
+{
+    const Consensus::Params& consensus = Params().GetConsensus();
+
+    CBlockUndo block_undo;
+    if (!UndoReadFromDisk(block_undo, pindex)) {
+        return false;
+    }
+    if (block_undo.vtxundo.size() + 1 != block.vtx.size()) {
+        return error("%s: block and undo data inconsistent", __func__);
+    }
+
+    // The senders of the contract transactions are taken from the coins spent by the block
+    CCoinsView view_dummy;
+    CCoinsViewCache view(&view_dummy);
+    for (size_t i = 1; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        const CTxUndo& txundo = block_undo.vtxundo[i - 1];
+        if (txundo.vprevout.size() != tx.vin.size()) {
+            return error("%s: transaction and undo data inconsistent", __func__);
+        }
+        for (size_t j = 0; j < tx.vin.size(); j++) {
+            view.AddCoin(tx.vin[j].prevout, Coin(txundo.vprevout[j]), true);
+        }
+    }
+
+    // Execute on the state after the previous block, with the parameters of the DGP for the block as ConnectBlock does
+    dev::h256 hashStateRoot(dev::sha3(dev::rlp("")));
+    dev::h256 hashUTXORoot(dev::sha3(dev::rlp("")));
+    if (pindex->pprev->hashStateRoot != uint256() && pindex->pprev->hashUTXORoot != uint256()) {
+        hashStateRoot = uintToh256(pindex->pprev->hashStateRoot);
+        hashUTXORoot = uintToh256(pindex->pprev->hashUTXORoot);
+    }
+    const int dgp_height = pindex->nHeight + (pindex->nHeight + 1 >= consensus.QIP7Height ? 0 : 1);
+    // The DGP templates are called on top of the previous block, not the tip
+    std::shared_ptr<const CallContractContext> callContext;
+    if (fGettingValuesDGP) {
+        CBlock prev_block;
+        if (!ReadBlockFromDisk(prev_block, pindex->pprev, consensus)) {
+            return error("%s: failed to read block %s from disk", __func__, pindex->pprev->GetBlockHash().ToString());
+        }
+        callContext = CallContractCache::BuildContext(prev_block, pindex->pprev);
+    }
+    std::unique_ptr<YodyState> state;
+    std::unique_ptr<dev::eth::SealEngineFace> sealEngine;
+    uint64_t blockGasLimit;
+    {
+        LOCK(cs_main);
+        // Read the DGP from the state after the previous block like ConnectBlock, not from the tip
+        state.reset(new YodyState(*globalState, hashStateRoot, hashUTXORoot));
+        // The templates get the gas limit stored in the DGP, reading it through them would call them again
+        uint64_t callGasLimit = 0;
+        if (callContext) {
+            callGasLimit = YodyDGP(state.get(), *m_chainstate, false).getBlockGasLimit(pindex->nHeight);
+        }
+        YodyDGP yodyDGP(state.get(), *m_chainstate, fGettingValuesDGP, callContext, callGasLimit);
+        blockGasLimit = yodyDGP.getBlockGasLimit(dgp_height);
+        sealEngine.reset(dev::eth::SealEngineRegistrar::create(globalSealEngine->chainParams()));
+        sealEngine->setYodySchedule(yodyDGP.getGasSchedule(dgp_height));
+    }
+    LastHashes lastHashes;
+    lastHashes.set(pindex->pprev);
+    dev::eth::EnvInfo envInfo(ByteCodeExec::BuildEVMEnvironment(block, pindex->pprev, blockGasLimit, lastHashes, *sealEngine));
+    const unsigned int contractflags = GetContractScriptFlags(pindex->nHeight, consensus);
+
+    try {
+        uint64_t blockGasUsed = 0;
+        for (size_t i = 0; i < block.vtx.size(); i++) {
+            const CTransaction& tx = *block.vtx[i];
+            if (!tx.HasCreateOrCall() || tx.HasOpSpend()) continue;
+
+            YodyTxConverter convert(tx, *m_chainstate, nullptr, &view, &block.vtx, contractflags);
+            ExtractYodyTX resultConvertYodyTX;
+            if (!convert.extractionYodyTransactions(resultConvertYodyTX)) {
+                return error("%s: contract transaction %s of the wrong format", __func__, tx.GetHash().ToString());
+            }
+
+            std::vector<TransactionReceiptInfo> tri;
+            for (const YodyTransaction& qtx : resultConvertYodyTX.first) {
+                if (qtx.getVersion().toRaw() != VersionVM::GetEVMDefault().toRaw()) {
+                    return error("%s: contract transaction %s with an unknown VM version", __func__, tx.GetHash().ToString());
+                }
+                ResultExecute result = !qtx.isCreation() && !state->addressInUse(qtx.receiveAddress()) ?
+                    UnknownAddressResult() :
+                    state->execute(envInfo, *sealEngine, qtx, pindex->pprev->nHeight, dev::eth::Permanence::Committed, OnOpFunc());
+
+                // Every execution uses its gas in the block, whether it is refunded or not
+                uint64_t gasUsed = uint64_t(result.execRes.gasUsed);
+                blockGasUsed += gasUsed;
+                tri.push_back(TransactionReceiptInfo{
+                    block.GetHash(),
+                    uint32_t(pindex->nHeight),
+                    tx.GetHash(),
+                    uint32_t(i),
+                    qtx.from(),
+                    qtx.to(),
+                    blockGasUsed,
+                    gasUsed,
+                    result.execRes.newAddress,
+                    result.txRec.takeLog(),
+                    result.execRes.excepted,
+                    exceptedMessage(result.execRes.excepted, result.execRes.output),
+                    qtx.getNVout(),
+                    result.txRec.bloom(),
+                    result.txRec.stateRoot(),
+                    result.txRec.utxoRoot(),
+                });
+            }
+            sealEngine->deleteAddresses.clear();
+            receipts.emplace_back(uintToh256(tx.GetHash()), std::move(tri));
+        }
+    } catch (const std::exception& e) {
+        // The state of the block is missing when it was pruned or compacted, only a reindex rebuilds it
+        return error("%s: failed to execute the contracts of block %s, rebuild the database using -reindex if its state is not available: %s",
+                     __func__, pindex->GetBlockHash().ToString(), e.what());
+    }
+
+    // The state is not committed, only compare the roots to make sure the receipts are the ones of the block
+    if (!receipts.empty() && pindex->nHeight != consensus.nOfflineStakeHeight &&
+        (h256Touint(state->rootHash()) != pindex->hashStateRoot || h256Touint(state->rootHashUTXO()) != pindex->hashUTXORoot)) {
+        return error("%s: the contracts of block %s do not execute to its state root", __func__, pindex->GetBlockHash().ToString());
+    }
+
+    return true;
+}
+
+bool ReceiptIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // The transactions of the genesis block are not connected
+    if (pindex->nHeight == 0) return true;
+
+    if (!HasReceipts(block, pindex)) {
+        std::shared_ptr<Replay> replay;
+        {
+            LOCK(m_mutex);
+            auto it = m_replays.find(pindex->GetBlockHash());
+            if (it != m_replays.end()) replay = it->second;
+        }
+
+        BlockReceipts receipts;
+        if (replay) {
+            WAIT_LOCK(m_mutex, lock);
+            m_cond_done.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return replay->done; });
+            if (!replay->ok) return false;
+            receipts = std::move(replay->receipts);
+        } else if (!ReplayBlock(block, pindex, receipts)) {
+            return false;
+        }
+
+        std::map<dev::Address, std::pair<CHeightTxIndexKey, std::vector<uint256>>> heightIndexes;
+        for (const auto& [hashTx, tri] : receipts) {
+            for (const TransactionReceiptInfo& receipt : tri) {
+                for (const dev::eth::LogEntry& log : receipt.logs) {
+                    if (!heightIndexes.count(log.address)) {
+                        heightIndexes[log.address].first = CHeightTxIndexKey(pindex->nHeight, log.address);
+                    }
+                    heightIndexes[log.address].second.push_back(h256Touint(hashTx));
+                }
+            }
+        }
+
+        pstorageresult->addReplayedResults(std::move(receipts));
+        for (const auto& e : heightIndexes) {
+            if (!pblocktree->WriteHeightIndex(e.second.first, e.second.second)) {
+                return error("%s: failed to write height index", __func__);
+            }
+        }
+        if (pstorageresult->pendingResultsUsage() > MAX_PENDING_RESULTS_USAGE && !pstorageresult->flushResults()) {
+            return error("%s: failed to write the receipts", __func__);
+        }
+    }
+    m_cond_done.notify_all();
+
+    ScheduleReplays(pindex);
+
+    // The delegation index is built from the receipts, once the ones of the chain are written
+    if (!m_delegation_index) {
+        LOCK(cs_main);
+        if (m_chainstate->m_chain.Tip() == pindex) {
+            if (!GetYodyDelegation().BuildDelegationIndex(m_chainman)) {
+                return error("%s: failed to build the delegation index", __func__);
+            }
+            m_delegation_index = true;
+        }
+    }
+
+    return true;
+}
+
+bool ReceiptIndex::CommitInternal(CDBBatch& batch)
+{
+    if (!pstorageresult->flushResults()) {
+        return error("%s: failed to write the receipts", __func__);
+    }
+    return BaseIndex::CommitInternal(batch);
+}
+
+bool ReceiptIndex::BlockUntilReceipts(const CBlock& block, const CBlockIndex* pindex)
+{
+    WAIT_LOCK(m_mutex, lock);
+    while (!HasReceipts(block, pindex)) {
+        if (ShutdownRequested()) return false;
+        m_cond_done.wait_for(lock, std::chrono::milliseconds{100});
+    }
+    return true;
+}
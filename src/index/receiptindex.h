@@ -0,0 +1,100 @@
+#ifndef BITCOIN_INDEX_RECEIPTINDEX_H
+#define BITCOIN_INDEX_RECEIPTINDEX_H
+
+#include <chain.h>
+#include <index/base.h>
+#include <sync.h>
+#include <yody/storageresults.h>
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <thread>
+
+class ChainstateManager;
+
+/** Number of blocks replayed ahead of the one written by the receipt index, per replay thread. */
+static constexpr int RECEIPTINDEX_REPLAY_AHEAD{16};
+
+/**
+ * ReceiptIndex fills the receipts database (-logevents) with the receipts of the blocks
+ * connected before it was enabled, so the log events can be enabled without a reindex.
+ * The contract transactions of such blocks are executed again on a private copy of the
+ * state at the roots of the previous block, and their receipts, height index and delegation
+ * events are written as ConnectBlock writes them for the new blocks, which keeps writing the
+ * receipts of the blocks it connects. While the index is behind the tip, the blocks ahead
+ * of the one written are replayed in parallel on the replay threads, the state of each
+ * block being independent from the others.
+ */
+class ReceiptIndex final : public BaseIndex
+{
+private:
+    /** Receipts of the contract transactions of a block, in block order. */
+    using BlockReceipts = std::vector<std::pair<dev::h256, std::vector<TransactionReceiptInfo>>>;
+
+    struct Replay {
+        const CBlockIndex* pindex{nullptr};
+        bool done{false};
+        bool ok{false};
+        BlockReceipts receipts;
+    };
+
+    std::unique_ptr<BaseIndex::DB> m_db;
+
+    ChainstateManager& m_chainman;
+
+    /** Whether the receipts of the blocks in the chain when the index was created are missing. */
+    const bool m_replay;
+    const int m_threads;
+
+    /** Whether the delegation index is built, else it is built when the index reaches the tip. */
+    bool m_delegation_index{false};
+
+    Mutex m_mutex;
+    std::condition_variable m_cond_queue;
+    /** Notified when a replay is done and when a block is written */
+    std::condition_variable m_cond_done;
+    std::map<uint256, std::shared_ptr<Replay>> m_replays GUARDED_BY(m_mutex);
+    std::deque<std::shared_ptr<Replay>> m_queue GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_replay_threads;
+
+    void ThreadReplay();
+
+    /** Queue the replays of the blocks of the active chain after pindex which are not queued yet */
+    void ScheduleReplays(const CBlockIndex* pindex);
+
+    /** Execute the contract transactions of a block again and collect their receipts */
+    bool ReplayBlock(const CBlock& block, const CBlockIndex* pindex, BlockReceipts& receipts) const;
+
+    /** Whether the receipts of the block are in the receipts database, with the block hash */
+    bool HasReceipts(const CBlock& block, const CBlockIndex* pindex) const;
+
+protected:
+    /// Override base class init to skip the blocks whose receipts were written by ConnectBlock.
+    bool Init() override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    /// Write the replayed receipts before the locator, so the index is never ahead of them.
+    bool CommitInternal(CDBBatch& batch) override;
+
+    BaseIndex::DB& GetDB() const override { return *m_db; }
+
+    const char* GetName() const override { return "receiptindex"; }
+
+public:
+    /// Constructs the index, which replays the blocks already in the chain when f_wipe is set.
+    explicit ReceiptIndex(ChainstateManager& chainman, size_t n_cache_size, bool f_memory = false, bool f_wipe = false, int n_threads = 0);
+
+    virtual ~ReceiptIndex() override;
+
+    /// Block until the receipts of a block are written, by this index or by ConnectBlock.
+    /// Returns false if shutdown was requested before.
+    bool BlockUntilReceipts(const CBlock& block, const CBlockIndex* pindex);
+};
+
+/// The global receipt index, running while the log events are enabled. May be null.
+extern std::unique_ptr<ReceiptIndex> g_receipt_index;
+
+#endif // BITCOIN_INDEX_RECEIPTINDEX_H
@@ -21,8 +21,11 @@
 #include <hash.h>
 #include <httprpc.h>
 #include <httpserver.h>
+#include <index/addressindex.h>
 #include <index/blockfilterindex.h>
 #include <index/coinstatsindex.h>
+#include <index/logindex.h>
+#include <index/receiptindex.h>
 #include <index/txindex.h>
 #include <init/common.h>
 #include <interfaces/chain.h>
@@ -41,6 +44,7 @@
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <policy/settings.h>
+#include <pos.h>
 #include <protocol.h>
 #include <rpc/blockchain.h>
 #include <rpc/register.h>
@@ -72,6 +76,8 @@
 #endif
 #include <walletinitinterface.h>
 #include <key_io.h>
+#include <yody/mempoolpreexec.h>
+#include <yody/statepruning.h>
 
 #include <functional>
 #include <set>
@@ -177,6 +183,15 @@ void Interrupt(NodeContext& node)
     if (g_coin_stats_index) {
         g_coin_stats_index->Interrupt();
     }
+    if (g_log_index) {
+        g_log_index->Interrupt();
+    }
+    if (g_receipt_index) {
+        g_receipt_index->Interrupt();
+    }
+    if (g_address_index) {
+        g_address_index->Interrupt();
+    }
 }
 
 void Shutdown(NodeContext& node)
@@ -215,6 +230,8 @@ void Shutdown(NodeContext& node)
     // Because these depend on each-other, we make sure that neither can be
     // using the other before destroying them.
     if (node.peerman) UnregisterValidationInterface(node.peerman.get());
+    UnregisterValidationInterface(&g_call_contract_cache);
+    if (g_mempool_preexec) g_mempool_preexec->Stop();
     if (node.connman) node.connman->Stop();
 
     StopTorControl();
@@ -224,10 +241,12 @@ void Shutdown(NodeContext& node)
     if (node.scheduler) node.scheduler->stop();
     if (node.chainman && node.chainman->m_load_block.joinable()) node.chainman->m_load_block.join();
     StopScriptCheckWorkerThreads();
+    StopContractExecWorkerThreads();
 
     // After the threads that potentially access these pointers have been stopped,
     // destruct and reset all to nullptr.
     node.peerman.reset();
+    g_mempool_preexec.reset();
     node.connman.reset();
     node.banman.reset();
     node.addrman.reset();
@@ -262,6 +281,18 @@ void Shutdown(NodeContext& node)
         g_coin_stats_index->Stop();
         g_coin_stats_index.reset();
     }
+    if (g_log_index) {
+        g_log_index->Stop();
+        g_log_index.reset();
+    }
+    if (g_receipt_index) {
+        g_receipt_index->Stop();
+        g_receipt_index.reset();
+    }
+    if (g_address_index) {
+        g_address_index->Stop();
+        g_address_index.reset();
+    }
     ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Stop(); });
     DestroyAllBlockFilterIndexes();
 
@@ -282,7 +313,13 @@ void Shutdown(NodeContext& node)
         pblocktree.reset();
         pstorageresult.reset();
         globalState.reset();
+        pstatesnapshot.reset();
+        g_state_node_cache.reset();
         globalSealEngine.reset();
+        g_call_contract_cache.Clear();
+        g_contract_exec_memo.Clear();
+        g_spent_coin_window.Clear();
+        g_dgp_cache.clear();
     }
     for (const auto& client : node.chain_clients) {
         client->stop();
@@ -413,6 +450,8 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s, signet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex(), signetChainParams->GetConsensus().nMinimumChainWork.GetHex()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
     argsman.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-parcontracts=<n>", strprintf("Set the number of threads executing the contract transactions of a block before they are committed in block order (up to %d, 0 or 1 = serial execution, default: %d)", MAX_CONTRACTEXEC_THREADS + 1, DEFAULT_CONTRACTEXEC_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-mempoolpreexec", strprintf("Execute the contract transactions of the mempool on the tip in the background, so that the staker packs them by the gas they use and skips the ones which fail (default: %u)", DEFAULT_MEMPOOL_PREEXEC), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-pid=<file>", strprintf("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", BITCOIN_PID_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-prune=<n>", strprintf("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex, -coinstatsindex and -rescan. "
@@ -436,6 +475,9 @@ void SetupServerArgs(ArgsManager& argsman)
                  " If <type> is not supplied or if <type> = 1, indexes for all known types are enabled.",
                  ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-logevents", strprintf("Maintain a full EVM log index, used by searchlogs and gettransactionreceipt rpc calls (default: %u)", DEFAULT_LOGEVENTS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-logindex", strprintf("Maintain a topic and bloom index of the EVM logs, used to speed up the searchlogs rpc call. Implies -logevents (default: %u)", DEFAULT_LOGINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-statepruning=<n>", strprintf("Delete the contract state trie nodes which are no longer used by the last <n> blocks. The state of older blocks can no longer be read or disconnected (default: %u, 0 = keep all, minimum: the checkpoint span)", DEFAULT_STATE_PRUNING), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-compactstate", "Rebuild the contract state databases at startup with only the trie nodes used by the recent blocks", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-addrindex", strprintf("Maintain a full address index (default: %u)", DEFAULT_ADDRINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-deleteblockchaindata", "Delete the local copy of the block chain data", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-forceinitialblocksdownloadmode", strprintf("Force initial blocks download mode for the node (default: %u)", DEFAULT_FORCE_INITIAL_BLOCKS_DOWNLOAD_MODE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -767,6 +809,11 @@ void InitParameterInteraction(ArgsManager& args)
             LogPrintf("%s: parameter interaction: -whitelistforcerelay=1 -> setting -whitelistrelay=1\n", __func__);
     }
 
+    if (args.GetBoolArg("-logindex", DEFAULT_LOGINDEX)) {
+        if (args.SoftSetBoolArg("-logevents", true))
+            LogPrintf("%s: parameter interaction: -logindex=1 -> setting -logevents=1\n", __func__);
+    }
+
 #ifdef ENABLE_WALLET
     // Set the required parameters for super staking
     if(args.GetBoolArg("-superstaking", DEFAULT_SUPER_STAKE))
@@ -929,6 +976,10 @@ bool AppInitParameterInteraction(const ArgsManager& args)
             return InitError(_("Prune mode is incompatible with -txindex."));
         if (args.GetBoolArg("-coinstatsindex", DEFAULT_COINSTATSINDEX))
             return InitError(_("Prune mode is incompatible with -coinstatsindex."));
+        if (args.GetBoolArg("-logindex", DEFAULT_LOGINDEX))
+            return InitError(_("Prune mode is incompatible with -logindex."));
+        if (args.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX))
+            return InitError(_("Prune mode is incompatible with -addrindex."));
     }
 
     // -bind and -whitebind can't be set when not listening
@@ -1017,6 +1068,18 @@ bool AppInitParameterInteraction(const ArgsManager& args)
         fPruneMode = true;
     }
 
+    // state pruning; the number of blocks whose contract state is kept
+    nStatePruning = args.GetArg("-statepruning", DEFAULT_STATE_PRUNING);
+    if (nStatePruning < 0) {
+        return InitError(_("State pruning cannot be configured with a negative value."));
+    }
+    if (nStatePruning > 0) {
+        if (nStatePruning < chainparams.GetConsensus().MaxCheckpointSpan()) {
+            return InitError(strprintf(_("State pruning configured below the minimum of %d blocks.  Please use a higher number."), chainparams.GetConsensus().MaxCheckpointSpan()));
+        }
+        LogPrintf("State pruning configured to keep the contract state of the last %d blocks.\n", nStatePruning);
+    }
+
     nConnectTimeout = args.GetArg("-timeout", DEFAULT_CONNECT_TIMEOUT);
     if (nConnectTimeout <= 0) {
         nConnectTimeout = DEFAULT_CONNECT_TIMEOUT;
@@ -1401,6 +1464,17 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
         StartScriptCheckWorkerThreads(script_threads);
     }
 
+    int contract_threads = args.GetArg("-parcontracts", DEFAULT_CONTRACTEXEC_THREADS);
+
+    // Subtract 1 because the thread connecting the block joins the contract execution threads
+    contract_threads = std::min(std::max(contract_threads - 1, 0), MAX_CONTRACTEXEC_THREADS);
+
+    if (contract_threads >= 1) {
+        LogPrintf("Contract execution uses %d additional threads\n", contract_threads);
+        g_parallel_contract_exec = true;
+        StartContractExecWorkerThreads(contract_threads);
+    }
+
     assert(!node.scheduler);
     node.scheduler = std::make_unique<CScheduler>();
 
@@ -1477,6 +1551,7 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     node.peerman = PeerManager::make(chainparams, *node.connman, *node.addrman, node.banman.get(),
                                      *node.scheduler, chainman, *node.mempool, ignores_incoming_txs);
     RegisterValidationInterface(node.peerman.get());
+    RegisterValidationInterface(&g_call_contract_cache);
 
     // sanitize comments per BIP-0014, format user agent and check total size
     std::vector<std::string> uacomments;
@@ -1602,11 +1677,10 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     nTotalCache = std::max(nTotalCache, nMinDbCache << 20); // total cache cannot be less than nMinDbCache
     nTotalCache = std::min(nTotalCache, nMaxDbCache << 20); // total cache cannot be greater than nMaxDbcache
     int64_t nBlockTreeDBCache = std::min(nTotalCache / 8, nMaxBlockDBCache << 20);
-    if (args.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX)) {
-        // enable 3/4 of the cache if addressindex and/or spentindex is enabled
-        nBlockTreeDBCache = nTotalCache * 3 / 4;
-    }
     nTotalCache -= nBlockTreeDBCache;
+    // enable 3/4 of the cache if addressindex and/or spentindex is enabled
+    int64_t nAddressIndexCache = args.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX) ? nTotalCache * 3 / 4 : 0;
+    nTotalCache -= nAddressIndexCache;
     int64_t nTxIndexCache = std::min(nTotalCache / 8, args.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxTxIndexCache << 20 : 0);
     nTotalCache -= nTxIndexCache;
     int64_t filter_index_cache = 0;
@@ -1616,6 +1690,8 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
         filter_index_cache = max_cache / n_indexes;
         nTotalCache -= filter_index_cache * n_indexes;
     }
+    int64_t nStateNodeCache = std::min(nTotalCache / 8, nMaxStateNodeCache << 20);
+    nTotalCache -= nStateNodeCache;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
@@ -1626,14 +1702,19 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     if (args.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
         LogPrintf("* Using %.1f MiB for transaction index database\n", nTxIndexCache * (1.0 / 1024 / 1024));
     }
+    if (args.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX)) {
+        LogPrintf("* Using %.1f MiB for address index database\n", nAddressIndexCache * (1.0 / 1024 / 1024));
+    }
     for (BlockFilterType filter_type : g_enabled_filter_types) {
         LogPrintf("* Using %.1f MiB for %s block filter index database\n",
                   filter_index_cache * (1.0 / 1024 / 1024), BlockFilterTypeName(filter_type));
     }
+    LogPrintf("* Using %.1f MiB for contract state trie node cache\n", nStateNodeCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1f MiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1f MiB for in-memory UTXO set (plus up to %.1f MiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
 
     bool fLoaded = false;
+    bool fReplayReceipts = false;
     while (!fLoaded && !ShutdownRequested()) {
         const bool fReset = fReindex;
         auto is_coinsview_empty = [&](CChainState* chainstate) EXCLUSIVE_LOCKS_REQUIRED(::cs_main) {
@@ -1660,7 +1741,13 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
                 pblocktree.reset();
                 pstorageresult.reset();
                 globalState.reset();
+                pstatesnapshot.reset();
+                g_state_node_cache.reset();
                 globalSealEngine.reset();
+                g_call_contract_cache.Clear();
+                g_contract_exec_memo.Clear();
+                g_spent_coin_window.Clear();
+                g_dgp_cache.clear();
                 pblocktree.reset(new CBlockTreeDB(nBlockTreeDBCache, false, fReset));
 
                 if (fReset) {
@@ -1721,30 +1808,38 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
                 dev::eth::BaseState existsYodystate = fStatus ? dev::eth::BaseState::PreExisting : dev::eth::BaseState::Empty;
                 globalState = std::unique_ptr<YodyState>(new YodyState(dev::u256(0), YodyState::openDB(dirYody, hashDB, dev::WithExisting::Trust), dirYody, existsYodystate));
                 globalSealEngine = std::unique_ptr<dev::eth::SealEngineFace>(cp.createSealEngine());
+                g_state_node_cache = std::make_shared<dev::TrieNodeCache>(nStateNodeCache);
+                pstatesnapshot = std::make_shared<StateSnapshot>(yodyStateDir / "snapshot", nStateSnapshotDBCache << 20, false, fReset);
 
                 pstorageresult.reset(new StorageResults(yodyStateDir.string()));
                 if (fReset) {
                     pstorageresult->wipeResults();
                 }
+                if (!pstorageresult->upgradeResults()) {
+                    strLoadError = _("Error upgrading the receipts database");
+                    break;
+                }
 
                 fRecordLogOpcodes = args.IsArgSet("-record-log-opcodes");
                 fIsVMlogFile = fs::exists(gArgs.GetDataDirNet() / "vmExecLogs.json");
 
-                if (fAddressIndex != args.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex to change -addrindex");
-                    break;
-                }
-
-                // Check for changed -logevents state
+                // Check for changed -logevents state, the receipts of the chain are replayed by the receipt index
                 if (fLogEvents != args.GetBoolArg("-logevents", DEFAULT_LOGEVENTS) && !fLogEvents) {
-                    strLoadError = _("You need to rebuild the database using -reindex to enable -logevents");
-                    break;
+                    if (nStatePruning > 0) {
+                        strLoadError = _("You need to rebuild the database using -reindex to enable -logevents with -statepruning");
+                        break;
+                    }
+                    fReplayReceipts = true;
+                    fLogEvents = true;
+                    pblocktree->WriteFlag("logevents", fLogEvents);
                 }
 
                 if (!args.GetBoolArg("-logevents", DEFAULT_LOGEVENTS))
                 {
                     pstorageresult->wipeResults();
                     pblocktree->WipeHeightIndex();
+                    pblocktree->WipeDelegationIndex();
+                    pblocktree->WriteFlag("delegationindex", false);
                     fLogEvents = false;
                     pblocktree->WriteFlag("logevents", fLogEvents);
                 }
@@ -1810,6 +1905,30 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
             {
                 LOCK(cs_main);
                 CChain& active_chain = chainman.ActiveChain();
+                if (args.GetBoolArg("-compactstate", false) && active_chain.Tip() != nullptr) {
+                    // Keep the roots which can still be disconnected
+                    uiInterface.InitMessage(_("Compacting state database…").translated);
+                    const int nFirstHeight = std::max(0, active_chain.Height() - std::max(nStatePruning, chainparams.GetConsensus().MaxCheckpointSpan()));
+                    std::vector<std::pair<dev::h256, dev::h256>> roots;
+                    for (int height = nFirstHeight; height <= active_chain.Height(); height++) {
+                        roots.emplace_back(uintToh256(active_chain[height]->hashStateRoot), uintToh256(active_chain[height]->hashUTXORoot));
+                    }
+                    const std::string dirYody((gArgs.GetDataDirNet() / "stateYody").string());
+                    globalState.reset();
+                    const bool fCompacted = CompactYodyState(dirYody, roots, nFirstHeight, nStatePruning > 0);
+                    globalState = std::unique_ptr<YodyState>(new YodyState(dev::u256(0), YodyState::openDB(dirYody, dev::sha3(dev::rlp("")), dev::WithExisting::Trust), dirYody, dev::eth::BaseState::PreExisting));
+                    if (!fCompacted) {
+                        strLoadError = _("Error compacting the state database");
+                        break;
+                    }
+                }
+                // A journaled database keeps counting the references of its nodes when the pruning is turned off,
+                // and both databases share the trie node cache
+                for (dev::OverlayDB* db : {&globalState->db(), &globalState->dbUtxo()}) {
+                    if (nStatePruning > 0 || db->journaled())
+                        db->setJournaling();
+                    db->setNodeCache(g_state_node_cache);
+                }
                 if(active_chain.Tip() != nullptr){
                 globalState->setRoot(uintToh256(active_chain.Tip()->hashStateRoot));
                 globalState->setRootUTXO(uintToh256(active_chain.Tip()->hashUTXORoot));
@@ -1820,6 +1939,19 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
                 }
                 globalState->db().commit();
                 globalState->dbUtxo().commit();
+                // The genesis state is kept, its nodes are not released with the commits discarded by the blocks
+                globalState->db().keepWritten();
+                globalState->dbUtxo().keepWritten();
+
+                // Bring the state snapshot to the tip, or copy it again from the state trie
+                if (!pstatesnapshot->Rewind(active_chain.Height()) || pstatesnapshot->root() != globalState->rootHash()) {
+                    uiInterface.InitMessage(_("Generating state snapshot…").translated);
+                    if (!pstatesnapshot->Generate(globalState->db(), globalState->rootHash(), active_chain.Height())) {
+                        strLoadError = _("Error generating the state snapshot");
+                        break;
+                    }
+                }
+                globalState->setSnapshot(pstatesnapshot);
             }
             ///////////////////////////////////////////////////////////////
 
@@ -1934,6 +2066,57 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
         }
     }
 
+    fAddressIndex = args.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX);
+    if (fAddressIndex) {
+        g_address_index = std::make_unique<AddressIndex>(nAddressIndexCache, false, fReindex);
+        if (!g_address_index->Start(chainman.ActiveChainstate())) {
+            return false;
+        }
+    }
+
+    if (args.GetBoolArg("-mempoolpreexec", DEFAULT_MEMPOOL_PREEXEC)) {
+        g_mempool_preexec = std::make_unique<MempoolPreExecutor>(chainman, *node.mempool);
+        g_mempool_preexec->Start();
+    }
+
+    // The contract index is kept with the contract state, build it if the database is older than the index
+    bool fContractIndex = false;
+    if (!fReindex && !(pblocktree->ReadFlag("contractindex", fContractIndex) && fContractIndex)) {
+        uiInterface.InitMessage(_("Building contract index…").translated);
+        LOCK(cs_main);
+        if (!BuildContractIndex()) {
+            return InitError(_("Error building the contract index"));
+        }
+    }
+
+    if (fLogEvents) {
+        g_receipt_index = std::make_unique<ReceiptIndex>(chainman, /* cache size */ 0, false, fReindex || fReplayReceipts,
+                                                         std::clamp(GetNumCores() - 1, 0, MAX_CONTRACTEXEC_THREADS));
+        if (!g_receipt_index->Start(chainman.ActiveChainstate())) {
+            return false;
+        }
+    }
+
+    // The delegation index is kept with the log events, build it if the database is older than the index,
+    // the receipt index builds it when it is done replaying the receipts
+    bool fDelegationIndex = false;
+    if (fLogEvents && !fReindex && g_receipt_index->GetSummary().synced && !(pblocktree->ReadFlag("delegationindex", fDelegationIndex) && fDelegationIndex)) {
+        uiInterface.InitMessage(_("Building delegation index…").translated);
+        if (!GetYodyDelegation().BuildDelegationIndex(chainman)) {
+            return InitError(_("Error building the delegation index"));
+        }
+    }
+
+    if (args.GetBoolArg("-logindex", DEFAULT_LOGINDEX)) {
+        if (!args.GetBoolArg("-logevents", DEFAULT_LOGEVENTS)) {
+            return InitError(_("-logindex requires -logevents."));
+        }
+        g_log_index = std::make_unique<LogIndex>(/* cache size */ 0, false, fReindex);
+        if (!g_log_index->Start(chainman.ActiveChainstate())) {
+            return false;
+        }
+    }
+
     // ********************************************************* Step 9: load wallet
     for (const auto& client : node.chain_clients) {
         if (!client->load()) {
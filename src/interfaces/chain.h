@@ -30,12 +30,16 @@ enum class RBFTransactionState;
 struct bilingual_str;
 struct CBlockLocator;
 struct FeeCalculation;
+struct LogFilter;
 struct NodeContext;
+struct TransactionReceiptInfo;
 class ChainstateManager;
 class CTxMemPool;
 class CBlockIndex;
 class CCoinsViewCache;
 
+namespace dev { namespace eth { struct LogEntry; } }
+
 namespace interfaces {
 
 class Handler;
@@ -160,6 +164,16 @@ public:
     //! Get map of the immature stakes.
     virtual std::map<COutPoint, uint32_t> getImmatureStakes() = 0;
 
+    //! Check that the address index is synced up to a height, always true
+    //! when the index is disabled.
+    virtual bool isAddressIndexSynced(int height) = 0;
+
+    //! Search the logs of the contract receipts matching a filter, calling fn
+    //! for each until it returns false. Only the data of the matching logs is
+    //! decoded.
+    using SearchLogsFn = std::function<bool(const TransactionReceiptInfo& receipt, const dev::eth::LogEntry& log)>;
+    virtual bool searchLogs(const LogFilter& filter, const SearchLogsFn& fn) = 0;
+
     //! Look up unspent output information. Returns coins in the mempool and in
     //! the current chain UTXO set. Iterates through all the keys in the map and
     //! populates the values.
@@ -8,6 +8,7 @@
 #include <amount.h>
 #include <chain.h>
 #include <chainparams.h>
+#include <checkqueue.h>
 #include <coins.h>
 #include <consensus/consensus.h>
 #include <consensus/merkle.h>
@@ -33,6 +34,8 @@
 #endif
 
 #include <algorithm>
+#include <set>
+#include <tuple>
 #include <utility>
 
 unsigned int nMaxStakeLookahead = MAX_STAKE_LOOKAHEAD;
@@ -516,8 +519,28 @@ bool BlockAssembler::AttemptToAddContractToBlock(CTxMemPool::txiter iter, uint64
         return false;
     }
     std::vector<YodyTransaction> yodyTransactions = resultConverter.first;
+
+    // With -mempoolpreexec the tx may have been executed on the tip already, then the txs known to fail
+    // are skipped and the others are packed by the gas they used instead of their gas limit. The execution
+    // of a tx spending the outputs of a tx of the block may change after it, so it is not reused then.
+    std::shared_ptr<const ContractPreExecution> preExecution = iter->GetPreExecution();
+    if(preExecution && (preExecution->hashTip != m_chainstate.m_chain.Tip()->GetBlockHash() || preExecution->vGasUsed.size() != yodyTransactions.size()))
+        preExecution.reset();
+    for(const CTxIn& txin : iter->GetTx().vin){
+        if(!preExecution)
+            break;
+        std::optional<CTxMemPool::txiter> parent = m_mempool.GetIter(txin.prevout.hash);
+        if(parent && inBlock.count(*parent))
+            preExecution.reset();
+    }
+    if(preExecution && preExecution->fFailed){
+        LogPrint(BCLog::MEMPOOL, "AttemptToAddContractToBlock(): Skip the contract tx %s which failed on the tip\n", iter->GetTx().GetHash().ToString());
+        return false;
+    }
+
     dev::u256 txGas = 0;
-    for(YodyTransaction yodyTransaction : yodyTransactions){
+    for(size_t i = 0; i < yodyTransactions.size(); i++){
+        const YodyTransaction& yodyTransaction = yodyTransactions[i];
         txGas += yodyTransaction.gas();
         if(txGas > txGasLimit) {
             // Limit the tx gas limit by the soft limit if such a limit has been specified.
@@ -525,7 +548,8 @@ bool BlockAssembler::AttemptToAddContractToBlock(CTxMemPool::txiter iter, uint64
             return false;
         }
 
-        if(bceResult.usedGas + yodyTransaction.gas() > softBlockGasLimit){
+        const dev::u256 gasNeeded = preExecution ? dev::u256(preExecution->vGasUsed[i]) : yodyTransaction.gas();
+        if(bceResult.usedGas + gasNeeded > softBlockGasLimit){
             // If this transaction's gasLimit could cause block gas limit to be exceeded, then don't add it
             // Log if the contract is the only contract tx
             if(bceResult.usedGas == 0)
@@ -540,6 +564,8 @@ bool BlockAssembler::AttemptToAddContractToBlock(CTxMemPool::txiter iter, uint64
     }
     // We need to pass the DGP's block gas limit (not the soft limit) since it is consensus critical.
     ByteCodeExec exec(*pblock, yodyTransactions, hardBlockGasLimit, m_chainstate.m_chain.Tip(), m_chainstate.m_chain);
+    // The tx is added after the transactions already in the block, so its results can be reused to connect it
+    exec.UseMemo(iter->GetTx().GetHash(), pblock->vtx.size(), true);
     if(!exec.performByteCode()){
         //error, don't add contract
         globalState->setRoot(oldHashStateRoot);
@@ -938,6 +964,27 @@ public:
 
         return true;
     }
+
+    /** Addresses of the wallet which can be in a delegation, read one by one from the delegation index */
+    std::set<uint160> GetWalletAddresses(CWallet *pwallet) const
+    {
+        AssertLockHeld(pwallet->cs_wallet);
+        std::set<uint160> addresses;
+        for(const auto& item : pwallet->m_address_book)
+        {
+            if(std::holds_alternative<PKHash>(item.first))
+                addresses.insert(uint160(std::get<PKHash>(item.first)));
+        }
+        for(const auto& item : pwallet->mapSuperStaker)
+        {
+            addresses.insert(item.second.stakerAddress);
+        }
+        for(const auto& item : pwallet->mapDelegation)
+        {
+            addresses.insert(item.second.delegateAddress);
+        }
+        return addresses;
+    }
 };
 
 class DelegationsStaker : public DelegationFilterBase
@@ -952,7 +999,6 @@ public:
 
     DelegationsStaker(CWallet *_pwallet):
         pwallet(_pwallet),
-        cacheHeight(0),
         type(StakerType::STAKER_NORMAL),
         fAllowWatchOnly(false)
     {
@@ -1032,40 +1078,28 @@ public:
 
     void Update(int32_t nHeight)
     {
-        if(pwallet->fUpdatedSuperStaker)
-        {
-            // Clear cache if updated
-            cacheHeight = 0;
-            cacheDelegationsStaker.clear();
-            pwallet->fUpdatedSuperStaker = false;
-        }
+        // The super staker configuration is applied by the filter, nothing is cached to clear
+        pwallet->fUpdatedSuperStaker = false;
 
+        // Get the delegations to the addresses of the wallet from the delegation index
         std::map<uint160, Delegation> delegations_staker;
-        int checkpointSpan = Params().GetConsensus().CheckpointSpan(nHeight);
-        if(nHeight <= checkpointSpan)
-        {
-            // Get delegations from events
-            std::vector<DelegationEvent> events;
-            yodyDelegations.FilterDelegationEvents(events, *this, pwallet->chain().chainman());
-            delegations_staker = yodyDelegations.DelegationsFromEvents(events);
-        }
-        else
+        for(const uint160& staker : GetWalletAddresses(pwallet))
         {
-            // Update the cached delegations for the staker, older then the sync checkpoint (500 blocks)
-            int cpsHeight = nHeight - checkpointSpan;
-            if(cacheHeight < cpsHeight)
+            std::map<uint160, Delegation> delegations;
+            if(!yodyDelegations.GetDelegationsForStaker(staker, delegations))
+                break;
+
+            for(const auto& item : delegations)
             {
-                std::vector<DelegationEvent> events;
-                yodyDelegations.FilterDelegationEvents(events, *this, pwallet->chain().chainman(), cacheHeight, cpsHeight);
-                yodyDelegations.UpdateDelegationsFromEvents(events, cacheDelegationsStaker);
-                cacheHeight = cpsHeight;
+                DelegationEvent event;
+                static_cast<Delegation&>(event.item) = item.second;
+                event.item.delegate = item.first;
+                event.type = DelegationType::DELEGATION_ADD;
+                if(Match(event))
+                {
+                    delegations_staker[item.first] = item.second;
+                }
             }
-
-            // Update the wallet delegations
-            std::vector<DelegationEvent> events;
-            yodyDelegations.FilterDelegationEvents(events, *this, pwallet->chain().chainman(), cacheHeight + 1);
-            delegations_staker = cacheDelegationsStaker;
-            yodyDelegations.UpdateDelegationsFromEvents(events, delegations_staker);
         }
         pwallet->updateDelegationsStaker(delegations_staker);
     }
@@ -1073,8 +1107,6 @@ public:
 private:
     CWallet *pwallet;
     YodyDelegation yodyDelegations;
-    int32_t cacheHeight;
-    std::map<uint160, Delegation> cacheDelegationsStaker;
     std::vector<uint160> allowList;
     std::vector<uint160> excludeList;
     int type;
@@ -1102,33 +1134,17 @@ public:
     {
         if(fLogEvents)
         {
-            // When log events are enabled, search the log events to get complete list of my delegations
-            int checkpointSpan = Params().GetConsensus().CheckpointSpan(nHeight);
-            if(nHeight <= checkpointSpan)
+            // When log events are enabled, read the delegations of the addresses of the wallet from the delegation index
+            std::map<uint160, Delegation> delegations;
+            for(const uint160& address : GetWalletAddresses(pwallet))
             {
-                // Get delegations from events
-                std::vector<DelegationEvent> events;
-                yodyDelegations.FilterDelegationEvents(events, *this, pwallet->chain().chainman());
-                pwallet->m_my_delegations = yodyDelegations.DelegationsFromEvents(events);
-            }
-            else
-            {
-                // Update the cached delegations for the staker, older then the sync checkpoint (500 blocks)
-                int cpsHeight = nHeight - checkpointSpan;
-                if(cacheHeight < cpsHeight)
+                Delegation delegation;
+                if(pwallet->HasPrivateKey(PKHash(address), fAllowWatchOnly) && yodyDelegations.GetDelegationForDelegate(address, delegation))
                 {
-                    std::vector<DelegationEvent> events;
-                    yodyDelegations.FilterDelegationEvents(events, *this, pwallet->chain().chainman(), cacheHeight, cpsHeight);
-                    yodyDelegations.UpdateDelegationsFromEvents(events, cacheMyDelegations);
-                    cacheHeight = cpsHeight;
+                    delegations[address] = delegation;
                 }
-
-                // Update the wallet delegations
-                std::vector<DelegationEvent> events;
-                yodyDelegations.FilterDelegationEvents(events, *this, pwallet->chain().chainman(), cacheHeight + 1);
-                pwallet->m_my_delegations = cacheMyDelegations;
-                yodyDelegations.UpdateDelegationsFromEvents(events, pwallet->m_my_delegations);
             }
+            pwallet->m_my_delegations = delegations;
         }
         else
         {
@@ -1291,18 +1307,56 @@ public:
     virtual ~IStakeMiner() {};
 };
 
-class SolveItem
+/** Number of stake candidates checked by one job of the staker workers */
+static const size_t STAKE_KERNEL_CHUNK = 1024;
+/** Number of block times checked in one pass over the stake candidates */
+static const size_t STAKE_SOLVE_TIMES = 4;
+
+typedef std::tuple<uint256, uint32_t, const CStakeKernel*> SolvedKernel;
+
+class StakeKernelCheck
 {
 public:
-    SolveItem(const COutPoint& _prevoutStake, const uint32_t& _blockTime, const bool& _delegate):
-        prevoutStake(_prevoutStake),
-        blockTime(_blockTime),
-        delegate(_delegate)
+    StakeKernelCheck() {}
+
+    StakeKernelCheck(const std::vector<CStakeKernel>* _kernels, size_t _from, size_t _to, const std::vector<uint32_t>* _blockTimes, std::vector<SolvedKernel>* _solved, RecursiveMutex* _cs_solved):
+        kernels(_kernels),
+        from(_from),
+        to(_to),
+        blockTimes(_blockTimes),
+        solved(_solved),
+        cs_solved(_cs_solved)
     {}
 
-    COutPoint prevoutStake;
-    uint32_t blockTime = 0;
-    bool delegate = false;
+    bool operator()()
+    {
+        std::vector<SolvedKernel> tmpSolved;
+        CheckStakeKernels(*kernels, from, to, *blockTimes, tmpSolved);
+        if(tmpSolved.size() > 0)
+        {
+            LOCK(*cs_solved);
+            solved->insert(solved->end(), tmpSolved.begin(), tmpSolved.end());
+        }
+        return true;
+    }
+
+    void swap(StakeKernelCheck& check)
+    {
+        std::swap(kernels, check.kernels);
+        std::swap(from, check.from);
+        std::swap(to, check.to);
+        std::swap(blockTimes, check.blockTimes);
+        std::swap(solved, check.solved);
+        std::swap(cs_solved, check.cs_solved);
+    }
+
+private:
+    const std::vector<CStakeKernel>* kernels = 0;
+    size_t from = 0;
+    size_t to = 0;
+    const std::vector<uint32_t>* blockTimes = 0;
+    std::vector<SolvedKernel>* solved = 0;
+    RecursiveMutex* cs_solved = 0;
 };
 
 class StakeMinerPriv
@@ -1320,7 +1374,7 @@ public:
     bool fAggressiveStaking = false;
     bool fError = false;
     int numThreads = 1;
-    boost::thread_group threads;
+    CCheckQueue<StakeKernelCheck> kernelQueue{4};
     mutable RecursiveMutex cs_worker;
     bool privateKeysDisabled = false;;
 
@@ -1341,8 +1395,8 @@ public:
     std::vector<COutPoint> setSelectedCoins;
     std::vector<COutPoint> setDelegateCoins;
     std::vector<COutPoint> prevouts;
+    std::vector<CStakeKernel> kernels;
     std::map<uint32_t, bool> mapSolveBlockTime;
-    std::multimap<uint256, SolveItem> mapSolvedBlock;
     std::map<uint32_t, std::vector<COutPoint>> mapSolveSelectedCoins;
     std::map<uint32_t, std::vector<COutPoint>> mapSolveDelegateCoins;
     uint32_t beginningTime = 0;
@@ -1384,6 +1438,14 @@ public:
         }
         if(pwallet) numThreads = pwallet->m_num_threads;
         if(pwallet) privateKeysDisabled = pwallet->IsWalletFlagSet(WALLET_FLAG_DISABLE_PRIVATE_KEYS);
+
+        // The staker thread joins the workers when checking the kernels
+        if(numThreads > 1) kernelQueue.StartWorkerThreads(numThreads - 1, threadName);
+    }
+
+    ~StakeMinerPriv()
+    {
+        kernelQueue.StopWorkerThreads();
     }
 
     void clearCache()
@@ -1400,8 +1462,8 @@ public:
         setSelectedCoins.clear();
         setDelegateCoins.clear();
         prevouts.clear();
+        kernels.clear();
         mapSolveBlockTime.clear();
-        mapSolvedBlock.clear();
         mapSolveSelectedCoins.clear();
         mapSolveDelegateCoins.clear();
         beginningTime = 0;
@@ -1663,6 +1725,7 @@ protected:
 
             LOCK(cs_main);
             d->pwallet->UpdateMinerStakeCache(true, d->prevouts, d->pindexPrev);
+            PrepareStakeKernels(d->pindexPrev, d->pblock->nBits, d->prevouts, d->pwallet->minerStakeCache, d->kernels);
         }
 
         d->beginningTime = GetAdjustedTime();
@@ -1697,63 +1760,52 @@ protected:
         if(searchInterval > 0) d->pwallet->m_last_coin_stake_search_interval = searchInterval;
     }
 
-    void SloveBlock(uint32_t blockTime, size_t delegateSize, size_t from, size_t to)
+    void SloveBlock(const uint32_t& blockTime)
     {
-        std::multimap<uint256, SolveItem> tmpSolvedBlock;
-        for(size_t i = from; i < to; i++)
-        {
-            const COutPoint &prevoutStake = d->prevouts[i];
-            uint256 hashProofOfStake;
-            if (CheckKernelCache(d->pindexPrev, d->pblock->nBits, blockTime, prevoutStake, d->pwallet->minerStakeCache, hashProofOfStake))
-            {
-                bool delegate = i < delegateSize;
-                tmpSolvedBlock.insert(std::make_pair(hashProofOfStake, SolveItem(prevoutStake, blockTime, delegate)));
-            }
-        }
-
-        if(tmpSolvedBlock.size() > 0)
+        // Check the next block times in the same pass over the candidates
+        std::vector<uint32_t> blockTimes(1, blockTime);
+        for(uint32_t nextTime = blockTime + d->stakeTimestampMask + 1; nextTime < d->endingTime && blockTimes.size() < STAKE_SOLVE_TIMES; nextTime += d->stakeTimestampMask + 1)
         {
-            LOCK(d->cs_worker);
-            d->mapSolveBlockTime[blockTime] = true;
-            d->mapSolvedBlock.insert(tmpSolvedBlock.begin(), tmpSolvedBlock.end());
+            if(d->mapSolveBlockTime.find(nextTime) != d->mapSolveBlockTime.end())
+                break;
+            d->mapSolveBlockTime[nextTime] = false;
+            blockTimes.push_back(nextTime);
         }
-    }
-
-    void SloveBlock(const uint32_t& blockTime)
-    {
-        // Init variables
-        size_t listSize = d->prevouts.size();
-        size_t delegateSize = d->setDelegateCoins.size();
 
         // Solve block
-        int numThreads = std::min(d->numThreads, (int)listSize);
-        if(listSize < 1000 || numThreads < 2)
+        size_t listSize = d->kernels.size();
+        std::vector<SolvedKernel> solved;
+        if(listSize < 1000 || d->numThreads < 2)
         {
-            SloveBlock(blockTime, delegateSize, 0, listSize);
+            CheckStakeKernels(d->kernels, 0, listSize, blockTimes, solved);
         }
         else
         {
-            size_t chunk = listSize / numThreads;
-            for(int i = 0; i < numThreads; i++)
+            std::vector<StakeKernelCheck> vChecks;
+            for(size_t from = 0; from < listSize; from += STAKE_KERNEL_CHUNK)
             {
-                size_t from = i * chunk;
-                size_t to = i == (numThreads -1) ? listSize : from + chunk;
-                d->threads.create_thread([this, blockTime, delegateSize, from, to]{SloveBlock(blockTime, delegateSize, from, to);});
+                vChecks.emplace_back(&d->kernels, from, std::min(from + STAKE_KERNEL_CHUNK, listSize), &blockTimes, &solved, &d->cs_worker);
             }
-            d->threads.join_all();
+            CCheckQueueControl<StakeKernelCheck> control(&d->kernelQueue);
+            control.Add(vChecks);
+            control.Wait();
         }
 
-        // Populate the list with the potential solwed blocks
-        for (auto it = d->mapSolvedBlock.begin(); it != d->mapSolvedBlock.end(); ++it)
+        // Populate the list with the potential solved blocks, ordered by proof hash
+        std::sort(solved.begin(), solved.end(), [](const SolvedKernel& a, const SolvedKernel& b){ return std::get<0>(a) < std::get<0>(b); });
+        size_t delegateSize = d->setDelegateCoins.size();
+        for(const SolvedKernel& item : solved)
         {
-            const SolveItem& item = (*it).second;
-            if(item.delegate)
+            uint32_t solvedTime = std::get<1>(item);
+            const CStakeKernel* kernel = std::get<2>(item);
+            d->mapSolveBlockTime[solvedTime] = true;
+            if(kernel->index < delegateSize)
             {
-                d->mapSolveDelegateCoins[item.blockTime].push_back(item.prevoutStake);
+                d->mapSolveDelegateCoins[solvedTime].push_back(kernel->prevout);
             }
             else
             {
-                d->mapSolveSelectedCoins[item.blockTime].push_back(item.prevoutStake);
+                d->mapSolveSelectedCoins[solvedTime].push_back(kernel->prevout);
             }
         }
     }
@@ -8,6 +8,7 @@
 #include <chainparams.h>
 #include <deploymentstatus.h>
 #include <external_signer.h>
+#include <index/addressindex.h>
 #include <init.h>
 #include <interfaces/chain.h>
 #include <interfaces/handler.h>
@@ -30,6 +31,7 @@
 #include <policy/settings.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
+#include <rpc/contract_util.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
 #include <shutdown.h>
@@ -543,6 +545,16 @@ public:
         LOCK(cs_main);
         return GetImmatureStakes(chainman());
     }
+    bool isAddressIndexSynced(int height) override
+    {
+        if (!g_address_index) return true;
+        IndexSummary summary = g_address_index->GetSummary();
+        return summary.synced && summary.best_block_height >= height;
+    }
+    bool searchLogs(const LogFilter& filter, const SearchLogsFn& fn) override
+    {
+        return SearchLogs(filter, chainman(), fn);
+    }
     std::optional<int> findLocatorFork(const CBlockLocator& locator) override
     {
         LOCK(cs_main);
@@ -457,6 +457,78 @@ bool CheckKernelCache(CBlockIndex *pindexPrev, unsigned int nBits, uint32_t nTim
     return false;
 }
 
+void PrepareStakeKernels(CBlockIndex* pindexPrev, unsigned int nBits, const std::vector<COutPoint>& prevouts, const std::map<COutPoint, CStakeCache>& cache, std::vector<CStakeKernel>& kernels)
+{
+    kernels.clear();
+    kernels.reserve(prevouts.size());
+
+    int nHeight = pindexPrev->nHeight + 1;
+    bool fNoBNOverflow = nHeight >= Params().GetConsensus().nReduceBlocktimeHeight;
+    arith_uint256 bnTarget;
+    bnTarget.SetCompact(nBits);
+    const arith_uint256 bnMax = ~arith_uint256();
+
+    for(size_t i = 0; i < prevouts.size(); i++)
+    {
+        const COutPoint& prevout = prevouts[i];
+        auto it = cache.find(prevout);
+        if(it == cache.end() || it->second.amount <= 0)
+            continue;
+        const CStakeCache& stake = it->second;
+
+        CStakeKernel kernel;
+        kernel.prevout = prevout;
+        kernel.blockFromTime = stake.blockFromTime;
+        kernel.index = i;
+
+        // hash(nStakeModifier + blockFrom.nTime + txPrev.vout.hash + txPrev.vout.n + nTime), the first block ends within txPrev.vout.hash
+        unsigned char data[64];
+        memcpy(data, pindexPrev->nStakeModifier.begin(), 32);
+        WriteLE32(data + 32, stake.blockFromTime);
+        memcpy(data + 36, prevout.hash.begin(), 28);
+        kernel.midstate.Write(data, sizeof(data));
+
+        arith_uint256 bnWeight = arith_uint256(stake.amount);
+        if(fNoBNOverflow)
+        {
+            // hash / weight <= target is hash < (target + 1) * weight, which holds for any hash when the product overflows
+            arith_uint256 bnTargetNext = bnTarget + 1;
+            kernel.maxHash = bnTargetNext > bnMax / bnWeight ? bnMax : bnTargetNext * bnWeight - 1;
+        }
+        else
+        {
+            kernel.maxHash = bnTarget * bnWeight;
+        }
+        kernels.push_back(kernel);
+    }
+
+    std::sort(kernels.begin(), kernels.end(), [](const CStakeKernel& a, const CStakeKernel& b){ return a.prevout < b.prevout; });
+}
+
+void CheckStakeKernels(const std::vector<CStakeKernel>& kernels, size_t from, size_t to, const std::vector<uint32_t>& blockTimes, std::vector<std::tuple<uint256, uint32_t, const CStakeKernel*>>& solved)
+{
+    unsigned char tail[12];
+    unsigned char hash[CSHA256::OUTPUT_SIZE];
+    uint256 hashProofOfStake;
+    for(size_t i = from; i < to; i++)
+    {
+        const CStakeKernel& kernel = kernels[i];
+        memcpy(tail, kernel.prevout.hash.begin() + 28, 4);
+        WriteLE32(tail + 4, kernel.prevout.n);
+        for(uint32_t nTimeBlock : blockTimes)
+        {
+            if(nTimeBlock < kernel.blockFromTime)
+                continue;
+
+            WriteLE32(tail + 8, nTimeBlock);
+            CSHA256(kernel.midstate).Write(tail, sizeof(tail)).Finalize(hash);
+            CSHA256().Write(hash, sizeof(hash)).Finalize(hashProofOfStake.begin());
+            if(UintToArith256(hashProofOfStake) <= kernel.maxHash)
+                solved.emplace_back(hashProofOfStake, nTimeBlock, &kernel);
+        }
+    }
+}
+
 void CacheKernel(std::map<COutPoint, CStakeCache>& cache, const COutPoint& prevout, CBlockIndex* pindexPrev, CCoinsViewCache& view){
     if(cache.find(prevout) != cache.end()){
         //already in cache
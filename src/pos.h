@@ -15,6 +15,7 @@
 #include <chainparams.h>
 #include <script/sign.h>
 #include <consensus/consensus.h>
+#include <crypto/sha256.h>
 
 struct CStakeCache{
     CStakeCache(uint32_t blockFromTime_, CAmount amount_) : blockFromTime(blockFromTime_), amount(amount_){
@@ -53,6 +54,25 @@ bool CheckKernel(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBloc
 bool CheckKernel(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBlock, const COutPoint& prevout, CCoinsViewCache& view, const std::map<COutPoint, CStakeCache>& cache, CChain& chain);
 bool CheckKernelCache(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBlock, const COutPoint& prevout, const std::map<COutPoint, CStakeCache>& cache, uint256& hashProofOfStake);
 
+// Kernel of a stake candidate prepared for searching many block times.
+// The first 64 bytes of the kernel do not depend on the block time, so their SHA256
+// state is kept, and the weighted target is turned into the highest valid hash.
+struct CStakeKernel{
+    CSHA256 midstate;
+    arith_uint256 maxHash;
+    COutPoint prevout;
+    uint32_t blockFromTime;
+    uint32_t index;
+};
+
+// Prepare the kernels of the cached prevouts for the block on top of pindexPrev, sorted by prevout.
+// The index of a kernel is the position of its prevout in prevouts, prevouts missing from the cache are skipped.
+void PrepareStakeKernels(CBlockIndex* pindexPrev, unsigned int nBits, const std::vector<COutPoint>& prevouts, const std::map<COutPoint, CStakeCache>& cache, std::vector<CStakeKernel>& kernels);
+
+// Check the kernels in [from, to) for all the block times in one pass over the kernels.
+// Same result as CheckStakeKernelHash, the valid ones are added to solved with their block time and proof hash.
+void CheckStakeKernels(const std::vector<CStakeKernel>& kernels, size_t from, size_t to, const std::vector<uint32_t>& blockTimes, std::vector<std::tuple<uint256, uint32_t, const CStakeKernel*>>& solved);
+
 unsigned int GetStakeMaxCombineInputs();
 
 int64_t GetStakeCombineThreshold();
@@ -65,6 +85,9 @@ int GetDelegationFeeTx(const CTransaction& tx, const Coin& coin, bool delegateOu
 
 bool GetDelegationFeeFromContract(const uint160& address, uint8_t& fee, CChainState& chainstate);
 
+class YodyDelegation;
+YodyDelegation& GetYodyDelegation();
+
 unsigned int GetStakeSplitOutputs();
 
 int64_t GetStakeSplitThreshold();
@@ -6,7 +6,9 @@
 #include <key_io.h>
 #include <util/strencodings.h>
 #include <util/convert.h>
-#include <qt/eventlog.h>
+#include <interfaces/chain.h>
+#include <interfaces/node.h>
+#include <node/context.h>
 #include <libethcore/ABI.h>
 #include <qt/walletmodel.h>
 
@@ -20,14 +22,12 @@ struct TokenData
 {
     ExecRPCCommand* call;
     ExecRPCCommand* send;
-    EventLog* eventLog;
     WalletModel* model;
     QString errorMessage;
 
     TokenData():
         call(0),
         send(0),
-        eventLog(0),
         model(0)
     {}
 };
@@ -58,9 +58,6 @@ Token::Token()
     lstOptional.append(YodyToken::paramPsbt());
     d->send = new ExecRPCCommand(Token_NS::PRC_SENDTO, lstMandatory, lstOptional, QMap<QString, QString>());
 
-    // Create new event log interface
-    d->eventLog = new EventLog();
-
     setYodyTokenExec(this);
 }
 
@@ -74,10 +71,6 @@ Token::~Token()
         delete d->send;
     d->send = 0;
 
-    if(d->eventLog)
-        delete d->eventLog;
-    d->eventLog = 0;
-
     if(d)
         delete d;
     d = 0;
@@ -139,50 +132,11 @@ bool Token::exec(const bool &sendTo, const std::map<std::string, std::string> &l
 
 bool Token::execEvents(const int64_t &fromBlock, const int64_t &toBlock, const int64_t &minconf, const std::string &eventName, const std::string &contractAddress, const std::string &senderAddress, const int &numTopics, std::vector<TokenEvent> &result)
 {
-    QVariant resultVar;
-    if(!(d->eventLog->searchTokenTx(d->model->node(), d->model, fromBlock, toBlock, minconf, eventName, contractAddress, senderAddress, numTopics, resultVar)))
-        return false;
-
-    QList<QVariant> list = resultVar.toList();
-    for(int i = 0; i < list.size(); i++)
-    {
-        // Search the log for events
-        QVariantMap variantMap = list[i].toMap();
-        QList<QVariant> listLog = variantMap.value("log").toList();
-        for(int i = 0; i < listLog.size(); i++)
-        {
-            // Skip the not needed events
-            QVariantMap variantLog = listLog[i].toMap();
-            QList<QVariant> topicsList = variantLog.value("topics").toList();
-            if(topicsList.count() < numTopics) continue;
-            if(topicsList[0].toString().toStdString() != eventName) continue;
-
-            // Create new event
-            TokenEvent tokenEvent;
-            tokenEvent.address = variantMap.value("contractAddress").toString().toStdString();
-            if(numTopics > 1)
-            {
-                tokenEvent.sender = topicsList[1].toString().toStdString().substr(24);
-                Token::ToYodyAddress(tokenEvent.sender, tokenEvent.sender);
-            }
-            if(numTopics > 2)
-            {
-                tokenEvent.receiver = topicsList[2].toString().toStdString().substr(24);
-                Token::ToYodyAddress(tokenEvent.receiver, tokenEvent.receiver);
-            }
-            tokenEvent.blockHash = uint256S(variantMap.value("blockHash").toString().toStdString());
-            tokenEvent.blockNumber = variantMap.value("blockNumber").toLongLong();
-            tokenEvent.transactionHash = uint256S(variantMap.value("transactionHash").toString().toStdString());
-
-            // Parse data
-            std::string data = variantLog.value("data").toString().toStdString();
-            tokenEvent.value = Token::ToUint256(data);
-
-            result.push_back(tokenEvent);
-        }
-    }
-
-    return true;
+    interfaces::Chain& chain = *d->model->node().context()->chain;
+    auto search = [&chain](const LogFilter& filter, const interfaces::Chain::SearchLogsFn& fn) {
+        return chain.searchLogs(filter, fn);
+    };
+    return Token::searchTokenEvents(search, fromBlock, toBlock, minconf, eventName, contractAddress, senderAddress, numTopics, result);
 }
 
 bool Token::privateKeysDisabled()
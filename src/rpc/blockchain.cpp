@@ -16,6 +16,7 @@
 #include <deploymentinfo.h>
 #include <deploymentstatus.h>
 #include <hash.h>
+#include <index/addressindex.h>
 #include <index/blockfilterindex.h>
 #include <index/coinstatsindex.h>
 #include <node/blockstorage.h>
@@ -48,6 +49,7 @@
 #include <pos.h>
 #include <txdb.h>
 #include <util/convert.h>
+#include <yody/statedump.h>
 #include <yody/yodydelegation.h>
 #include <util/tokenstr.h>
 #include <rpc/contract_util.h>
@@ -607,6 +609,17 @@ static std::vector<RPCResult> MempoolEntryDescription() { return {
         {RPCResult{RPCResult::Type::STR_HEX, "transactionid", "child transaction id"}}},
     RPCResult{RPCResult::Type::BOOL, "bip125-replaceable", "Whether this transaction could be replaced due to BIP125 (replace-by-fee)"},
     RPCResult{RPCResult::Type::BOOL, "unbroadcast", "Whether this transaction is currently unbroadcast (initial broadcast not yet acknowledged by any peers)"},
+    RPCResult{RPCResult::Type::OBJ, "preexecution", /* optional */ true, "execution of the contract outputs on a chain tip (only with -mempoolpreexec)",
+        {
+            RPCResult{RPCResult::Type::STR_HEX, "tip", "hash of the tip the contracts were executed on"},
+            RPCResult{RPCResult::Type::ARR, "gasused", "gas used by each contract output",
+                {RPCResult{RPCResult::Type::NUM, "", "gas used"}}},
+            RPCResult{RPCResult::Type::BOOL, "failed", "whether one of the executions threw or reverted"},
+            RPCResult{RPCResult::Type::ARR, "read", "accounts read by the executions",
+                {RPCResult{RPCResult::Type::STR_HEX, "", "account address"}}},
+            RPCResult{RPCResult::Type::ARR, "written", "accounts changed by the executions",
+                {RPCResult{RPCResult::Type::STR_HEX, "", "account address"}}},
+        }},
 };}
 
 static void entryToJSON(const CTxMemPool& pool, UniValue& info, const CTxMemPoolEntry& e) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
@@ -669,6 +682,25 @@ static void entryToJSON(const CTxMemPool& pool, UniValue& info, const CTxMemPool
 
     info.pushKV("bip125-replaceable", rbfStatus);
     info.pushKV("unbroadcast", pool.IsUnbroadcastTx(tx.GetHash()));
+
+    if (std::shared_ptr<const ContractPreExecution> pre = e.GetPreExecution()) {
+        UniValue preexecution(UniValue::VOBJ);
+        preexecution.pushKV("tip", pre->hashTip.GetHex());
+        UniValue gasused(UniValue::VARR);
+        for (uint64_t gas : pre->vGasUsed)
+            gasused.push_back(gas);
+        preexecution.pushKV("gasused", gasused);
+        preexecution.pushKV("failed", pre->fFailed);
+        UniValue read(UniValue::VARR);
+        for (const auto& account : pre->vRead)
+            read.push_back(uintToh160(std::get<0>(account)).hex());
+        preexecution.pushKV("read", read);
+        UniValue written(UniValue::VARR);
+        for (const uint160& account : pre->vWritten)
+            written.push_back(uintToh160(account).hex());
+        preexecution.pushKV("written", written);
+        info.pushKV("preexecution", preexecution);
+    }
 }
 
 UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose, bool include_mempool_sequence)
@@ -1777,23 +1809,7 @@ RPCHelpMan getdelegationinfoforaddress()
     };
 }
 
-class DelegationsStakerFilter : public IDelegationFilter
-{
-public:
-    DelegationsStakerFilter(const uint160& _address):
-        address(_address)
-    {}
-
-    bool Match(const DelegationEvent& event) const override
-    {
-        return event.item.staker == address;
-    }
-
-private:
-    uint160 address;
-};
-
-uint64_t getDelegateWeight(const uint160& keyid, const std::map<COutPoint, uint32_t>& immatureStakes, int height)
+uint64_t getDelegateWeight(const uint160& keyid, int height)
 {
     // Decode address
     uint256 hashBytes;
@@ -1804,7 +1820,7 @@ uint64_t getDelegateWeight(const uint160& keyid, const std::map<COutPoint, uint3
 
     // Get address weight
     uint64_t weight = 0;
-    if (!GetAddressWeight(hashBytes, type, immatureStakes, height, weight)) {
+    if (!GetAddressWeight(hashBytes, type, height, weight)) {
         return 0;
     }
 
@@ -1842,6 +1858,10 @@ RPCHelpMan getdelegationsforstaker()
     if (!fLogEvents)
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Events indexing disabled");
 
+    if (g_address_index) {
+        g_address_index->BlockUntilSyncedToCurrentChain();
+    }
+
     ChainstateManager& chainman = EnsureAnyChainman(request.context);
     LOCK(cs_main);
 
@@ -1858,18 +1878,14 @@ RPCHelpMan getdelegationsforstaker()
     }
 
     // Get delegations for staker
-    YodyDelegation yodyDelegation;
-    std::vector<DelegationEvent> events;
     PKHash pkhash = std::get<PKHash>(dest);
     uint160 address = uint160(pkhash);
-    DelegationsStakerFilter filter(address);
-    if(!yodyDelegation.FilterDelegationEvents(events, filter, chainman)) {
+    std::map<uint160, Delegation> delegations;
+    if(!GetYodyDelegation().GetDelegationsForStaker(address, delegations)) {
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Failed to get delegations for staker");
     }
-    std::map<uint160, Delegation> delegations = yodyDelegation.DelegationsFromEvents(events);
 
     // Get chain parameters
-    std::map<COutPoint, uint32_t> immatureStakes = GetImmatureStakes(chainman);
     int height = chainman.ActiveChain().Height();
 
     // Fill the json object with information
@@ -1882,7 +1898,7 @@ RPCHelpMan getdelegationsforstaker()
         delegation.pushKV("blockHeight", (int64_t)it->second.blockHeight);
         if(fAddressIndex)
         {
-            delegation.pushKV("weight", getDelegateWeight(it->first, immatureStakes, height));
+            delegation.pushKV("weight", getDelegateWeight(it->first, height));
         }
         delegation.pushKV("PoD", HexStr(it->second.PoD));
         result.push_back(delegation);
@@ -1897,10 +1913,11 @@ RPCHelpMan getdelegationsforstaker()
 RPCHelpMan listcontracts()
 {
     return RPCHelpMan{"listcontracts",
-                "\nGet the contracts list.\n",
+                "\nGet the contracts list, in the order they were created.\n",
                 {
                     {"start", RPCArg::Type::NUM, RPCArg::Default{1}, "The starting account index"},
                     {"maxdisplay", RPCArg::Type::NUM, RPCArg::Default{20}, "Max accounts to list"},
+                    {"after", RPCArg::Type::STR_HEX, RPCArg::Optional::OMITTED_NAMED_ARG, "Continue after this account, the last one of the previous page. The starting index is counted from it"},
                 },
                 RPCResult{
                     RPCResult::Type::OBJ, "", "",
@@ -1909,6 +1926,7 @@ RPCHelpMan listcontracts()
                     }},
                 RPCExamples{
                     HelpExampleCli("listcontracts", "")
+            + HelpExampleCli("listcontracts", "1 20 \"eb23c0b3e6042821da281a2e2364feb22dd543e3\"")
             + HelpExampleRpc("listcontracts", "")
                 },
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
@@ -1930,21 +1948,35 @@ RPCHelpMan listcontracts()
 			throw JSONRPCError(RPC_TYPE_ERROR, "Invalid maxDisplay");
 	}
 
-	UniValue result(UniValue::VOBJ);
+	// Seek the contract index to the account of the previous page, or to the first account
+	CHeightTxIndexKey begin;
+	size_t skip = start - 1;
+	if (!request.params[2].isNull()){
+		std::string strAddr = request.params[2].get_str();
+		if(strAddr.size() != 40 || !IsHex(strAddr))
+			throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Incorrect address");
+		dev::h160 after(strAddr);
+		unsigned int height = 0;
+		if (!pblocktree->ReadContractHeight(after, height))
+			throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address does not exist");
+		begin = CHeightTxIndexKey(height, after);
+		skip++;
+	}
 
-	auto map = globalState->addresses();
-	int contractsCount=(int)map.size();
+	std::vector<CHeightTxIndexKey> contracts;
+	if (!pblocktree->ReadContractIndex(begin, skip, maxDisplay, contracts))
+		throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read the contract index");
 
-	if (contractsCount>0 && start > contractsCount)
-		throw JSONRPCError(RPC_TYPE_ERROR, "start greater than max index "+ i64tostr(contractsCount));
+	if (contracts.empty() && request.params[2].isNull() && start > 1)
+		throw JSONRPCError(RPC_TYPE_ERROR, "start greater than max index");
 
-	int itStartPos=std::min(start-1,contractsCount);
-	int i=0;
-	for (auto it = std::next(map.begin(),itStartPos); it!=map.end(); it++)
+	UniValue result(UniValue::VOBJ);
+	for (const CHeightTxIndexKey& contract : contracts)
 	{
-		result.pushKV(it->first.hex(),ValueFromAmount(CAmount(globalState->balance(it->first))));
-		i++;
-		if(i==maxDisplay)break;
+		// Accounts registered from the state of an older database can be stale after a reorganization
+		if (!globalState->addressInUse(contract.address))
+			continue;
+		result.pushKV(contract.address.hex(),ValueFromAmount(CAmount(globalState->balance(contract.address))));
 	}
 
 	return result;
@@ -3451,7 +3483,7 @@ static RPCHelpMan dumptxoutset()
 {
     return RPCHelpMan{
         "dumptxoutset",
-        "\nWrite the serialized UTXO set to disk.\n",
+        "\nWrite the serialized UTXO set to disk, followed by the contract state at the same block.\n",
         {
             {"path",
                 RPCArg::Type::STR,
@@ -3463,6 +3495,8 @@ static RPCHelpMan dumptxoutset()
             RPCResult::Type::OBJ, "", "",
                 {
                     {RPCResult::Type::NUM, "coins_written", "the number of coins written in the snapshot"},
+                    {RPCResult::Type::NUM, "state_nodes_written", "the number of contract state trie nodes and codes written in the snapshot"},
+                    {RPCResult::Type::NUM, "state_preimages_written", "the number of contract state key preimages written in the snapshot"},
                     {RPCResult::Type::STR_HEX, "base_hash", "the hash of the base of the snapshot"},
                     {RPCResult::Type::NUM, "base_height", "the height of the base of the snapshot"},
                     {RPCResult::Type::STR, "path", "the absolute path that the snapshot was written to"},
@@ -3499,9 +3533,15 @@ static RPCHelpMan dumptxoutset()
 
 UniValue CreateUTXOSnapshot(NodeContext& node, CChainState& chainstate, CAutoFile& afile)
 {
+    // The contract state is read after cs_main is released, the validation could prune its nodes meanwhile
+    if (nStatePruning > 0) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to dump the contract state with -statepruning");
+    }
+
     std::unique_ptr<CCoinsViewCursor> pcursor;
     CCoinsStats stats{CoinStatsHashType::NONE};
     CBlockIndex* tip;
+    std::unique_ptr<dev::OverlayDB> stateDB, utxoDB;
 
     {
         // We need to lock cs_main to ensure that the coinsdb isn't written to
@@ -3527,6 +3567,11 @@ UniValue CreateUTXOSnapshot(NodeContext& node, CChainState& chainstate, CAutoFil
         pcursor = chainstate.CoinsDB().Cursor();
         tip = chainstate.m_blockman.LookupBlockIndex(stats.hashBlock);
         CHECK_NONFATAL(tip);
+
+        // The contract state databases are shared with the validation, which does not delete nodes
+        // without -statepruning, so the nodes of the tip roots can be read from copies below this block
+        stateDB = std::make_unique<dev::OverlayDB>(globalState->db());
+        utxoDB = std::make_unique<dev::OverlayDB>(globalState->dbUtxo());
     }
 
     SnapshotMetadata metadata{tip->GetBlockHash(), stats.coins_count, tip->nChainTx};
@@ -3548,10 +3593,18 @@ UniValue CreateUTXOSnapshot(NodeContext& node, CChainState& chainstate, CAutoFil
         pcursor->Next();
     }
 
+    // yody
+    YodyStateDumpStats state_stats;
+    if (!DumpYodyState(afile, *stateDB, *utxoDB, uintToh256(tip->hashStateRoot), uintToh256(tip->hashUTXORoot), node.rpc_interruption_point, state_stats)) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read the contract state");
+    }
+
     afile.fclose();
 
     UniValue result(UniValue::VOBJ);
     result.pushKV("coins_written", stats.coins_count);
+    result.pushKV("state_nodes_written", state_stats.nodes);
+    result.pushKV("state_preimages_written", state_stats.preimages);
     result.pushKV("base_hash", tip->GetBlockHash().ToString());
     result.pushKV("base_height", tip->nHeight);
 
@@ -3820,11 +3873,9 @@ static RPCHelpMan qrc20listtransactions()
     if(!request.params[3].isNull())
         minconf = request.params[3].get_int64();
 
-    // Get transaction events
-    LOCK(cs_main);
+    // Get transaction events, the logs are searched without cs_main
     std::vector<TokenEvent> result;
-    CChain& active_chain = chainman.ActiveChain();
-    int64_t toBlock = active_chain.Height();
+    int64_t toBlock = WITH_LOCK(cs_main, return chainman.ActiveChain().Height());
     if(!token.transferEvents(result, fromBlock, toBlock, minconf))
         throw JSONRPCError(RPC_MISC_ERROR, "Fail to get transfer events");
     if(!token.burnEvents(result, fromBlock, toBlock, minconf))
@@ -3836,6 +3887,7 @@ static RPCHelpMan qrc20listtransactions()
         throw JSONRPCError(RPC_MISC_ERROR, "Fail to get decimals");
 
     // Create transaction list
+    LOCK(cs_main);
     UniValue res(UniValue::VARR);
     for(const auto& event : result){
         UniValue obj(UniValue::VOBJ);
@@ -3855,7 +3907,8 @@ static RPCHelpMan qrc20listtransactions()
         obj.pushKV("confirmations", confirms);
         obj.pushKV("blockHash", event.blockHash.GetHex());
         obj.pushKV("blockNumber", event.blockNumber);
-        obj.pushKV("blocktime", active_chain[event.blockNumber]->GetBlockTime());
+        const CBlockIndex* pblockindex = chainman.m_blockman.LookupBlockIndex(event.blockHash);
+        obj.pushKV("blocktime", pblockindex ? pblockindex->GetBlockTime() : 0);
         obj.pushKV("transactionHash", event.transactionHash.GetHex());
         res.push_back(obj);
     }
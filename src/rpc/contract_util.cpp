@@ -4,6 +4,8 @@
 #include <key_io.h>
 #include <rpc/server.h>
 #include <txdb.h>
+#include <index/logindex.h>
+#include <index/receiptindex.h>
 
 UniValue executionResultToJSON(const dev::eth::ExecutionResult& exRes)
 {
@@ -48,14 +50,15 @@ UniValue transactionReceiptToJSON(const YodyTransactionReceipt& txRec)
 
 UniValue CallToContract(const UniValue& params, ChainstateManager &chainman)
 {
-    LOCK(cs_main);
-
     std::string strAddr = params[0].get_str();
     std::string data = params[1].get_str();
 
     if(data.size() % 2 != 0 || !CheckHex(data))
         throw JSONRPCError(RPC_TYPE_ERROR, "Invalid data (data not hex)");
 
+    // Only the snapshot of the tip state is taken under cs_main, the call itself runs without it
+    std::unique_ptr<CallContractSnapshot> snapshot = WITH_LOCK(cs_main, return std::make_unique<CallContractSnapshot>(chainman.ActiveChainstate()));
+
     dev::Address addrAccount;
     if(strAddr.size() > 0)
     {
@@ -63,7 +66,7 @@ UniValue CallToContract(const UniValue& params, ChainstateManager &chainman)
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Incorrect address");
 
         addrAccount = dev::Address(strAddr);
-        if(!globalState->addressInUse(addrAccount))
+        if(!snapshot->AddressInUse(addrAccount))
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address does not exist");
     }
 
@@ -91,9 +94,10 @@ UniValue CallToContract(const UniValue& params, ChainstateManager &chainman)
     }
 
 
-    std::vector<ResultExecute> execResults = CallContract(addrAccount, ParseHex(data), chainman.ActiveChainstate(), senderAddress, gasLimit, nAmount);
+    std::vector<ResultExecute> execResults = snapshot->Call(addrAccount, ParseHex(data), senderAddress, gasLimit, nAmount);
 
     if(fRecordLogOpcodes){
+        LOCK(cs_main);
         writeVMlog(execResults, chainman.ActiveChain());
     }
 
@@ -270,125 +274,193 @@ void parseParam(const UniValue& val, std::vector<boost::optional<dev::h256>> &h2
     });
 }
 
-class SearchLogsParams {
-public:
-    size_t fromBlock;
-    size_t toBlock;
-    size_t minconf;
+/** Parse the parameters of searchlogs, the default blocks being the latest one */
+static LogFilter ParseSearchLogsParams(const UniValue& params)
+{
+    std::unique_lock<std::mutex> lock(cs_blockchange);
 
-    std::set<dev::h160> addresses;
-    std::vector<boost::optional<dev::h256>> topics;
+    LogFilter filter;
+    filter.fromBlock = parseBlockHeight(params[0], latestblock.height);
+    filter.toBlock = parseBlockHeight(params[1], latestblock.height);
 
-    SearchLogsParams(const UniValue& params) {
-        std::unique_lock<std::mutex> lock(cs_blockchange);
+    parseParam(params[2]["addresses"], filter.addresses);
 
-        setFromBlock(params[0]);
-        setToBlock(params[1]);
+    std::vector<boost::optional<dev::h256>> topics;
+    parseParam(params[3]["topics"], topics);
+    for (const auto& topic : topics) {
+        filter.topics.push_back(topic ? std::make_optional(*topic) : std::nullopt);
+    }
 
-        parseParam(params[2]["addresses"], addresses);
-        parseParam(params[3]["topics"], topics);
+    filter.minconf = parseUInt(params[4], 0);
+    return filter;
+}
 
-        minconf = parseUInt(params[4], 0);
+/**
+ * Collect the transactions matching the filters from the log index, grouped by block in the
+ * same order ReadHeightIndex returns them. Returns false when the index can not serve the query,
+ * in which case the height index has to be scanned.
+ */
+static bool ReadLogIndex(const LogFilter& params, ChainstateManager &chainman, std::vector<std::vector<uint256>>& hashesToBlock) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    int low = params.fromBlock;
+    int high = params.toBlock;
+    if ((high < low && high > -1) || (high == 0 && low == 0) || (high < -1 || low < 0)) {
+        return false;
     }
 
-private:
-    void setFromBlock(const UniValue& val) {
-        if (!val.isNull()) {
-            fromBlock = parseBlockHeight(val);
-        } else {
-            fromBlock = latestblock.height;
-        }
+    int tipHeight = chainman.ActiveChain().Height();
+    int stop = high > -1 ? std::min(high, tipHeight) : tipHeight;
+    if (params.minconf > 0) {
+        stop = std::min(stop, tipHeight - params.minconf);
     }
-
-    void setToBlock(const UniValue& val) {
-        if (!val.isNull()) {
-            toBlock = parseBlockHeight(val);
-        } else {
-            toBlock = latestblock.height;
-        }
+    if (g_log_index->BestHeight() < stop) {
+        return false;
+    }
+    if (stop < low) {
+        return true;
     }
 
-};
-
-UniValue SearchLogs(const UniValue& _params, ChainstateManager &chainman)
-{
-    if(!fLogEvents)
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Events indexing disabled");
+    bool hasTopics = false;
+    for (const auto& topic : params.topics) {
+        hasTopics |= bool(topic);
+    }
 
-    int curheight = 0;
+    if (hasTopics) {
+        std::map<std::pair<int, uint32_t>, LogIndexEntry> found;
+        for (size_t i = 0; i < params.topics.size() && i <= std::numeric_limits<uint8_t>::max(); i++) {
+            if (!params.topics[i]) {
+                continue;
+            }
+            std::vector<LogIndexEntry> entries;
+            if (!g_log_index->LookupTopic(i, h256Touint(*params.topics[i]), low, stop, entries)) {
+                return false;
+            }
+            for (LogIndexEntry& entry : entries) {
+                found.emplace(std::make_pair(entry.height, entry.tx_index), std::move(entry));
+            }
+        }
 
-    LOCK(cs_main);
+        std::set<uint160> addresses;
+        for (const auto& address : params.addresses) {
+            addresses.insert(h160Touint(address));
+        }
 
-    SearchLogsParams params(_params);
+        // ReadHeightIndex orders the transactions of a block by the address of their logs
+        std::vector<std::tuple<int, uint160, uint32_t, uint256>> ordered;
+        for (const auto& e : found) {
+            const LogIndexEntry& entry = e.second;
+            for (const uint160& address : entry.addresses) {
+                if (addresses.empty() || addresses.count(address)) {
+                    ordered.emplace_back(entry.height, address, entry.tx_index, entry.tx_hash);
+                    break;
+                }
+            }
+        }
+        std::sort(ordered.begin(), ordered.end());
 
-    std::vector<std::vector<uint256>> hashesToBlock;
+        int lastHeight = -1;
+        for (const auto& tx : ordered) {
+            if (std::get<0>(tx) != lastHeight) {
+                hashesToBlock.emplace_back();
+                lastHeight = std::get<0>(tx);
+            }
+            hashesToBlock.back().push_back(std::get<3>(tx));
+        }
+        return true;
+    }
 
-    curheight = pblocktree->ReadHeightIndex(params.fromBlock, params.toBlock, params.minconf, hashesToBlock, params.addresses, chainman);
+    if (!params.addresses.empty()) {
+        std::vector<dev::eth::LogBloom> blooms;
+        for (const auto& address : params.addresses) {
+            blooms.push_back(dev::eth::LogEntry(address, {}, {}).bloom());
+        }
 
-    if (curheight == -1) {
-        throw JSONRPCError(RPC_INVALID_PARAMETER, "Incorrect params");
+        std::vector<int> heights;
+        if (!g_log_index->LookupBlooms(blooms, low, stop, heights)) {
+            return false;
+        }
+        for (int height : heights) {
+            if (height > 0) {
+                pblocktree->ReadHeightIndex(height, height, 0, hashesToBlock, params.addresses, chainman);
+            }
+        }
+        return true;
     }
 
-    UniValue result(UniValue::VARR);
-
-    auto topics = params.topics;
+    // Without filters every block with logs is returned, the height index serves that directly
+    return false;
+}
 
-    std::set<uint256> dupes;
+/**
+ * Pass the hashes of the transactions with logs matching the addresses of a filter to fn in block order, until
+ * it returns false. Only the index is read under cs_main, the receipts are left to fn to read without it.
+ * Returns false if the filter is incorrect.
+ */
+static bool FindLogTransactions(const LogFilter& filter, ChainstateManager &chainman, const std::function<bool(const uint256&)>& fn)
+{
+    // The logs of the blocks before -logevents was enabled are found once the receipt index replayed them
+    if (g_receipt_index) {
+        g_receipt_index->BlockUntilSyncedToCurrentChain();
+    }
+    bool fLogIndex = g_log_index && g_log_index->BlockUntilSyncedToCurrentChain();
 
-    for(const auto& hashesTx : hashesToBlock)
+    std::vector<std::vector<uint256>> hashesToBlock;
     {
-        for(const auto& e : hashesTx)
-        {
-
-            if(dupes.find(e) != dupes.end()) {
-                continue;
+        LOCK(cs_main);
+        if (!fLogIndex || !ReadLogIndex(filter, chainman, hashesToBlock)) {
+            if (pblocktree->ReadHeightIndex(filter.fromBlock, filter.toBlock, filter.minconf, hashesToBlock, filter.addresses, chainman) == -1) {
+                return false;
             }
-            dupes.insert(e);
-
-            std::vector<TransactionReceiptInfo> receipts = pstorageresult->getResult(uintToh256(e));
-
-            for(const auto& receipt : receipts) {
-                if(receipt.logs.empty()) {
-                    continue;
-                }
-
-                if (!topics.empty()) {
-                    for (size_t i = 0; i < topics.size(); i++) {
-                        const auto& tc = topics[i];
-
-                        if (!tc) {
-                            continue;
-                        }
-
-                        for (const auto& log: receipt.logs) {
-                            auto filterTopicContent = tc.get();
-
-                            if (i >= log.topics.size()) {
-                                continue;
-                            }
+        }
+    }
 
-                            if (filterTopicContent == log.topics[i]) {
-                                goto push;
-                            }
-                        }
-                    }
+    std::set<uint256> dupes;
+    for (const auto& hashesTx : hashesToBlock) {
+        for (const auto& e : hashesTx) {
+            if (dupes.insert(e).second && !fn(e)) {
+                return true;
+            }
+        }
+    }
+    return true;
+}
 
-                    // Skip the log if none of the topics are matched
-                    continue;
-                }
+UniValue SearchLogs(const UniValue& _params, ChainstateManager &chainman)
+{
+    if(!fLogEvents)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Events indexing disabled");
 
-            push:
+    const LogFilter filter = ParseSearchLogsParams(_params);
 
+    UniValue result(UniValue::VARR);
+    bool ret = FindLogTransactions(filter, chainman, [&](const uint256& hash) {
+        for (const auto& receipt : pstorageresult->getResult(uintToh256(hash))) {
+            if (MatchLogTopics(receipt.logs, filter.topics)) {
                 UniValue tri(UniValue::VOBJ);
                 transactionReceiptInfoToJSON(receipt, tri);
                 result.push_back(tri);
             }
         }
+        return true;
+    });
+    if (!ret) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Incorrect params");
     }
 
     return result;
 }
 
+bool SearchLogs(const LogFilter& filter, ChainstateManager &chainman, const LogMatchFn& fn)
+{
+    if (!fLogEvents) {
+        return false;
+    }
+
+    return FindLogTransactions(filter, chainman, [&](const uint256& hash) {
+        return pstorageresult->searchLogs(uintToh256(hash), filter.topics, fn);
+    });
+}
+
 CallToken::CallToken(ChainstateManager &_chainman):
     chainman(_chainman)
 {
@@ -474,87 +546,10 @@ bool CallToken::exec(const bool &sendTo, const std::map<std::string, std::string
 
 bool CallToken::execEvents(const int64_t &fromBlock, const int64_t &toBlock, const int64_t& minconf, const std::string &eventName, const std::string &contractAddress, const std::string &senderAddress, const int &numTopics, std::vector<TokenEvent> &result)
 {
-    UniValue resultVar;
-    if(!searchTokenTx(fromBlock, toBlock, minconf, eventName, contractAddress, senderAddress, numTopics, resultVar))
-        return false;
-
-    const UniValue& list = resultVar.get_array();
-    for(size_t i = 0; i < list.size(); i++)
-    {
-        // Search the log for events
-        const UniValue& eventMap = list[i].get_obj();
-        const UniValue& listLog = eventMap["log"].get_array();
-        for(size_t i = 0; i < listLog.size(); i++)
-        {
-            // Skip the not needed events
-            const UniValue& eventLog = listLog[i].get_obj();
-            const UniValue& topicsList = eventLog["topics"].get_array();
-            if(topicsList.size() < (size_t)numTopics) continue;
-            if(topicsList[0].get_str() != eventName) continue;
-
-            // Create new event
-            TokenEvent tokenEvent;
-            tokenEvent.address = eventMap["contractAddress"].get_str();
-            if(numTopics > 1)
-            {
-                tokenEvent.sender = topicsList[1].get_str().substr(24);
-                ToYodyAddress(tokenEvent.sender, tokenEvent.sender);
-            }
-            if(numTopics > 2)
-            {
-                tokenEvent.receiver = topicsList[2].get_str().substr(24);
-                ToYodyAddress(tokenEvent.receiver, tokenEvent.receiver);
-            }
-            tokenEvent.blockHash = uint256S(eventMap["blockHash"].get_str());
-            tokenEvent.blockNumber = eventMap["blockNumber"].get_int64();
-            tokenEvent.transactionHash = uint256S(eventMap["transactionHash"].get_str());
-
-            // Parse data
-            std::string data = eventLog["data"].get_str();
-            tokenEvent.value = ToUint256(data);
-
-            result.push_back(tokenEvent);
-        }
-    }
-
-    return true;
-}
-
-bool CallToken::searchTokenTx(const int64_t &fromBlock, const int64_t &toBlock, const int64_t &minconf, const std::string &eventName, const std::string &contractAddress, const std::string &senderAddress, const int &numTopics, UniValue &resultVar)
-{
-    UniValue params(UniValue::VARR);
-    params.push_back(fromBlock);
-    params.push_back(toBlock);
-
-    UniValue addresses(UniValue::VARR);
-    addresses.push_back(contractAddress);
-    UniValue addressesObj(UniValue::VOBJ);
-    addressesObj.pushKV("addresses", addresses);
-    params.push_back(addressesObj);
-
-    UniValue topics(UniValue::VARR);
-    // Skip the event type check
-    static std::string nullRecord = uint256().ToString();
-    topics.push_back(nullRecord);
-    if(numTopics > 1)
-    {
-        // Match the log with sender address
-        topics.push_back(senderAddress);
-    }
-    if(numTopics > 2)
-    {
-        // Match the log with receiver address
-        topics.push_back(senderAddress);
-    }
-    UniValue topicsObj(UniValue::VOBJ);
-    topicsObj.pushKV("topics", topics);
-    params.push_back(topicsObj);
-
-    params.push_back(minconf);
-
-    resultVar = SearchLogs(params, chainman);
-
-    return true;
+    auto search = [this](const LogFilter& filter, const LogMatchFn& fn) {
+        return SearchLogs(filter, chainman, fn);
+    };
+    return searchTokenEvents(search, fromBlock, toBlock, minconf, eventName, contractAddress, senderAddress, numTopics, result);
 }
 
 void CallToken::setCheckGasForCall(bool value)
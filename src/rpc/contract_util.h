@@ -11,6 +11,12 @@ UniValue CallToContract(const UniValue& params, ChainstateManager &chainman);
 
 UniValue SearchLogs(const UniValue& params, ChainstateManager &chainman);
 
+/**
+ * Typed version of searchlogs, for the consumers in the node which need the logs without their JSON encoding.
+ * Only the logs of the receipts are decoded. Returns false if the log events are disabled or the filter is incorrect.
+ */
+bool SearchLogs(const LogFilter& filter, ChainstateManager &chainman, const LogMatchFn& fn);
+
 void assignJSON(UniValue& entry, const TransactionReceiptInfo& resExec);
 
 void assignJSON(UniValue& logEntry, const dev::eth::LogEntry& log,
@@ -42,8 +48,6 @@ public:
 
     bool execEvents(const int64_t &fromBlock, const int64_t &toBlock, const int64_t &minconf, const std::string &eventName, const std::string &contractAddress, const std::string &senderAddress, const int &numTopics, std::vector<TokenEvent> &result) override;
 
-    bool searchTokenTx(const int64_t &fromBlock, const int64_t &toBlock, const int64_t &minconf, const std::string &eventName, const std::string &contractAddress, const std::string &senderAddress, const int &numTopics, UniValue& resultVar);
-
     void setCheckGasForCall(bool value);
 
 protected:
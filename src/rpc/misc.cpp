@@ -4,8 +4,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <httpserver.h>
+#include <index/addressindex.h>
 #include <index/blockfilterindex.h>
 #include <index/coinstatsindex.h>
+#include <index/receiptindex.h>
 #include <index/txindex.h>
 #include <interfaces/chain.h>
 #include <interfaces/echo.h>
@@ -260,6 +262,9 @@ RPCHelpMan getaddressdeltas()
             },
     [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
+    if (g_address_index) {
+        g_address_index->BlockUntilSyncedToCurrentChain();
+    }
 
     UniValue startValue = find_value(request.params[0].get_obj(), "start");
     UniValue endValue = find_value(request.params[0].get_obj(), "end");
@@ -386,6 +391,9 @@ RPCHelpMan getaddressbalance()
                 },
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
+    if (g_address_index) {
+        g_address_index->BlockUntilSyncedToCurrentChain();
+    }
 
     std::vector<std::pair<uint256, int> > addresses;
 
@@ -489,6 +497,9 @@ RPCHelpMan getaddressutxos()
                 },
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
+    if (g_address_index) {
+        g_address_index->BlockUntilSyncedToCurrentChain();
+    }
 
     bool includeChainInfo = false;
     if (request.params[0].isObject()) {
@@ -669,6 +680,9 @@ RPCHelpMan getblockhashes()
                 },
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
+    if (g_address_index) {
+        g_address_index->BlockUntilSyncedToCurrentChain();
+    }
 
     ChainstateManager& chainman = EnsureAnyChainman(request.context);
 
@@ -743,6 +757,10 @@ RPCHelpMan getspentinfo()
                 },
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
+    if (g_address_index) {
+        g_address_index->BlockUntilSyncedToCurrentChain();
+    }
+
     const NodeContext& node = EnsureAnyNodeContext(request.context);
     const CTxMemPool& mempool = EnsureMemPool(node);
 
@@ -804,6 +822,9 @@ RPCHelpMan getaddresstxids()
                 },
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
+    if (g_address_index) {
+        g_address_index->BlockUntilSyncedToCurrentChain();
+    }
 
     std::vector<std::pair<uint256, int> > addresses;
 
@@ -1338,6 +1359,17 @@ static UniValue RPCLockedMemoryInfo()
     return obj;
 }
 
+static UniValue RPCStateNodeCacheInfo(const dev::TrieNodeCache& cache)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("used", uint64_t(cache.size()));
+    obj.pushKV("max", uint64_t(cache.capacity()));
+    obj.pushKV("nodes", uint64_t(cache.count()));
+    obj.pushKV("hits", cache.hits());
+    obj.pushKV("misses", cache.misses());
+    return obj;
+}
+
 #ifdef HAVE_MALLOC_INFO
 static std::string RPCMallocInfo()
 {
@@ -1382,6 +1414,14 @@ static RPCHelpMan getmemoryinfo()
                                 {RPCResult::Type::NUM, "chunks_used", "Number allocated chunks"},
                                 {RPCResult::Type::NUM, "chunks_free", "Number unused chunks"},
                             }},
+                            {RPCResult::Type::OBJ, "statenodecache", /* optional */ true, "Information about the contract state trie node cache",
+                            {
+                                {RPCResult::Type::NUM, "used", "Number of bytes used"},
+                                {RPCResult::Type::NUM, "max", "Maximum number of bytes used"},
+                                {RPCResult::Type::NUM, "nodes", "Number of trie nodes cached"},
+                                {RPCResult::Type::NUM, "hits", "Number of reads found in the cache"},
+                                {RPCResult::Type::NUM, "misses", "Number of reads not found in the cache"},
+                            }},
                         }
                     },
                     RPCResult{"mode \"mallocinfo\"",
@@ -1398,6 +1438,9 @@ static RPCHelpMan getmemoryinfo()
     if (mode == "stats") {
         UniValue obj(UniValue::VOBJ);
         obj.pushKV("locked", RPCLockedMemoryInfo());
+        if (std::shared_ptr<dev::TrieNodeCache> cache = g_state_node_cache) {
+            obj.pushKV("statenodecache", RPCStateNodeCacheInfo(*cache));
+        }
         return obj;
     } else if (mode == "mallocinfo") {
 #ifdef HAVE_MALLOC_INFO
@@ -1620,6 +1663,14 @@ static RPCHelpMan getindexinfo()
         result.pushKVs(SummaryToJSON(g_coin_stats_index->GetSummary(), index_name));
     }
 
+    if (g_address_index) {
+        result.pushKVs(SummaryToJSON(g_address_index->GetSummary(), index_name));
+    }
+
+    if (g_receipt_index) {
+        result.pushKVs(SummaryToJSON(g_receipt_index->GetSummary(), index_name));
+    }
+
     ForEachBlockFilterIndex([&result, &index_name](const BlockFilterIndex& index) {
         result.pushKVs(SummaryToJSON(index.GetSummary(), index_name));
     });
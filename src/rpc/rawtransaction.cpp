@@ -7,6 +7,7 @@
 #include <coins.h>
 #include <consensus/validation.h>
 #include <core_io.h>
+#include <index/addressindex.h>
 #include <index/txindex.h>
 #include <key_io.h>
 #include <merkleblock.h>
@@ -375,6 +376,9 @@ static RPCHelpMan getrawtransaction()
     int nHeight = 0;
     int nConfirmations = 0;
     int nBlockTime = 0;
+    if (g_address_index) {
+        g_address_index->BlockUntilSyncedToCurrentChain();
+    }
     if(fAddressIndex) {
         LOCK(cs_main);
         BlockMap::iterator mi = chainman.BlockIndex().find(hash_block);
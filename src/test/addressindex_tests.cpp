@@ -0,0 +1,189 @@
+#include <chainparams.h>
+#include <index/addressindex.h>
+#include <script/standard.h>
+#include <test/util/setup_common.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(addressindex_tests)
+
+BOOST_FIXTURE_TEST_CASE(addressindex_initial_sync, TestChain100Setup)
+{
+    AddressIndex addressindex(1 << 20, true);
+
+    // The coinbases of the test chain pay to the address of the coinbase key
+    CScript coinbase_script_pub_key = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CTxDestination dest;
+    BOOST_REQUIRE(ExtractDestination(coinbase_script_pub_key, dest));
+    valtype bytesID(std::visit(DataVisitor(), dest));
+    valtype addressBytes(32);
+    std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
+    const uint256 address(addressBytes);
+    const int type = dest.index();
+
+    // Nothing is indexed before the index is started.
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> unspent;
+    BOOST_CHECK(addressindex.ReadAddressUnspentIndex(address, type, unspent));
+    BOOST_CHECK(unspent.empty());
+    BOOST_CHECK(!addressindex.BlockUntilSyncedToCurrentChain());
+
+    BOOST_REQUIRE(addressindex.Start(m_node.chainman->ActiveChainstate()));
+
+    // Allow the address index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!addressindex.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        UninterruptibleSleep(std::chrono::milliseconds{100});
+    }
+
+    // Every coinbase of the chain before the index started is an unspent output of the address
+    auto find_unspent = [&](const uint256& txid) {
+        unspent.clear();
+        BOOST_CHECK(addressindex.ReadAddressUnspentIndex(address, type, unspent));
+        for (const auto& [key, value] : unspent) {
+            if (key.txhash == txid && key.index == 0) return true;
+        }
+        return false;
+    };
+    for (const auto& txn : m_coinbase_txns) {
+        BOOST_CHECK(find_unspent(txn->GetHash()));
+    }
+
+    std::vector<std::pair<CAddressIndexKey, CAmount>> deltas;
+    BOOST_CHECK(addressindex.ReadAddressIndex(address, type, deltas));
+    BOOST_CHECK_EQUAL(deltas.size(), m_coinbase_txns.size());
+    CAmount total = 0;
+    for (const auto& delta : deltas) {
+        BOOST_CHECK(!delta.first.spending);
+        total += delta.second;
+    }
+
+    CAddressWeightValue weight;
+    BOOST_CHECK(addressindex.ReadAddressWeight(address, type, weight));
+    BOOST_CHECK_EQUAL(weight.total, total);
+
+    // The blocks are indexed by increasing logical timestamp
+    std::vector<std::pair<uint256, unsigned int>> hashes;
+    BOOST_CHECK(addressindex.ReadTimestampIndex(std::numeric_limits<unsigned int>::max(), 0, true, hashes, *m_node.chainman));
+    BOOST_CHECK_EQUAL(hashes.size(), (size_t)WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Height()));
+
+    // Check that the outputs of new blocks make it into the index.
+    for (int i = 0; i < 10; i++) {
+        std::vector<CMutableTransaction> no_txns;
+        const CBlock& block = CreateAndProcessBlock(no_txns, coinbase_script_pub_key);
+
+        BOOST_CHECK(addressindex.BlockUntilSyncedToCurrentChain());
+        BOOST_CHECK(find_unspent(block.vtx[0]->GetHash()));
+    }
+
+    // shutdown sequence (c.f. Shutdown() in init.cpp)
+    addressindex.Stop();
+
+    // Let scheduler events finish running to avoid accessing any memory related to the index after it is destructed
+    SyncWithValidationInterfaceQueue();
+}
+
+BOOST_FIXTURE_TEST_CASE(addressindex_rewind, TestChain100Setup)
+{
+    AddressIndex addressindex(1 << 20, true);
+
+    CScript coinbase_script_pub_key = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CTxDestination dest;
+    BOOST_REQUIRE(ExtractDestination(coinbase_script_pub_key, dest));
+    valtype bytesID(std::visit(DataVisitor(), dest));
+    valtype addressBytes(32);
+    std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
+    const uint256 address(addressBytes);
+    const int type = dest.index();
+
+    // The new blocks pay their coinbase to another address, so only the spend changes the coinbase key address
+    CKey other_key;
+    other_key.MakeNewKey(true);
+    CScript other_script_pub_key = CScript() << ToByteVector(other_key.GetPubKey()) << OP_CHECKSIG;
+
+    BOOST_REQUIRE(addressindex.Start(m_node.chainman->ActiveChainstate()));
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!addressindex.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        UninterruptibleSleep(std::chrono::milliseconds{100});
+    }
+
+    auto find_unspent = [&](const uint256& txid) {
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> unspent;
+        BOOST_CHECK(addressindex.ReadAddressUnspentIndex(address, type, unspent));
+        for (const auto& [key, value] : unspent) {
+            if (key.txhash == txid && key.index == 0) return true;
+        }
+        return false;
+    };
+    auto read_weight = [&] {
+        CAddressWeightValue weight;
+        BOOST_CHECK(addressindex.ReadAddressWeight(address, type, weight));
+        return weight;
+    };
+    const CTransactionRef coinbase_tx = m_coinbase_txns[0];
+    const CSpentIndexKey spent_key(coinbase_tx->GetHash(), 0);
+    CSpentIndexValue spent_value;
+
+    BOOST_CHECK(find_unspent(coinbase_tx->GetHash()));
+    BOOST_CHECK(!addressindex.ReadSpentIndex(spent_key, spent_value));
+    const CAddressWeightValue weight_unspent = read_weight();
+
+    // Spend the first coinbase back to its address
+    CMutableTransaction spend = CreateValidMempoolTransaction(coinbase_tx, 0, 1, coinbaseKey, coinbase_script_pub_key, coinbase_tx->vout[0].nValue - COIN, /* submit */ false);
+    const CBlock spend_block = CreateAndProcessBlock({spend}, other_script_pub_key);
+    const uint256 spend_hash = spend_block.GetHash();
+    BOOST_CHECK(addressindex.BlockUntilSyncedToCurrentChain());
+
+    auto check_spent = [&] {
+        BOOST_CHECK(!find_unspent(coinbase_tx->GetHash()));
+        BOOST_CHECK(find_unspent(spend.GetHash()));
+        BOOST_CHECK(addressindex.ReadSpentIndex(spent_key, spent_value));
+        BOOST_CHECK(spent_value.txid == spend.GetHash());
+        BOOST_CHECK_EQUAL(spent_value.inputIndex, 0U);
+    };
+    check_spent();
+    const CAddressWeightValue weight_spent = read_weight();
+    BOOST_CHECK_EQUAL(weight_spent.total, weight_unspent.total - COIN);
+
+    // Invalidate the block of the spend, the index is rewound when the block of the other branch is connected
+    {
+        BlockValidationState state;
+        CBlockIndex* pindex = WITH_LOCK(cs_main, return m_node.chainman->m_blockman.LookupBlockIndex(spend_hash));
+        BOOST_REQUIRE(m_node.chainman->ActiveChainstate().InvalidateBlock(state, pindex));
+    }
+    const uint256 other_hash = CreateAndProcessBlock({}, other_script_pub_key).GetHash();
+    BOOST_CHECK(addressindex.BlockUntilSyncedToCurrentChain());
+
+    BOOST_CHECK(find_unspent(coinbase_tx->GetHash()));
+    BOOST_CHECK(!find_unspent(spend.GetHash()));
+    BOOST_CHECK(!addressindex.ReadSpentIndex(spent_key, spent_value));
+    CAddressWeightValue weight = read_weight();
+    BOOST_CHECK_EQUAL(weight.total, weight_unspent.total);
+    BOOST_CHECK(weight.recent == weight_unspent.recent);
+
+    // Reconsider the block of the spend and invalidate the other branch, the spend is indexed again
+    {
+        BlockValidationState state;
+        CBlockIndex* pindex = WITH_LOCK(cs_main, return m_node.chainman->m_blockman.LookupBlockIndex(other_hash));
+        WITH_LOCK(cs_main, m_node.chainman->ActiveChainstate().ResetBlockFailureFlags(m_node.chainman->m_blockman.LookupBlockIndex(spend_hash)));
+        BOOST_REQUIRE(m_node.chainman->ActiveChainstate().InvalidateBlock(state, pindex));
+        BOOST_REQUIRE(m_node.chainman->ActiveChainstate().ActivateBestChain(state));
+    }
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Tip()->GetBlockHash()), spend_hash);
+    BOOST_CHECK(addressindex.BlockUntilSyncedToCurrentChain());
+
+    check_spent();
+    weight = read_weight();
+    BOOST_CHECK_EQUAL(weight.total, weight_spent.total);
+    BOOST_CHECK(weight.recent == weight_spent.recent);
+
+    addressindex.Stop();
+    SyncWithValidationInterfaceQueue();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -162,6 +162,12 @@ ChainTestingSetup::ChainTestingSetup(const std::string& chainName, const std::ve
     globalState->db().commit();
     globalState->dbUtxo().commit();
     pstorageresult.reset(new StorageResults(pathTemp.string()));
+    g_state_node_cache = std::make_shared<dev::TrieNodeCache>(1 << 20);
+    globalState->db().setNodeCache(g_state_node_cache);
+    globalState->dbUtxo().setNodeCache(g_state_node_cache);
+    pstatesnapshot = std::make_shared<StateSnapshot>(pathTemp / "snapshot", 1 << 20, true);
+    pstatesnapshot->Generate(globalState->db(), globalState->rootHash(), -1);
+    globalState->setSnapshot(pstatesnapshot);
 //////////////////////////////////////////////////////////////
 
     pblocktree.reset(new CBlockTreeDB(1 << 20, true));
@@ -195,7 +201,10 @@ ChainTestingSetup::~ChainTestingSetup()
     pblocktree.reset();
 
 /////////////////////////////////////////////// // yody
+    pstorageresult.reset();
     delete globalState.release();
+    pstatesnapshot.reset();
+    g_state_node_cache.reset();
     globalSealEngine.reset();
 ///////////////////////////////////////////////
 }
@@ -9,7 +9,9 @@
 #include <rpc/blockchain.h>
 #include <sync.h>
 #include <test/util/setup_common.h>
+#include <txdb.h>
 #include <uint256.h>
+#include <util/convert.h>
 #include <validation.h>
 #include <validationinterface.h>
 
@@ -281,6 +283,10 @@ BOOST_FIXTURE_TEST_CASE(chainstatemanager_activate_snapshot, TestChain100Setup)
 
     BOOST_CHECK_EQUAL(tip->nChainTx, au_data.nChainTx);
 
+    // The contract state loaded with the snapshot is at the roots of its base block
+    BOOST_CHECK(WITH_LOCK(::cs_main, return globalState->rootHash()) == uintToh256(tip->hashStateRoot));
+    BOOST_CHECK(WITH_LOCK(::cs_main, return globalState->rootHashUTXO()) == uintToh256(tip->hashUTXORoot));
+
     // To be checked against later when we try loading a subsequent snapshot.
     uint256 loaded_snapshot_blockhash{*chainman.SnapshotBlockhash()};
 
@@ -353,4 +359,46 @@ BOOST_FIXTURE_TEST_CASE(chainstatemanager_activate_snapshot, TestChain100Setup)
         loaded_snapshot_blockhash);
 }
 
+//! The background chainstate only checks the state roots of its blocks, the
+//! indexes and the contract state follow the active snapshot chainstate.
+BOOST_FIXTURE_TEST_CASE(chainstatemanager_background_indexes, TestChain100Setup)
+{
+    ChainstateManager& chainman = *Assert(m_node.chainman);
+
+    mineBlocks(10);
+    BOOST_REQUIRE(CreateAndActivateUTXOSnapshot(m_node, m_path_root));
+
+    CChainState& background = chainman.ValidatedChainstate();
+    BOOST_REQUIRE(chainman.IsBackgroundIBD(&background));
+    const CBlockIndex* tip = chainman.ActiveTip();
+
+    // A contract registered by the active chainstate at the height of the snapshot
+    const dev::Address contract{"6c89a1a6ca2ae7c00b248bb2832d6f480f27da68"};
+    std::vector<std::pair<dev::h160, bool>> contracts{{contract, true}};
+    BOOST_REQUIRE(WITH_LOCK(::cs_main, return pblocktree->UpdateContractIndex(tip->nHeight, contracts)));
+
+    // Disconnect the tip of the background chainstate and connect it again
+    {
+        LOCK2(::cs_main, m_node.mempool->cs);
+        BlockValidationState state;
+        BOOST_REQUIRE(background.DisconnectTip(state, nullptr));
+        BOOST_CHECK_EQUAL(background.m_chain.Height(), tip->nHeight - 1);
+    }
+    BlockValidationState state;
+    BOOST_REQUIRE(background.ActivateBestChain(state, nullptr));
+    BOOST_CHECK_EQUAL(WITH_LOCK(::cs_main, return background.m_chain.Height()), tip->nHeight);
+
+    // The contract index of the active chainstate is left as it was
+    unsigned int height = 0;
+    BOOST_CHECK(WITH_LOCK(::cs_main, return pblocktree->ReadContractHeight(contract, height)));
+    BOOST_CHECK_EQUAL(height, (unsigned int)tip->nHeight);
+
+    // The contract state is back at the roots of the active tip
+    BOOST_CHECK(WITH_LOCK(::cs_main, return globalState->rootHash()) == uintToh256(tip->hashStateRoot));
+    BOOST_CHECK(WITH_LOCK(::cs_main, return globalState->rootHashUTXO()) == uintToh256(tip->hashUTXORoot));
+
+    // Let scheduler events finish running to avoid accessing memory that is going to be unloaded
+    SyncWithValidationInterfaceQueue();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -20,7 +20,8 @@ BOOST_AUTO_TEST_CASE(getcoinscachesizestate)
 {
     CTxMemPool mempool;
     BlockManager blockman{};
-    CChainState chainstate{&mempool, blockman};
+    ChainstateManager chainman{};
+    CChainState chainstate{&mempool, blockman, chainman};
     constexpr int CACHE_SIZE_BYTES = 1664;
     chainstate.InitCoinsDB(/*cache_size_bytes*/ CACHE_SIZE_BYTES, /*in_memory*/ true, /*should_wipe*/ false);
     WITH_LOCK(::cs_main, chainstate.InitCoinsCache(CACHE_SIZE_BYTES));
@@ -2,10 +2,12 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <arith_uint256.h>
 #include <chainparams.h>
 #include <net.h>
 #include <signet.h>
 #include <uint256.h>
+#include <undo.h>
 #include <validation.h>
 
 #include <test/util/setup_common.h>
@@ -179,4 +181,59 @@ BOOST_AUTO_TEST_CASE(test_assumeutxo)
     BOOST_CHECK_EQUAL(out210.nChainTx, 2100U);
 }
 
+//! Test the lookup of the coins spent by the last blocks of the chain.
+BOOST_AUTO_TEST_CASE(spent_coin_window)
+{
+    const int maturity = Params().GetConsensus().MaxCoinbaseMaturity();
+    const int count = maturity + 10;
+    std::vector<CBlockIndex> indexes(count);
+    std::vector<COutPoint> prevouts;
+    SpentCoinWindow window;
+    for (int i = 0; i < count; i++) {
+        indexes[i].nHeight = i;
+        indexes[i].pprev = i ? &indexes[i - 1] : nullptr;
+
+        // Each block spends one coin besides the coinbase
+        CBlock block;
+        block.vtx.push_back(MakeTransactionRef(CMutableTransaction()));
+        CMutableTransaction tx;
+        prevouts.emplace_back(ArithToUint256(arith_uint256(i + 1)), 0);
+        tx.vin.emplace_back(prevouts.back());
+        block.vtx.push_back(MakeTransactionRef(tx));
+        CBlockUndo undo;
+        undo.vtxundo.emplace_back();
+        undo.vtxundo.back().vprevout.emplace_back(CTxOut(i, CScript()), i, false, false);
+        window.BlockConnected(block, undo, &indexes[i]);
+    }
+    const CBlockIndex* tip = &indexes[count - 1];
+
+    // The coins spent after the fork are found, the window covers the maturity
+    Coin coin;
+    int start = 0;
+    BOOST_CHECK(window.Find(tip, count - 5, prevouts[count - 2], &coin, start));
+    BOOST_CHECK_EQUAL(coin.out.nValue, count - 2);
+    BOOST_CHECK_EQUAL(start, count - maturity);
+    BOOST_CHECK(!window.Find(tip, count - 2, prevouts[count - 2], &coin, start));
+    BOOST_CHECK(!window.Find(tip, 0, prevouts[count - maturity - 1], &coin, start));
+    BOOST_CHECK(window.Find(tip, 0, prevouts[count - maturity], &coin, start));
+
+    // Another tip is not covered
+    BOOST_CHECK(!window.Find(&indexes[count - 2], 0, prevouts[count - 3], &coin, start));
+    BOOST_CHECK_EQUAL(start, count - 1);
+
+    // The coins of a disconnected block are dropped
+    window.BlockDisconnected(tip);
+    BOOST_CHECK(!window.Find(&indexes[count - 2], 0, prevouts[count - 1], &coin, start));
+    BOOST_CHECK(window.Find(&indexes[count - 2], 0, prevouts[count - 3], &coin, start));
+    BOOST_CHECK_EQUAL(start, count - maturity);
+
+    // A block which does not extend the tip starts the window again
+    CBlockIndex fork;
+    fork.nHeight = 1;
+    fork.pprev = &indexes[0];
+    window.BlockConnected(CBlock(), CBlockUndo(), &fork);
+    BOOST_CHECK(!window.Find(&fork, 0, prevouts[1], &coin, start));
+    BOOST_CHECK_EQUAL(start, 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,69 @@
+#include <boost/test/unit_test.hpp>
+#include <chainparams.h>
+#include <index/addressindex.h>
+#include <test/util/setup_common.h>
+
+BOOST_FIXTURE_TEST_SUITE(addressweight_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(address_weight_connect_disconnect)
+{
+    AddressIndex::DB db(1 << 20, true);
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    const int height = 10000;
+    const int maturity = consensusParams.CoinbaseMaturity(height + 1);
+    const uint256 address = uint256S("01");
+    const uint256 txOld = uint256S("02");
+    const uint256 txNew = uint256S("03");
+    CScript script;
+
+    // Connect an old output and a recent one
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> connect;
+    connect.emplace_back(CAddressUnspentKey(1, address, txOld, 0), CAddressUnspentValue(5 * COIN, script, height - maturity - 10, false));
+    BOOST_CHECK(db.UpdateAddressUnspentIndex(connect, height - maturity - 10));
+    connect.clear();
+    connect.emplace_back(CAddressUnspentKey(1, address, txNew, 0), CAddressUnspentValue(3 * COIN, script, height, false));
+    connect.emplace_back(CAddressUnspentKey(1, address, txNew, 1), CAddressUnspentValue(2 * COIN, script, height, false));
+    BOOST_CHECK(db.UpdateAddressUnspentIndex(connect, height));
+
+    CAddressWeightValue weight;
+    BOOST_CHECK(db.ReadAddressWeight(address, 1, weight));
+    BOOST_CHECK_EQUAL(weight.total, 10 * COIN);
+    BOOST_CHECK_EQUAL(weight.GetMature(height, maturity), 5 * COIN);
+    BOOST_CHECK_EQUAL(weight.GetMature(height + maturity - 1, maturity), 10 * COIN);
+
+    // Spend the old output and one of the new ones in the next block
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> spend;
+    spend.emplace_back(CAddressUnspentKey(1, address, txOld, 0), CAddressUnspentValue());
+    spend.emplace_back(CAddressUnspentKey(1, address, txNew, 1), CAddressUnspentValue());
+    BOOST_CHECK(db.UpdateAddressUnspentIndex(spend, height + 1));
+    BOOST_CHECK(db.ReadAddressWeight(address, 1, weight));
+    BOOST_CHECK_EQUAL(weight.total, 3 * COIN);
+    BOOST_CHECK_EQUAL(weight.GetMature(height + 1, maturity), 0);
+
+    // Disconnect the block, the spent outputs are restored
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> restore;
+    restore.emplace_back(CAddressUnspentKey(1, address, txOld, 0), CAddressUnspentValue(5 * COIN, script, height - maturity - 10, false));
+    restore.emplace_back(CAddressUnspentKey(1, address, txNew, 1), CAddressUnspentValue(2 * COIN, script, height, false));
+    BOOST_CHECK(db.UpdateAddressUnspentIndex(restore, height + 1));
+    BOOST_CHECK(db.ReadAddressWeight(address, 1, weight));
+    BOOST_CHECK_EQUAL(weight.total, 10 * COIN);
+    BOOST_CHECK_EQUAL(weight.GetMature(height, maturity), 5 * COIN);
+
+    // Writing an output again does not count it twice
+    BOOST_CHECK(db.UpdateAddressUnspentIndex(connect, height));
+    BOOST_CHECK(db.ReadAddressWeight(address, 1, weight));
+    BOOST_CHECK_EQUAL(weight.total, 10 * COIN);
+
+    // The rebuilt weights match the updated ones
+    CAddressWeightValue updated = weight;
+    BOOST_CHECK(db.BuildAddressWeightIndex(height));
+    BOOST_CHECK(db.ReadAddressWeight(address, 1, weight));
+    BOOST_CHECK_EQUAL(weight.total, updated.total);
+    BOOST_CHECK(weight.recent == updated.recent);
+
+    // An address without outputs has no weight
+    BOOST_CHECK(db.ReadAddressWeight(uint256S("04"), 1, weight));
+    BOOST_CHECK(weight.IsNull());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
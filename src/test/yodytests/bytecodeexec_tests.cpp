@@ -374,4 +374,82 @@ BOOST_AUTO_TEST_CASE(bytecodeexec_contract_create_contracts){
     BOOST_CHECK(result.second.valueTransfers.size() == 0);
 }
 
+BOOST_AUTO_TEST_CASE(bytecodeexec_call_contract_snapshot){
+    initState();
+    YodyTransaction txEthCreate = createYodyTransaction(CODE[3], 0, GASLIMIT, dev::u256(1), HASHTX, dev::Address());
+    std::vector<YodyTransaction> txs(1, txEthCreate);
+    executeBC(txs, *m_node.chainman);
+    dev::Address newAddress(createYodyAddress(txEthCreate.getHashWith(), txEthCreate.getNVout()));
+    valtype codeCall(ParseHex("3f811b80"));
+
+    std::vector<ResultExecute> expected = WITH_LOCK(cs_main, return CallContract(newAddress, codeCall, m_node.chainman->ActiveChainstate()));
+    std::unique_ptr<CallContractSnapshot> snapshot = WITH_LOCK(cs_main, return std::make_unique<CallContractSnapshot>(m_node.chainman->ActiveChainstate()));
+
+    // Changes made to the global state after the snapshot was taken are not visible to it
+    YodyTransaction txEthCreate2 = createYodyTransaction(CODE[0], 0, GASLIMIT, dev::u256(1), HASHTX, dev::Address(), 1);
+    std::vector<YodyTransaction> txs2(1, txEthCreate2);
+    executeBC(txs2, *m_node.chainman);
+    dev::Address newAddress2(createYodyAddress(txEthCreate2.getHashWith(), txEthCreate2.getNVout()));
+    BOOST_CHECK(globalState->addressInUse(newAddress2));
+    BOOST_CHECK(!snapshot->AddressInUse(newAddress2));
+    BOOST_CHECK(snapshot->AddressInUse(newAddress));
+
+    std::vector<ResultExecute> result = snapshot->Call(newAddress, codeCall);
+    BOOST_CHECK(result.size() == 1);
+    BOOST_CHECK(result[0].execRes.excepted == expected[0].execRes.excepted);
+    BOOST_CHECK(result[0].execRes.gasUsed == expected[0].execRes.gasUsed);
+    BOOST_CHECK(result[0].execRes.output == expected[0].execRes.output);
+    BOOST_CHECK(result[0].txRec.log().size() == expected[0].txRec.log().size());
+}
+
+BOOST_AUTO_TEST_CASE(bytecodeexec_memo){
+    initState();
+    CBlock block(generateBlock());
+    CChain& chain = m_node.chainman->ActiveChain();
+    CBlockIndex* tip = WITH_LOCK(cs_main, return chain.Tip());
+    const uint256 hashTx = uint256S("01");
+    const dev::h256 oldHashStateRoot = globalState->rootHash();
+    const dev::h256 oldHashUTXORoot = globalState->rootHashUTXO();
+
+    // The execution made to assemble the block is recorded
+    YodyTransaction txEth = createYodyTransaction(CODE[0], 0, GASLIMIT, dev::u256(1), HASHTX, dev::Address());
+    ByteCodeExec exec(block, std::vector<YodyTransaction>(1, txEth), DEFAULT_BLOCK_GAS_LIMIT_DGP, tip, chain);
+    exec.UseMemo(hashTx, 1, true);
+    BOOST_CHECK(exec.performByteCode());
+    const dev::h256 hashStateRoot = globalState->rootHash();
+    const dev::h256 hashUTXORoot = globalState->rootHashUTXO();
+    const dev::Address newAddress = createYodyAddress(txEth.getHashWith(), txEth.getNVout());
+    BOOST_CHECK(globalState->addressInUse(newAddress));
+
+    // It is reused from the same state without executing the transactions again
+    globalState->setRoot(oldHashStateRoot);
+    globalState->setRootUTXO(oldHashUTXORoot);
+    ByteCodeExec memo(block, std::vector<YodyTransaction>(), DEFAULT_BLOCK_GAS_LIMIT_DGP, tip, chain);
+    memo.UseMemo(hashTx, 1, false);
+    BOOST_CHECK(memo.performByteCode());
+    BOOST_CHECK(memo.getResult().size() == 1);
+    BOOST_CHECK(memo.getResult()[0].execRes.gasUsed == exec.getResult()[0].execRes.gasUsed);
+    BOOST_CHECK(memo.getResult()[0].execRes.newAddress == newAddress);
+    BOOST_CHECK(globalState->rootHash() == hashStateRoot);
+    BOOST_CHECK(globalState->rootHashUTXO() == hashUTXORoot);
+    BOOST_CHECK(globalState->addressInUse(newAddress));
+
+    // Not at another position of the block or from another state
+    globalState->setRoot(oldHashStateRoot);
+    globalState->setRootUTXO(oldHashUTXORoot);
+    ByteCodeExec otherPosition(block, std::vector<YodyTransaction>(), DEFAULT_BLOCK_GAS_LIMIT_DGP, tip, chain);
+    otherPosition.UseMemo(hashTx, 2, false);
+    BOOST_CHECK(otherPosition.performByteCode());
+    BOOST_CHECK(otherPosition.getResult().empty());
+    BOOST_CHECK(globalState->rootHash() == oldHashStateRoot);
+
+    globalState->setRoot(hashStateRoot);
+    globalState->setRootUTXO(hashUTXORoot);
+    ByteCodeExec otherState(block, std::vector<YodyTransaction>(), DEFAULT_BLOCK_GAS_LIMIT_DGP, tip, chain);
+    otherState.UseMemo(hashTx, 1, false);
+    BOOST_CHECK(otherState.performByteCode());
+    BOOST_CHECK(otherState.getResult().empty());
+    g_contract_exec_memo.Clear();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,79 @@
+#include <boost/test/unit_test.hpp>
+#include <test/util/setup_common.h>
+#include <txdb.h>
+
+namespace {
+
+std::vector<dev::h160> ReadContracts(CBlockTreeDB& db)
+{
+    std::vector<CHeightTxIndexKey> keys;
+    BOOST_CHECK(db.ReadContractIndex(CHeightTxIndexKey(), 0, 100, keys));
+    std::vector<dev::h160> contracts;
+    for (const CHeightTxIndexKey& key : keys)
+        contracts.push_back(key.address);
+    return contracts;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(contractindex_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(contract_index_connect_disconnect)
+{
+    CBlockTreeDB db(1 << 20, true);
+    const dev::h160 first("0000000000000000000000000000000000000003");
+    const dev::h160 second("0000000000000000000000000000000000000002");
+    const dev::h160 third("0000000000000000000000000000000000000001");
+
+    // Accounts are listed by creation height, changed accounts keep their height
+    BOOST_CHECK(db.UpdateContractIndex(100, {{first, true}, {third, false}}));
+    BOOST_CHECK(db.UpdateContractIndex(101, {{first, true}, {second, true}}));
+    BOOST_CHECK(db.UpdateContractIndex(102, {{first, false}, {third, true}}));
+    BOOST_CHECK(ReadContracts(db) == std::vector<dev::h160>({second, third}));
+
+    unsigned int height = 0;
+    BOOST_CHECK(db.ReadContractHeight(second, height));
+    BOOST_CHECK_EQUAL(height, 101U);
+    std::vector<CHeightTxIndexKey> page;
+    BOOST_CHECK(db.ReadContractIndex(CHeightTxIndexKey(height, second), 1, 100, page));
+    BOOST_REQUIRE_EQUAL(page.size(), 1U);
+    BOOST_CHECK(page[0].address == third);
+
+    // Disconnecting restores the removed account at its creation height
+    BOOST_CHECK(db.EraseContractIndex(102));
+    BOOST_CHECK(ReadContracts(db) == std::vector<dev::h160>({first, second}));
+
+    // Reconnecting from a lower height reverts the blocks connected above it first
+    BOOST_CHECK(db.UpdateContractIndex(102, {{third, true}}));
+    BOOST_CHECK(db.UpdateContractIndex(101, {{second, true}}));
+    BOOST_CHECK(ReadContracts(db) == std::vector<dev::h160>({first, second}));
+    BOOST_CHECK(db.EraseContractIndex(101));
+    BOOST_CHECK(db.EraseContractIndex(100));
+    BOOST_CHECK(ReadContracts(db).empty());
+}
+
+BOOST_AUTO_TEST_CASE(contract_index_prune_undo)
+{
+    CBlockTreeDB db(1 << 20, true);
+    const dev::h160 first("0000000000000000000000000000000000000003");
+    const dev::h160 second("0000000000000000000000000000000000000002");
+
+    BOOST_CHECK(db.UpdateContractIndex(100, {{first, true}}));
+    BOOST_CHECK(db.UpdateContractIndex(101, {{second, true}}));
+    BOOST_CHECK(db.UpdateContractIndex(102, {{first, false}}));
+
+    // The undo data below the height is erased, those blocks are no longer disconnected
+    BOOST_CHECK(db.PruneContractUndo(102));
+    BOOST_CHECK(db.PruneContractUndo(102));
+    BOOST_CHECK(db.EraseContractIndex(102));
+    BOOST_CHECK(ReadContracts(db) == std::vector<dev::h160>({first, second}));
+    BOOST_CHECK(db.EraseContractIndex(101));
+    BOOST_CHECK(db.EraseContractIndex(100));
+    BOOST_CHECK(ReadContracts(db) == std::vector<dev::h160>({first, second}));
+
+    // Reconnecting above the pruned heights does not revert them
+    BOOST_CHECK(db.UpdateContractIndex(102, {{first, false}}));
+    BOOST_CHECK(ReadContracts(db) == std::vector<dev::h160>({second}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
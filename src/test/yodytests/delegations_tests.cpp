@@ -2,6 +2,7 @@
 #include <yodytests/test_utils.h>
 #include <script/standard.h>
 #include <chainparams.h>
+#include <txdb.h>
 #include <yody/yodydelegation.h>
 
 namespace DelegationTest{
@@ -100,6 +101,78 @@ BOOST_AUTO_TEST_CASE(checking_delegations_from_events){
     BOOST_CHECK(delegations.size() == 0);
 }
 
+BOOST_AUTO_TEST_CASE(checking_delegation_index){
+    CBlockTreeDB db(1 << 20, true);
+
+    // Initialize events
+    DelegationEvent event;
+    event.type = DELEGATION_ADD;
+    event.item.delegate = uint160(ParseHex(DELEGATE_ADDRESS_HEX));
+    event.item.staker = uint160(ParseHex(STAKER_ADDRESS_HEX));
+    event.item.fee = STAKER_FEE;
+    event.item.blockHeight = 10;
+    event.item.PoD = ParseHex(POD_HEX);
+    uint160 staker2 = uint160(ParseHex("a2330f4221f31b7d5648eae85e505d73bb852b49"));
+
+    // Add delegation
+    BOOST_CHECK(db.UpdateDelegationIndex(10, {event}));
+    Delegation delegation;
+    BOOST_CHECK(db.ReadDelegation(event.item.delegate, delegation));
+    BOOST_CHECK(delegation == event.item);
+    std::map<uint160, Delegation> delegations;
+    BOOST_CHECK(db.ReadStakerDelegations(event.item.staker, delegations));
+    BOOST_CHECK(delegations.size() == 1 && delegations[event.item.delegate] == event.item);
+
+    // Delegate to another staker, then remove the delegation in the same block
+    DelegationEvent event2 = event;
+    event2.item.staker = staker2;
+    event2.item.blockHeight = 11;
+    DelegationEvent event3 = event2;
+    event3.type = DELEGATION_REMOVE;
+    BOOST_CHECK(db.UpdateDelegationIndex(11, {event2}));
+    delegations.clear();
+    BOOST_CHECK(db.ReadStakerDelegations(event.item.staker, delegations));
+    BOOST_CHECK(delegations.empty());
+    BOOST_CHECK(db.ReadStakerDelegations(staker2, delegations));
+    BOOST_CHECK(delegations.size() == 1);
+    BOOST_CHECK(db.UpdateDelegationIndex(12, {event3, event2, event3}));
+    BOOST_CHECK(!db.ReadDelegation(event.item.delegate, delegation));
+    delegations.clear();
+    BOOST_CHECK(db.ReadDelegations(delegations));
+    BOOST_CHECK(delegations.empty());
+
+    // Disconnect the blocks
+    BOOST_CHECK(db.EraseDelegationIndex(12));
+    BOOST_CHECK(db.ReadDelegation(event.item.delegate, delegation));
+    BOOST_CHECK(delegation == event2.item);
+    BOOST_CHECK(db.EraseDelegationIndex(11));
+    BOOST_CHECK(db.ReadDelegation(event.item.delegate, delegation));
+    BOOST_CHECK(delegation == event.item);
+    delegations.clear();
+    BOOST_CHECK(db.ReadStakerDelegations(staker2, delegations));
+    BOOST_CHECK(delegations.empty());
+    BOOST_CHECK(db.ReadStakerDelegations(event.item.staker, delegations));
+    BOOST_CHECK(delegations.size() == 1);
+
+    // Connect a block again after an unclean shutdown
+    BOOST_CHECK(db.UpdateDelegationIndex(11, {event3}));
+    BOOST_CHECK(db.UpdateDelegationIndex(11, {event2}));
+    BOOST_CHECK(db.ReadDelegation(event.item.delegate, delegation));
+    BOOST_CHECK(delegation == event2.item);
+
+    // A block without events connected again after an unclean shutdown reverts the changes left at its height
+    BOOST_CHECK(db.UpdateDelegationIndex(11, {}));
+    BOOST_CHECK(db.ReadDelegation(event.item.delegate, delegation));
+    BOOST_CHECK(delegation == event.item);
+    BOOST_CHECK(db.EraseDelegationIndex(11));
+    BOOST_CHECK(db.ReadDelegation(event.item.delegate, delegation));
+    BOOST_CHECK(delegation == event.item);
+    BOOST_CHECK(db.EraseDelegationIndex(10));
+    delegations.clear();
+    BOOST_CHECK(db.ReadDelegations(delegations));
+    BOOST_CHECK(delegations.empty());
+}
+
 BOOST_AUTO_TEST_CASE(checking_delegations_contract){
     // Initialize
 //    initState();
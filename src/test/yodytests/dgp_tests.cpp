@@ -535,6 +535,30 @@ BOOST_AUTO_TEST_CASE(block_size_passage_from_130_to_0_three_paramsInstance_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(block_size_cache_follows_state_root){
+    initState();
+    contractLoading();
+    dev::h256 oldHashStateRoot = globalState->rootHash();
+    dev::h256 oldHashUTXORoot = globalState->rootHashUTXO();
+
+    YodyDGP yodyDGP(globalState.get(), m_node.chainman->ActiveChainstate());
+    int coinbaseMaturity = Params().GetConsensus().CoinbaseMaturity(0);
+    uint32_t blocktimeDownscaleFactor = Params().GetConsensus().BlocktimeDownscaleFactor(coinbaseMaturity + 2);
+    BOOST_CHECK(yodyDGP.getBlockSize(coinbaseMaturity + 2) == DEFAULT_BLOCK_SIZE_DGP / blocktimeDownscaleFactor);
+
+    dev::h256 hashTemp(hash);
+    std::vector<YodyTransaction> txs;
+    txs.push_back(createYodyTransaction(code[0], 0, dev::u256(500000), dev::u256(1), hashTemp, BlockSizeDGP, 0));
+    txs.push_back(createYodyTransaction(code[7], 0, dev::u256(500000), dev::u256(1), ++hashTemp, dev::Address(), 0));
+    txs.push_back(createYodyTransaction(code[2], 0, dev::u256(500000), dev::u256(1), ++hashTemp, BlockSizeDGP, 0));
+    auto result = executeBC(txs, *m_node.chainman);
+    BOOST_CHECK(yodyDGP.getBlockSize(coinbaseMaturity + 2) == 1000000);
+
+    globalState->setRoot(oldHashStateRoot);
+    globalState->setRootUTXO(oldHashUTXORoot);
+    BOOST_CHECK(yodyDGP.getBlockSize(coinbaseMaturity + 2) == DEFAULT_BLOCK_SIZE_DGP / blocktimeDownscaleFactor);
+}
+
 BOOST_AUTO_TEST_CASE(min_gas_price_default_state_test1){
     initState();
     contractLoading();
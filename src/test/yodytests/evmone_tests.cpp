@@ -2,6 +2,7 @@
 #include <yodytests/test_utils.h>
 #include <script/standard.h>
 #include <chainparams.h>
+#include <libevm/CodeAnalysisCache.h>
 
 namespace EvmoneTest{
 
@@ -58,6 +59,27 @@ BOOST_AUTO_TEST_CASE(checking_create_with_value){
 
 }
 
+BOOST_AUTO_TEST_CASE(code_analysis_cache){
+    dev::eth::CodeAnalysisCache cache(1 << 20, 1);
+    const valtype& code = CODE[0];
+    const dev::h256 codeHash = dev::sha3(code);
+
+    // The analysis is shared by the calls to the same code and revision
+    auto analysis = cache.get(codeHash, EVMC_LONDON, dev::bytesConstRef(code.data(), code.size()));
+    BOOST_CHECK(cache.get(codeHash, EVMC_LONDON, dev::bytesConstRef(code.data(), code.size())) == analysis);
+    BOOST_CHECK(cache.hits() == 1 && cache.misses() == 1);
+    BOOST_CHECK(cache.get(codeHash, EVMC_BERLIN, dev::bytesConstRef(code.data(), code.size())) != analysis);
+    BOOST_CHECK(cache.count() == 2);
+    BOOST_CHECK(cache.size() > 0 && cache.size() <= cache.capacity());
+
+    // An evicted analysis stays valid for its users
+    cache.setCapacity(0);
+    BOOST_CHECK(cache.count() == 0 && cache.size() == 0);
+    BOOST_CHECK(analysis.use_count() == 1);
+    BOOST_CHECK(cache.get(codeHash, EVMC_LONDON, dev::bytesConstRef(code.data(), code.size())) != analysis);
+    BOOST_CHECK(cache.count() == 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
@@ -0,0 +1,222 @@
+#include <boost/test/unit_test.hpp>
+#include <test/util/setup_common.h>
+#include <yodytests/test_utils.h>
+
+namespace {
+
+const dev::u256 GASLIMIT = dev::u256(500000);
+const dev::h256 HASHTX = dev::h256(ParseHex("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"));
+
+/*
+    pragma solidity ^0.4.12;
+    contract Test {
+        uint x = 13;
+        function () payable {
+            x *= 2;
+        }
+        function add(uint y) returns (uint) {
+            x += y;
+            return x;
+        }
+    }
+*/
+const valtype CODE = ParseHex("6060604052600d600055341561001457600080fd5b61017e806100236000396000f30060606040526004361061004c576000357c0100000000000000000000000000000000000000000000000000000000900463ffffffff168063027c1aaf1461004e5780635b9af12b14610058575b005b61005661008f565b005b341561006357600080fd5b61007960048080359060200190919050506100a1565b6040518082815260200191505060405180910390f35b60026000808282540292505081905550565b60007fc5c442325655248f6bccf5c6181738f8755524172cea2a8bd1e38e43f833e7f282600054016000548460405180848152602001838152602001828152602001935050505060405180910390a17fc5c442325655248f6bccf5c6181738f8755524172cea2a8bd1e38e43f833e7f282600054016000548460405180848152602001838152602001828152602001935050505060405180910390a1816000540160008190555060005490509190505600a165627a7a7230582015732bfa66bdede47ecc05446bf4c1e8ed047efac25478cb13b795887df70f290029");
+
+const valtype ADD = ParseHex("5b9af12b0000000000000000000000000000000000000000000000000000000000000001");
+
+struct BlockExecution {
+    std::vector<ResultExecute> results;
+    dev::h256 hashStateRoot;
+    dev::h256 hashUTXORoot;
+    size_t nCommitted{0};
+    size_t nConflicts{0};
+};
+
+std::vector<dev::Address> deployContracts(size_t count, ChainstateManager& chainman){
+    std::vector<YodyTransaction> txs;
+    std::vector<dev::Address> addresses;
+    dev::h256 hash(HASHTX);
+    for(size_t i = 0; i < count; i++){
+        txs.push_back(createYodyTransaction(CODE, 0, GASLIMIT, dev::u256(1), hash, dev::Address()));
+        addresses.push_back(createYodyAddress(hash, 0));
+        ++hash;
+    }
+    executeBC(txs, chainman);
+    return addresses;
+}
+
+/** Connect each transaction as the contract transaction at position i + 1 of a block, from the current roots */
+BlockExecution executeBlock(const std::vector<YodyTransaction>& txs, ChainstateManager& chainman, bool fParallel){
+    CBlock block(generateBlock());
+    CChain& chain = chainman.ActiveChain();
+    YodyDGP yodyDGP(globalState.get(), chainman.ActiveChainstate(), fGettingValuesDGP);
+    uint64_t blockGasLimit = yodyDGP.getBlockGasLimit(chain.Tip()->nHeight + 1);
+
+    std::unique_ptr<ParallelContractExec> parallel;
+    if(fParallel){
+        std::vector<std::pair<uint32_t, YodyTransaction>> candidates;
+        for(size_t i = 0; i < txs.size(); i++)
+            candidates.emplace_back(i + 1, txs[i]);
+        parallel = std::make_unique<ParallelContractExec>();
+        parallel->Execute(block, chain.Tip(), blockGasLimit, std::move(candidates));
+    }
+
+    BlockExecution ret;
+    for(size_t i = 0; i < txs.size(); i++){
+        ByteCodeExec exec(block, std::vector<YodyTransaction>(1, txs[i]), blockGasLimit, chain.Tip(), chain);
+        exec.UseParallel(parallel.get(), i + 1);
+        BOOST_CHECK(exec.performByteCode());
+        for(const ResultExecute& re : exec.getResult())
+            ret.results.push_back(re);
+    }
+    ret.hashStateRoot = globalState->rootHash();
+    ret.hashUTXORoot = globalState->rootHashUTXO();
+    if(parallel){
+        ret.nCommitted = parallel->Committed();
+        ret.nConflicts = parallel->Conflicts();
+    }
+    return ret;
+}
+
+/** Execute the transactions serially and in parallel from the same roots, and check that the results are the same */
+BlockExecution checkDeterminism(const std::vector<YodyTransaction>& txs, ChainstateManager& chainman){
+    const dev::h256 hashStateRoot = globalState->rootHash();
+    const dev::h256 hashUTXORoot = globalState->rootHashUTXO();
+    BlockExecution serial = executeBlock(txs, chainman, false);
+
+    globalState->setRoot(hashStateRoot);
+    globalState->setRootUTXO(hashUTXORoot);
+    BlockExecution parallel = executeBlock(txs, chainman, true);
+
+    BOOST_CHECK(serial.hashStateRoot == parallel.hashStateRoot);
+    BOOST_CHECK(serial.hashUTXORoot == parallel.hashUTXORoot);
+    BOOST_CHECK_EQUAL(serial.results.size(), parallel.results.size());
+    for(size_t i = 0; i < std::min(serial.results.size(), parallel.results.size()); i++){
+        const ResultExecute& s = serial.results[i];
+        const ResultExecute& p = parallel.results[i];
+        BOOST_CHECK(s.execRes.excepted == p.execRes.excepted);
+        BOOST_CHECK(s.execRes.gasUsed == p.execRes.gasUsed);
+        BOOST_CHECK(s.execRes.newAddress == p.execRes.newAddress);
+        BOOST_CHECK(s.execRes.output == p.execRes.output);
+        BOOST_CHECK(s.txRec.stateRoot() == p.txRec.stateRoot());
+        BOOST_CHECK(s.txRec.utxoRoot() == p.txRec.utxoRoot());
+        BOOST_CHECK(s.txRec.cumulativeGasUsed() == p.txRec.cumulativeGasUsed());
+        BOOST_CHECK_EQUAL(s.txRec.log().size(), p.txRec.log().size());
+        for(size_t j = 0; j < std::min(s.txRec.log().size(), p.txRec.log().size()); j++){
+            BOOST_CHECK(s.txRec.log()[j].address == p.txRec.log()[j].address);
+            BOOST_CHECK(s.txRec.log()[j].topics == p.txRec.log()[j].topics);
+            BOOST_CHECK(s.txRec.log()[j].data == p.txRec.log()[j].data);
+        }
+        BOOST_CHECK(s.tx.GetHash() == p.tx.GetHash());
+        BOOST_CHECK(s.changedAccounts == p.changedAccounts);
+    }
+    return parallel;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(parallelexec_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(parallelexec_independent_calls){
+    initState();
+    std::vector<dev::Address> contracts = deployContracts(4, *m_node.chainman);
+
+    // Each call changes its own contract, the sender and the author are deleted after each one
+    std::vector<YodyTransaction> txs;
+    dev::h256 hash(HASHTX ^ dev::h256(1));
+    for(const dev::Address& contract : contracts){
+        txs.push_back(createYodyTransaction(ADD, 0, GASLIMIT, dev::u256(1), hash, contract));
+        ++hash;
+    }
+    BlockExecution parallel = checkDeterminism(txs, *m_node.chainman);
+    BOOST_CHECK_EQUAL(parallel.nCommitted, 4U);
+    BOOST_CHECK_EQUAL(parallel.nConflicts, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(parallelexec_conflicting_calls){
+    initState();
+    std::vector<dev::Address> contracts = deployContracts(2, *m_node.chainman);
+
+    // The calls to the same contract read the storage changed by the call before them
+    std::vector<YodyTransaction> txs;
+    dev::h256 hash(HASHTX ^ dev::h256(1));
+    for(size_t i = 0; i < 3; i++){
+        txs.push_back(createYodyTransaction(ADD, 0, GASLIMIT, dev::u256(1), hash, contracts[0]));
+        ++hash;
+    }
+    txs.push_back(createYodyTransaction(ADD, 0, GASLIMIT, dev::u256(1), hash, contracts[1]));
+    BlockExecution parallel = checkDeterminism(txs, *m_node.chainman);
+    BOOST_CHECK_EQUAL(parallel.nCommitted, 2U);
+    BOOST_CHECK_EQUAL(parallel.nConflicts, 2U);
+}
+
+BOOST_AUTO_TEST_CASE(parallelexec_value_failures_and_creations){
+    initState();
+    std::vector<dev::Address> contracts = deployContracts(3, *m_node.chainman);
+
+    std::vector<YodyTransaction> txs;
+    dev::h256 hash(HASHTX ^ dev::h256(1));
+    // The fallback keeps the value, which changes the UTXO of the contract
+    txs.push_back(createYodyTransaction(valtype(), 1000, GASLIMIT, dev::u256(1), hash, contracts[0]));
+    // add is not payable, the value is refunded
+    txs.push_back(createYodyTransaction(ADD, 1000, GASLIMIT, dev::u256(1), ++hash, contracts[1]));
+    // Out of gas
+    txs.push_back(createYodyTransaction(ADD, 0, dev::u256(22000), dev::u256(1), ++hash, contracts[2]));
+    txs.push_back(createYodyTransaction(CODE, 0, GASLIMIT, dev::u256(1), ++hash, dev::Address()));
+    // Reads the UTXO of the first call
+    txs.push_back(createYodyTransaction(valtype(), 1000, GASLIMIT, dev::u256(1), ++hash, contracts[0]));
+    // Calls a missing contract, it is not executed
+    txs.push_back(createYodyTransaction(ADD, 0, GASLIMIT, dev::u256(1), ++hash, dev::Address("0202020202020202020202020202020202020202")));
+    BlockExecution parallel = checkDeterminism(txs, *m_node.chainman);
+    BOOST_CHECK_EQUAL(parallel.nCommitted, 4U);
+    BOOST_CHECK_EQUAL(parallel.nConflicts, 1U);
+}
+
+BOOST_AUTO_TEST_CASE(parallelexec_worker_threads){
+    initState();
+    std::vector<dev::Address> contracts = deployContracts(8, *m_node.chainman);
+
+    std::vector<YodyTransaction> txs;
+    dev::h256 hash(HASHTX ^ dev::h256(1));
+    for(size_t i = 0; i < 16; i++){
+        txs.push_back(createYodyTransaction(ADD, 0, GASLIMIT, dev::u256(1), hash, contracts[i % contracts.size()]));
+        ++hash;
+    }
+
+    StartContractExecWorkerThreads(3);
+    g_parallel_contract_exec = true;
+    BlockExecution parallel = checkDeterminism(txs, *m_node.chainman);
+    g_parallel_contract_exec = false;
+    StopContractExecWorkerThreads();
+
+    // The second call to each contract conflicts with the first one
+    BOOST_CHECK_EQUAL(parallel.nCommitted, 8U);
+    BOOST_CHECK_EQUAL(parallel.nConflicts, 8U);
+}
+
+BOOST_AUTO_TEST_CASE(parallelexec_take){
+    initState();
+    std::vector<dev::Address> contracts = deployContracts(2, *m_node.chainman);
+    const YodyTransaction tx1 = createYodyTransaction(ADD, 0, GASLIMIT, dev::u256(1), HASHTX ^ dev::h256(1), contracts[0]);
+    const YodyTransaction tx2 = createYodyTransaction(ADD, 0, GASLIMIT, dev::u256(1), HASHTX ^ dev::h256(2), contracts[1]);
+
+    std::vector<std::pair<uint32_t, YodyTransaction>> candidates;
+    candidates.emplace_back(1, tx1);
+    candidates.emplace_back(2, tx2);
+    CChain& chain = m_node.chainman->ActiveChain();
+    ParallelContractExec parallel;
+    parallel.Execute(generateBlock(), chain.Tip(), DEFAULT_BLOCK_GAS_LIMIT_DGP, std::move(candidates));
+
+    // An execution is not committed for another transaction or position
+    BOOST_CHECK(!parallel.Take(1, createYodyTransaction(ADD, 1, GASLIMIT, dev::u256(1), HASHTX ^ dev::h256(1), contracts[0])));
+    BOOST_CHECK(!parallel.Take(1, tx1));
+    BOOST_CHECK(!parallel.Take(3, tx2));
+
+    // Nor once the root was replaced, as when the results of the memo are used
+    globalState->setRoot(dev::sha3(dev::rlp("")));
+    BOOST_CHECK(!parallel.Take(2, tx2));
+    BOOST_CHECK_EQUAL(parallel.Committed(), 0U);
+    BOOST_CHECK_EQUAL(parallel.Conflicts(), 1U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
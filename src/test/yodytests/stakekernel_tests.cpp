@@ -0,0 +1,61 @@
+#include <boost/test/unit_test.hpp>
+#include <test/util/setup_common.h>
+#include <pos.h>
+#include <random.h>
+
+BOOST_FIXTURE_TEST_SUITE(stakekernel_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(stake_kernels_match_kernel_hash)
+{
+    FastRandomContext rng(true);
+    // Before and after the reduce block time fork, which changes how the weight is applied
+    for(int nHeight : {1000, Params().GetConsensus().nReduceBlocktimeHeight + 1000})
+    {
+        CBlockIndex index;
+        index.nHeight = nHeight - 1;
+        index.nStakeModifier = rng.rand256();
+
+        std::vector<COutPoint> prevouts;
+        std::map<COutPoint, CStakeCache> cache;
+        for(size_t i = 0; i < 2000; i++)
+        {
+            COutPoint prevout(rng.rand256(), rng.randrange(4));
+            prevouts.push_back(prevout);
+            if(i % 10 != 0)
+                cache.emplace(prevout, CStakeCache(1000 + rng.randrange(100), 1 + rng.randrange(1000 * COIN)));
+        }
+        std::vector<uint32_t> blockTimes = {1050, 1066, 1082, 1098};
+
+        // An easy target so both valid and invalid kernels are found
+        for(unsigned int nBits : {0x1d0fffffU, 0x2100ffffU})
+        {
+            std::vector<CStakeKernel> kernels;
+            PrepareStakeKernels(&index, nBits, prevouts, cache, kernels);
+            BOOST_CHECK_EQUAL(kernels.size(), cache.size());
+
+            std::vector<std::tuple<uint256, uint32_t, const CStakeKernel*>> solved;
+            CheckStakeKernels(kernels, 0, kernels.size(), blockTimes, solved);
+
+            size_t expected = 0;
+            for(uint32_t nTimeBlock : blockTimes)
+            {
+                for(const COutPoint& prevout : prevouts)
+                {
+                    uint256 hashProofOfStake;
+                    if(!CheckKernelCache(&index, nBits, nTimeBlock, prevout, cache, hashProofOfStake))
+                        continue;
+                    expected++;
+                    auto it = std::find_if(solved.begin(), solved.end(), [&](const std::tuple<uint256, uint32_t, const CStakeKernel*>& item){
+                        return std::get<2>(item)->prevout == prevout && std::get<1>(item) == nTimeBlock;
+                    });
+                    BOOST_REQUIRE(it != solved.end());
+                    BOOST_CHECK(std::get<0>(*it) == hashProofOfStake);
+                    BOOST_CHECK(prevouts[std::get<2>(*it)->index] == prevout);
+                }
+            }
+            BOOST_CHECK_EQUAL(solved.size(), expected);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
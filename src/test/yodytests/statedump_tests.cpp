@@ -0,0 +1,152 @@
+#include <boost/test/unit_test.hpp>
+#include <clientversion.h>
+#include <streams.h>
+#include <test/util/setup_common.h>
+#include <util/convert.h>
+#include <yody/statedump.h>
+#include <yody/yodystate.h>
+
+#include <fstream>
+
+namespace {
+
+const dev::Address contract("0000000000000000000000000000000000000789");
+
+bool Load(const fs::path& path, YodyState& state, const dev::h256& root, const dev::h256& rootUTXO)
+{
+    CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    YodyStateDumpStats stats;
+    return LoadYodyState(file, state.db(), state.dbUtxo(), root, rootUTXO, stats);
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(statedump_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(state_dump_load)
+{
+    const std::string dirSrc = (m_args.GetDataDirNet() / "stateSrc").string();
+    const std::string dirDst = (m_args.GetDataDirNet() / "stateDst").string();
+    const fs::path path = m_args.GetDataDirNet() / "state.dat";
+    const dev::h256 hashDB(dev::sha3(dev::rlp("")));
+
+    YodyState src(dev::u256(0), YodyState::openDB(dirSrc, hashDB, dev::WithExisting::Trust), dirSrc, dev::eth::BaseState::Empty);
+    dev::eth::State& base = src;
+    base.addBalance(contract, 5);
+    base.setCode(contract, dev::bytes(100, 0x60), 0);
+    for (unsigned i = 0; i < 50; i++) {
+        src.setStorage(contract, i, 1000 + i);
+    }
+    src.commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+    src.db().commit();
+    src.dbUtxo().commit();
+    const dev::h256 root = src.rootHash();
+    const dev::h256 rootUTXO = src.rootHashUTXO();
+
+    YodyStateDumpStats stats;
+    {
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        BOOST_CHECK(DumpYodyState(file, src.db(), src.dbUtxo(), root, rootUTXO, [] {}, stats));
+    }
+    BOOST_CHECK(stats.nodes > 2);
+    BOOST_CHECK(stats.preimages > 50);
+
+    YodyState dst(dev::u256(0), YodyState::openDB(dirDst, hashDB, dev::WithExisting::Trust), dirDst, dev::eth::BaseState::Empty);
+
+    // The roots of the snapshot must be the expected ones
+    BOOST_CHECK(!Load(path, dst, rootUTXO, root));
+
+    // An entry which does not match its hash is rejected
+    const fs::path badPath = m_args.GetDataDirNet() / "bad.dat";
+    {
+        std::ifstream in(path.string(), std::ios::binary);
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        data[64 + 4 + 1 + 32 + 5] ^= 1;
+        std::ofstream out(badPath.string(), std::ios::binary);
+        out << data;
+    }
+    BOOST_CHECK(!Load(badPath, dst, root, rootUTXO));
+
+    BOOST_CHECK(Load(path, dst, root, rootUTXO));
+    dst.setRoot(root);
+    dst.setRootUTXO(rootUTXO);
+    BOOST_CHECK(dst.balance(contract) == 5);
+    BOOST_CHECK(dst.code(contract) == dev::bytes(100, 0x60));
+    for (unsigned i = 0; i < 50; i++) {
+        BOOST_CHECK(dst.storage(contract, i) == 1000 + i);
+    }
+    BOOST_CHECK(dst.storage(contract).size() == 50);
+}
+
+BOOST_AUTO_TEST_CASE(state_dump_chunks)
+{
+    const std::string dirSrc = (m_args.GetDataDirNet() / "stateSrc").string();
+    const std::string dirDst = (m_args.GetDataDirNet() / "stateDst").string();
+    const fs::path path = m_args.GetDataDirNet() / "state.dat";
+    const dev::h256 hashDB(dev::sha3(dev::rlp("")));
+
+    // The code of the two contracts does not fit in the same chunk
+    const dev::Address contract2("0000000000000000000000000000000000000790");
+    YodyState src(dev::u256(0), YodyState::openDB(dirSrc, hashDB, dev::WithExisting::Trust), dirSrc, dev::eth::BaseState::Empty);
+    dev::eth::State& base = src;
+    base.addBalance(contract, 5);
+    base.setCode(contract, dev::bytes(STATE_SNAPSHOT_CHUNK_BYTES / 2, 0x60), 0);
+    base.addBalance(contract2, 5);
+    base.setCode(contract2, dev::bytes(STATE_SNAPSHOT_CHUNK_BYTES / 2, 0x61), 0);
+    src.commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+    src.db().commit();
+    src.dbUtxo().commit();
+    const dev::h256 root = src.rootHash();
+    const dev::h256 rootUTXO = src.rootHashUTXO();
+
+    YodyStateDumpStats stats;
+    {
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        BOOST_CHECK(DumpYodyState(file, src.db(), src.dbUtxo(), root, rootUTXO, [] {}, stats));
+    }
+
+    // Only the chunks of a single entry are larger than the limit
+    {
+        CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+        uint256 snapshotRoot, snapshotRootUTXO;
+        file >> snapshotRoot >> snapshotRootUTXO;
+        size_t chunks = 0;
+        uint32_t count;
+        file >> count;
+        while (count) {
+            size_t bytes = 0;
+            for (uint32_t i = 0; i < count; i++) {
+                uint8_t type;
+                uint256 key;
+                std::string value;
+                file >> type >> key >> value;
+                bytes += 1 + 32 + GetSizeOfCompactSize(value.size()) + value.size();
+            }
+            BOOST_CHECK(count == 1 || bytes <= STATE_SNAPSHOT_CHUNK_BYTES);
+            chunks++;
+            file >> count;
+        }
+        BOOST_CHECK(chunks >= 2);
+    }
+
+    YodyState dst(dev::u256(0), YodyState::openDB(dirDst, hashDB, dev::WithExisting::Trust), dirDst, dev::eth::BaseState::Empty);
+    BOOST_CHECK(Load(path, dst, root, rootUTXO));
+    dst.setRoot(root);
+    dst.setRootUTXO(rootUTXO);
+    BOOST_CHECK(dst.code(contract2) == dev::bytes(STATE_SNAPSHOT_CHUNK_BYTES / 2, 0x61));
+
+    // A chunk of several entries larger than the limit is rejected
+    const fs::path badPath = m_args.GetDataDirNet() / "bad.dat";
+    {
+        CAutoFile file(fsbridge::fopen(badPath, "wb"), SER_DISK, CLIENT_VERSION);
+        file << h256Touint(root) << h256Touint(rootUTXO) << uint32_t{2};
+        for (char c : {'a', 'b'}) {
+            const std::string value(STATE_SNAPSHOT_CHUNK_BYTES / 2, c);
+            file << uint8_t{0} << h256Touint(dev::sha3(dev::bytesConstRef(&value))) << value;
+        }
+        file << uint32_t{0} << uint32_t{0};
+    }
+    BOOST_CHECK(!Load(badPath, dst, root, rootUTXO));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,154 @@
+#include <boost/test/unit_test.hpp>
+#include <libdevcore/DBFactory.h>
+#include <libdevcore/TrieDB.h>
+#include <test/util/setup_common.h>
+#include <yody/statepruning.h>
+#include <yody/yodystate.h>
+
+namespace {
+
+dev::h256 Key(unsigned i)
+{
+    return dev::sha3(dev::rlp(i));
+}
+
+std::string Value(unsigned i, unsigned block)
+{
+    return std::string(40, char('a' + (i + block) % 26));
+}
+
+void WriteBlock(dev::GenericTrieDB<dev::OverlayDB>& trie, dev::OverlayDB& db, unsigned keys, unsigned block)
+{
+    for (unsigned i = 0; i < keys; i++) {
+        const dev::h256 key = Key(i);
+        const std::string value = Value(i, block);
+        trie.insert(key.ref(), dev::bytesConstRef(&value));
+    }
+    db.commit();
+    db.writeJournal(block);
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(statepruning_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(state_pruning_journal)
+{
+    dev::OverlayDB db(dev::db::DBFactory::create(m_args.GetDataDirNet() / "journal"));
+    BOOST_CHECK(!db.journaled());
+    db.setJournaling();
+    BOOST_CHECK(db.journaled());
+    dev::GenericTrieDB<dev::OverlayDB> trie(&db);
+    trie.init();
+
+    // Block 1 writes the keys and block 2 changes half of them
+    WriteBlock(trie, db, 100, 1);
+    const dev::h256 root1 = trie.root();
+    WriteBlock(trie, db, 50, 2);
+    const dev::h256 root2 = trie.root();
+
+    // The nodes replaced by block 2 are deleted when block 2 is pruned
+    db.prune(1);
+    BOOST_CHECK(db.exists(root1));
+    db.prune(2);
+    BOOST_CHECK(!db.exists(root1));
+    BOOST_CHECK(db.exists(root2));
+    for (unsigned i = 0; i < 100; i++) {
+        BOOST_CHECK(trie.at(Key(i).ref()) == Value(i, i < 50 ? 2 : 1));
+    }
+
+    // A disconnected block does not release the nodes it replaced, but the ones it wrote
+    WriteBlock(trie, db, 100, 3);
+    const dev::h256 root3 = trie.root();
+    db.removeJournal(3);
+    db.prune(3);
+    BOOST_CHECK(!db.exists(root3));
+    BOOST_CHECK(db.exists(root2));
+    trie.setRoot(root2);
+    BOOST_CHECK(trie.at(Key(10).ref()) == Value(10, 2));
+
+    // The block connected again writes its nodes back
+    WriteBlock(trie, db, 100, 3);
+    BOOST_CHECK(trie.root() == root3);
+    BOOST_CHECK(db.exists(root3));
+    for (unsigned i = 0; i < 100; i++) {
+        BOOST_CHECK(trie.at(Key(i).ref()) == Value(i, 3));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(state_pruning_discarded)
+{
+    dev::OverlayDB db(dev::db::DBFactory::create(m_args.GetDataDirNet() / "discarded"));
+    db.setJournaling();
+    dev::GenericTrieDB<dev::OverlayDB> trie(&db);
+    trie.init();
+
+    WriteBlock(trie, db, 100, 1);
+    const dev::h256 root1 = trie.root();
+
+    // A block template is committed on the tip and discarded
+    for (unsigned i = 0; i < 10; i++) {
+        const std::string value = Value(i, 5);
+        trie.insert(Key(i).ref(), dev::bytesConstRef(&value));
+    }
+    db.commit();
+    const dev::h256 rootTemplate = trie.root();
+    trie.setRoot(root1);
+
+    // The references of the template are released with the next block, when it is pruned
+    db.clearJournal();
+    WriteBlock(trie, db, 0, 2);
+    db.prune(1);
+    BOOST_CHECK(db.exists(rootTemplate));
+    db.prune(2);
+    BOOST_CHECK(!db.exists(rootTemplate));
+    BOOST_CHECK(db.exists(root1));
+    for (unsigned i = 0; i < 100; i++) {
+        BOOST_CHECK(trie.at(Key(i).ref()) == Value(i, 1));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(state_pruning_compact)
+{
+    const std::string dirYody = (m_args.GetDataDirNet() / "stateYody").string();
+    const dev::h256 hashDB(dev::sha3(dev::rlp("")));
+    const dev::Address contract("0000000000000000000000000000000000000789");
+    std::vector<std::pair<dev::h256, dev::h256>> roots;
+    {
+        YodyState state(dev::u256(0), YodyState::openDB(dirYody, hashDB, dev::WithExisting::Trust), dirYody, dev::eth::BaseState::Empty);
+        state.db().setJournaling();
+        dev::eth::State& base = state;
+        for (unsigned height = 1; height <= 3; height++) {
+            base.addBalance(contract, 1);
+            for (unsigned i = 0; i < 20; i++) {
+                state.setStorage(contract, i, height * 100 + i);
+            }
+            state.commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+            state.db().commit();
+            state.db().writeJournal(height);
+            roots.emplace_back(state.rootHash(), state.rootHashUTXO());
+        }
+    }
+
+    // Only the roots of blocks 2 and 3 are kept
+    BOOST_CHECK(CompactYodyState(dirYody, {roots[1], roots[2]}, 2, true));
+    YodyState state(dev::u256(0), YodyState::openDB(dirYody, hashDB, dev::WithExisting::Trust), dirYody, dev::eth::BaseState::PreExisting);
+    BOOST_CHECK(state.db().journaled());
+    BOOST_CHECK(!state.db().exists(roots[0].first));
+    for (unsigned height = 2; height <= 3; height++) {
+        state.setRoot(roots[height - 1].first);
+        BOOST_CHECK(state.balance(contract) == height);
+        for (unsigned i = 0; i < 20; i++) {
+            BOOST_CHECK(state.storage(contract, i) == height * 100 + i);
+        }
+    }
+
+    // The journal of block 3 is kept, so the nodes it replaced are deleted when it is pruned
+    state.db().setJournaling();
+    state.db().prune(3);
+    BOOST_CHECK(!state.db().exists(roots[1].first));
+    state.setRoot(roots[2].first);
+    BOOST_CHECK(state.storage(contract, 19) == 319);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,93 @@
+#include <boost/test/unit_test.hpp>
+#include <test/util/setup_common.h>
+#include <validation.h>
+
+BOOST_FIXTURE_TEST_SUITE(statesnapshot_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(state_snapshot_connect_disconnect)
+{
+    dev::eth::State& state = *globalState;
+    const dev::Address contract("0000000000000000000000000000000000000123");
+    const dev::h256 genesisRoot = globalState->rootHash();
+    BOOST_CHECK(pstatesnapshot->root() == genesisRoot);
+
+    // Block 1 creates the account with two slots
+    state.addBalance(contract, 1);
+    globalState->setStorage(contract, 1, 10);
+    globalState->setStorage(contract, 2, 20);
+    globalState->commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+    const dev::h256 root1 = globalState->rootHash();
+    BOOST_CHECK(pstatesnapshot->root() == root1);
+    BOOST_CHECK(pstatesnapshot->Flush(1, 0));
+    BOOST_CHECK(pstatesnapshot->storage(contract, 1) == 10);
+    BOOST_CHECK(pstatesnapshot->storage(contract, 2) == 20);
+    BOOST_CHECK(!pstatesnapshot->account(contract).empty());
+
+    // A commit dropped by setting the root back is not flushed
+    globalState->setStorage(contract, 1, 0);
+    globalState->commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+    BOOST_CHECK(pstatesnapshot->storage(contract, 1) == 0);
+    globalState->setRoot(root1);
+    BOOST_CHECK(pstatesnapshot->root() == root1);
+    BOOST_CHECK(pstatesnapshot->storage(contract, 1) == 10);
+
+    // Block 2 clears a slot and changes the other one
+    globalState->setStorage(contract, 1, 0);
+    globalState->setStorage(contract, 2, 30);
+    globalState->commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+    const dev::h256 root2 = globalState->rootHash();
+    BOOST_CHECK(pstatesnapshot->Flush(2, 0));
+    BOOST_CHECK(pstatesnapshot->root() == root2);
+    BOOST_CHECK(globalState->storage(contract, 1) == 0);
+    BOOST_CHECK(globalState->storage(contract, 2) == 30);
+
+    // Block 3 removes the account with its storage
+    state.kill(contract);
+    globalState->commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+    BOOST_CHECK(pstatesnapshot->Flush(3, 0));
+    BOOST_CHECK(pstatesnapshot->account(contract).empty());
+    BOOST_CHECK(pstatesnapshot->storage(contract, 2) == 0);
+
+    // Disconnecting the blocks restores the entries they replaced
+    BOOST_CHECK(pstatesnapshot->Disconnect(3));
+    globalState->setRoot(root2);
+    BOOST_CHECK(globalState->storage(contract, 1) == 0);
+    BOOST_CHECK(globalState->storage(contract, 2) == 30);
+    BOOST_CHECK(pstatesnapshot->Rewind(0));
+    BOOST_CHECK(pstatesnapshot->root() == genesisRoot);
+    BOOST_CHECK(pstatesnapshot->account(contract).empty());
+    BOOST_CHECK(pstatesnapshot->storage(contract, 1) == 0);
+    BOOST_CHECK(pstatesnapshot->storage(contract, 2) == 0);
+    globalState->setRoot(genesisRoot);
+}
+
+BOOST_AUTO_TEST_CASE(state_snapshot_generate)
+{
+    dev::eth::State& state = *globalState;
+    const dev::Address contract("0000000000000000000000000000000000000456");
+    state.addBalance(contract, 1);
+    globalState->setStorage(contract, 7, 70);
+    globalState->commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+    globalState->db().commit();
+    const dev::h256 root = globalState->rootHash();
+    const std::string account = pstatesnapshot->account(contract);
+
+    // A snapshot copied from the trie holds the same entries as the one kept up to date
+    StateSnapshot snapshot(m_args.GetDataDirNet() / "generated_snapshot", 1 << 20, true);
+    BOOST_CHECK(snapshot.Generate(globalState->db(), root, 1));
+    BOOST_CHECK(snapshot.root() == root);
+    BOOST_CHECK(snapshot.account(contract) == account);
+    BOOST_CHECK(snapshot.storage(contract, 7) == 70);
+    BOOST_CHECK(snapshot.storage(contract, 8) == 0);
+
+    // Blocks flushed before the prune height can no longer be disconnected
+    BOOST_CHECK(pstatesnapshot->Flush(1, 0));
+    globalState->setStorage(contract, 7, 71);
+    globalState->commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+    BOOST_CHECK(pstatesnapshot->Flush(2, 2));
+    BOOST_CHECK(pstatesnapshot->Disconnect(2));
+    BOOST_CHECK(pstatesnapshot->root() == root);
+    BOOST_CHECK(!pstatesnapshot->Disconnect(1));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
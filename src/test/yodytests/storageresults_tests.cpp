@@ -0,0 +1,303 @@
+#include <boost/test/unit_test.hpp>
+#include <key_io.h>
+#include <test/util/setup_common.h>
+#include <util/convert.h>
+#include <yody/storageresults.h>
+#include <yody/yodytoken.h>
+
+namespace {
+
+std::vector<TransactionReceiptInfo> createResult(const uint256& hashTx)
+{
+    dev::Address contract("0102030405060708090a0b0c0d0e0f1011121314");
+    dev::Address sender("abababababababababababababababababababab");
+    dev::h256 topic0(dev::sha3(std::string("Transfer(address,address,uint256)")));
+    dev::bytes data(64, 0);
+    data[31] = 0x2a;
+    data[40] = 0x01;
+    data[41] = 0x02;
+
+    dev::eth::LogEntries logs;
+    logs.push_back(dev::eth::LogEntry(contract, {topic0, dev::h256(sender, dev::h256::AlignRight)}, data));
+    logs.push_back(dev::eth::LogEntry(contract, {topic0}, dev::bytes()));
+
+    std::vector<TransactionReceiptInfo> result;
+    for (uint32_t i = 0; i < 2; i++) {
+        dev::eth::LogBloom bloom;
+        for (const dev::eth::LogEntry& log : logs)
+            bloom |= log.bloom();
+        result.push_back(TransactionReceiptInfo{
+            uint256S("aa"), 1234, hashTx, 7, sender, contract, 50000 + i, 25000, dev::Address(),
+            i == 0 ? logs : dev::eth::LogEntries(), dev::eth::TransactionException::None, "None", i,
+            i == 0 ? bloom : dev::eth::LogBloom(), dev::h256(i + 1), dev::h256(i + 2)});
+    }
+    return result;
+}
+
+void checkResult(const std::vector<TransactionReceiptInfo>& expected, const std::vector<TransactionReceiptInfo>& result, uint32_t fields)
+{
+    BOOST_REQUIRE_EQUAL(expected.size(), result.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        BOOST_CHECK(expected[i].blockHash == result[i].blockHash);
+        BOOST_CHECK_EQUAL(expected[i].blockNumber, result[i].blockNumber);
+        BOOST_CHECK(expected[i].transactionHash == result[i].transactionHash);
+        BOOST_CHECK_EQUAL(expected[i].transactionIndex, result[i].transactionIndex);
+        BOOST_CHECK(expected[i].from == result[i].from);
+        BOOST_CHECK(expected[i].to == result[i].to);
+        BOOST_CHECK_EQUAL(expected[i].cumulativeGasUsed, result[i].cumulativeGasUsed);
+        BOOST_CHECK_EQUAL(expected[i].gasUsed, result[i].gasUsed);
+        BOOST_CHECK(expected[i].contractAddress == result[i].contractAddress);
+        BOOST_CHECK(expected[i].excepted == result[i].excepted);
+        BOOST_CHECK_EQUAL(expected[i].exceptedMessage, result[i].exceptedMessage);
+        BOOST_CHECK_EQUAL(expected[i].outputIndex, result[i].outputIndex);
+        BOOST_CHECK(((fields & RECEIPT_BLOOM) ? expected[i].bloom : dev::eth::LogBloom()) == result[i].bloom);
+        BOOST_CHECK(((fields & RECEIPT_ROOTS) ? expected[i].stateRoot : dev::h256()) == result[i].stateRoot);
+        BOOST_CHECK(((fields & RECEIPT_ROOTS) ? expected[i].utxoRoot : dev::h256()) == result[i].utxoRoot);
+        BOOST_REQUIRE_EQUAL((fields & RECEIPT_LOGS) ? expected[i].logs.size() : 0, result[i].logs.size());
+        for (size_t j = 0; j < result[i].logs.size(); j++) {
+            BOOST_CHECK(expected[i].logs[j].address == result[i].logs[j].address);
+            BOOST_CHECK(expected[i].logs[j].topics == result[i].logs[j].topics);
+            BOOST_CHECK(expected[i].logs[j].data == result[i].logs[j].data);
+        }
+    }
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(storageresults_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(storageresults_columnar_roundtrip)
+{
+    StorageResults results((m_path_root / "results").string());
+    uint256 hashTx = uint256S("0102");
+    std::vector<TransactionReceiptInfo> expected = createResult(hashTx);
+    results.addResult(uintToh256(hashTx), expected);
+    results.commitResults();
+
+    for (uint32_t fields : {RECEIPT_BASE, RECEIPT_LOGS, RECEIPT_BLOOM, RECEIPT_ROOTS, RECEIPT_ALL}) {
+        checkResult(expected, results.getResult(uintToh256(hashTx), fields), fields);
+    }
+    BOOST_CHECK(results.getResult(uintToh256(uint256S("0103"))).empty());
+}
+
+BOOST_AUTO_TEST_CASE(storageresults_pending_flush)
+{
+    std::string path = (m_path_root / "results").string();
+    uint256 hashTx = uint256S("0105");
+    uint256 hashFailed = uint256S("0106");
+    std::vector<TransactionReceiptInfo> expected = createResult(hashTx);
+    CMutableTransaction tx;
+    tx.nLockTime = 1;
+    uint256 hashDeleted = tx.GetHash();
+    {
+        StorageResults results(path);
+
+        // Results of a block which failed to connect are dropped
+        results.addResult(uintToh256(hashFailed), expected);
+        results.clearCacheResult();
+        results.commitResults();
+        BOOST_CHECK(results.getResult(uintToh256(hashFailed)).empty());
+
+        // Committed results are readable before they are flushed
+        results.addResult(uintToh256(hashTx), expected);
+        results.commitResults();
+        BOOST_CHECK(results.pendingResultsUsage() > 0);
+        checkResult(expected, results.getResult(uintToh256(hashTx), RECEIPT_LOGS), RECEIPT_LOGS);
+
+        // Results of a disconnected block are hidden before the deletion is flushed
+        std::vector<TransactionReceiptInfo> deleted = createResult(hashDeleted);
+        results.addResult(uintToh256(hashDeleted), deleted);
+        results.commitResults();
+        BOOST_CHECK(results.flushResults());
+        BOOST_CHECK_EQUAL(results.pendingResultsUsage(), 0U);
+        results.deleteResults({MakeTransactionRef(tx)});
+        BOOST_CHECK(results.getResult(uintToh256(hashDeleted)).empty());
+        BOOST_CHECK(results.flushResults());
+        BOOST_CHECK(results.getResult(uintToh256(hashDeleted)).empty());
+    }
+
+    StorageResults results(path);
+    checkResult(expected, results.getResult(uintToh256(hashTx), RECEIPT_ALL), RECEIPT_ALL);
+    BOOST_CHECK(results.getResult(uintToh256(hashFailed)).empty());
+}
+
+BOOST_AUTO_TEST_CASE(storageresults_replayed_results)
+{
+    StorageResults results((m_path_root / "results").string());
+    uint256 hashTx = uint256S("0107");
+    uint256 hashStaged = uint256S("0108");
+    std::vector<TransactionReceiptInfo> expected = createResult(hashTx);
+
+    // Replayed results go to the pending buffer, a block failing to connect meanwhile does not drop them
+    results.addResult(uintToh256(hashStaged), createResult(hashStaged));
+    results.addReplayedResults({{uintToh256(hashTx), expected}});
+    results.clearCacheResult();
+    BOOST_CHECK(results.pendingResultsUsage() > 0);
+    checkResult(expected, results.getResult(uintToh256(hashTx)), RECEIPT_ALL);
+    BOOST_CHECK(results.getResult(uintToh256(hashStaged)).empty());
+
+    BOOST_CHECK(results.flushResults());
+    checkResult(expected, results.getResult(uintToh256(hashTx)), RECEIPT_ALL);
+}
+
+BOOST_AUTO_TEST_CASE(storageresults_upgrade_legacy)
+{
+    uint256 hashTx = uint256S("0104");
+    uint256 hashCorrupt = uint256S("0105");
+    std::vector<TransactionReceiptInfo> expected = createResult(hashTx);
+    std::string path = (m_path_root / "results").string();
+    fs::create_directories(path);
+    {
+        // Write the result the way it was stored before the columnar format
+        TransactionReceiptInfoSerialized tris;
+        for (const TransactionReceiptInfo& tri : expected) {
+            tris.blockHashes.push_back(uintToh256(tri.blockHash));
+            tris.blockNumbers.push_back(tri.blockNumber);
+            tris.transactionHashes.push_back(uintToh256(tri.transactionHash));
+            tris.transactionIndexes.push_back(tri.transactionIndex);
+            tris.senders.push_back(tri.from);
+            tris.receivers.push_back(tri.to);
+            tris.cumulativeGasUsed.push_back(dev::u256(tri.cumulativeGasUsed));
+            tris.gasUsed.push_back(dev::u256(tri.gasUsed));
+            tris.contractAddresses.push_back(tri.contractAddress);
+            logEntriesSerialize logs;
+            for (const dev::eth::LogEntry& log : tri.logs)
+                logs.push_back(std::make_pair(log.address, std::make_pair(log.topics, log.data)));
+            tris.logs.push_back(logs);
+            tris.excepted.push_back(uint32_t(static_cast<int>(tri.excepted)));
+            tris.exceptedMessage.push_back(tri.exceptedMessage);
+            tris.outputIndexes.push_back(tri.outputIndex);
+            tris.blooms.push_back(tri.bloom);
+            tris.stateRoots.push_back(tri.stateRoot);
+            tris.utxoRoots.push_back(tri.utxoRoot);
+        }
+        dev::RLPStream streamRLP(16);
+        streamRLP << tris.blockHashes << tris.blockNumbers << tris.transactionHashes << tris.transactionIndexes << tris.senders;
+        streamRLP << tris.receivers << tris.cumulativeGasUsed << tris.gasUsed << tris.contractAddresses << tris.logs << tris.excepted << tris.exceptedMessage << tris.outputIndexes << tris.blooms << tris.stateRoots << tris.utxoRoots;
+        dev::bytes data = streamRLP.out();
+
+        leveldb::DB* db;
+        leveldb::Options options;
+        options.create_if_missing = true;
+        BOOST_REQUIRE(leveldb::DB::Open(options, path + "/resultsDB", &db).ok());
+        BOOST_REQUIRE(db->Put(leveldb::WriteOptions(), uintToh256(hashTx).hex(), std::string(data.begin(), data.end())).ok());
+        // A truncated record does not stop the upgrade of the others
+        BOOST_REQUIRE(db->Put(leveldb::WriteOptions(), uintToh256(hashCorrupt).hex(), "\xf8\xff").ok());
+        delete db;
+    }
+
+    StorageResults results(path);
+    checkResult(expected, results.getResult(uintToh256(hashTx), RECEIPT_ALL), RECEIPT_ALL);
+    BOOST_CHECK(results.upgradeResults());
+    results.clearCacheResult();
+    checkResult(expected, results.getResult(uintToh256(hashTx), RECEIPT_ALL), RECEIPT_ALL);
+    BOOST_CHECK(results.getResult(uintToh256(hashCorrupt)).empty());
+    checkResult(expected, results.getResult(uintToh256(hashTx), RECEIPT_LOGS), RECEIPT_LOGS);
+    BOOST_CHECK(results.upgradeResults());
+}
+
+BOOST_AUTO_TEST_CASE(storageresults_search_logs)
+{
+    StorageResults results((m_path_root / "results").string());
+    uint256 hashTx = uint256S("0108");
+    std::vector<TransactionReceiptInfo> expected = createResult(hashTx);
+    dev::h256 topic0 = expected[0].logs[0].topics[0];
+    dev::h256 topic1 = expected[0].logs[0].topics[1];
+    expected[1].logs.push_back(dev::eth::LogEntry(expected[1].to, {dev::h256(5)}, dev::bytes(40, 0x11)));
+    results.addResult(uintToh256(hashTx), expected);
+    results.commitResults();
+
+    auto search = [&](const std::vector<std::optional<dev::h256>>& topics) {
+        std::vector<std::pair<uint32_t, dev::eth::LogEntry>> found;
+        BOOST_CHECK(results.searchLogs(uintToh256(hashTx), topics, [&](const TransactionReceiptInfo& receipt, const dev::eth::LogEntry& log) {
+            BOOST_CHECK(receipt.transactionHash == hashTx);
+            found.emplace_back(receipt.outputIndex, log);
+            return true;
+        }));
+        return found;
+    };
+    auto check = [&](const std::vector<std::pair<uint32_t, dev::eth::LogEntry>>& found, const std::vector<std::pair<uint32_t, size_t>>& logs) {
+        BOOST_REQUIRE_EQUAL(found.size(), logs.size());
+        for (size_t i = 0; i < logs.size(); i++) {
+            const dev::eth::LogEntry& log = expected[logs[i].first].logs[logs[i].second];
+            BOOST_CHECK_EQUAL(found[i].first, logs[i].first);
+            BOOST_CHECK(found[i].second.address == log.address);
+            BOOST_CHECK(found[i].second.topics == log.topics);
+            BOOST_CHECK(found[i].second.data == log.data);
+        }
+    };
+
+    // The pending results are searched in memory, then the same results are decoded from the database
+    for (int i = 0; i < 2; i++) {
+        check(search({}), {{0, 0}, {0, 1}, {1, 0}});
+        check(search({topic0}), {{0, 0}, {0, 1}});
+        check(search({std::nullopt, topic1}), {{0, 0}, {0, 1}});
+        check(search({dev::h256(5)}), {{1, 0}});
+        check(search({dev::h256(6)}), {});
+        check(search({std::nullopt, topic0}), {});
+
+        // The search stops when the callback returns false
+        size_t calls = 0;
+        BOOST_CHECK(!results.searchLogs(uintToh256(hashTx), {}, [&](const TransactionReceiptInfo&, const dev::eth::LogEntry&) {
+            calls++;
+            return false;
+        }));
+        BOOST_CHECK_EQUAL(calls, 1U);
+
+        BOOST_CHECK(results.flushResults());
+    }
+    BOOST_CHECK(results.searchLogs(uintToh256(uint256S("0109")), {}, [](const TransactionReceiptInfo&, const dev::eth::LogEntry&) {
+        BOOST_ERROR("Unexpected log");
+        return true;
+    }));
+}
+
+BOOST_AUTO_TEST_CASE(storageresults_token_events)
+{
+    StorageResults results((m_path_root / "results").string());
+    uint256 hashTx = uint256S("0109");
+    results.addResult(uintToh256(hashTx), createResult(hashTx));
+    results.commitResults();
+
+    dev::Address contract("0102030405060708090a0b0c0d0e0f1011121314");
+    std::string sender = "000000000000000000000000abababababababababababababababababababab";
+    std::string eventName = dev::sha3(std::string("Transfer(address,address,uint256)")).hex();
+
+    // The logs of the stored receipts are passed to the token events without their JSON encoding
+    LogFilter searched;
+    auto search = [&](const LogFilter& filter, const LogMatchFn& fn) {
+        searched = filter;
+        for (const TransactionReceiptInfo& receipt : results.getResult(uintToh256(hashTx), RECEIPT_LOGS)) {
+            for (const dev::eth::LogEntry& log : receipt.logs) {
+                if (!fn(receipt, log))
+                    return true;
+            }
+        }
+        return true;
+    };
+    std::vector<TokenEvent> events;
+    BOOST_CHECK(YodyToken::searchTokenEvents(search, 10, -1, 6, eventName, contract.hex(), sender, 2, events));
+    BOOST_CHECK_EQUAL(searched.fromBlock, 10);
+    BOOST_CHECK_EQUAL(searched.toBlock, -1);
+    BOOST_CHECK_EQUAL(searched.minconf, 6);
+    BOOST_CHECK(searched.addresses == std::set<dev::h160>{contract});
+    BOOST_REQUIRE_EQUAL(searched.topics.size(), 2U);
+    BOOST_CHECK(!searched.topics[0]);
+    BOOST_CHECK(*searched.topics[1] == dev::h256(sender));
+
+    // The log without the indexed sender is skipped
+    BOOST_REQUIRE_EQUAL(events.size(), 1U);
+    BOOST_CHECK_EQUAL(events[0].sender, EncodeDestination(PKHash(uint160(ParseHex(sender.substr(24))))));
+    BOOST_CHECK(events[0].blockHash == uint256S("aa"));
+    BOOST_CHECK_EQUAL(events[0].blockNumber, 1234U);
+    BOOST_CHECK(events[0].transactionHash == hashTx);
+    BOOST_CHECK(uintTou256(events[0].value) == 42);
+
+    // Malformed parameters are rejected before searching
+    events.clear();
+    BOOST_CHECK(!YodyToken::searchTokenEvents(search, 0, -1, 0, "Transfer", contract.hex(), sender, 2, events));
+    BOOST_CHECK(!YodyToken::searchTokenEvents(search, 0, -1, 0, eventName, "0102", sender, 2, events));
+    BOOST_CHECK(events.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
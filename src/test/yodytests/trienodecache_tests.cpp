@@ -0,0 +1,70 @@
+#include <boost/test/unit_test.hpp>
+#include <libdevcore/RLP.h>
+#include <libdevcore/SHA3.h>
+#include <libdevcore/TrieNodeCache.h>
+#include <test/util/setup_common.h>
+#include <validation.h>
+
+namespace {
+
+dev::h256 NodeHash(unsigned i)
+{
+    return dev::sha3(dev::rlp(i));
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(trienodecache_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(trie_node_cache_lru)
+{
+    // One shard holding about ten nodes
+    dev::TrieNodeCache cache(10 * (100 + 128), 1);
+    const std::string node(100, 'n');
+    for (unsigned i = 0; i < 10; i++) {
+        cache.insert(NodeHash(i), node);
+    }
+    BOOST_CHECK_EQUAL(cache.count(), 10U);
+    BOOST_CHECK(cache.size() <= cache.capacity());
+
+    // The least recently used nodes are evicted first
+    std::string value;
+    BOOST_CHECK(cache.lookup(NodeHash(0), value));
+    BOOST_CHECK(value == node);
+    cache.insert(NodeHash(10), node);
+    BOOST_CHECK(cache.contains(NodeHash(0)));
+    BOOST_CHECK(!cache.contains(NodeHash(1)));
+    BOOST_CHECK(cache.contains(NodeHash(10)));
+    BOOST_CHECK(!cache.lookup(NodeHash(1), value));
+    BOOST_CHECK_EQUAL(cache.hits(), 1U);
+    BOOST_CHECK_EQUAL(cache.misses(), 1U);
+
+    // Values too large for the cache are not kept
+    cache.insert(NodeHash(11), std::string(1000, 'c'));
+    BOOST_CHECK(!cache.contains(NodeHash(11)));
+
+    cache.remove(NodeHash(0));
+    BOOST_CHECK(!cache.contains(NodeHash(0)));
+    cache.clear();
+    BOOST_CHECK_EQUAL(cache.count(), 0U);
+    BOOST_CHECK_EQUAL(cache.size(), 0U);
+}
+
+BOOST_FIXTURE_TEST_CASE(trie_node_cache_state, TestingSetup)
+{
+    // The state reads the committed nodes through the cache shared with its copies
+    const dev::Address contract("0000000000000000000000000000000000000abc");
+    dev::eth::State& base = *globalState;
+    base.addBalance(contract, 1);
+    globalState->setStorage(contract, 1, 10);
+    globalState->commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+    globalState->db().commit();
+    BOOST_CHECK(g_state_node_cache->contains(globalState->rootHash()));
+
+    YodyState state(*globalState, globalState->rootHash(), globalState->rootHashUTXO());
+    const uint64_t hits = g_state_node_cache->hits();
+    BOOST_CHECK(state.storage(contract, 1) == 10);
+    BOOST_CHECK(g_state_node_cache->hits() > hits);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
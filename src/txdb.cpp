@@ -10,6 +10,7 @@
 #include <random.h>
 #include <shutdown.h>
 #include <uint256.h>
+#include <util/convert.h>
 #include <util/system.h>
 #include <util/translation.h>
 #include <util/vector.h>
@@ -27,6 +28,9 @@ static constexpr uint8_t DB_BLOCK_INDEX{'b'};
 static constexpr uint8_t DB_HEIGHTINDEX{'h'};
 static constexpr uint8_t DB_STAKEINDEX{'s'};
 static constexpr uint8_t DB_DELEGATEINDEX{'d'};
+static constexpr uint8_t DB_DELEGATION{'D'};
+static constexpr uint8_t DB_STAKERDELEGATION{'K'};
+static constexpr uint8_t DB_DELEGATIONUNDO{'U'};
 //////////////////////////////////////////
 
 static constexpr uint8_t DB_BEST_BLOCK{'B'};
@@ -36,11 +40,9 @@ static constexpr uint8_t DB_REINDEX_FLAG{'R'};
 static constexpr uint8_t DB_LAST_BLOCK{'l'};
 
 ////////////////////////////////////////// // yody
-static constexpr uint8_t DB_ADDRESSINDEX{'a'};
-static constexpr uint8_t DB_ADDRESSUNSPENTINDEX{'u'};
-static constexpr uint8_t DB_TIMESTAMPINDEX{'S'};
-static constexpr uint8_t DB_BLOCKHASHINDEX{'z'};
-static constexpr uint8_t DB_SPENTINDEX{'p'};
+static constexpr uint8_t DB_CONTRACTINDEX{'n'};
+static constexpr uint8_t DB_CONTRACTHEIGHT{'N'};
+static constexpr uint8_t DB_CONTRACTUNDO{'Y'};
 //////////////////////////////////////////
 
 namespace {
@@ -521,45 +523,93 @@ bool CBlockTreeDB::EraseDelegateIndex(unsigned int height) {
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
+bool CBlockTreeDB::UpdateDelegationIndex(unsigned int height, const std::vector<DelegationEvent>& events, bool fUndo) {
+
+    // The block was connected before an unclean shutdown, revert it first
+    if (Exists(std::make_pair(DB_DELEGATIONUNDO, height)) && !EraseDelegationIndex(height))
+        return false;
+
     CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Write(std::make_pair(DB_ADDRESSINDEX, it->first), it->second);
+    std::map<uint160, Delegation> current;
+    std::vector<std::pair<uint160, Delegation>> undo;
+
+    for (const DelegationEvent& event : events) {
+        const uint160& delegate = event.item.delegate;
+        auto it = current.find(delegate);
+        if (it == current.end()) {
+            Delegation previous;
+            Read(std::make_pair(DB_DELEGATION, delegate), previous);
+            undo.emplace_back(delegate, previous);
+            it = current.emplace(delegate, previous).first;
+        }
+
+        if (!it->second.IsNull())
+            batch.Erase(std::make_pair(DB_STAKERDELEGATION, std::make_pair(it->second.staker, delegate)));
+
+        switch (event.type) {
+        case DELEGATION_ADD:
+            it->second = event.item;
+            batch.Write(std::make_pair(DB_DELEGATION, delegate), it->second);
+            batch.Write(std::make_pair(DB_STAKERDELEGATION, std::make_pair(it->second.staker, delegate)), it->second);
+            break;
+        case DELEGATION_REMOVE:
+            it->second = Delegation();
+            batch.Erase(std::make_pair(DB_DELEGATION, delegate));
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (fUndo && !undo.empty())
+        batch.Write(std::make_pair(DB_DELEGATIONUNDO, height), undo);
+
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
+bool CBlockTreeDB::EraseDelegationIndex(unsigned int height) {
+
+    std::vector<std::pair<uint160, Delegation>> undo;
+    if (!Read(std::make_pair(DB_DELEGATIONUNDO, height), undo))
+        return true;
+
     CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Erase(std::make_pair(DB_ADDRESSINDEX, it->first));
+    for (const std::pair<uint160, Delegation>& entry : undo) {
+        const uint160& delegate = entry.first;
+        Delegation delegation;
+        if (Read(std::make_pair(DB_DELEGATION, delegate), delegation))
+            batch.Erase(std::make_pair(DB_STAKERDELEGATION, std::make_pair(delegation.staker, delegate)));
+
+        if (entry.second.IsNull()) {
+            batch.Erase(std::make_pair(DB_DELEGATION, delegate));
+        } else {
+            batch.Write(std::make_pair(DB_DELEGATION, delegate), entry.second);
+            batch.Write(std::make_pair(DB_STAKERDELEGATION, std::make_pair(entry.second.staker, delegate)), entry.second);
+        }
+    }
+    batch.Erase(std::make_pair(DB_DELEGATIONUNDO, height));
+
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadAddressIndex(uint256 addressHash, int type,
-                                    std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                                    int start, int end) {
+bool CBlockTreeDB::ReadDelegation(const uint160& delegate, Delegation& delegation) {
+    return Read(std::make_pair(DB_DELEGATION, delegate), delegation);
+}
+
+bool CBlockTreeDB::ReadStakerDelegations(const uint160& staker, std::map<uint160, Delegation>& delegations) {
 
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
-    if (start > 0 && end > 0) {
-        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
-    } else {
-        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
-    }
+    pcursor->Seek(std::make_pair(DB_STAKERDELEGATION, std::make_pair(staker, uint160())));
 
     while (pcursor->Valid()) {
-        std::pair<char,CAddressIndexKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.hashBytes == addressHash) {
-            if (end > 0 && key.second.blockHeight > end) {
-                break;
-            }
-            CAmount nValue;
-            if (pcursor->GetValue(nValue)) {
-                addressIndex.push_back(std::make_pair(key.second, nValue));
-                pcursor->Next();
-            } else {
-                return error("failed to get address index value");
-            }
+        std::pair<uint8_t, std::pair<uint160, uint160>> key;
+        if (pcursor->GetKey(key) && key.first == DB_STAKERDELEGATION && key.second.first == staker) {
+            Delegation delegation;
+            if (!pcursor->GetValue(delegation))
+                return error("failed to get delegation value");
+            delegations[key.second.second] = delegation;
+            pcursor->Next();
         } else {
             break;
         }
@@ -568,34 +618,20 @@ bool CBlockTreeDB::ReadAddressIndex(uint256 addressHash, int type,
     return true;
 }
 
-bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
-        if (it->second.IsNull()) {
-            batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
-        } else {
-            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
-        }
-    }
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::ReadAddressUnspentIndex(uint256 addressHash, int type,
-                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
+bool CBlockTreeDB::ReadDelegations(std::map<uint160, Delegation>& delegations) {
 
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
-    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+
+    pcursor->Seek(DB_DELEGATION);
 
     while (pcursor->Valid()) {
-        std::pair<char,CAddressUnspentKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash) {
-            CAddressUnspentValue nValue;
-            if (pcursor->GetValue(nValue)) {
-                unspentOutputs.push_back(std::make_pair(key.second, nValue));
-                pcursor->Next();
-            } else {
-                return error("failed to get address unspent value");
-            }
+        std::pair<uint8_t, uint160> key;
+        if (pcursor->GetKey(key) && key.first == DB_DELEGATION) {
+            Delegation delegation;
+            if (!pcursor->GetValue(delegation))
+                return error("failed to get delegation value");
+            delegations[key.second] = delegation;
+            pcursor->Next();
         } else {
             break;
         }
@@ -604,79 +640,165 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint256 addressHash, int type,
     return true;
 }
 
-bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
+bool CBlockTreeDB::WipeDelegationIndex() {
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
     CDBBatch batch(*this);
-    batch.Write(std::make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
+
+    auto wipe = [&](auto key) {
+        const uint8_t prefix = key.first;
+        pcursor->Seek(prefix);
+        while (pcursor->Valid()) {
+            if (pcursor->GetKey(key) && key.first == prefix) {
+                batch.Erase(key);
+                pcursor->Next();
+            } else {
+                break;
+            }
+        }
+    };
+    wipe(std::make_pair(DB_DELEGATION, uint160()));
+    wipe(std::make_pair(DB_STAKERDELEGATION, std::make_pair(uint160(), uint160())));
+    wipe(std::make_pair(DB_DELEGATIONUNDO, (unsigned int)0));
+
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes, ChainstateManager &chainman) {
+bool CBlockTreeDB::UpdateContractIndex(unsigned int height, const std::vector<std::pair<dev::h160, bool>>& contracts, bool fUndo) {
 
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    // Blocks connected before an unclean shutdown are reconnected from the last flush, revert them first
+    std::vector<unsigned int> connected;
+    {
+        std::unique_ptr<CDBIterator> pcursor(NewIterator());
+        pcursor->Seek(std::make_pair(DB_CONTRACTUNDO, CHeightTxIndexIteratorKey(height)));
+        std::pair<uint8_t, CHeightTxIndexIteratorKey> key;
+        while (pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_CONTRACTUNDO) {
+            connected.push_back(key.second.height);
+            pcursor->Next();
+        }
+    }
+    for (auto it = connected.rbegin(); it != connected.rend(); ++it) {
+        if (!EraseContractIndex(*it))
+            return false;
+    }
 
-    pcursor->Seek(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
+    CDBBatch batch(*this);
+    std::vector<std::pair<uint160, int>> undo;
 
-    while (pcursor->Valid()) {
-        std::pair<char, CTimestampIndexKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_TIMESTAMPINDEX && key.second.timestamp < high) {
-            if (fActiveOnly) {
-                if (blockOnchainActive(key.second.blockHash, chainman)) {
-                    hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
-                }
-            } else {
-                hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
-            }
+    for (const std::pair<dev::h160, bool>& contract : contracts) {
+        const dev::h160& address = contract.first;
+        unsigned int created = 0;
+        bool fRegistered = Read(std::make_pair(DB_CONTRACTHEIGHT, h160Touint(address)), created);
+        if (fRegistered == contract.second)
+            continue;
 
-            pcursor->Next();
+        undo.emplace_back(h160Touint(address), fRegistered ? int(created) : -1);
+        if (contract.second) {
+            batch.Write(std::make_pair(DB_CONTRACTINDEX, CHeightTxIndexKey(height, address)), true);
+            batch.Write(std::make_pair(DB_CONTRACTHEIGHT, h160Touint(address)), height);
         } else {
-            break;
+            batch.Erase(std::make_pair(DB_CONTRACTINDEX, CHeightTxIndexKey(created, address)));
+            batch.Erase(std::make_pair(DB_CONTRACTHEIGHT, h160Touint(address)));
         }
     }
 
-    return true;
+    if (fUndo && !undo.empty())
+        batch.Write(std::make_pair(DB_CONTRACTUNDO, CHeightTxIndexIteratorKey(height)), undo);
+
+    return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts) {
+bool CBlockTreeDB::EraseContractIndex(unsigned int height) {
+
+    std::vector<std::pair<uint160, int>> undo;
+    if (!Read(std::make_pair(DB_CONTRACTUNDO, CHeightTxIndexIteratorKey(height)), undo))
+        return true;
+
     CDBBatch batch(*this);
-    batch.Write(std::make_pair(DB_BLOCKHASHINDEX, blockhashIndex), logicalts);
+    for (const std::pair<uint160, int>& entry : undo) {
+        const dev::h160 address = uintToh160(entry.first);
+        unsigned int created = 0;
+        if (Read(std::make_pair(DB_CONTRACTHEIGHT, entry.first), created))
+            batch.Erase(std::make_pair(DB_CONTRACTINDEX, CHeightTxIndexKey(created, address)));
+
+        if (entry.second < 0) {
+            batch.Erase(std::make_pair(DB_CONTRACTHEIGHT, entry.first));
+        } else {
+            batch.Write(std::make_pair(DB_CONTRACTINDEX, CHeightTxIndexKey(entry.second, address)), true);
+            batch.Write(std::make_pair(DB_CONTRACTHEIGHT, entry.first), (unsigned int)entry.second);
+        }
+    }
+    batch.Erase(std::make_pair(DB_CONTRACTUNDO, CHeightTxIndexIteratorKey(height)));
+
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadTimestampBlockIndex(const uint256 &hash, unsigned int &ltimestamp) {
+bool CBlockTreeDB::PruneContractUndo(unsigned int height) {
 
-    CTimestampBlockIndexValue lts;
-    if (!Read(std::make_pair(DB_BLOCKHASHINDEX, hash), lts))
-       return false;
+    CDBBatch batch(*this);
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_CONTRACTUNDO, CHeightTxIndexIteratorKey(0)));
+    std::pair<uint8_t, CHeightTxIndexIteratorKey> key;
+    while (pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_CONTRACTUNDO && key.second.height < height) {
+        batch.Erase(key);
+        pcursor->Next();
+    }
+    if (batch.SizeEstimate() == 0)
+        return true;
 
-    ltimestamp = lts.ltimestamp;
-    return true;
+    return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
-    return Read(std::make_pair(DB_SPENTINDEX, key), value);
+bool CBlockTreeDB::ReadContractHeight(const dev::h160& address, unsigned int& height) {
+    return Read(std::make_pair(DB_CONTRACTHEIGHT, h160Touint(address)), height);
 }
 
-bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CSpentIndexKey,CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
-        if (it->second.IsNull()) {
-            batch.Erase(std::make_pair(DB_SPENTINDEX, it->first));
+bool CBlockTreeDB::ReadContractIndex(const CHeightTxIndexKey& begin, size_t skip, size_t maxResults, std::vector<CHeightTxIndexKey>& contracts) {
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_CONTRACTINDEX, begin));
+
+    while (pcursor->Valid() && contracts.size() < maxResults) {
+        std::pair<uint8_t, CHeightTxIndexKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_CONTRACTINDEX) {
+            if (skip > 0)
+                skip--;
+            else
+                contracts.push_back(key.second);
+            pcursor->Next();
         } else {
-            batch.Write(std::make_pair(DB_SPENTINDEX, it->first), it->second);
+            break;
         }
     }
-    return WriteBatch(batch);
+
+    return true;
 }
 
-bool CBlockTreeDB::blockOnchainActive(const uint256 &hash, ChainstateManager &chainman) {
-    LOCK(cs_main);
-    BlockMap::iterator mi = chainman.BlockIndex().find(hash);
-    if (mi == chainman.BlockIndex().end())
-        return false;
+bool CBlockTreeDB::WipeContractIndex() {
 
-    CBlockIndex* pblockindex = (*mi).second;
-    return pblockindex && chainman.ActiveChain().Contains(pblockindex);
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    CDBBatch batch(*this);
+
+    auto wipe = [&](auto key) {
+        const uint8_t prefix = key.first;
+        pcursor->Seek(prefix);
+        while (pcursor->Valid()) {
+            if (pcursor->GetKey(key) && key.first == prefix) {
+                batch.Erase(key);
+                pcursor->Next();
+            } else {
+                break;
+            }
+        }
+    };
+    wipe(std::make_pair(DB_CONTRACTINDEX, CHeightTxIndexKey()));
+    wipe(std::make_pair(DB_CONTRACTHEIGHT, uint160()));
+    wipe(std::make_pair(DB_CONTRACTUNDO, CHeightTxIndexIteratorKey()));
+
+    return WriteBatch(batch);
 }
+
 ///////////////////////////////////////////////////////
 
 bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
@@ -13,7 +13,9 @@
 #include <libdevcore/Common.h>
 #include <libdevcore/FixedHash.h>
 #include <index/disktxpos.h>
+#include <yody/yodydelegation.h>
 
+#include <map>
 #include <memory>
 #include <string>
 #include <utility>
@@ -29,6 +31,7 @@ struct CHeightTxIndexIteratorKey;
 struct CAddressIndexKey;
 struct CAddressUnspentKey;
 struct CAddressUnspentValue;
+struct CAddressWeightValue;
 struct CMempoolAddressDeltaKey;
 struct CTimestampIndexKey;
 struct CTimestampBlockIndexKey;
@@ -59,6 +62,8 @@ static const int64_t nMaxTxIndexCache = 1024;
 static const int64_t max_filter_index_cache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
+//! Max memory allocated to the contract state trie node cache (MiB)
+static const int64_t nMaxStateNodeCache = 1024;
 
 // Actually declared in validation.cpp; can't include because of circular dependency.
 extern RecursiveMutex cs_main;
@@ -136,24 +141,30 @@ public:
     bool ReadDelegateIndex(unsigned int height, uint160& address, uint8_t& fee);
     bool EraseDelegateIndex(unsigned int height);
 
-    bool EraseBlockIndex(const std::vector<uint256>&vect);
+    /**
+     * Current delegations of the delegations contract, by delegate and by staker.
+     * The state replaced by the events of a block is kept by height so the block can be disconnected.
+     */
+    bool UpdateDelegationIndex(unsigned int height, const std::vector<DelegationEvent>& events, bool fUndo = true);
+    bool EraseDelegationIndex(unsigned int height);
+    bool ReadDelegation(const uint160& delegate, Delegation& delegation);
+    bool ReadStakerDelegations(const uint160& staker, std::map<uint160, Delegation>& delegations);
+    bool ReadDelegations(std::map<uint160, Delegation>& delegations);
+    bool WipeDelegationIndex();
 
-    // Block explorer database functions
-    bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
-    bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
-    bool ReadAddressIndex(uint256 addressHash, int type,
-                        std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                        int start = 0, int end = 0);
-    bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
-    bool ReadAddressUnspentIndex(uint256 addressHash, int type,
-                                std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
-    bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
-    bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect, ChainstateManager & chainman);
-    bool WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts);
-    bool ReadTimestampBlockIndex(const uint256 &hash, unsigned int &logicalTS);
-    bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
-    bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect);
-    bool blockOnchainActive(const uint256 &hash, ChainstateManager &chainman);
+    /**
+     * Accounts of the contract state by creation height, updated with the accounts written by the contract executions of a block.
+     * The registrations replaced by a block are kept by height so the block can be disconnected.
+     */
+    bool UpdateContractIndex(unsigned int height, const std::vector<std::pair<dev::h160, bool>>& contracts, bool fUndo = true);
+    bool EraseContractIndex(unsigned int height);
+    /** Erase the undo data of the contract index below a height, whose blocks can no longer be disconnected. */
+    bool PruneContractUndo(unsigned int height);
+    bool ReadContractHeight(const dev::h160& address, unsigned int& height);
+    bool ReadContractIndex(const CHeightTxIndexKey& begin, size_t skip, size_t maxResults, std::vector<CHeightTxIndexKey>& contracts);
+    bool WipeContractIndex();
+
+    bool EraseBlockIndex(const std::vector<uint256>&vect);
 
     //////////////////////////////////////////////////////////////////////////////
 };
@@ -549,6 +560,38 @@ struct CAddressIndexIteratorKey {
         hashBytes.SetNull();
     }
 };
+
+/**
+ * Aggregated value of the unspent outputs of an address. The outputs created in
+ * the recent blocks that can still be immature or disconnected are also summed by height.
+ */
+struct CAddressWeightValue {
+    CAmount total;
+    std::map<int, CAmount> recent;
+
+    SERIALIZE_METHODS(CAddressWeightValue, obj) { READWRITE(obj.total, obj.recent); }
+
+    CAddressWeightValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        total = 0;
+        recent.clear();
+    }
+
+    bool IsNull() const {
+        return total == 0 && recent.empty();
+    }
+
+    //! Value of the outputs at least coinbaseMaturity deep in a chain with the given height
+    CAmount GetMature(int height, int coinbaseMaturity) const {
+        CAmount weight = total;
+        for (auto it = recent.upper_bound(height + 1 - coinbaseMaturity); it != recent.end(); ++it)
+            weight -= it->second;
+        return weight;
+    }
+};
 ////////////////////////////////////////////////////////////
 
 #endif // BITCOIN_TXDB_H
@@ -8,9 +8,11 @@
 
 #include <atomic>
 #include <map>
+#include <memory>
 #include <optional>
 #include <set>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -147,6 +149,16 @@ struct CMempoolAddressDeltaKeyCompare
         }
     }
 };
+
+/** Outcome of the speculative execution of the contract outputs of a mempool transaction on a chain tip */
+struct ContractPreExecution
+{
+    uint256 hashTip;                                //!< Tip the contracts were executed on
+    std::vector<uint64_t> vGasUsed;                 //!< Gas used by each contract output
+    bool fFailed{false};                            //!< One of the executions threw or reverted
+    std::vector<std::tuple<uint160, uint256, uint256>> vRead; //!< Accounts read, with the hashes of their state and their vin on the tip
+    std::vector<uint160> vWritten;                  //!< Accounts changed
+};
 ////////////////////////////////////////////////////////
 
 /** \class CTxMemPoolEntry
@@ -183,6 +195,7 @@ private:
     int64_t feeDelta;          //!< Used for determining the priority of the transaction for mining in a block
     LockPoints lockPoints;     //!< Track the height and time at which tx was final
     CAmount nMinGasPrice;      //!< The minimum gas price among the contract outputs of the tx
+    mutable std::shared_ptr<const ContractPreExecution> m_pre_execution; //!< Set by the mempool pre-executor, guarded by the mempool lock
 
     // Information about descendants of this transaction that are in the
     // mempool; if we remove this transaction we must remove all of these
@@ -215,6 +228,8 @@ public:
     size_t DynamicMemoryUsage() const { return nUsageSize; }
     const LockPoints& GetLockPoints() const { return lockPoints; }
     const CAmount& GetMinGasPrice() const { return nMinGasPrice; }
+    std::shared_ptr<const ContractPreExecution> GetPreExecution() const { return m_pre_execution; }
+    void SetPreExecution(std::shared_ptr<const ContractPreExecution> pre_execution) const { m_pre_execution = std::move(pre_execution); }
 
     // Adjusts the descendant state.
     void UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
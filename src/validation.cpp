@@ -18,6 +18,7 @@
 #include <deploymentstatus.h>
 #include <flatfile.h>
 #include <hash.h>
+#include <index/addressindex.h>
 #include <index/blockfilterindex.h>
 #include <index/txindex.h>
 #include <logging.h>
@@ -62,6 +63,7 @@
 #include <wallet/wallet.h>
 #include <util/convert.h>
 #include <util/signstr.h>
+#include <yody/statedump.h>
 #include <yody/yodyledger.h>
 
 #include <algorithm>
@@ -146,8 +148,10 @@ Mutex g_best_block_mutex;
 std::condition_variable g_best_block_cv;
 uint256 g_best_block;
 bool g_parallel_script_checks{false};
+bool g_parallel_contract_exec{false};
 bool fAddressIndex = false; // yody
 bool fLogEvents = false;
+int nStatePruning = DEFAULT_STATE_PRUNING;
 bool fRequireStandard = true;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
@@ -201,6 +205,8 @@ CBlockIndex* BlockManager::FindForkInGlobalIndex(const CChain& chain, const CBlo
 
 std::unique_ptr<CBlockTreeDB> pblocktree;
 std::unique_ptr<StorageResults> pstorageresult;
+std::shared_ptr<StateSnapshot> pstatesnapshot;
+std::shared_ptr<dev::TrieNodeCache> g_state_node_cache;
 
 bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
                        const CCoinsViewCache& inputs, unsigned int flags, bool cacheSigStore,
@@ -1439,10 +1445,11 @@ void CoinsViews::InitCache()
     m_cacheview = std::make_unique<CCoinsViewCache>(&m_catcherview);
 }
 
-CChainState::CChainState(CTxMemPool* mempool, BlockManager& blockman, std::optional<uint256> from_snapshot_blockhash)
+CChainState::CChainState(CTxMemPool* mempool, BlockManager& blockman, ChainstateManager& chainman, std::optional<uint256> from_snapshot_blockhash)
     : m_mempool(mempool),
       m_params(::Params()),
       m_blockman(blockman),
+      m_chainman(chainman),
       m_from_snapshot_blockhash(from_snapshot_blockhash) {}
 
 void CChainState::InitCoinsDB(
@@ -1813,11 +1820,6 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
         return DISCONNECT_FAILED;
     }
 
-    /////////////////////////////////////////////////////////// // yody
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
-    ///////////////////////////////////////////////////////////
-
     // undo transactions in reverse order
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
         const CTransaction &tx = *(block.vtx[i]);
@@ -1838,29 +1840,6 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
             }
         }
 
-        /////////////////////////////////////////////////////////// // yody
-        if (pfClean == NULL && fAddressIndex) {
-
-            for (unsigned int k = tx.vout.size(); k-- > 0;) {
-                const CTxOut &out = tx.vout[k];
-
-                CTxDestination dest;
-                if (ExtractDestination({hash, k}, out.scriptPubKey, dest)) {
-                    valtype bytesID(std::visit(DataVisitor(), dest));
-                    if(bytesID.empty()) {
-                        continue;
-                    }
-                    valtype addressBytes(32);
-                    std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
-                    // undo receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(dest.index(), uint256(addressBytes), pindex->nHeight, i, hash, k, false), out.nValue));
-                    // undo unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(dest.index(), uint256(addressBytes), hash, k), CAddressUnspentValue()));
-                }
-            }
-        }
-        ///////////////////////////////////////////////////////////
-
         // restore inputs
         if (i > 0) { // not coinbases
             CTxUndo &txundo = blockUndo.vtxundo[i-1];
@@ -1873,27 +1852,6 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
                 int res = ApplyTxInUndo(std::move(txundo.vprevout[j]), view, out);
                 if (res == DISCONNECT_FAILED) return DISCONNECT_FAILED;
                 fClean = fClean && res != DISCONNECT_UNCLEAN;
-
-                if (pfClean == NULL && fAddressIndex) {
-                    const auto &undo = txundo.vprevout[j];
-                    const bool isTxCoinStake = tx.IsCoinStake();
-                    const CTxIn input = tx.vin[j];
-                    const CTxOut &prevout = view.GetOutputFor(input);
-
-                    CTxDestination dest;
-                    if (ExtractDestination(input.prevout, prevout.scriptPubKey, dest)) {
-                        valtype bytesID(std::visit(DataVisitor(), dest));
-                        if(bytesID.empty()) {
-                            continue;
-                        }
-                        valtype addressBytes(32);
-                        std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
-                        // undo spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(dest.index(), uint256(addressBytes), pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
-                        // restore unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(dest.index(), uint256(addressBytes), input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undo.nHeight, isTxCoinStake)));
-                    }
-                }
             }
             // At this point, all of txundo.vprevout should have been moved out.
         }
@@ -1902,36 +1860,36 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
+    // The indexes and the journal of the height follow the active chainstate, not the background one
+    const bool fActiveChainstate = this == &m_chainman.ActiveChainstate();
+
+    // The snapshot is no longer read if it can not be disconnected, until it is generated again at startup
+    if (pfClean == NULL && fActiveChainstate && pstatesnapshot && !pstatesnapshot->Disconnect(pindex->nHeight))
+        LogPrintf("%s: failed to disconnect the state snapshot\n", __func__);
+    if (pfClean == NULL && fActiveChainstate) {
+        globalState->db().removeJournal(pindex->nHeight);
+        globalState->dbUtxo().removeJournal(pindex->nHeight);
+    }
     globalState->setRoot(uintToh256(pindex->pprev->hashStateRoot)); // yody
     globalState->setRootUTXO(uintToh256(pindex->pprev->hashUTXORoot)); // yody
 
-    if(pfClean == NULL && fLogEvents){
+    if(pfClean == NULL && fLogEvents && fActiveChainstate){
         pstorageresult->deleteResults(block.vtx);
         pblocktree->EraseHeightIndex(pindex->nHeight);
+        pblocktree->EraseDelegationIndex(pindex->nHeight);
     }
+    if(pfClean == NULL && fActiveChainstate)
+        pblocktree->EraseContractIndex(pindex->nHeight);
 
     // The stake and delegate index is needed for MPoS, update it while MPoS is active
     const CChainParams& chainparams = Params();
-    if(pindex->nHeight <= chainparams.GetConsensus().nLastMPoSBlock)
+    if(fActiveChainstate && pindex->nHeight <= chainparams.GetConsensus().nLastMPoSBlock)
     {
         pblocktree->EraseStakeIndex(pindex->nHeight);
         if(pindex->IsProofOfStake() && pindex->HasProofOfDelegation())
             pblocktree->EraseDelegateIndex(pindex->nHeight);
     }
 
-    //////////////////////////////////////////////////// // yody
-    if (pfClean == NULL && fAddressIndex) {
-        if (!pblocktree->EraseAddressIndex(addressIndex)) {
-            error("Failed to delete address index");
-            return DISCONNECT_FAILED;
-        }
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            error("Failed to write address unspent index");
-            return DISCONNECT_FAILED;
-        }
-    }
-    ////////////////////////////////////////////////////
-
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
@@ -1947,6 +1905,18 @@ void StopScriptCheckWorkerThreads()
     scriptcheckqueue.StopWorkerThreads();
 }
 
+static CCheckQueue<CContractExecCheck> contractexecqueue(1);
+
+void StartContractExecWorkerThreads(int threads_num)
+{
+    contractexecqueue.StartWorkerThreads(threads_num, "contractexec");
+}
+
+void StopContractExecWorkerThreads()
+{
+    contractexecqueue.StopWorkerThreads();
+}
+
 /**
  * Threshold condition checker that triggers when unknown versionbits are seen on the network.
  */
@@ -2086,6 +2056,69 @@ bool GetSpentCoinFromBlock(const CBlockIndex* pindex, COutPoint prevout, Coin* c
     return false;
 }
 
+SpentCoinWindow g_spent_coin_window;
+
+void SpentCoinWindow::BlockConnected(const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    LOCK(m_mutex);
+    if (!m_blocks.empty() && m_blocks.back().first != pindex->pprev) {
+        m_blocks.clear();
+        m_spent.clear();
+    }
+
+    std::vector<COutPoint> spent;
+    for (size_t i = 1; i < block.vtx.size() && i - 1 < blockundo.vtxundo.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        const CTxUndo& txundo = blockundo.vtxundo[i - 1]; // no vtxundo for coinbase
+        for (size_t j = 0; j < tx.vin.size() && j < txundo.vprevout.size(); j++) {
+            m_spent.insert_or_assign(tx.vin[j].prevout, std::make_pair(pindex->nHeight, txundo.vprevout[j]));
+            spent.push_back(tx.vin[j].prevout);
+        }
+    }
+    m_blocks.emplace_back(pindex, std::move(spent));
+
+    const int nMaturity = Params().GetConsensus().MaxCoinbaseMaturity();
+    while (m_blocks.front().first->nHeight <= pindex->nHeight - nMaturity) {
+        for (const COutPoint& prevout : m_blocks.front().second)
+            m_spent.erase(prevout);
+        m_blocks.pop_front();
+    }
+}
+
+void SpentCoinWindow::BlockDisconnected(const CBlockIndex* pindex)
+{
+    LOCK(m_mutex);
+    if (m_blocks.empty() || m_blocks.back().first != pindex) {
+        m_blocks.clear();
+        m_spent.clear();
+        return;
+    }
+    for (const COutPoint& prevout : m_blocks.back().second)
+        m_spent.erase(prevout);
+    m_blocks.pop_back();
+}
+
+bool SpentCoinWindow::Find(const CBlockIndex* pindexTip, int nForkHeight, const COutPoint& prevout, Coin* coin, int& nStartHeight) const
+{
+    LOCK(m_mutex);
+    nStartHeight = pindexTip->nHeight + 1;
+    if (m_blocks.empty() || m_blocks.back().first != pindexTip)
+        return false;
+    nStartHeight = m_blocks.front().first->nHeight;
+    auto it = m_spent.find(prevout);
+    if (it == m_spent.end() || it->second.first <= nForkHeight)
+        return false;
+    *coin = it->second.second;
+    return true;
+}
+
+void SpentCoinWindow::Clear()
+{
+    LOCK(m_mutex);
+    m_blocks.clear();
+    m_spent.clear();
+}
+
 bool GetSpentCoinFromMainChain(const CBlockIndex* pforkPrev, COutPoint prevoutStake, Coin* coin, CChain& chain) {
     const CBlockIndex* pforkBase = chain.FindFork(pforkPrev);
 
@@ -2111,9 +2144,14 @@ bool GetSpentCoinFromMainChain(const CBlockIndex* pforkPrev, COutPoint prevoutSt
 
     // Scan through blocks until we reach the forkbase to check if the prevoutStake has been spent in one of those blocks
     // If it not in any of those blocks, and not in the utxo set, it can't be spendable in the orphan chain.
+    // The blocks in the spent coin window are looked up at once, only the ones below it are read from disk.
     {
-        CBlockIndex* pindex = chain.Tip();
-        while(pindex && pindex != pforkBase) {
+        int nStartHeight;
+        if(g_spent_coin_window.Find(chain.Tip(), pforkBase->nHeight, prevoutStake, coin, nStartHeight)) {
+            return true;
+        }
+        CBlockIndex* pindex = chain[nStartHeight - 1];
+        while(pindex && pindex->nHeight > pforkBase->nHeight) {
             if(GetSpentCoinFromBlock(pindex, prevoutStake, coin)) {
                 return true;
             }
@@ -2196,30 +2234,117 @@ bool CheckSenderScript(const CCoinsViewCache& view, const CTransaction& tx){
     return true;
 }
 
-std::vector<ResultExecute> CallContract(const dev::Address& addrContract, std::vector<unsigned char> opcode, CChainState& chainstate, const dev::Address& sender, uint64_t gasLimit, CAmount nAmount){
+CallContractCache g_call_contract_cache;
+
+std::shared_ptr<const CallContractContext> CallContractCache::BuildContext(const CBlock& block, const CBlockIndex* pindex)
+{
+    auto context = std::make_shared<CallContractContext>();
+    context->hashTip = pindex->GetBlockHash();
+    context->pindex = pindex;
+    context->block = block.GetBlockHeader();
+    size_t nKeep = block.IsProofOfStake() ? 2 : 1;
+    context->block.vtx.assign(block.vtx.begin(), block.vtx.begin() + std::min(nKeep, block.vtx.size()));
+    context->lastHashes.set(pindex);
+    return context;
+}
+
+void CallContractCache::BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex)
+{
+    std::shared_ptr<const CallContractContext> context = BuildContext(*block, pindex);
+
+    LOCK(m_mutex);
+    // Do not replace a context that was already rebuilt for a descendant of this block
+    if (m_context && m_context->pindex->nHeight > pindex->nHeight &&
+        m_context->pindex->GetAncestor(pindex->nHeight) == pindex) {
+        return;
+    }
+    m_context = std::move(context);
+}
+
+std::shared_ptr<const CallContractContext> CallContractCache::GetContext(CChainState& chainstate)
+{
+    AssertLockHeld(cs_main);
+    CBlockIndex* pindexTip = chainstate.m_chain.Tip();
+    {
+        LOCK(m_mutex);
+        if (m_context && m_context->hashTip == pindexTip->GetBlockHash()) {
+            return m_context;
+        }
+    }
+
     CBlock block;
-    CMutableTransaction tx;
+    ReadBlockFromDisk(block, pindexTip, Params().GetConsensus());
+    std::shared_ptr<const CallContractContext> context = BuildContext(block, pindexTip);
 
-    CBlockIndex* pblockindex = chainstate.m_blockman.m_block_index[chainstate.m_chain.Tip()->GetBlockHash()];
-    ReadBlockFromDisk(block, pblockindex, Params().GetConsensus());
-    block.nTime = GetAdjustedTime();
+    LOCK(m_mutex);
+    m_context = context;
+    return context;
+}
 
-    if(block.IsProofOfStake())
-    	block.vtx.erase(block.vtx.begin()+2,block.vtx.end());
-    else
-    	block.vtx.erase(block.vtx.begin()+1,block.vtx.end());
+uint64_t CallContractCache::GetBlockGasLimit(CChainState& chainstate)
+{
+    AssertLockHeld(cs_main);
+    const uint256 hashTip = chainstate.m_chain.Tip()->GetBlockHash();
+    const dev::h256 hashStateRoot = globalState->rootHash();
+    {
+        LOCK(m_mutex);
+        if (m_gas_limit != 0 && m_gas_limit_tip == hashTip && m_gas_limit_root == hashStateRoot && m_gas_limit_dgpevm == fGettingValuesDGP) {
+            return m_gas_limit;
+        }
+    }
 
     YodyDGP yodyDGP(globalState.get(), chainstate, fGettingValuesDGP);
     uint64_t blockGasLimit = yodyDGP.getBlockGasLimit(chainstate.m_chain.Tip()->nHeight + 1);
 
+    LOCK(m_mutex);
+    m_gas_limit_tip = hashTip;
+    m_gas_limit_root = hashStateRoot;
+    m_gas_limit_dgpevm = fGettingValuesDGP;
+    m_gas_limit = blockGasLimit;
+    return blockGasLimit;
+}
+
+void CallContractCache::Clear()
+{
+    LOCK(m_mutex);
+    m_context.reset();
+    m_gas_limit = 0;
+}
+
+CallContractSnapshot::CallContractSnapshot(CChainState& chainstate) :
+    CallContractSnapshot(g_call_contract_cache.GetContext(chainstate), g_call_contract_cache.GetBlockGasLimit(chainstate),
+                         globalState->rootHash(), globalState->rootHashUTXO())
+{
+}
+
+CallContractSnapshot::CallContractSnapshot(std::shared_ptr<const CallContractContext> _context, uint64_t _blockGasLimit, const dev::h256& hashStateRoot, const dev::h256& hashUTXORoot) :
+    context(std::move(_context)),
+    blockGasLimit(_blockGasLimit),
+    state(new YodyState(*globalState, hashStateRoot, hashUTXORoot)),
+    sealEngine(dev::eth::SealEngineRegistrar::create(globalSealEngine->chainParams()))
+{
+    AssertLockHeld(cs_main);
+    sealEngine->setYodySchedule(globalSealEngine->getYodySchedule());
+}
+
+/**
+ * Build the transaction of a read-only contract call on a state, and the block it is executed in:
+ * the cached tip block at the current time, with the transaction paying the value from the sender.
+ */
+static YodyTransaction BuildCallTransaction(const CallContractContext& context, YodyState& state, const dev::Address& addrContract, const std::vector<unsigned char>& opcode, const dev::Address& sender, uint64_t gasLimit, CAmount nAmount, uint64_t blockGasLimit, CBlock& block){
+    CMutableTransaction tx;
+
+    block = context.block;
+    block.nTime = GetAdjustedTime();
+
     if(gasLimit == 0){
         gasLimit = blockGasLimit - 1;
     }
     dev::Address senderAddress = sender == dev::Address() ? dev::Address("ffffffffffffffffffffffffffffffffffffffff") : sender;
     tx.vout.push_back(CTxOut(nAmount, CScript() << OP_DUP << OP_HASH160 << senderAddress.asBytes() << OP_EQUALVERIFY << OP_CHECKSIG));
     block.vtx.push_back(MakeTransactionRef(CTransaction(tx)));
-    dev::u256 nonce = globalState->getNonce(senderAddress);
- 
+    dev::u256 nonce = state.getNonce(senderAddress);
+
     YodyTransaction callTransaction;
     if(addrContract == dev::Address())
     {
@@ -2231,11 +2356,65 @@ std::vector<ResultExecute> CallContract(const dev::Address& addrContract, std::v
     }
     callTransaction.forceSender(senderAddress);
     callTransaction.setVersion(VersionVM::GetEVMDefault());
+    return callTransaction;
+}
 
-    
-    ByteCodeExec exec(block, std::vector<YodyTransaction>(1, callTransaction), blockGasLimit, pblockindex, chainstate.m_chain);
+std::vector<ResultExecute> CallContractSnapshot::Call(const dev::Address& addrContract, std::vector<unsigned char> opcode, const dev::Address& sender, uint64_t gasLimit, CAmount nAmount){
+    CBlock block;
+    YodyTransaction callTransaction = BuildCallTransaction(*context, *state, addrContract, opcode, sender, gasLimit, nAmount, blockGasLimit, block);
+
+    std::vector<ResultExecute> result;
+    if(!callTransaction.isCreation() && !state->addressInUse(callTransaction.receiveAddress())){
+        dev::eth::ExecutionResult execRes;
+        execRes.excepted = dev::eth::TransactionException::Unknown;
+        result.push_back(ResultExecute{execRes, YodyTransactionReceipt(dev::h256(), dev::h256(), dev::u256(), dev::eth::LogEntries()), CTransaction(), {}});
+        return result;
+    }
+
+    dev::eth::EnvInfo envInfo(ByteCodeExec::BuildEVMEnvironment(block, context->pindex, blockGasLimit, context->lastHashes, *sealEngine));
+    result.push_back(state->execute(envInfo, *sealEngine, callTransaction, context->pindex->nHeight, dev::eth::Permanence::Reverted, OnOpFunc()));
+    sealEngine->deleteAddresses.clear();
+    return result;
+}
+
+std::vector<ResultExecute> CallContractSnapshot::Execute(const std::vector<YodyTransaction>& txs, std::set<dev::Address>* pRead, std::set<dev::Address>* pWritten){
+    CBlock block = context->block;
+    block.nTime = GetAdjustedTime();
+    dev::eth::EnvInfo envInfo(ByteCodeExec::BuildEVMEnvironment(block, context->pindex, blockGasLimit, context->lastHashes, *sealEngine));
+
+    std::vector<ResultExecute> result;
+    state->recordAccess(pRead || pWritten);
+    for(const YodyTransaction& tx : txs){
+        if(tx.getVersion().toRaw() != VersionVM::GetEVMDefault().toRaw() || (!tx.isCreation() && !state->addressInUse(tx.receiveAddress()))){
+            if(pRead && !tx.isCreation())
+                pRead->insert(tx.receiveAddress());
+            dev::eth::ExecutionResult execRes;
+            execRes.excepted = dev::eth::TransactionException::Unknown;
+            result.push_back(ResultExecute{execRes, YodyTransactionReceipt(dev::h256(), dev::h256(), dev::u256(), dev::eth::LogEntries()), CTransaction(), {}});
+            continue;
+        }
+        result.push_back(state->execute(envInfo, *sealEngine, tx, context->pindex->nHeight, dev::eth::Permanence::Reverted, OnOpFunc()));
+        sealEngine->deleteAddresses.clear();
+    }
+    if(pRead)
+        pRead->insert(state->accessRead().begin(), state->accessRead().end());
+    if(pWritten)
+        pWritten->insert(state->accessWritten().begin(), state->accessWritten().end());
+    state->recordAccess(false);
+    return result;
+}
+
+std::vector<ResultExecute> CallContract(const dev::Address& addrContract, std::vector<unsigned char> opcode, CChainState& chainstate, const dev::Address& sender, uint64_t gasLimit, CAmount nAmount){
+    CBlockIndex* pblockindex = chainstate.m_chain.Tip();
+    std::shared_ptr<const CallContractContext> context = g_call_contract_cache.GetContext(chainstate);
+    uint64_t blockGasLimit = g_call_contract_cache.GetBlockGasLimit(chainstate);
+
+    CBlock block;
+    YodyTransaction callTransaction = BuildCallTransaction(*context, *globalState, addrContract, opcode, sender, gasLimit, nAmount, blockGasLimit, block);
+
+    ByteCodeExec exec(block, std::vector<YodyTransaction>(1, callTransaction), blockGasLimit, pblockindex, chainstate.m_chain, &context->lastHashes);
     exec.performByteCode(dev::eth::Permanence::Reverted);
-    return exec.getResult();
+    return std::move(exec.getResult());
 }
 
 bool CheckMinGasPrice(std::vector<EthTransactionParams>& etps, const uint64_t& minGasPrice){
@@ -2398,8 +2577,7 @@ UniValue vmLogToJSON(const ResultExecute& execRes, const CTransaction& tx, const
         result.pushKV("blockheight", chain.Tip()->nHeight);
     }
     UniValue logEntries(UniValue::VARR);
-    dev::eth::LogEntries logs = execRes.txRec.log();
-    for(dev::eth::LogEntry log : logs){
+    for(const dev::eth::LogEntry& log : execRes.txRec.log()){
         UniValue logEntrie(UniValue::VOBJ);
         logEntrie.pushKV("address", log.address.hex());
         UniValue topics(UniValue::VARR);
@@ -2472,7 +2650,229 @@ void LastHashes::clear()
     m_lastHashes.clear();
 }
 
+ContractExecutionMemo g_contract_exec_memo;
+
+void ContractExecutionMemo::Add(const uint256& hashPrevBlock, const uint256& key, std::shared_ptr<const Entry> entry)
+{
+    LOCK(m_mutex);
+    if (hashPrevBlock != m_hash_prev_block) {
+        m_entries.clear();
+        m_hash_prev_block = hashPrevBlock;
+    }
+    if (m_entries.size() < MAX_CONTRACT_EXEC_MEMO)
+        m_entries[key] = std::move(entry);
+}
+
+std::shared_ptr<const ContractExecutionMemo::Entry> ContractExecutionMemo::Find(const uint256& key) const
+{
+    LOCK(m_mutex);
+    auto it = m_entries.find(key);
+    return it == m_entries.end() ? nullptr : it->second;
+}
+
+bool ContractExecutionMemo::HasParent(const uint256& hashPrevBlock) const
+{
+    LOCK(m_mutex);
+    return !m_entries.empty() && m_hash_prev_block == hashPrevBlock;
+}
+
+void ContractExecutionMemo::Clear()
+{
+    LOCK(m_mutex);
+    m_entries.clear();
+    m_hash_prev_block.SetNull();
+}
+
+static bool SameYodyTransaction(const YodyTransaction& a, const YodyTransaction& b)
+{
+    return a.sender() == b.sender() && a.isCreation() == b.isCreation() &&
+           (a.isCreation() || a.receiveAddress() == b.receiveAddress()) &&
+           a.value() == b.value() && a.gas() == b.gas() && a.gasPrice() == b.gasPrice() &&
+           a.nonce() == b.nonce() && a.data() == b.data() &&
+           a.getHashWith() == b.getHashWith() && a.getNVout() == b.getNVout() &&
+           a.getVersion().toRaw() == b.getVersion().toRaw();
+}
+
+ParallelContractExec::ParallelContractExec()
+{
+    globalState->recordCommittedAccounts(true);
+}
+
+ParallelContractExec::~ParallelContractExec()
+{
+    globalState->recordCommittedAccounts(false);
+}
+
+std::vector<std::pair<uint32_t, YodyTransaction>> ParallelContractExec::Candidates(const CBlock& block, CChainState& chainstate, const CTxMemPool* mempool, CCoinsViewCache& view, unsigned int contractflags)
+{
+    std::vector<std::pair<uint32_t, YodyTransaction>> candidates;
+    for (uint32_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        if (tx.IsCoinBase() || !tx.HasCreateOrCall() || tx.HasOpSpend())
+            continue;
+        YodyTxConverter convert(tx, chainstate, mempool, &view, &block.vtx, contractflags);
+        ExtractYodyTX resultConvertYodyTX;
+        if (!convert.extractionYodyTransactions(resultConvertYodyTX) || resultConvertYodyTX.first.size() != 1)
+            continue;
+        if (resultConvertYodyTX.first[0].getVersion().toRaw() != VersionVM::GetEVMDefault().toRaw())
+            continue;
+        candidates.emplace_back(i, std::move(resultConvertYodyTX.first[0]));
+    }
+    return candidates;
+}
+
+void ParallelContractExec::Execute(const CBlock& block, const CBlockIndex* pindexPrev, uint64_t blockGasLimit, std::vector<std::pair<uint32_t, YodyTransaction>>&& candidates)
+{
+    lastHashes.set(pindexPrev);
+    envInfo = std::make_unique<dev::eth::EnvInfo>(ByteCodeExec::BuildEVMEnvironment(block, pindexPrev, blockGasLimit, lastHashes, *globalSealEngine));
+
+    preState.reset(new YodyState(*globalState, globalState->rootHash(), globalState->rootHashUTXO()));
+    std::vector<CContractExecCheck> vChecks;
+    speculations.resize(candidates.size());
+    for (size_t i = 0; i < candidates.size(); i++) {
+        Speculation& speculation = speculations[i];
+        speculation.nIn = candidates[i].first;
+        speculation.tx = std::move(candidates[i].second);
+        // Transactions over the gas limit make the block invalid, they are not worth executing
+        if (speculation.tx.gas() > blockGasLimit)
+            continue;
+        speculation.state.reset(new YodyState(*globalState, globalState->rootHash(), globalState->rootHashUTXO()));
+        speculation.sealEngine.reset(dev::eth::SealEngineRegistrar::create(globalSealEngine->chainParams()));
+        speculation.sealEngine->setYodySchedule(globalSealEngine->getYodySchedule());
+        vChecks.emplace_back(speculation, *envInfo, pindexPrev->nHeight);
+    }
+
+    if (g_parallel_contract_exec) {
+        CCheckQueueControl<CContractExecCheck> control(&contractexecqueue);
+        control.Add(vChecks);
+        control.Wait();
+    } else {
+        for (CContractExecCheck& check : vChecks)
+            check();
+    }
+
+    // The copies of the state are not needed to commit the executions
+    for (Speculation& speculation : speculations) {
+        speculation.state.reset();
+        speculation.sealEngine.reset();
+    }
+}
+
+SpeculativeExecution* ParallelContractExec::Take(uint32_t nIn, const YodyTransaction& tx)
+{
+    auto it = std::lower_bound(speculations.begin(), speculations.end(), nIn, [](const Speculation& speculation, uint32_t n) { return speculation.nIn < n; });
+    if (it == speculations.end() || it->nIn != nIn || !it->fExecuted)
+        return nullptr;
+    it->fExecuted = false;
+    if (!SameYodyTransaction(it->tx, tx))
+        return nullptr;
+
+    // The accounts committed since the copies were made are the ones of the transactions before nIn
+    bool fConflict = globalState->rootReplaced();
+    const std::set<dev::Address>& committed = globalState->committedAccounts();
+    for (auto addr = it->spec.accessed.begin(); !fConflict && addr != it->spec.accessed.end(); ++addr) {
+        if (committed.count(*addr))
+            fConflict = preState->accountHash(*addr) != globalState->accountHash(*addr) || preState->vinHash(*addr) != globalState->vinHash(*addr);
+    }
+    if (fConflict) {
+        nConflicts++;
+        return nullptr;
+    }
+    nCommitted++;
+    return &it->spec;
+}
+
+bool CContractExecCheck::operator()()
+{
+    ParallelContractExec::Speculation& s = *speculation;
+    try {
+        if (!s.tx.isCreation() && !s.state->addressInUse(s.tx.receiveAddress()))
+            return true;
+        s.state->executeSpeculative(*envInfo, *s.sealEngine, s.tx, nHeight, s.spec);
+        s.fExecuted = true;
+    } catch (const std::exception& e) {
+        // The transaction is executed again on globalState
+        LogPrint(BCLog::BENCH, "%s: parallel execution of input %u failed: %s\n", __func__, s.nIn, e.what());
+    }
+    return true;
+}
+
+void ByteCodeExec::UseMemo(const uint256& hashTx, uint32_t nPosition, bool fRecord){
+    memoHashTx = hashTx;
+    memoPosition = nPosition;
+    fMemoRecord = fRecord;
+}
+
+uint256 ByteCodeExec::MemoKey() const{
+    // Everything the execution depends on besides the transactions, see BuildEVMEnvironment
+    const CScript& scriptAuthor = block.IsProofOfStake() ? block.vtx[1]->vout[1].scriptPubKey : block.vtx[0]->vout[0].scriptPubKey;
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << pindex->GetBlockHash() << block.nTime << block.nBits << blockGasLimit << h160Touint(EthAddrFromScript(scriptAuthor));
+    ss << h256Touint(globalState->rootHash()) << h256Touint(globalState->rootHashUTXO()) << memoHashTx << memoPosition;
+    return ss.GetHash();
+}
+
+bool ByteCodeExec::ApplyMemo(const uint256& key){
+    std::shared_ptr<const ContractExecutionMemo::Entry> entry = g_contract_exec_memo.Find(key);
+    if(!entry || !globalState->db().exists(entry->hashStateRoot))
+        return false;
+
+    // The commits of the execution are added to the snapshot so it stays in sync with the state
+    const bool fSnapshot = pstatesnapshot && pstatesnapshot->root() == globalState->rootHash();
+    if(fSnapshot && !entry->fSnapshot)
+        return false;
+    if(fSnapshot)
+        pstatesnapshot->AddPending(entry->snapshotLayers);
+    globalState->db().addKilled(entry->stateKilled);
+    globalState->dbUtxo().addKilled(entry->utxoKilled);
+    globalState->db().addWritten(entry->stateWritten);
+    globalState->dbUtxo().addWritten(entry->utxoWritten);
+    globalState->setRoot(entry->hashStateRoot);
+    globalState->setRootUTXO(entry->hashUTXORoot);
+    for(const ResultExecute& re : entry->results)
+        result.push_back(re);
+    globalSealEngine.get()->deleteAddresses.clear();
+    return true;
+}
+
+void ByteCodeExec::RecordMemo(const uint256& key, const dev::h256& oldHashStateRoot, size_t nStateKilled, size_t nUTXOKilled, size_t nStateWritten, size_t nUTXOWritten){
+    auto entry = std::make_shared<ContractExecutionMemo::Entry>();
+    entry->results.reserve(result.size());
+    for(const ResultExecute& re : result)
+        entry->results.push_back(re);
+    entry->hashStateRoot = globalState->rootHash();
+    entry->hashUTXORoot = globalState->rootHashUTXO();
+    if(pstatesnapshot)
+        entry->fSnapshot = pstatesnapshot->GetPending(oldHashStateRoot, entry->snapshotLayers);
+    const dev::h256s& stateKilled = globalState->db().killed();
+    const dev::h256s& utxoKilled = globalState->dbUtxo().killed();
+    if(stateKilled.size() >= nStateKilled)
+        entry->stateKilled.assign(stateKilled.begin() + nStateKilled, stateKilled.end());
+    if(utxoKilled.size() >= nUTXOKilled)
+        entry->utxoKilled.assign(utxoKilled.begin() + nUTXOKilled, utxoKilled.end());
+    const dev::h256s& stateWritten = globalState->db().written();
+    const dev::h256s& utxoWritten = globalState->dbUtxo().written();
+    if(stateWritten.size() >= nStateWritten)
+        entry->stateWritten.assign(stateWritten.begin() + nStateWritten, stateWritten.end());
+    if(utxoWritten.size() >= nUTXOWritten)
+        entry->utxoWritten.assign(utxoWritten.begin() + nUTXOWritten, utxoWritten.end());
+    g_contract_exec_memo.Add(pindex->GetBlockHash(), key, std::move(entry));
+}
+
 bool ByteCodeExec::performByteCode(dev::eth::Permanence type){
+    uint256 memoKey;
+    const bool fMemo = memoPosition >= 0 && type == dev::eth::Permanence::Committed;
+    if(fMemo){
+        memoKey = MemoKey();
+        if(!fMemoRecord && ApplyMemo(memoKey))
+            return true;
+    }
+    const dev::h256 oldHashStateRoot = globalState->rootHash();
+    const size_t nStateKilled = globalState->db().killed().size();
+    const size_t nUTXOKilled = globalState->dbUtxo().killed().size();
+    const size_t nStateWritten = globalState->db().written().size();
+    const size_t nUTXOWritten = globalState->dbUtxo().written().size();
+
     for(YodyTransaction& tx : txs){
         //validate VM version
         if(tx.getVersion().toRaw() != VersionVM::GetEVMDefault().toRaw()){
@@ -2482,14 +2882,20 @@ bool ByteCodeExec::performByteCode(dev::eth::Permanence type){
         if(!tx.isCreation() && !globalState->addressInUse(tx.receiveAddress())){
             dev::eth::ExecutionResult execRes;
             execRes.excepted = dev::eth::TransactionException::Unknown;
-            result.push_back(ResultExecute{execRes, YodyTransactionReceipt(dev::h256(), dev::h256(), dev::u256(), dev::eth::LogEntries()), CTransaction()});
+            result.push_back(ResultExecute{execRes, YodyTransactionReceipt(dev::h256(), dev::h256(), dev::u256(), dev::eth::LogEntries()), CTransaction(), {}});
             continue;
         }
-        result.push_back(globalState->execute(envInfo, *globalSealEngine.get(), tx, chain, type, OnOpFunc()));
+        SpeculativeExecution* spec = pParallel && type == dev::eth::Permanence::Committed && txs.size() == 1 ? pParallel->Take(parallelPosition, tx) : nullptr;
+        if(spec)
+            result.push_back(globalState->commitSpeculative(envInfo, *globalSealEngine.get(), tx, std::move(*spec)));
+        else
+            result.push_back(globalState->execute(envInfo, *globalSealEngine.get(), tx, chain, type, OnOpFunc()));
     }
     globalState->db().commit();
     globalState->dbUtxo().commit();
     globalSealEngine.get()->deleteAddresses.clear();
+    if(fMemo && fMemoRecord)
+        RecordMemo(memoKey, oldHashStateRoot, nStateKilled, nUTXOKilled, nStateWritten, nUTXOWritten);
     return true;
 }
 
@@ -2542,22 +2948,29 @@ bool ByteCodeExec::processingResults(ByteCodeExecResult& resultBCE){
 }
 
 dev::eth::EnvInfo ByteCodeExec::BuildEVMEnvironment(){
-    CBlockIndex* tip = pindex;
+    const LastHashes* hashes = pLastHashes;
+    if(!hashes){
+        lastHashes.set(pindex);
+        hashes = &lastHashes;
+    }
+    return BuildEVMEnvironment(block, pindex, blockGasLimit, *hashes, *globalSealEngine);
+}
+
+dev::eth::EnvInfo ByteCodeExec::BuildEVMEnvironment(const CBlock& block, const CBlockIndex* pindex, const uint64_t blockGasLimit, const LastHashes& lastHashes, const dev::eth::SealEngineFace& sealEngine){
+    const CBlockIndex* tip = pindex;
     dev::eth::BlockHeader header;
     header.setNumber(tip->nHeight + 1);
     header.setTimestamp(block.nTime);
     header.setDifficulty(dev::u256(block.nBits));
     header.setGasLimit(blockGasLimit);
 
-    lastHashes.set(tip);
-
     if(block.IsProofOfStake()){
         header.setAuthor(EthAddrFromScript(block.vtx[1]->vout[1].scriptPubKey));
     }else {
         header.setAuthor(EthAddrFromScript(block.vtx[0]->vout[0].scriptPubKey));
     }
     dev::u256 gasUsed;
-    dev::eth::EnvInfo env(header, lastHashes, gasUsed, globalSealEngine->chainParams().chainID);
+    dev::eth::EnvInfo env(header, lastHashes, gasUsed, sealEngine.chainParams().chainID);
     return env;
 }
 
@@ -2736,6 +3149,13 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
     int64_t nTimeStart = GetTimeMicros();
 
     ///////////////////////////////////////////////// // yody
+    // The background chainstate validating the blocks below a snapshot only computes and checks the state roots,
+    // the receipts, the indexes and the pruning journal follow the active chainstate
+    const bool fActiveChainstate = this == &m_chainman.ActiveChainstate();
+    // Only the trie nodes killed by this block go in its pruning journal, the references counted by the
+    // executions discarded before it, like the block templates and the checked blocks, are released with it
+    globalState->db().clearJournal();
+    globalState->dbUtxo().clearJournal();
     YodyDGP yodyDGP(globalState.get(), *this, fGettingValuesDGP);
     globalSealEngine->setYodySchedule(yodyDGP.getGasSchedule(pindex->nHeight + (pindex->nHeight+1 >= m_params.GetConsensus().QIP7Height ? 0 : 1) ));
     uint32_t sizeBlockDGP = yodyDGP.getBlockSize(pindex->nHeight + (pindex->nHeight+1 >= m_params.GetConsensus().QIP7Height ? 0 : 1));
@@ -2967,10 +3387,9 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
 
     ///////////////////////////////////////////////////////// // yody
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
-    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
     std::map<dev::Address, std::pair<CHeightTxIndexKey, std::vector<uint256>>> heightIndexes;
+    std::vector<DelegationEvent> delegationEvents;
+    std::set<dev::Address> contractAccounts;
     /////////////////////////////////////////////////////////
 
     uint64_t blockGasUsed = 0;
@@ -2988,6 +3407,17 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
         nValueCoinPrev = coin.out.nValue;
     }
 
+    // Execute the contract transactions in parallel first, unless they were executed to assemble the block
+    std::unique_ptr<ParallelContractExec> parallelExec;
+    if (g_parallel_contract_exec && pindex->pprev->nHeight >= m_params.GetConsensus().nFixUTXOCacheHFHeight &&
+        !g_contract_exec_memo.HasParent(pindex->pprev->GetBlockHash())) {
+        std::vector<std::pair<uint32_t, YodyTransaction>> candidates = ParallelContractExec::Candidates(block, *this, m_mempool, view, contractflags);
+        if (candidates.size() > 1) {
+            parallelExec = std::make_unique<ParallelContractExec>();
+            parallelExec->Execute(block, pindex->pprev, blockGasLimit, std::move(candidates));
+        }
+    }
+
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
         const CTransaction &tx = *(block.vtx[i]);
@@ -3022,31 +3452,6 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
                 LogPrintf("ERROR: %s: contains a non-BIP68-final transaction\n", __func__);
                 return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-txns-nonfinal");
             }
-
-            ////////////////////////////////////////////////////////////////// // yody
-            if (fAddressIndex)
-            {
-                for (size_t j = 0; j < tx.vin.size(); j++) {
-                    const CTxIn input = tx.vin[j];
-                    const CTxOut &prevout = view.GetOutputFor(tx.vin[j]);
-
-                    CTxDestination dest;
-                    if (ExtractDestination(input.prevout, prevout.scriptPubKey, dest)) {
-                        valtype bytesID(std::visit(DataVisitor(), dest));
-                        if(bytesID.empty()) {
-                            continue;
-                        }
-                        valtype addressBytes(32);
-                        std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(dest.index(), uint256(addressBytes), pindex->nHeight, i, tx.GetHash(), j, true), prevout.nValue * -1));
-
-                        // remove address from unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(dest.index(), uint256(addressBytes), input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
-                        spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue(tx.GetHash(), j, pindex->nHeight, prevout.nValue, dest.index(), uint256(addressBytes))));
-                    }
-                }
-            }
-            //////////////////////////////////////////////////////////////////
         }
 
         // GetTransactionSigOpCost counts 3 types of sigops:
@@ -3180,18 +3585,22 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
                 }
             }
 
+            exec.UseMemo(tx.GetHash(), i, false);
+            exec.UseParallel(parallelExec.get(), i);
             if(!exec.performByteCode()){
                 return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-tx-unknown-error", "ConnectBlock(): Unknown error during contract execution");
             }
 
-            std::vector<ResultExecute> resultExec(exec.getResult());
+            std::vector<ResultExecute>& resultExec = exec.getResult();
+            for(const ResultExecute& re : resultExec)
+                contractAccounts.insert(re.changedAccounts.begin(), re.changedAccounts.end());
             ByteCodeExecResult bcer;
             if(!exec.processingResults(bcer)){
                 return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-vm-exec-processing", "ConnectBlock(): Error processing VM execution results");
             }
 
             std::vector<TransactionReceiptInfo> tri;
-            if (fLogEvents && !fJustCheck)
+            if (fLogEvents && !fJustCheck && fActiveChainstate)
             {
                 uint64_t countCumulativeGasUsed = blockGasUsed;
                 for(size_t k = 0; k < resultConvertYodyTX.first.size(); k ++){
@@ -3200,6 +3609,9 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
                             heightIndexes[log.address].first = CHeightTxIndexKey(pindex->nHeight, log.address);
                         }
                         heightIndexes[log.address].second.push_back(tx.GetHash());
+                        DelegationEvent event;
+                        if(GetYodyDelegation().GetDelegationEvent(log, event))
+                            delegationEvents.push_back(event);
                     }
                     uint64_t gasUsed = uint64_t(resultExec[k].execRes.gasUsed);
                     countCumulativeGasUsed += gasUsed;
@@ -3213,7 +3625,8 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
                         countCumulativeGasUsed,
                         gasUsed,
                         resultExec[k].execRes.newAddress,
-                        resultExec[k].txRec.log(),
+                        // The logs are moved to the receipt unless the VM log still reads them
+                        fRecordLogOpcodes ? resultExec[k].txRec.log() : resultExec[k].txRec.takeLog(),
                         resultExec[k].execRes.excepted,
                         exceptedMessage(resultExec[k].execRes.excepted, resultExec[k].execRes.output),
                         resultConvertYodyTX.first[k].getNVout(),
@@ -3223,7 +3636,7 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
                     });
                 }
 
-                pstorageresult->addResult(uintToh256(tx.GetHash()), tri);
+                pstorageresult->addResult(uintToh256(tx.GetHash()), std::move(tri));
             }
 
             blockGasUsed += bcer.usedGas;
@@ -3248,30 +3661,6 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
         }
 /////////////////////////////////////////////////////////////////////////////////////////
 
-        /////////////////////////////////////////////////////////////////////////////////// // yody
-        if (fAddressIndex) {
-
-            for (unsigned int k = 0; k < tx.vout.size(); k++) {
-                const CTxOut &out = tx.vout[k];
-                const bool isTxCoinStake = tx.IsCoinStake();
-
-                CTxDestination dest;
-                if (ExtractDestination({tx.GetHash(), k}, out.scriptPubKey, dest)) {
-                    valtype bytesID(std::visit(DataVisitor(), dest));
-                    if(bytesID.empty()) {
-                        continue;
-                    }
-                    valtype addressBytes(32);
-                    std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(dest.index(), uint256(addressBytes), pindex->nHeight, i, tx.GetHash(), k, false), out.nValue));
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(dest.index(), uint256(addressBytes), tx.GetHash(), k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight, isTxCoinStake)));
-                }
-            }
-        }
-        ///////////////////////////////////////////////////////////////////////////////////
-
         CTxUndo undoDummy;
         if (i > 0) {
             blockundo.vtxundo.push_back(CTxUndo());
@@ -3280,6 +3669,10 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
     }
     int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
     LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs (%.2fms/blk)]\n", (unsigned)block.vtx.size(), MILLI * (nTime3 - nTime2), MILLI * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : MILLI * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * MICRO, nTimeConnect * MILLI / nBlocksTotal);
+    if (parallelExec) {
+        LogPrint(BCLog::BENCH, "      - Parallel contract executions: %u committed, %u conflicting\n", parallelExec->Committed(), parallelExec->Conflicts());
+        parallelExec.reset();
+    }
 
     if(nFees < gasRefunds) { //make sure it won't overflow
         return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-blk-fees-greater-gasrefund", "ConnectBlock(): Less total fees than gas refund fees");
@@ -3297,6 +3690,7 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
 ////////////////////////////////////////////////////////////////// // yody
     if(pindex->nHeight == m_params.GetConsensus().nOfflineStakeHeight){
         globalState->deployDelegationsContract();
+        contractAccounts.insert(uintToh160(m_params.GetConsensus().delegationsAddress));
     }
     checkBlock.hashMerkleRoot = BlockMerkleRoot(checkBlock);
     checkBlock.hashStateRoot = h256Touint(globalState->rootHash());
@@ -3382,21 +3776,55 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
     if (!WriteUndoDataForBlock(blockundo, state, pindex, m_params)) {
         return false;
     }
+    if (fActiveChainstate)
+        g_spent_coin_window.BlockConnected(block, blockundo, pindex);
 
     if (!pindex->IsValid(BLOCK_VALID_SCRIPTS)) {
         pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
         setDirtyBlockIndex.insert(pindex);
     }
-    if (fLogEvents)
+    if (fLogEvents && fActiveChainstate)
     {
         for (const auto& e: heightIndexes)
         {
             if (!pblocktree->WriteHeightIndex(e.second.first, e.second.second))
                 return AbortNode(state, "Failed to write height index");
         }
+        // Run for the blocks without events too, to revert the undo data left at the height by an unclean shutdown
+        if (!pblocktree->UpdateDelegationIndex(pindex->nHeight, delegationEvents))
+            return AbortNode(state, "Failed to write delegation index");
+    }
+
+    if (fActiveChainstate) {
+        // Register the accounts which exist after the block, and unregister the removed ones
+        std::vector<std::pair<dev::h160, bool>> contracts;
+        for (const dev::Address& address : contractAccounts)
+            contracts.emplace_back(address, globalState->addressInUse(address));
+        if (!pblocktree->UpdateContractIndex(pindex->nHeight, contracts))
+            return AbortNode(state, "Failed to write contract index");
+        // The blocks deeper than a reorganization can reach are not disconnected, drop their undo data
+        const int nUndoDepth = m_params.GetConsensus().MaxCheckpointSpan();
+        if (pindex->nHeight > nUndoDepth && !pblocktree->PruneContractUndo(pindex->nHeight - nUndoDepth))
+            return AbortNode(state, "Failed to prune contract index");
+
+        if (pstatesnapshot && !pstatesnapshot->Flush(pindex->nHeight, pindex->nHeight - m_params.GetConsensus().MaxCheckpointSpan()))
+            return AbortNode(state, "Failed to write state snapshot");
+
+        // Journal the trie nodes replaced by the block, and delete the ones no longer used within the pruning depth
+        globalState->db().writeJournal(pindex->nHeight);
+        globalState->dbUtxo().writeJournal(pindex->nHeight);
+        if (nStatePruning > 0 && pindex->nHeight > nStatePruning) {
+            globalState->db().prune(pindex->nHeight - nStatePruning);
+            globalState->dbUtxo().prune(pindex->nHeight - nStatePruning);
+        }
+    } else {
+        // The heights of the background chainstate are journaled by the active one, its nodes are kept
+        globalState->db().keepWritten();
+        globalState->dbUtxo().keepWritten();
     }
 
-    // The stake and delegate index is needed for MPoS, update it while MPoS is active
+    // The stake and delegate index is needed for MPoS, update it while MPoS is active.
+    // The background chainstate writes it too, the MPoS rewards of its next blocks are checked with it.
     if(pindex->nHeight <= m_params.GetConsensus().nLastMPoSBlock)
     {
         if(block.IsProofOfStake()){
@@ -3424,39 +3852,6 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
     }
 
     assert(pindex->phashBlock);
-    ///////////////////////////////////////////////////////////// // yody
-    if (fAddressIndex) {
-        if (!pblocktree->WriteAddressIndex(addressIndex)) {
-            return AbortNode(state, "Failed to write address index");
-        }
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            return AbortNode(state, "Failed to write address unspent index");
-        }
-
-        if (!pblocktree->UpdateSpentIndex(spentIndex))
-            return AbortNode(state, "Failed to write transaction index");
-
-        unsigned int logicalTS = pindex->nTime;
-        unsigned int prevLogicalTS = 0;
-
-        // retrieve logical timestamp of the previous block
-        if (pindex->pprev)
-            if (!pblocktree->ReadTimestampBlockIndex(pindex->pprev->GetBlockHash(), prevLogicalTS))
-                LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
-
-        if (logicalTS <= prevLogicalTS) {
-            logicalTS = prevLogicalTS + 1;
-            LogPrint(BCLog::INDEX, "%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, pindex->nTime, prevLogicalTS, logicalTS);
-        }
-
-        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(logicalTS, pindex->GetBlockHash())))
-            return AbortNode(state, "Failed to write timestamp index");
-
-        if (!pblocktree->WriteTimestampBlockIndex(CTimestampBlockIndexKey(pindex->GetBlockHash()), CTimestampBlockIndexValue(logicalTS)))
-            return AbortNode(state, "Failed to write blockhash index");
-    }
-    /////////////////////////////////////////////////////////////
-
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
@@ -3466,7 +3861,7 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
     int64_t nTime6 = GetTimeMicros(); nTimeCallbacks += nTime6 - nTime5;
     LogPrint(BCLog::BENCH, "    - Callbacks: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime6 - nTime5), nTimeCallbacks * MICRO, nTimeCallbacks * MILLI / nBlocksTotal);
 
-    if (fLogEvents)
+    if (fLogEvents && fActiveChainstate)
         pstorageresult->commitResults();
 
     return true;
@@ -3609,6 +4004,14 @@ bool CChainState::FlushStateToDisk(
             }
             nLastWrite = nNow;
         }
+        // Write the receipts of the connected blocks, before the coins so they are never behind the chainstate best block.
+        if (pstorageresult && (fDoFullFlush || pstorageresult->pendingResultsUsage() > MAX_PENDING_RESULTS_USAGE)) {
+            LOG_TIME_MILLIS_WITH_CATEGORY("write receipts to disk", BCLog::BENCH);
+
+            if (!pstorageresult->flushResults()) {
+                return AbortNode(state, "Failed to write to receipts database");
+            }
+        }
         // Flush best chain related state. This can only be done if the blocks / block index write was also done.
         if (fDoFullFlush && !CoinsTip().GetBestBlock().IsNull()) {
             LOG_TIME_SECONDS(strprintf("write coins cache to disk (%d coins, %.2fkB)",
@@ -3710,6 +4113,43 @@ void CChainState::UpdateTip(const CBlockIndex* pindexNew)
       !warning_messages.empty() ? strprintf(" warning='%s'", warning_messages.original) : "");
 }
 
+/**
+ * The contract state follows the tip of the active chainstate. The background chainstate validating the
+ * blocks below a snapshot shares it, so its blocks are connected and disconnected from the roots of its
+ * own tip, without the flat state snapshot, and the roots and schedule of the active tip are restored after.
+ */
+class BackgroundStateRoots
+{
+public:
+    BackgroundStateRoots(const CChainState& chainstate, const CBlockIndex* tip) :
+        m_stateRoot(globalState->rootHash()), m_utxoRoot(globalState->rootHashUTXO()),
+        m_background(tip && &chainstate != &chainstate.m_chainman.ActiveChainstate())
+    {
+        if (!m_background)
+            return;
+        m_schedule = globalSealEngine->getYodySchedule();
+        globalState->setSnapshot(nullptr);
+        globalState->setRoot(uintToh256(tip->hashStateRoot));
+        globalState->setRootUTXO(uintToh256(tip->hashUTXORoot));
+    }
+
+    ~BackgroundStateRoots()
+    {
+        if (!m_background)
+            return;
+        globalState->setRoot(m_stateRoot);
+        globalState->setRootUTXO(m_utxoRoot);
+        globalState->setSnapshot(pstatesnapshot);
+        globalSealEngine->setYodySchedule(m_schedule);
+    }
+
+private:
+    const dev::h256 m_stateRoot;
+    const dev::h256 m_utxoRoot;
+    const bool m_background;
+    dev::eth::EVMSchedule m_schedule;
+};
+
 /** Disconnect m_chain's tip.
   * After calling, the mempool will be in an inconsistent state, with
   * transactions from disconnected blocks being added to disconnectpool.  You
@@ -3727,6 +4167,7 @@ bool CChainState::DisconnectTip(BlockValidationState& state, DisconnectedBlockTr
 
     CBlockIndex *pindexDelete = m_chain.Tip();
     assert(pindexDelete);
+    BackgroundStateRoots stateRoots(*this, pindexDelete); // yody
     // Read block from disk.
     std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
     CBlock& block = *pblock;
@@ -3740,6 +4181,8 @@ bool CChainState::DisconnectTip(BlockValidationState& state, DisconnectedBlockTr
         assert(view.GetBestBlock() == pindexDelete->GetBlockHash());
         if (DisconnectBlock(block, pindexDelete, view, nullptr) != DISCONNECT_OK)
             return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
+        if (this == &m_chainman.ActiveChainstate())
+            g_spent_coin_window.BlockDisconnected(pindexDelete);
         bool flushed = view.Flush();
         assert(flushed);
     }
@@ -3829,6 +4272,7 @@ bool CChainState::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew
     if (m_mempool) AssertLockHeld(m_mempool->cs);
 
     assert(pindexNew->pprev == m_chain.Tip());
+    BackgroundStateRoots stateRoots(*this, pindexNew->pprev); // yody
     // Read block from disk.
     int64_t nTime1 = GetTimeMicros();
     std::shared_ptr<const CBlock> pthisBlock;
@@ -5897,10 +6341,6 @@ bool CChainState::LoadBlockIndexDB()
     pblocktree->ReadReindexing(fReindexing);
     if(fReindexing) fReindex = true;
 
-    ///////////////////////////////////////////////////////////// // yody
-    pblocktree->ReadFlag("addrindex", fAddressIndex);
-    LogPrintf("LoadBlockIndexDB(): address index %s\n", fAddressIndex ? "enabled" : "disabled");
-    /////////////////////////////////////////////////////////////
     // Check whether we have a transaction index
     pblocktree->ReadFlag("logevents", fLogEvents);
     LogPrintf("%s: log events index %s\n", __func__, fLogEvents ? "enabled" : "disabled");
@@ -6245,9 +6685,9 @@ bool ChainstateManager::LoadBlockIndex()
         // Use the provided setting for -logevents in the new database
         fLogEvents = gArgs.GetBoolArg("-logevents", DEFAULT_LOGEVENTS);
         pblocktree->WriteFlag("logevents", fLogEvents);
+        pblocktree->WriteFlag("delegationindex", fLogEvents);
         /////////////////////////////////////////////////////////////// // yody
-        fAddressIndex = gArgs.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX);
-        pblocktree->WriteFlag("addrindex", fAddressIndex);
+        pblocktree->WriteFlag("contractindex", true);
         ///////////////////////////////////////////////////////////////
     }
     return true;
@@ -6884,7 +7324,7 @@ CChainState& ChainstateManager::InitializeChainstate(
     if (to_modify) {
         throw std::logic_error("should not be overwriting a chainstate");
     }
-    to_modify.reset(new CChainState(mempool, m_blockman, snapshot_blockhash));
+    to_modify.reset(new CChainState(mempool, m_blockman, *this, snapshot_blockhash));
 
     // Snapshot chainstates and initial IBD chaintates always become active.
     if (is_snapshot || (!is_snapshot && !m_active_chainstate)) {
@@ -6954,7 +7394,7 @@ bool ChainstateManager::ActivateSnapshot(
     }
 
     auto snapshot_chainstate = WITH_LOCK(::cs_main, return std::make_unique<CChainState>(
-        /* mempool */ nullptr, m_blockman, base_blockhash));
+        /* mempool */ nullptr, m_blockman, *this, base_blockhash));
 
     {
         LOCK(::cs_main);
@@ -6980,6 +7420,22 @@ bool ChainstateManager::ActivateSnapshot(
         const bool chaintip_loaded = m_snapshot_chainstate->LoadChainTip();
         assert(chaintip_loaded);
 
+        // yody: the contract state follows the snapshot chainstate, from the roots of its base block
+        const CBlockIndex* snapshot_tip = m_snapshot_chainstate->m_chain.Tip();
+        globalState->setRoot(uintToh256(snapshot_tip->hashStateRoot));
+        globalState->setRootUTXO(uintToh256(snapshot_tip->hashUTXORoot));
+        if (pstatesnapshot && pstatesnapshot->root() != globalState->rootHash() &&
+            !pstatesnapshot->Generate(globalState->db(), globalState->rootHash(), snapshot_tip->nHeight)) {
+            // The state is read from the trie while the flat snapshot is not at its root
+            LogPrintf("[snapshot] failed to generate the state snapshot at %s\n", base_blockhash.ToString());
+        }
+        globalState->setSnapshot(pstatesnapshot);
+
+        // The background chainstate does not write the contract index, register the accounts of the snapshot state
+        if (!BuildContractIndex()) {
+            LogPrintf("[snapshot] failed to build the contract index at %s\n", base_blockhash.ToString());
+        }
+
         m_active_chainstate = m_snapshot_chainstate.get();
 
         LogPrintf("[snapshot] successfully activated snapshot %s\n", base_blockhash.ToString());
@@ -7022,6 +7478,18 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
 
     const AssumeutxoData& au_data = *maybe_au_data;
 
+    // The nodes of the contract state are added to the state databases, whose references are only
+    // counted when they are journaled, so the state of the snapshot could be pruned by the other blocks
+    if (WITH_LOCK(::cs_main, return globalState->db().journaling() || globalState->dbUtxo().journaling())) {
+        LogPrintf("[snapshot] refusing to load snapshot with -statepruning\n");
+        return false;
+    }
+
+    // The state databases are written by the validation while the snapshot is loaded, so the contract
+    // state is added to them through copies, which share their storage and node cache
+    dev::OverlayDB state_db = WITH_LOCK(::cs_main, return globalState->db());
+    dev::OverlayDB utxo_db = WITH_LOCK(::cs_main, return globalState->dbUtxo());
+
     COutPoint outpoint;
     Coin coin;
     const uint64_t coins_count = metadata.m_coins_count;
@@ -7096,6 +7564,17 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
     // method.
     coins_cache.SetBestBlock(base_blockhash);
 
+    // yody
+    LogPrintf("[snapshot] loading contract state from snapshot %s\n", base_blockhash.ToString());
+    YodyStateDumpStats state_stats;
+    if (!LoadYodyState(coins_file, state_db, utxo_db, uintToh256(snapshot_start_block->hashStateRoot),
+                       uintToh256(snapshot_start_block->hashUTXORoot), state_stats)) {
+        LogPrintf("[snapshot] bad contract state after deserializing %d coins\n", coins_count);
+        return false;
+    }
+    LogPrintf("[snapshot] loaded %d nodes and %d preimages (%.2f MB) of contract state\n",
+        state_stats.nodes, state_stats.preimages, state_stats.bytes / (1000.0 * 1000));
+
     bool out_of_coins{false};
     try {
         coins_file >> outpoint;
@@ -7104,7 +7583,7 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
         out_of_coins = true;
     }
     if (!out_of_coins) {
-        LogPrintf("[snapshot] bad snapshot - coins left over after deserializing %d coins\n",
+        LogPrintf("[snapshot] bad snapshot - data left over after deserializing %d coins and the contract state\n",
             coins_count);
         return false;
     }
@@ -7254,10 +7733,10 @@ void ChainstateManager::MaybeRebalanceCaches()
 ////////////////////////////////////////////////////////////////////////////////// // yody
 bool GetAddressIndex(uint256 addressHash, int type, std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end)
 {
-    if (!fAddressIndex)
+    if (!g_address_index)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end))
+    if (!g_address_index->ReadAddressIndex(addressHash, type, addressIndex, start, end))
         return error("unable to get txids for address");
 
     return true;
@@ -7265,13 +7744,13 @@ bool GetAddressIndex(uint256 addressHash, int type, std::vector<std::pair<CAddre
 
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value, const CTxMemPool& mempool)
 {
-    if (!fAddressIndex)
+    if (!g_address_index)
         return false;
 
     if (mempool.getSpentIndex(key, value))
         return true;
 
-    if (!pblocktree->ReadSpentIndex(key, value))
+    if (!g_address_index->ReadSpentIndex(key, value))
         return false;
 
     return true;
@@ -7279,10 +7758,10 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value, const CTxMemPoo
 
 bool GetAddressUnspent(uint256 addressHash, int type, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
 {
-    if (!fAddressIndex)
+    if (!g_address_index)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, unspentOutputs))
+    if (!g_address_index->ReadAddressUnspentIndex(addressHash, type, unspentOutputs))
         return error("unable to get txids for address");
 
     return true;
@@ -7290,10 +7769,10 @@ bool GetAddressUnspent(uint256 addressHash, int type, std::vector<std::pair<CAdd
 
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes, ChainstateManager& chainman)
 {
-    if (!fAddressIndex)
+    if (!g_address_index)
         return error("Timestamp index not enabled");
 
-    if (!pblocktree->ReadTimestampIndex(high, low, fActiveOnly, hashes, chainman))
+    if (!g_address_index->ReadTimestampIndex(high, low, fActiveOnly, hashes, chainman))
         return error("Unable to get hashes for timestamps");
 
     return true;
@@ -7326,38 +7805,49 @@ CAmount GetTxGasFee(const CMutableTransaction& _tx, const CTxMemPool& mempool, C
     return nGasFee;
 }
 
-bool GetAddressWeight(uint256 addressHash, int type, const std::map<COutPoint, uint32_t>& immatureStakes, int32_t nHeight, uint64_t& nWeight)
+bool GetAddressWeight(uint256 addressHash, int type, int32_t nHeight, uint64_t& nWeight)
 {
     nWeight = 0;
 
-    if (!fAddressIndex)
+    if (!g_address_index)
         return error("address index not enabled");
 
-    // Get address utxos
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
-    if (!GetAddressUnspent(addressHash, type, unspentOutputs)) {
-        throw error("No information available for address");
+    // Get the aggregated value of the address utxos, and count only the mature ones.
+    // The coins spent by the recent coinstakes are not in the index, so no immature stake is counted.
+    CAddressWeightValue weight;
+    if (!g_address_index->ReadAddressWeight(addressHash, type, weight)) {
+        return error("No information available for address");
     }
 
-    // Add the utxos to the list if they are mature
-	const Consensus::Params& consensusParams = Params().GetConsensus();
-    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator i=unspentOutputs.begin(); i!=unspentOutputs.end(); i++) {
+    CAmount nMature = weight.GetMature(nHeight, Params().GetConsensus().CoinbaseMaturity(nHeight + 1));
+    if (nMature > 0)
+        nWeight = nMature;
 
-        int nDepth = nHeight - i->second.blockHeight + 1;
-        if (nDepth < consensusParams.CoinbaseMaturity(nHeight + 1))
-            continue;
+    return true;
+}
 
-        if(i->second.satoshis < 0)
-            continue;
+bool BuildContractIndex()
+{
+    AssertLockHeld(cs_main);
 
-        COutPoint prevout = COutPoint(i->first.txhash, i->first.index);
-        if(immatureStakes.find(prevout) == immatureStakes.end())
-        {
-            nWeight+= i->second.satoshis;
-        }
-    }
+    if (!pblocktree->WipeContractIndex())
+        return false;
 
-    return true;
+    // Walk the state trie a page at a time, the creation height of the existing accounts is not known so they are registered first
+    dev::h256 begin;
+    do {
+        std::pair<dev::eth::State::AddressMap, dev::h256> page = globalState->addresses(begin, 1000);
+        std::vector<std::pair<dev::h160, bool>> contracts;
+        for (const auto& entry : page.first)
+            contracts.emplace_back(entry.second, true);
+        if (!pblocktree->UpdateContractIndex(0, contracts, false))
+            return false;
+        if (ShutdownRequested())
+            return false;
+        begin = page.second;
+    } while (begin != dev::h256());
+
+    return pblocktree->WriteFlag("contractindex", true);
 }
 
 std::map<COutPoint, uint32_t> GetImmatureStakes(ChainstateManager& chainman)
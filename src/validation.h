@@ -28,8 +28,10 @@
 #include <util/check.h>
 #include <util/hasher.h>
 #include <util/translation.h>
+#include <validationinterface.h>
 
 #include <atomic>
+#include <deque>
 #include <map>
 #include <memory>
 #include <optional>
@@ -53,6 +55,7 @@ class CWallet;
 #include <libethashseal/GenesisInfo.h>
 #include <script/standard.h>
 #include <yody/storageresults.h>
+#include <yody/statesnapshot.h>
 
 
 extern std::unique_ptr<YodyState> globalState;
@@ -76,6 +79,7 @@ struct CCheckpointData;
 class CInv;
 class CConnman;
 class CScriptCheck;
+class ParallelContractExec;
 class CTxMemPool;
 class ChainstateManager;
 struct CDiskTxPos;
@@ -109,12 +113,18 @@ static const unsigned int DEFAULT_MEMPOOL_EXPIRY = 336;
 static const int MAX_SCRIPTCHECK_THREADS = 15;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Maximum number of dedicated contract execution threads allowed */
+static const int MAX_CONTRACTEXEC_THREADS = 15;
+/** -parcontracts default (number of contract execution threads, 0 = contracts are executed serially) */
+static const int DEFAULT_CONTRACTEXEC_THREADS = 0;
 static const int64_t DEFAULT_MAX_TIP_AGE = 12 * 60 * 60; //Changed to 12 hours so that isInitialBlockDownload() is more accurate
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
 static const bool DEFAULT_TXINDEX = false;
 static constexpr bool DEFAULT_COINSTATSINDEX{false};
 static const bool DEFAULT_ADDRINDEX = false;
 static const bool DEFAULT_LOGEVENTS = false;
+/** Default for -statepruning, the number of blocks whose state trie nodes are kept (0 = keep all) */
+static const int DEFAULT_STATE_PRUNING = 0;
 static const char* const DEFAULT_BLOCKFILTERINDEX = "0";
 /** Default for -persistmempool */
 static const bool DEFAULT_PERSIST_MEMPOOL = true;
@@ -163,8 +173,11 @@ extern uint256 g_best_block;
  * False indicates all script checking is done on the main threadMessageHandler thread.
  */
 extern bool g_parallel_script_checks;
+/** Whether the contract transactions of the connected blocks are executed in parallel before they are committed */
+extern bool g_parallel_contract_exec;
 extern bool fAddressIndex;
 extern bool fLogEvents;
+extern int nStatePruning;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
@@ -196,6 +209,10 @@ void UnloadBlockIndex(CTxMemPool* mempool, ChainstateManager& chainman);
 void StartScriptCheckWorkerThreads(int threads_num);
 /** Stop all of the script checking worker threads */
 void StopScriptCheckWorkerThreads();
+/** Run instances of contract execution worker threads */
+void StartContractExecWorkerThreads(int threads_num);
+/** Stop all of the contract execution worker threads */
+void StopContractExecWorkerThreads();
 /**
  * Return transaction from the block at block_index.
  * If block_index is not provided, fall back to mempool.
@@ -407,9 +424,12 @@ bool GetAddressUnspent(uint256 addressHash, int type,
 
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes, ChainstateManager& chainman);
 
-bool GetAddressWeight(uint256 addressHash, int type, const std::map<COutPoint, uint32_t>& immatureStakes, int32_t nHeight, uint64_t& nWeight);
+bool GetAddressWeight(uint256 addressHash, int type, int32_t nHeight, uint64_t& nWeight);
 
 std::map<COutPoint, uint32_t> GetImmatureStakes(ChainstateManager& chainman);
+
+/** Register the accounts of the current contract state, for a database older than the contract index or a loaded snapshot */
+bool BuildContractIndex() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 /////////////////////////////////////////////////////////////////
 
 bool CheckIndexProof(const CBlockIndex& block, const Consensus::Params& consensusParams);
@@ -453,6 +473,12 @@ public:
 
 extern std::unique_ptr<StorageResults> pstorageresult;
 
+/** Flat copy of the contract state at the tip, read by globalState before the state trie */
+extern std::shared_ptr<StateSnapshot> pstatesnapshot;
+
+/** Trie nodes of the contract state and UTXO databases, shared by globalState and its copies */
+extern std::shared_ptr<dev::TrieNodeCache> g_state_node_cache;
+
 bool CheckReward(const CBlock& block, BlockValidationState& state, int nHeight, const Consensus::Params& consensusParams, CAmount nFees, CAmount gasRefunds, CAmount nActualStakeReward, const std::vector<CTxOut>& vouts, CAmount nValueCoinPrev, bool delegateOutputExist, CChain& chain);
 
 //////////////////////////////////////////////////////// yody
@@ -460,6 +486,39 @@ bool GetSpentCoinFromBlock(const CBlockIndex* pindex, COutPoint prevout, Coin* c
 
 bool GetSpentCoinFromMainChain(const CBlockIndex* pforkPrev, COutPoint prevoutStake, Coin* coin, CChain& chain);
 
+/**
+ * Coins spent by the last blocks of the active chain, up to the coinbase maturity, so that
+ * GetSpentCoinFromMainChain finds the stake of a fork header without reading the blocks and their undo
+ * data from disk. The blocks are added when they are connected and removed when they are disconnected,
+ * the window starts again from a connected block which does not extend its tip.
+ */
+class SpentCoinWindow
+{
+public:
+    /** Add the coins spent by the block connected at pindex, and drop the blocks out of the maturity window */
+    void BlockConnected(const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex);
+
+    /** Remove the coins spent by the block disconnected at pindex */
+    void BlockDisconnected(const CBlockIndex* pindex);
+
+    /**
+     * Look up the coin spent by prevout in the blocks after nForkHeight when the tip of the window is pindexTip.
+     * nStartHeight is set to the height of the first block of the window, the blocks below it are not covered.
+     */
+    bool Find(const CBlockIndex* pindexTip, int nForkHeight, const COutPoint& prevout, Coin* coin, int& nStartHeight) const;
+
+    void Clear();
+
+private:
+    mutable Mutex m_mutex;
+    //! Outpoints spent by each block of the window, from the oldest one
+    std::deque<std::pair<const CBlockIndex*, std::vector<COutPoint>>> m_blocks GUARDED_BY(m_mutex);
+    //! Height of the block spending the outpoint and the spent coin
+    std::unordered_map<COutPoint, std::pair<int, Coin>, SaltedOutpointHasher> m_spent GUARDED_BY(m_mutex);
+};
+
+extern SpentCoinWindow g_spent_coin_window;
+
 unsigned int GetContractScriptFlags(int nHeight, const Consensus::Params& consensusparams);
 
 std::vector<ResultExecute> CallContract(const dev::Address& addrContract, std::vector<unsigned char> opcode, CChainState& chainstate, const dev::Address& sender = dev::Address(), uint64_t gasLimit=0, CAmount nAmount=0);
@@ -546,19 +605,37 @@ class ByteCodeExec {
 
 public:
 
-    ByteCodeExec(const CBlock& _block, std::vector<YodyTransaction> _txs, const uint64_t _blockGasLimit, CBlockIndex* _pindex, CChain& _chain) : txs(_txs), block(_block), blockGasLimit(_blockGasLimit), pindex(_pindex), chain(_chain) {}
+    ByteCodeExec(const CBlock& _block, std::vector<YodyTransaction> _txs, const uint64_t _blockGasLimit, CBlockIndex* _pindex, CChain& _chain, const LastHashes* _pLastHashes = nullptr) : txs(_txs), block(_block), blockGasLimit(_blockGasLimit), pindex(_pindex), pLastHashes(_pLastHashes), chain(_chain) {}
 
     bool performByteCode(dev::eth::Permanence type = dev::eth::Permanence::Committed);
 
+    /**
+     * Take the results of the transactions from the execution memo when the transaction at nPosition
+     * of the block was executed from the same state and environment, else execute them. With fRecord
+     * the results are added to the memo instead.
+     */
+    void UseMemo(const uint256& hashTx, uint32_t nPosition, bool fRecord);
+
+    /** Commit the execution of the transaction at nPosition of the block made by parallel when it can be used */
+    void UseParallel(ParallelContractExec* parallel, uint32_t nPosition){ pParallel = parallel; parallelPosition = nPosition; }
+
     bool processingResults(ByteCodeExecResult& result);
 
     std::vector<ResultExecute>& getResult(){ return result; }
 
+    static dev::eth::EnvInfo BuildEVMEnvironment(const CBlock& block, const CBlockIndex* pindex, const uint64_t blockGasLimit, const LastHashes& lastHashes, const dev::eth::SealEngineFace& sealEngine);
+
+    static dev::Address EthAddrFromScript(const CScript& scriptIn);
+
 private:
 
     dev::eth::EnvInfo BuildEVMEnvironment();
 
-    dev::Address EthAddrFromScript(const CScript& scriptIn);
+    uint256 MemoKey() const;
+
+    bool ApplyMemo(const uint256& key);
+
+    void RecordMemo(const uint256& key, const dev::h256& oldHashStateRoot, size_t nStateKilled, size_t nUTXOKilled, size_t nStateWritten, size_t nUTXOWritten);
 
     std::vector<YodyTransaction> txs;
 
@@ -572,7 +649,227 @@ private:
 
     LastHashes lastHashes;
 
+    const LastHashes* pLastHashes;
+
     CChain& chain;
+
+    uint256 memoHashTx;
+
+    int64_t memoPosition = -1;
+
+    bool fMemoRecord = false;
+
+    ParallelContractExec* pParallel = nullptr;
+
+    uint32_t parallelPosition = 0;
+};
+
+/** Maximum number of contract transactions kept in the execution memo */
+static const size_t MAX_CONTRACT_EXEC_MEMO = 5000;
+
+/**
+ * Results and state changes of the contract transactions executed to assemble a block, so they are
+ * not executed again when the block is tested and connected. The entries are keyed by the state and
+ * UTXO roots the transaction was executed from, the environment of the block, the transaction and its
+ * position, and are dropped when a block is assembled on another tip.
+ */
+class ContractExecutionMemo
+{
+public:
+    struct Entry {
+        std::vector<ResultExecute> results;
+        dev::h256 hashStateRoot;
+        dev::h256 hashUTXORoot;
+        //! Commits of the state snapshot, when it was in sync
+        bool fSnapshot{false};
+        std::vector<StateSnapshot::Layer> snapshotLayers;
+        //! Nodes killed in the state databases, journaled when they are pruned
+        dev::h256s stateKilled;
+        dev::h256s utxoKilled;
+        //! Nodes referenced in the state databases, the references of the recorded execution are released
+        dev::h256s stateWritten;
+        dev::h256s utxoWritten;
+    };
+
+    void Add(const uint256& hashPrevBlock, const uint256& key, std::shared_ptr<const Entry> entry);
+
+    std::shared_ptr<const Entry> Find(const uint256& key) const;
+
+    /** Whether there are entries for blocks assembled on hashPrevBlock */
+    bool HasParent(const uint256& hashPrevBlock) const;
+
+    void Clear();
+
+private:
+    mutable Mutex m_mutex;
+    uint256 m_hash_prev_block GUARDED_BY(m_mutex);
+    std::map<uint256, std::shared_ptr<const Entry>> m_entries GUARDED_BY(m_mutex);
+};
+
+extern ContractExecutionMemo g_contract_exec_memo;
+
+/**
+ * Optimistic parallel execution of the contract transactions of a block. Before the transactions are
+ * connected, each one is executed by a CContractExecCheck on its own copy of the state before the block,
+ * recording the accounts and UTXOs it reads or writes. The transactions are then committed in block order
+ * on globalState: the changes of an execution are committed as they are when the accounts it accessed
+ * are the same as before the block, else the transaction is executed again on globalState, so the roots
+ * are the same as the ones of the serial execution. Only the accounts committed by the transactions before
+ * it in the block are compared, most of them are the sender and the author which are deleted again.
+ */
+class ParallelContractExec
+{
+public:
+    struct Speculation {
+        uint32_t nIn{0};
+        YodyTransaction tx;
+        std::unique_ptr<YodyState> state;
+        std::unique_ptr<dev::eth::SealEngineFace> sealEngine;
+        SpeculativeExecution spec;
+        bool fExecuted{false};
+    };
+
+    ParallelContractExec();
+    ~ParallelContractExec();
+
+    /**
+     * Return the contract transactions of the block which can be executed in parallel, with their
+     * position: the transactions with a single contract output of the default VM version.
+     */
+    static std::vector<std::pair<uint32_t, YodyTransaction>> Candidates(const CBlock& block, CChainState& chainstate, const CTxMemPool* mempool, CCoinsViewCache& view, unsigned int contractflags);
+
+    /** Execute the candidates on copies of globalState, on the contract execution threads when running */
+    void Execute(const CBlock& block, const CBlockIndex* pindexPrev, uint64_t blockGasLimit, std::vector<std::pair<uint32_t, YodyTransaction>>&& candidates);
+
+    /**
+     * Return the execution of tx at position nIn of the block when it can be committed on globalState,
+     * else nullptr.
+     */
+    SpeculativeExecution* Take(uint32_t nIn, const YodyTransaction& tx);
+
+    size_t Committed() const { return nCommitted; }
+    size_t Conflicts() const { return nConflicts; }
+
+private:
+    std::vector<Speculation> speculations;
+    //! State before the block, to compare the accounts committed since
+    std::unique_ptr<YodyState> preState;
+    LastHashes lastHashes;
+    std::unique_ptr<dev::eth::EnvInfo> envInfo;
+    size_t nCommitted{0};
+    size_t nConflicts{0};
+};
+
+/** Closure executing a contract transaction of ParallelContractExec */
+class CContractExecCheck
+{
+private:
+    ParallelContractExec::Speculation* speculation;
+    const dev::eth::EnvInfo* envInfo;
+    int nHeight;
+
+public:
+    CContractExecCheck(): speculation(nullptr), envInfo(nullptr), nHeight(0) {}
+    CContractExecCheck(ParallelContractExec::Speculation& speculationIn, const dev::eth::EnvInfo& envInfoIn, int nHeightIn) :
+        speculation(&speculationIn), envInfo(&envInfoIn), nHeight(nHeightIn) {}
+
+    bool operator()();
+
+    void swap(CContractExecCheck& check) {
+        std::swap(speculation, check.speculation);
+        std::swap(envInfo, check.envInfo);
+        std::swap(nHeight, check.nHeight);
+    }
+};
+
+/** Execution context for read-only contract calls, built once per chain tip */
+struct CallContractContext
+{
+    uint256 hashTip;
+    const CBlockIndex* pindex = nullptr;
+    CBlock block; //!< tip block with vtx trimmed to the coinbase (and coinstake)
+    LastHashes lastHashes;
+};
+
+/**
+ * Keeps the CallContractContext of the active chain tip so that callcontract
+ * and the other read-only contract calls do not read the tip block from disk.
+ * The context is refreshed from BlockConnected and rebuilt on demand when the
+ * notification has not been processed yet.
+ */
+class CallContractCache final : public CValidationInterface
+{
+public:
+    /** Return the context for the active tip, rebuilding it from disk when missing */
+    std::shared_ptr<const CallContractContext> GetContext(CChainState& chainstate) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    /** Return the block gas limit for the block after the active tip */
+    uint64_t GetBlockGasLimit(CChainState& chainstate) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    void Clear();
+
+    /** Build the context for calls executed on top of the given block */
+    static std::shared_ptr<const CallContractContext> BuildContext(const CBlock& block, const CBlockIndex* pindex);
+
+protected:
+    void BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex) override;
+
+private:
+    Mutex m_mutex;
+    std::shared_ptr<const CallContractContext> m_context GUARDED_BY(m_mutex);
+
+    //! The gas limit depends on the DGP contract storage, so it is keyed by the state root as well
+    uint256 m_gas_limit_tip GUARDED_BY(m_mutex);
+    dev::h256 m_gas_limit_root GUARDED_BY(m_mutex);
+    bool m_gas_limit_dgpevm GUARDED_BY(m_mutex){false};
+    uint64_t m_gas_limit GUARDED_BY(m_mutex){0};
+};
+
+extern CallContractCache g_call_contract_cache;
+
+/**
+ * Read-only contract call engine pinned to the contract state of the active tip.
+ * The snapshot is taken under cs_main, Call() then executes on a private YodyState
+ * and seal engine, so independent snapshots can run concurrently on any thread
+ * without cs_main while blocks are connected on globalState.
+ */
+class CallContractSnapshot
+{
+public:
+    explicit CallContractSnapshot(CChainState& chainstate) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    /**
+     * Snapshot of the state at the given roots instead of the tip, to call contracts as of a past block.
+     * The context of that block and the block gas limit of the DGP at its state are given by the caller.
+     */
+    CallContractSnapshot(std::shared_ptr<const CallContractContext> _context, uint64_t _blockGasLimit, const dev::h256& hashStateRoot, const dev::h256& hashUTXORoot) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    std::vector<ResultExecute> Call(const dev::Address& addrContract, std::vector<unsigned char> opcode, const dev::Address& sender = dev::Address(), uint64_t gasLimit=0, CAmount nAmount=0);
+
+    /**
+     * Execute the contract outputs of a transaction with their own sender, gas and value without
+     * committing them, each output on the tip state. The accounts they read and change are added
+     * to pRead and pWritten when given.
+     */
+    std::vector<ResultExecute> Execute(const std::vector<YodyTransaction>& txs, std::set<dev::Address>* pRead = nullptr, std::set<dev::Address>* pWritten = nullptr);
+
+    bool AddressInUse(const dev::Address& address) const { return state->addressInUse(address); }
+
+    /** Hash of the state of an account on the tip, to tell whether a later tip changed it */
+    dev::h256 AccountHash(const dev::Address& address) const { return state->accountHash(address); }
+
+    /** Hash of the vin of an account on the tip, the UTXO holding its balance */
+    dev::h256 VinHash(const dev::Address& address) const { return state->vinHash(address); }
+
+    int Height() const { return context->pindex->nHeight; }
+
+    const uint256& TipHash() const { return context->hashTip; }
+
+private:
+    std::shared_ptr<const CallContractContext> context;
+    const uint64_t blockGasLimit;
+    std::unique_ptr<YodyState> state;
+    std::unique_ptr<dev::eth::SealEngineFace> sealEngine;
 };
 
 enum DisconnectResult
@@ -822,9 +1119,14 @@ public:
     //! CChainState instances.
     BlockManager& m_blockman;
 
+    //! The chainstate manager that owns this chainstate, to tell whether it is
+    //! the active one. Only the active chainstate writes the yody indexes.
+    ChainstateManager& m_chainman;
+
     explicit CChainState(
         CTxMemPool* mempool,
         BlockManager& blockman,
+        ChainstateManager& chainman,
         std::optional<uint256> from_snapshot_blockhash = std::nullopt);
 
     /**
@@ -597,6 +597,92 @@ BOOST_FIXTURE_TEST_CASE(ListCoins, ListCoinsTestingSetup)
     BOOST_CHECK_EQUAL(list.begin()->second.size(), 2U);
 }
 
+BOOST_FIXTURE_TEST_CASE(stake_coins, ListCoinsTestingSetup)
+{
+    auto stake_coins = [&] {
+        LOCK(wallet->cs_wallet);
+        CAmount target_value = MAX_MONEY;
+        CAmount value = 0;
+        std::set<std::pair<const CWalletTx*, unsigned int>> coins;
+        BOOST_CHECK(wallet->SelectCoinsForStaking(target_value, coins, value));
+        std::set<COutPoint> prevouts;
+        for (const auto& coin : coins) {
+            prevouts.emplace(coin.first->GetHash(), coin.second);
+        }
+        return prevouts;
+    };
+
+    // Confirm the mature coinbase transaction is the only stake coin.
+    std::set<COutPoint> coins = stake_coins();
+    BOOST_CHECK_EQUAL(coins.size(), 1U);
+    const COutPoint coinbase = *coins.begin();
+
+    // Receive a watch-only output together with the change in the same transaction.
+    CKey watch_key;
+    watch_key.MakeNewKey(true);
+    CScript watch_script = GetScriptForRawPubKey(watch_key.GetPubKey());
+    {
+        LegacyScriptPubKeyMan* spk_man = wallet->GetLegacyScriptPubKeyMan();
+        LOCK2(wallet->cs_wallet, spk_man->cs_KeyStore);
+        BOOST_CHECK(spk_man->AddWatchOnly(watch_script, 0 /* nCreateTime */));
+    }
+    const CTransactionRef tx = AddTx(CRecipient{watch_script, 100 * COIN, false /* subtract fee */}).tx;
+    BOOST_CHECK_EQUAL(tx->vout.size(), 2U);
+
+    // The spent coinbase output is removed and the new outputs are not mature yet.
+    coins = stake_coins();
+    BOOST_CHECK(!coins.count(coinbase));
+    for (unsigned int i = 0; i < tx->vout.size(); i++) {
+        BOOST_CHECK(!coins.count(COutPoint(tx->GetHash(), i)));
+    }
+
+    // Move the wallet tip across the maturity of the transaction. The watch-only
+    // output is kept because the transaction also pays spendable credit.
+    const int height = WITH_LOCK(wallet->cs_wallet, return wallet->GetLastBlockHeight());
+    const int maturity = Params().GetConsensus().CoinbaseMaturity(height + 1);
+    const uint256 tip_hash = WITH_LOCK(::cs_main, return m_node.chainman->ActiveChain().Tip()->GetBlockHash());
+    WITH_LOCK(wallet->cs_wallet, wallet->SetLastBlockProcessed(height + maturity - 2, tip_hash));
+    coins = stake_coins();
+    for (unsigned int i = 0; i < tx->vout.size(); i++) {
+        BOOST_CHECK(!coins.count(COutPoint(tx->GetHash(), i)));
+    }
+    WITH_LOCK(wallet->cs_wallet, wallet->SetLastBlockProcessed(height + maturity - 1, tip_hash));
+    coins = stake_coins();
+    for (unsigned int i = 0; i < tx->vout.size(); i++) {
+        BOOST_CHECK(coins.count(COutPoint(tx->GetHash(), i)));
+    }
+
+    // Disconnect the block of the transaction, the set is rebuilt without its outputs.
+    CBlock block;
+    {
+        LOCK(::cs_main);
+        BOOST_CHECK(ReadBlockFromDisk(block, m_node.chainman->ActiveChain().Tip(), Params().GetConsensus()));
+    }
+    wallet->blockDisconnected(block, height);
+    wallet->transactionRemovedFromMempool(tx, MemPoolRemovalReason::BLOCK, 0 /* mempool_sequence */);
+    coins = stake_coins();
+    BOOST_CHECK(!coins.count(coinbase));
+    for (unsigned int i = 0; i < tx->vout.size(); i++) {
+        BOOST_CHECK(!coins.count(COutPoint(tx->GetHash(), i)));
+    }
+
+    // Abandon the transaction, the coinbase output is available again.
+    BOOST_CHECK(wallet->AbandonTransaction(tx->GetHash()));
+    coins = stake_coins();
+    BOOST_CHECK(coins.count(coinbase));
+
+    // Zap the coinbase transaction, its output is removed.
+    {
+        LOCK(wallet->cs_wallet);
+        std::vector<uint256> hashes{coinbase.hash};
+        std::vector<uint256> zapped;
+        BOOST_CHECK_EQUAL(wallet->ZapSelectTx(hashes, zapped), DBErrors::LOAD_OK);
+        BOOST_CHECK_EQUAL(zapped.size(), 1U);
+    }
+    coins = stake_coins();
+    BOOST_CHECK(!coins.count(coinbase));
+}
+
 BOOST_FIXTURE_TEST_CASE(wallet_disableprivkeys, TestChain100Setup)
 {
     std::shared_ptr<CWallet> wallet = std::make_shared<CWallet>(m_node.chain.get(), "", CreateDummyWalletDatabase());
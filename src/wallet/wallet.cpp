@@ -816,6 +816,7 @@ void CWallet::MarkDirty()
         LOCK(cs_wallet);
         for (std::pair<const uint256, CWalletTx>& item : mapWallet)
             item.second.MarkDirty();
+        m_stake_coins_rebuild = true;
     }
 }
 
@@ -1009,6 +1010,7 @@ CWalletTx* CWallet::AddToWallet(CTransactionRef tx, const CWalletTx::Confirmatio
 
     // Break debit/credit balance caches:
     wtx.MarkDirty();
+    MarkStakeCoinsDirty(hash);
 
     // Notify UI of new or updated transaction
     NotifyTransactionChanged(hash, fInsertedNew ? CT_NEW : CT_UPDATED);
@@ -1186,6 +1188,7 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
             assert(!wtx.InMempool());
             wtx.setAbandoned();
             wtx.MarkDirty();
+            MarkStakeCoinsDirty(now);
             batch.WriteTx(wtx);
             NotifyTransactionChanged(wtx.GetHash(), CT_UPDATED);
             // Iterate over all its outputs, and mark transactions in the wallet that spend them abandoned too
@@ -1241,6 +1244,7 @@ void CWallet::MarkConflicted(const uint256& hashBlock, int conflicting_height, c
             wtx.m_confirm.block_height = conflicting_height;
             wtx.setConflicted();
             wtx.MarkDirty();
+            MarkStakeCoinsDirty(now);
             batch.WriteTx(wtx);
             // Iterate over all its outputs, and mark transactions in the wallet that spend them conflicted too
             TxSpends::const_iterator iter = mapTxSpends.lower_bound(COutPoint(now, 0));
@@ -1350,6 +1354,7 @@ void CWallet::blockDisconnected(const CBlock& block, int height)
     // future with a stickier abandoned state or even removing abandontransaction call.
     m_last_block_processed_height = height - 1;
     m_last_block_processed = block.hashPrevBlock;
+    m_stake_coins_rebuild = true;
     for (const CTransactionRef& ptx : block.vtx) {
         int index = ptx->IsCoinStake() ? -1 : 0;
         SyncTransaction(ptx, {CWalletTx::Status::UNCONFIRMED, /* block height */ 0, /* block hash */ {}, index, /* hasDelegation */ false});
@@ -2752,6 +2757,7 @@ DBErrors CWallet::ZapSelectTx(std::vector<uint256>& vHashIn, std::vector<uint256
         for (const auto& txin : it->second.tx->vin)
             mapTxSpends.erase(txin.prevout);
         mapWallet.erase(it);
+        MarkStakeCoinsDirty(hash);
         NotifyTransactionChanged(hash, CT_DELETED);
     }
 
@@ -4811,7 +4817,16 @@ void CWallet::updateHaveCoinSuperStaker(const std::set<std::pair<const CWalletTx
 void CWallet::UpdateMinerStakeCache(bool fStakeCache, const std::vector<COutPoint> &prevouts, CBlockIndex *pindexPrev )
 {
     if(minerStakeCache.size() > prevouts.size() + 100){
-        minerStakeCache.clear();
+        // Drop the coins that are no longer staked, the others stay cached
+        std::vector<COutPoint> sortedPrevouts(prevouts);
+        std::sort(sortedPrevouts.begin(), sortedPrevouts.end());
+        for(auto it = minerStakeCache.begin(); it != minerStakeCache.end();)
+        {
+            if(std::binary_search(sortedPrevouts.begin(), sortedPrevouts.end(), it->first))
+                ++it;
+            else
+                it = minerStakeCache.erase(it);
+        }
     }
 
     if(fStakeCache)
@@ -4845,108 +4860,134 @@ void CWallet::CleanCoinStake()
     }
 }
 
-void CWallet::AvailableCoinsForStaking(const std::vector<uint256>& maturedTx, size_t from, size_t to, const std::map<COutPoint, uint32_t>& immatureStakes, std::vector<std::pair<const CWalletTx *, unsigned int> >& vCoins, std::map<COutPoint, CScriptCache>* insertScriptCache) const
+void CWallet::MarkStakeCoinsDirty(const uint256& hash)
 {
-    for(size_t i = from; i < to; i++)
+    AssertLockHeld(cs_wallet);
+    if(!m_stake_coins_rebuild)
+        m_stake_dirty_txs.insert(hash);
+}
+
+void CWallet::UpdateStakeCoins(const uint256& hash, int nHeight, int coinbaseMaturity) const
+{
+    AssertLockHeld(cs_wallet);
+
+    // Remove the outputs of the transaction, they are added back if still available
+    auto itCoin = m_stake_coins.lower_bound(COutPoint(hash, 0));
+    while(itCoin != m_stake_coins.end() && itCoin->first.hash == hash)
+        itCoin = m_stake_coins.erase(itCoin);
+
+    std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(hash);
+    if(it == mapWallet.end())
+        return;
+    const CWalletTx* pcoin = &(*it).second;
+
+    int nDepth = pcoin->GetDepthInMainChain();
+    if (nDepth < 1)
+        return;
+
+    // Queue the transaction until the tip height at which it becomes mature
+    int nMatureDepth = (pcoin->IsCoinBase() || pcoin->IsCoinStake()) ? coinbaseMaturity + 1 : coinbaseMaturity;
+    if (nDepth < nMatureDepth)
     {
-        std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(maturedTx[i]);
-        if(it == mapWallet.end()) continue;
-        const uint256& wtxid = it->first;
-        const CWalletTx* pcoin = &(*it).second;
-        for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
-            isminetype mine = IsMine(pcoin->tx->vout[i]);
-            if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
-                !IsLockedCoin((*it).first, i) && (pcoin->tx->vout[i].nValue > 0) &&
-                // Check if the staking coin is dust
-                pcoin->tx->vout[i].nValue >= m_staker_min_utxo_size)
-            {
-                // Get the script data for the coin
-                COutPoint prevout = COutPoint(pcoin->GetHash(), i);
-                const CScriptCache& scriptCache = GetScriptCache(prevout, pcoin->tx->vout[i].scriptPubKey, insertScriptCache);
+        m_stake_maturity_queue[nHeight - 1 + nMatureDepth - nDepth].push_back(hash);
+        return;
+    }
 
-                // Check that the script is not a contract script
-                if(scriptCache.contract || !scriptCache.keyIdOk)
-                    continue;
+    for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
+        const CTxOut& txout = pcoin->tx->vout[i];
+        isminetype mine = IsMine(txout);
+        if (mine == ISMINE_NO || txout.nValue <= 0)
+            continue;
 
-                // Check that the address is not delegated to other staker
-                if(m_my_delegations.find(scriptCache.keyId) != m_my_delegations.end())
-                    continue;
+        // Get the script data for the coin
+        COutPoint prevout = COutPoint(hash, i);
+        const CScriptCache& scriptCache = GetScriptCache(prevout, txout.scriptPubKey);
 
-                // Check prevout maturity
-                if(immatureStakes.find(prevout) == immatureStakes.end())
-                {
-                    // Check if script is spendable
-                    bool spendable = ((mine & ISMINE_SPENDABLE) != ISMINE_NO) || (((mine & ISMINE_WATCH_ONLY) != ISMINE_NO) && scriptCache.solvable);
-                    if(spendable)
-                        vCoins.push_back(std::make_pair(pcoin, i));
-                }
-            }
+        // Check that the script is not a contract script
+        if(scriptCache.contract || !scriptCache.keyIdOk)
+            continue;
+
+        // Check if script is spendable
+        bool spendable = ((mine & ISMINE_SPENDABLE) != ISMINE_NO) || (((mine & ISMINE_WATCH_ONLY) != ISMINE_NO) && scriptCache.solvable);
+        if(!spendable)
+            continue;
+
+        CStakeCoin& coin = m_stake_coins[prevout];
+        coin.wtx = pcoin;
+        coin.keyId = scriptCache.keyId;
+        coin.mine = mine;
+    }
+}
+
+void CWallet::UpdateStakeCoins() const
+{
+    AssertLockHeld(cs_wallet);
+
+    int nHeight = GetLastBlockHeight() + 1;
+    int coinbaseMaturity = Params().GetConsensus().CoinbaseMaturity(nHeight);
+    if(m_stake_coins_rebuild || coinbaseMaturity != m_stake_coins_maturity)
+    {
+        // Scan the whole wallet, needed at start and when the chain is rewound
+        m_stake_coins.clear();
+        m_stake_dirty_txs.clear();
+        m_stake_maturity_queue.clear();
+        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        {
+            UpdateStakeCoins(it->first, nHeight, coinbaseMaturity);
         }
+        m_stake_coins_maturity = coinbaseMaturity;
+        m_stake_coins_rebuild = false;
+        return;
     }
+
+    // Transactions that reached maturity since the previous round
+    while(!m_stake_maturity_queue.empty() && m_stake_maturity_queue.begin()->first < nHeight)
+    {
+        auto itQueue = m_stake_maturity_queue.begin();
+        m_stake_dirty_txs.insert(itQueue->second.begin(), itQueue->second.end());
+        m_stake_maturity_queue.erase(itQueue);
+    }
+
+    for(const uint256& hash : m_stake_dirty_txs)
+    {
+        UpdateStakeCoins(hash, nHeight, coinbaseMaturity);
+    }
+    m_stake_dirty_txs.clear();
 }
 
 bool CWallet::SelectCoinsForStaking(CAmount &nTargetValue, std::set<std::pair<const CWalletTx *, unsigned int> > &setCoinsRet, CAmount &nValueRet) const
 {
+    AssertLockHeld(cs_wallet);
     std::vector<std::pair<const CWalletTx *, unsigned int> > vCoins;
-    vCoins.clear();
 
-    int nHeight = GetLastBlockHeight() + 1;
-    int coinbaseMaturity = Params().GetConsensus().CoinbaseMaturity(nHeight);
-    std::map<COutPoint, uint32_t> immatureStakes = chain().getImmatureStakes();
-    std::vector<uint256> maturedTx;
+    UpdateStakeCoins();
     const bool include_watch_only = GetLegacyScriptPubKeyMan() && IsWalletFlagSet(WALLET_FLAG_DISABLE_PRIVATE_KEYS);
     const isminetype is_mine_filter = include_watch_only ? ISMINE_WATCH_ONLY : ISMINE_SPENDABLE;
-    for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+    std::map<COutPoint, uint32_t> immatureStakes = chain().getImmatureStakes();
+    for(const std::pair<const COutPoint, CStakeCoin>& item : m_stake_coins)
     {
-        // Check the cached data for available coins for the tx
-        const CWalletTx* pcoin = &(*it).second;
-        const CAmount tx_credit_mine{pcoin->GetAvailableCredit(/* fUseCache */ true, is_mine_filter | ISMINE_NO)};
-        if(tx_credit_mine == 0)
+        const COutPoint& prevout = item.first;
+        const CWalletTx* pcoin = item.second.wtx;
+        if (IsSpent(prevout.hash, prevout.n) || IsLockedCoin(prevout.hash, prevout.n))
             continue;
 
-        const uint256& wtxid = it->first;
-        int nDepth = pcoin->GetDepthInMainChain();
-
-        if (nDepth < 1)
+        // The outputs outside the filter are used only when the transaction has available credit for the filter
+        if (!(item.second.mine & is_mine_filter) && pcoin->GetAvailableCredit(/* fUseCache */ true, is_mine_filter) == 0)
             continue;
 
-        if (nDepth < coinbaseMaturity)
+        // Check if the staking coin is dust
+        if (pcoin->tx->vout[prevout.n].nValue < m_staker_min_utxo_size)
             continue;
 
-        if (pcoin->GetBlocksToMaturity() > 0)
+        // Check that the address is not delegated to other staker
+        if(m_my_delegations.find(item.second.keyId) != m_my_delegations.end())
             continue;
 
-        maturedTx.push_back(wtxid);
-    }
-
-    size_t listSize = maturedTx.size();
-    int numThreads = std::min(m_num_threads, (int)listSize);
-    if(numThreads < 2)
-    {
-        AvailableCoinsForStaking(maturedTx, 0, listSize, immatureStakes, vCoins, nullptr);
-    }
-    else
-    {
-        size_t chunk = listSize / numThreads;
-        for(int i = 0; i < numThreads; i++)
-        {
-            size_t from = i * chunk;
-            size_t to = i == (numThreads -1) ? listSize : from + chunk;
-            threads.create_thread([this, from, to, &maturedTx, &immatureStakes, &vCoins]{
-                std::vector<std::pair<const CWalletTx *, unsigned int> > tmpCoins;
-                std::map<COutPoint, CScriptCache> tmpInsertScriptCache;
-                AvailableCoinsForStaking(maturedTx, from, to, immatureStakes, tmpCoins, &tmpInsertScriptCache);
+        // Check prevout maturity
+        if(immatureStakes.find(prevout) != immatureStakes.end())
+            continue;
 
-                LOCK(cs_worker);
-                vCoins.insert(vCoins.end(), tmpCoins.begin(), tmpCoins.end());
-                if((int32_t)prevoutScriptCache.size() > m_staker_max_utxo_script_cache)
-                {
-                    prevoutScriptCache.clear();
-                }
-                prevoutScriptCache.insert(tmpInsertScriptCache.begin(), tmpInsertScriptCache.end());
-            });
-        }
-        threads.join_all();
+        vCoins.push_back(std::make_pair(pcoin, prevout.n));
     }
 
     setCoinsRet.clear();
@@ -5024,6 +5065,14 @@ bool CWallet::AvailableDelegateCoinsForStaking(const std::vector<uint160>& deleg
             return error("Invalid address");
         }
 
+        // Skip the delegate if its mature coins are below the minimum value in total
+        uint64_t addressWeight = 0;
+        if (!GetAddressWeight(hashBytes, type, height, addressWeight)) {
+            return error("No information available for address");
+        }
+        if (addressWeight == 0 || addressWeight < (uint64_t)staking_min_utxo_value)
+            continue;
+
         // Get address utxos
         std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
         if (!GetAddressUnspent(hashBytes, type, unspentOutputs)) {
@@ -5069,6 +5118,12 @@ bool CWallet::SelectDelegateCoinsForStaking(std::vector<COutPoint> &setDelegateC
         return error("Invalid blockchain height");
     }
 
+    // The delegate coins are read from the address index, skip them until it has caught up with the chain
+    if (!chain().isAddressIndexSynced(height)) {
+        LogPrint(BCLog::COINSTAKE, "The address index is not synced, skip the delegate coins\n");
+        return true;
+    }
+
     std::map<COutPoint, uint32_t> immatureStakes = chain().getImmatureStakes();
     std::map<uint256, CSuperStakerInfo> mapStakers = mapSuperStaker;
 
@@ -251,6 +251,12 @@ struct CScriptCache{
     bool solvable = false;
 };
 
+struct CStakeCoin{
+    const CWalletTx* wtx = nullptr;
+    uint160 keyId;
+    isminetype mine = ISMINE_NO;
+};
+
 class WalletRescanReserver; //forward declarations for ScanForWalletTransactions/RescanFromTime
 /**
  * A CWallet maintains a set of transactions and balances, and provides the ability to create new transactions.
@@ -284,6 +290,20 @@ private:
     bool fHasMinerStakeCache = false;
     mutable std::map<COutPoint, CScriptCache> prevoutScriptCache;
 
+    /**
+     * Candidate outputs for staking, kept up to date from wallet transaction updates
+     * so a staking round only has to re-check the transactions that changed since the last one.
+     * Transactions waiting for maturity are queued by the tip height at which they mature.
+     */
+    mutable std::map<COutPoint, CStakeCoin> m_stake_coins GUARDED_BY(cs_wallet);
+    mutable std::set<uint256> m_stake_dirty_txs GUARDED_BY(cs_wallet);
+    mutable std::map<int, std::vector<uint256>> m_stake_maturity_queue GUARDED_BY(cs_wallet);
+    mutable int m_stake_coins_maturity GUARDED_BY(cs_wallet){-1};
+    mutable bool m_stake_coins_rebuild GUARDED_BY(cs_wallet){true};
+    void MarkStakeCoinsDirty(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    void UpdateStakeCoins() const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    void UpdateStakeCoins(const uint256& hash, int nHeight, int coinbaseMaturity) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     /**
      * Used to keep track of spent outpoints, and
      * detect and report conflicts (double-spends or
@@ -491,7 +511,7 @@ public:
     bool CanSupportFeature(enum WalletFeature wf) const override EXCLUSIVE_LOCKS_REQUIRED(cs_wallet) { AssertLockHeld(cs_wallet); return IsFeatureSupported(nWalletVersion, wf); }
 
     //! select coins for staking from the available coins for staking.
-    bool SelectCoinsForStaking(CAmount& nTargetValue, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet) const;
+    bool SelectCoinsForStaking(CAmount& nTargetValue, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
     //! select delegated coins for staking from other users.
     bool SelectDelegateCoinsForStaking(std::vector<COutPoint>& setDelegateCoinsRet, std::map<uint160, CAmount>& mDelegateWeight) const;
@@ -502,7 +522,6 @@ public:
     /**
      * populate vCoins with vector of available COutputs.
      */
-    void AvailableCoinsForStaking(const std::vector<uint256>& maturedTx, size_t from, size_t to, const std::map<COutPoint, uint32_t>& immatureStakes, std::vector<std::pair<const CWalletTx *, unsigned int> >& vCoins, std::map<COutPoint, CScriptCache>* insertScriptCache) const;
     void AvailableCoins(std::vector<COutput>& vCoins, const CCoinControl* coinControl = nullptr, const CAmount& nMinimumAmount = 1, const CAmount& nMaximumAmount = MAX_MONEY, const CAmount& nMinimumSumAmount = MAX_MONEY, const uint64_t nMaximumCount = 0) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     bool AvailableDelegateCoinsForStaking(const std::vector<uint160>& delegations, size_t from, size_t to, int32_t height, const std::map<COutPoint, uint32_t>& immatureStakes,  const std::map<uint256, CSuperStakerInfo>& mapStakers, std::vector<std::pair<COutPoint,CAmount>>& vUnsortedDelegateCoins, std::map<uint160, CAmount> &mDelegateWeight) const;
     bool GetSuperStaker(CSuperStakerInfo &info, const uint160& stakerAddress) const;
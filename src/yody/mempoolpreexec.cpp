@@ -0,0 +1,167 @@
+#include <yody/mempoolpreexec.h>
+
+#include <chainparams.h>
+#include <logging.h>
+#include <txmempool.h>
+#include <util/convert.h>
+#include <util/thread.h>
+#include <validation.h>
+
+#include <set>
+
+std::unique_ptr<MempoolPreExecutor> g_mempool_preexec;
+
+MempoolPreExecutor::MempoolPreExecutor(ChainstateManager& chainman, CTxMemPool& mempool) :
+    m_chainman(chainman), m_mempool(mempool) {}
+
+MempoolPreExecutor::~MempoolPreExecutor()
+{
+    Stop();
+}
+
+void MempoolPreExecutor::Start()
+{
+    RegisterValidationInterface(this);
+    m_thread = std::thread(&util::TraceThread, "preexec", [this] { ThreadPreExecute(); });
+}
+
+void MempoolPreExecutor::Stop()
+{
+    if (!m_thread.joinable())
+        return;
+    UnregisterValidationInterface(this);
+    {
+        LOCK(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    m_thread.join();
+}
+
+void MempoolPreExecutor::TransactionAddedToMempool(const CTransactionRef& tx, uint64_t mempool_sequence)
+{
+    if (!tx->HasCreateOrCall())
+        return;
+    {
+        LOCK(m_mutex);
+        m_queue.push_back(tx->GetHash());
+    }
+    m_cond.notify_one();
+}
+
+void MempoolPreExecutor::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload)
+{
+    if (fInitialDownload)
+        return;
+    {
+        LOCK(m_mutex);
+        m_revalidate = true;
+    }
+    m_cond.notify_one();
+}
+
+void MempoolPreExecutor::ThreadPreExecute()
+{
+    while (true) {
+        std::vector<uint256> txids;
+        bool fRevalidate = false;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || m_revalidate || !m_queue.empty(); });
+            if (m_stop)
+                return;
+            txids.assign(m_queue.begin(), m_queue.end());
+            m_queue.clear();
+            std::swap(fRevalidate, m_revalidate);
+        }
+
+        std::unique_ptr<CallContractSnapshot> snapshot = WITH_LOCK(cs_main, return std::make_unique<CallContractSnapshot>(m_chainman.ActiveChainstate()));
+        if (fRevalidate)
+            Revalidate(*snapshot, txids);
+        for (const uint256& txid : txids) {
+            if (WITH_LOCK(m_mutex, return m_stop))
+                return;
+            PreExecute(*snapshot, txid);
+        }
+    }
+}
+
+void MempoolPreExecutor::PreExecute(CallContractSnapshot& snapshot, const uint256& txid)
+{
+    std::vector<YodyTransaction> txs;
+    {
+        LOCK2(cs_main, m_mempool.cs);
+        std::optional<CTxMemPool::txiter> it = m_mempool.GetIter(txid);
+        if (!it)
+            return;
+        std::shared_ptr<const ContractPreExecution> pre = (*it)->GetPreExecution();
+        if (pre && pre->hashTip == snapshot.TipHash())
+            return;
+        unsigned int contractflags = GetContractScriptFlags(snapshot.Height() + 1, Params().GetConsensus());
+        YodyTxConverter convert((*it)->GetTx(), m_chainman.ActiveChainstate(), &m_mempool, NULL, NULL, contractflags);
+        ExtractYodyTX resultConverter;
+        if (!convert.extractionYodyTransactions(resultConverter))
+            return;
+        txs = resultConverter.first;
+    }
+
+    std::set<dev::Address> read, written;
+    std::vector<ResultExecute> result;
+    try {
+        result = snapshot.Execute(txs, &read, &written);
+    } catch (const std::exception& e) {
+        LogPrint(BCLog::MEMPOOL, "%s: execution of %s failed: %s\n", __func__, txid.ToString(), e.what());
+        return;
+    }
+
+    auto pre = std::make_shared<ContractPreExecution>();
+    pre->hashTip = snapshot.TipHash();
+    for (const ResultExecute& res : result) {
+        pre->vGasUsed.push_back(uint64_t(res.execRes.gasUsed));
+        pre->fFailed |= res.execRes.excepted != dev::eth::TransactionException::None;
+    }
+    for (const dev::Address& address : read)
+        pre->vRead.emplace_back(h160Touint(address), h256Touint(snapshot.AccountHash(address)), h256Touint(snapshot.VinHash(address)));
+    for (const dev::Address& address : written)
+        pre->vWritten.push_back(h160Touint(address));
+
+    LOCK(m_mempool.cs);
+    if (std::optional<CTxMemPool::txiter> it = m_mempool.GetIter(txid))
+        (*it)->SetPreExecution(std::move(pre));
+}
+
+void MempoolPreExecutor::Revalidate(CallContractSnapshot& snapshot, std::vector<uint256>& txids)
+{
+    std::vector<std::pair<uint256, std::shared_ptr<const ContractPreExecution>>> entries;
+    {
+        LOCK(m_mempool.cs);
+        for (const CTxMemPoolEntry& entry : m_mempool.mapTx) {
+            std::shared_ptr<const ContractPreExecution> pre = entry.GetPreExecution();
+            if (pre && pre->hashTip != snapshot.TipHash())
+                entries.emplace_back(entry.GetTx().GetHash(), std::move(pre));
+        }
+    }
+
+    size_t nConflicts = 0;
+    for (const auto& [txid, pre] : entries) {
+        bool fConflict = false;
+        for (const auto& [address, hashState, hashVin] : pre->vRead) {
+            if (h256Touint(snapshot.AccountHash(uintToh160(address))) != hashState ||
+                h256Touint(snapshot.VinHash(uintToh160(address))) != hashVin) {
+                fConflict = true;
+                break;
+            }
+        }
+        if (fConflict) {
+            txids.push_back(txid);
+            nConflicts++;
+            continue;
+        }
+        auto moved = std::make_shared<ContractPreExecution>(*pre);
+        moved->hashTip = snapshot.TipHash();
+        LOCK(m_mempool.cs);
+        if (std::optional<CTxMemPool::txiter> it = m_mempool.GetIter(txid))
+            (*it)->SetPreExecution(std::move(moved));
+    }
+    LogPrint(BCLog::MEMPOOL, "%s: %u of %u pre-executed transactions conflict with tip %s\n", __func__, nConflicts, entries.size(), snapshot.TipHash().ToString());
+}
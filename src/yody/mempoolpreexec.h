@@ -0,0 +1,66 @@
+#ifndef YODY_MEMPOOLPREEXEC_H
+#define YODY_MEMPOOLPREEXEC_H
+
+#include <sync.h>
+#include <uint256.h>
+#include <validationinterface.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+class CallContractSnapshot;
+class ChainstateManager;
+class CTxMemPool;
+
+static const bool DEFAULT_MEMPOOL_PREEXEC = false;
+
+/**
+ * Executes the contract transactions accepted to the mempool on a snapshot of the tip state in a
+ * worker thread, and records the gas they use, the accounts they read and change and whether they
+ * fail as the ContractPreExecution of their mempool entry. When the tip changes, only the entries
+ * which read an account changed by the new blocks are executed again, the others are moved to the
+ * new tip. The results are hints for block assembly: the block environment (number, time, author)
+ * is the one of the next block at the time of the execution.
+ */
+class MempoolPreExecutor final : public CValidationInterface
+{
+public:
+    MempoolPreExecutor(ChainstateManager& chainman, CTxMemPool& mempool);
+    ~MempoolPreExecutor();
+
+    /** Register for the notifications and start the worker thread */
+    void Start();
+
+    /** Unregister and join the worker thread */
+    void Stop();
+
+protected:
+    void TransactionAddedToMempool(const CTransactionRef& tx, uint64_t mempool_sequence) override;
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override;
+
+private:
+    void ThreadPreExecute();
+
+    /** Execute a mempool transaction on the snapshot and record the result on its entry */
+    void PreExecute(CallContractSnapshot& snapshot, const uint256& txid);
+
+    /** Move the results which are still valid to the tip of the snapshot, and add the others to txids */
+    void Revalidate(CallContractSnapshot& snapshot, std::vector<uint256>& txids);
+
+    ChainstateManager& m_chainman;
+    CTxMemPool& m_mempool;
+
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<uint256> m_queue GUARDED_BY(m_mutex);
+    bool m_revalidate GUARDED_BY(m_mutex){false};
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::thread m_thread;
+};
+
+extern std::unique_ptr<MempoolPreExecutor> g_mempool_preexec;
+
+#endif // YODY_MEMPOOLPREEXEC_H
@@ -0,0 +1,236 @@
+#include <yody/statedump.h>
+
+#include <libdevcore/RLP.h>
+#include <libdevcore/SHA3.h>
+#include <libdevcore/TrieCommon.h>
+#include <shutdown.h>
+#include <streams.h>
+#include <util/convert.h>
+#include <util/system.h>
+
+#include <ios>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+/** Kinds of the entries of a contract state snapshot */
+enum StateEntryType : uint8_t {
+    STATE_ENTRY_NODE = 0,     //!< Trie node or code, in the main part of the database
+    STATE_ENTRY_PREIMAGE = 1, //!< Preimage of a key of a secure trie, in the aux part of the database
+};
+
+/** Serialized size of an entry of a contract state snapshot, with its type and key */
+size_t StateEntrySize(const std::string& value)
+{
+    return 1 + 32 + GetSizeOfCompactSize(value.size()) + value.size();
+}
+
+/** Visits once the trie nodes, the preimages of the keys and the code of the accounts reachable from a root */
+class StateWalker
+{
+public:
+    using Visitor = std::function<bool(uint8_t type, const dev::h256& key, const std::string& value)>;
+
+    StateWalker(const dev::OverlayDB& db, Visitor visitor) :
+        m_db(db), m_visitor(std::move(visitor)) {}
+
+    bool Walk(const dev::h256& root, bool fAccounts)
+    {
+        dev::bytes path;
+        return WalkNode(root, path, fAccounts);
+    }
+
+private:
+    bool WalkNode(const dev::h256& hash, dev::bytes& path, bool fAccounts)
+    {
+        if (hash == dev::EmptyTrie || !m_visited.insert(hash).second)
+            return true;
+
+        const std::string node = m_db.lookup(hash);
+        if (node.empty())
+            return error("%s: missing trie node %s", __func__, hash.hex());
+        if (!m_visitor(STATE_ENTRY_NODE, hash, node) || ShutdownRequested())
+            return false;
+        return WalkItems(dev::RLP(node), path, fAccounts);
+    }
+
+    bool WalkItems(const dev::RLP& node, dev::bytes& path, bool fAccounts)
+    {
+        if (node.isList() && node.itemCount() == 17) {
+            for (unsigned i = 0; i < 16; i++) {
+                path.push_back(i);
+                bool ret = WalkChild(node[i], path, fAccounts);
+                path.pop_back();
+                if (!ret)
+                    return false;
+            }
+        } else if (node.isList() && node.itemCount() == 2) {
+            const dev::NibbleSlice key = dev::keyOf(node);
+            for (unsigned i = 0; i < key.size(); i++)
+                path.push_back(key[i]);
+            bool ret = dev::isLeaf(node) ? WalkValue(node[1].payload(), path, fAccounts) : WalkChild(node[1], path, fAccounts);
+            path.resize(path.size() - key.size());
+            return ret;
+        }
+        return true;
+    }
+
+    bool WalkChild(const dev::RLP& item, dev::bytes& path, bool fAccounts)
+    {
+        // Nodes shorter than a hash are inlined in their parent
+        if (item.isList())
+            return WalkItems(item, path, fAccounts);
+        if (item.isData() && item.size() == 32)
+            return WalkNode(item.toHash<dev::h256>(), path, fAccounts);
+        return true;
+    }
+
+    bool WalkValue(dev::bytesConstRef value, const dev::bytes& path, bool fAccounts)
+    {
+        // The keys of the secure tries are hashes, their preimages are kept to list the keys
+        if (path.size() == 64) {
+            dev::h256 key;
+            for (unsigned i = 0; i < 32; i++)
+                key[i] = (path[i * 2] << 4) | path[i * 2 + 1];
+            const dev::bytes preimage = m_db.lookupAux(key);
+            if (!preimage.empty() && m_visited.insert(key).second &&
+                !m_visitor(STATE_ENTRY_PREIMAGE, key, std::string(preimage.begin(), preimage.end())))
+                return false;
+        }
+        if (!fAccounts)
+            return true;
+
+        const dev::RLP account(value);
+        const dev::h256 codeHash = account[3].toHash<dev::h256>();
+        if (codeHash != dev::EmptySHA3 && m_visited.insert(codeHash).second) {
+            const std::string code = m_db.lookup(codeHash);
+            if (code.empty())
+                return error("%s: missing code %s", __func__, codeHash.hex());
+            if (!m_visitor(STATE_ENTRY_NODE, codeHash, code))
+                return false;
+        }
+        const dev::h256 storageRoot = account[2].toHash<dev::h256>();
+        dev::bytes storagePath;
+        return WalkNode(storageRoot, storagePath, false);
+    }
+
+    const dev::OverlayDB& m_db;
+    Visitor m_visitor;
+    std::unordered_set<dev::h256> m_visited;
+};
+
+bool DumpStateDB(CAutoFile& file, const dev::OverlayDB& db, const dev::h256& root, bool fAccounts,
+                 const std::function<void()>& interruption_point, YodyStateDumpStats& stats)
+{
+    std::vector<std::tuple<uint8_t, dev::h256, std::string>> chunk;
+    size_t chunkBytes = 0;
+    auto writeChunk = [&] {
+        file << static_cast<uint32_t>(chunk.size());
+        for (const auto& [type, key, value] : chunk)
+            file << type << h256Touint(key) << value;
+        chunk.clear();
+        chunkBytes = 0;
+        interruption_point();
+    };
+
+    StateWalker walker(db, [&](uint8_t type, const dev::h256& key, const std::string& value) {
+        (type == STATE_ENTRY_NODE ? stats.nodes : stats.preimages)++;
+        stats.bytes += value.size();
+        const size_t entryBytes = StateEntrySize(value);
+        if (!chunk.empty() && chunkBytes + entryBytes > STATE_SNAPSHOT_CHUNK_BYTES)
+            writeChunk();
+        chunk.emplace_back(type, key, value);
+        chunkBytes += entryBytes;
+        return true;
+    });
+    if (!walker.Walk(root, fAccounts))
+        return false;
+    if (!chunk.empty())
+        writeChunk();
+    file << uint32_t{0};
+    return true;
+}
+
+bool LoadStateDB(CAutoFile& file, dev::OverlayDB& db, const dev::h256& root, bool fAccounts, YodyStateDumpStats& stats)
+{
+    try {
+        uint32_t count;
+        file >> count;
+        while (count) {
+            size_t chunkBytes = 0;
+            for (uint32_t i = 0; i < count; i++) {
+                uint8_t type;
+                uint256 key;
+                std::string value;
+                file >> type >> key >> value;
+
+                chunkBytes += StateEntrySize(value);
+                if (i > 0 && chunkBytes > STATE_SNAPSHOT_CHUNK_BYTES)
+                    return error("%s: bad chunk of more than %u bytes", __func__, STATE_SNAPSHOT_CHUNK_BYTES);
+
+                const dev::h256 hash = uintToh256(key);
+                if (dev::sha3(dev::bytesConstRef(&value)) != hash)
+                    return error("%s: entry %s does not match its hash", __func__, hash.hex());
+                if (type == STATE_ENTRY_NODE) {
+                    db.insert(hash, dev::bytesConstRef(&value));
+                    stats.nodes++;
+                } else if (type == STATE_ENTRY_PREIMAGE) {
+                    db.insertAux(hash, dev::bytesConstRef(&value));
+                    stats.preimages++;
+                } else {
+                    return error("%s: unknown entry type %u", __func__, type);
+                }
+                stats.bytes += value.size();
+            }
+            db.commit();
+            if (ShutdownRequested())
+                return false;
+            file >> count;
+        }
+    } catch (const std::ios_base::failure& e) {
+        return error("%s: %s", __func__, e.what());
+    }
+
+    // The chunks only hold verified entries, make sure none reachable from the root is missing
+    StateWalker walker(db, [](uint8_t, const dev::h256&, const std::string&) { return true; });
+    return walker.Walk(root, fAccounts);
+}
+
+} // namespace
+
+bool DumpYodyState(CAutoFile& file, const dev::OverlayDB& db, const dev::OverlayDB& dbUtxo,
+                   const dev::h256& root, const dev::h256& rootUTXO,
+                   const std::function<void()>& interruption_point, YodyStateDumpStats& stats)
+{
+    file << h256Touint(root) << h256Touint(rootUTXO);
+    try {
+        return DumpStateDB(file, db, root, true, interruption_point, stats) &&
+               DumpStateDB(file, dbUtxo, rootUTXO, false, interruption_point, stats);
+    } catch (const std::exception& e) {
+        return error("%s: %s", __func__, e.what());
+    }
+}
+
+bool LoadYodyState(CAutoFile& file, dev::OverlayDB& db, dev::OverlayDB& dbUtxo,
+                   const dev::h256& root, const dev::h256& rootUTXO, YodyStateDumpStats& stats)
+{
+    uint256 snapshotRoot, snapshotRootUTXO;
+    try {
+        file >> snapshotRoot >> snapshotRootUTXO;
+    } catch (const std::ios_base::failure& e) {
+        return error("%s: %s", __func__, e.what());
+    }
+    if (uintToh256(snapshotRoot) != root || uintToh256(snapshotRootUTXO) != rootUTXO)
+        return error("%s: the snapshot has the roots %s and %s instead of %s and %s", __func__,
+                     snapshotRoot.GetHex(), snapshotRootUTXO.GetHex(), root.hex(), rootUTXO.hex());
+
+    try {
+        return LoadStateDB(file, db, root, true, stats) &&
+               LoadStateDB(file, dbUtxo, rootUTXO, false, stats);
+    } catch (const std::exception& e) {
+        return error("%s: %s", __func__, e.what());
+    }
+}
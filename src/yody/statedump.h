@@ -0,0 +1,43 @@
+#ifndef YODY_STATEDUMP_H
+#define YODY_STATEDUMP_H
+
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/OverlayDB.h>
+
+#include <cstdint>
+#include <functional>
+
+class CAutoFile;
+
+/**
+ * Serialized size of the entries of the contract state written in a chunk of a snapshot, which is loaded
+ * in one batch. Only a chunk of a single entry can be larger.
+ */
+static constexpr size_t STATE_SNAPSHOT_CHUNK_BYTES{4 << 20};
+
+/** Counts of the entries of the contract state written in a snapshot */
+struct YodyStateDumpStats {
+    uint64_t nodes{0};
+    uint64_t preimages{0};
+    uint64_t bytes{0};
+};
+
+/**
+ * Write the contract state at the state and UTXO roots after the coins of a UTXO snapshot: the roots, then
+ * for the state and for the UTXO databases the trie nodes, the code of the accounts and the preimages of
+ * the keys of the secure tries reachable from the root, in chunks of up to STATE_SNAPSHOT_CHUNK_BYTES
+ * bytes ending with an empty chunk. Every entry is keyed by the hash of its value, so it is verified on load.
+ */
+bool DumpYodyState(CAutoFile& file, const dev::OverlayDB& db, const dev::OverlayDB& dbUtxo,
+                   const dev::h256& root, const dev::h256& rootUTXO,
+                   const std::function<void()>& interruption_point, YodyStateDumpStats& stats);
+
+/**
+ * Load the contract state written by DumpYodyState in the state and UTXO databases, one chunk at a time.
+ * Fails if the roots of the snapshot are not the expected ones, if an entry does not hash to its key, or
+ * if a node reachable from the roots is missing once all the chunks are loaded.
+ */
+bool LoadYodyState(CAutoFile& file, dev::OverlayDB& db, dev::OverlayDB& dbUtxo,
+                   const dev::h256& root, const dev::h256& rootUTXO, YodyStateDumpStats& stats);
+
+#endif // YODY_STATEDUMP_H
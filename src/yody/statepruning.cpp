@@ -0,0 +1,229 @@
+#include <yody/statepruning.h>
+
+#include <fs.h>
+#include <libdevcore/DBFactory.h>
+#include <libdevcore/OverlayDB.h>
+#include <libdevcore/RLP.h>
+#include <libdevcore/SHA3.h>
+#include <libdevcore/TrieCommon.h>
+#include <libethereum/DatabasePaths.h>
+#include <shutdown.h>
+#include <util/system.h>
+
+#include <unordered_map>
+
+namespace {
+
+/** Number of nodes inserted in the compacted database before they are written */
+constexpr size_t COMPACT_BATCH = 100000;
+
+/** Copies the trie nodes, the preimages of the keys and the code of the accounts used by some roots */
+class StateCompactor
+{
+public:
+    StateCompactor(const dev::OverlayDB& src, dev::OverlayDB& dst, bool fAccounts) :
+        m_src(src), m_dst(dst), m_accounts(fAccounts) {}
+
+    /** Copy the nodes of a root, adding a reference for each place they are used in with fReferences */
+    bool CopyRoot(const dev::h256& root, bool fReferences)
+    {
+        m_references = fReferences;
+        dev::bytes path;
+        return CopyNode(root, path, m_accounts);
+    }
+
+    /**
+     * Add a reference for each time a copied node is killed in the kept journals. The nodes which are
+     * only used by the other roots are released by those journals, or kept when they are not in any.
+     */
+    void Finish(const std::unordered_map<dev::h256, unsigned>& killed)
+    {
+        for (const auto& i : killed) {
+            auto copied = m_copied.find(i.first);
+            if (copied == m_copied.end())
+                continue;
+            const std::string node = m_src.lookup(i.first);
+            for (unsigned n = copied->second ? 0 : 1; n < i.second; n++)
+                Insert(i.first, node);
+        }
+        m_dst.commit();
+    }
+
+    size_t Copied() const { return m_copied.size(); }
+
+private:
+    bool CopyNode(const dev::h256& hash, dev::bytes& path, bool fAccounts)
+    {
+        if (hash == dev::EmptyTrie)
+            return true;
+        auto copied = m_copied.find(hash);
+        if (copied != m_copied.end() && !m_references)
+            return true;
+
+        const std::string node = m_src.lookup(hash);
+        if (node.empty())
+            return error("%s: missing trie node %s", __func__, hash.hex());
+        if (copied == m_copied.end() || m_references) {
+            Insert(hash, node);
+            m_copied[hash] |= m_references;
+        }
+        if (ShutdownRequested())
+            return false;
+        return CopyItems(dev::RLP(node), path, fAccounts);
+    }
+
+    bool CopyItems(const dev::RLP& node, dev::bytes& path, bool fAccounts)
+    {
+        if (node.isList() && node.itemCount() == 17) {
+            for (unsigned i = 0; i < 16; i++) {
+                path.push_back(i);
+                bool ret = CopyChild(node[i], path, fAccounts);
+                path.pop_back();
+                if (!ret)
+                    return false;
+            }
+        } else if (node.isList() && node.itemCount() == 2) {
+            const dev::NibbleSlice key = dev::keyOf(node);
+            for (unsigned i = 0; i < key.size(); i++)
+                path.push_back(key[i]);
+            bool ret = dev::isLeaf(node) ? CopyValue(node[1].payload(), path, fAccounts) : CopyChild(node[1], path, fAccounts);
+            path.resize(path.size() - key.size());
+            return ret;
+        }
+        return true;
+    }
+
+    bool CopyChild(const dev::RLP& item, dev::bytes& path, bool fAccounts)
+    {
+        // Nodes shorter than a hash are inlined in their parent
+        if (item.isList())
+            return CopyItems(item, path, fAccounts);
+        if (item.isData() && item.size() == 32)
+            return CopyNode(item.toHash<dev::h256>(), path, fAccounts);
+        return true;
+    }
+
+    bool CopyValue(dev::bytesConstRef value, const dev::bytes& path, bool fAccounts)
+    {
+        // The keys of the secure tries are hashes, their preimages are kept to list the keys
+        if (path.size() == 64) {
+            dev::h256 key;
+            for (unsigned i = 0; i < 32; i++)
+                key[i] = (path[i * 2] << 4) | path[i * 2 + 1];
+            dev::bytes preimage = m_src.lookupAux(key);
+            if (!preimage.empty())
+                m_dst.insertAux(key, &preimage);
+        }
+        if (!fAccounts)
+            return true;
+
+        const dev::RLP account(value);
+        const dev::h256 codeHash = account[3].toHash<dev::h256>();
+        if (codeHash != dev::EmptySHA3 && !m_copied.count(codeHash)) {
+            const std::string code = m_src.lookup(codeHash);
+            if (code.empty())
+                return error("%s: missing code %s", __func__, codeHash.hex());
+            Insert(codeHash, code);
+            m_copied[codeHash] = true;
+        }
+        const dev::h256 storageRoot = account[2].toHash<dev::h256>();
+        if (storageRoot == dev::EmptyTrie)
+            return true;
+        dev::bytes storagePath;
+        return CopyNode(storageRoot, storagePath, false);
+    }
+
+    void Insert(const dev::h256& hash, const std::string& node)
+    {
+        m_dst.insert(hash, dev::bytesConstRef(&node));
+        if (++m_inserted % COMPACT_BATCH == 0) {
+            m_dst.commit();
+            LogPrintf("Compacting the state database, %u nodes copied\n", m_copied.size());
+        }
+    }
+
+    const dev::OverlayDB& m_src;
+    dev::OverlayDB& m_dst;
+    bool m_accounts;
+    bool m_references = false;
+    size_t m_inserted = 0;
+    std::unordered_map<dev::h256, bool> m_copied; // true when the node is used by the tip
+};
+
+bool CompactStateDB(const fs::path& path, const std::vector<dev::h256>& roots, unsigned nFirstHeight, bool fJournal, bool fAccounts)
+{
+    const fs::path compactPath = path.string() + ".compact";
+    const fs::path oldPath = path.string() + ".old";
+    fs::remove_all(compactPath);
+    {
+        dev::OverlayDB src(dev::db::DBFactory::create(path));
+        dev::OverlayDB dst(dev::db::DBFactory::create(compactPath));
+        if (fJournal)
+            dst.setJournaling();
+        dst.insert(dev::EmptyTrie, dev::bytesConstRef(&dev::RLPNull));
+
+        // The tip is copied first with the references of its nodes, then the nodes which can still be disconnected
+        StateCompactor compactor(src, dst, fAccounts);
+        if (roots.back() && !compactor.CopyRoot(roots.back(), true))
+            return false;
+        for (size_t i = 0; i + 1 < roots.size(); i++) {
+            if (!roots[i] || !src.exists(roots[i])) {
+                LogPrintf("%s: the state root of height %u is no longer available\n", __func__, nFirstHeight + i);
+                continue;
+            }
+            if (!compactor.CopyRoot(roots[i], false))
+                return false;
+        }
+
+        std::unordered_map<dev::h256, unsigned> killed;
+        if (fJournal) {
+            // The copied nodes are not written by the journaled heights, they are not released if one is disconnected
+            dst.keepWritten();
+            for (size_t i = 1; i < roots.size(); i++) {
+                for (const dev::h256& hash : src.readJournal(nFirstHeight + i))
+                    killed[hash]++;
+            }
+        }
+        compactor.Finish(killed);
+
+        if (fJournal) {
+            // The copied nodes are not written by the journaled heights, they are not released if one is disconnected
+            dst.keepWritten();
+            for (size_t i = 1; i < roots.size(); i++) {
+                for (const dev::h256& hash : src.readJournal(nFirstHeight + i))
+                    dst.kill(hash);
+                dst.writeJournal(nFirstHeight + i);
+            }
+            dst.prune(nFirstHeight);
+        }
+        LogPrintf("%s: copied %u nodes of %s\n", __func__, compactor.Copied(), path.string());
+    }
+
+    fs::remove_all(oldPath);
+    fs::rename(path, oldPath);
+    fs::rename(compactPath, path);
+    fs::remove_all(oldPath);
+    return true;
+}
+
+} // namespace
+
+bool CompactYodyState(const std::string& dirYody, const std::vector<std::pair<dev::h256, dev::h256>>& roots, unsigned nFirstHeight, bool fJournal)
+{
+    if (roots.empty())
+        return true;
+
+    std::vector<dev::h256> stateRoots, utxoRoots;
+    for (const auto& root : roots) {
+        stateRoots.push_back(root.first);
+        utxoRoots.push_back(root.second);
+    }
+
+    const dev::h256 hashDB(dev::sha3(dev::rlp("")));
+    try {
+        return CompactStateDB(dev::eth::DatabasePaths(dirYody, hashDB).statePath(), stateRoots, nFirstHeight, fJournal, true) &&
+               CompactStateDB(dev::eth::DatabasePaths(dirYody + "/yodyDB", hashDB).statePath(), utxoRoots, nFirstHeight, fJournal, false);
+    } catch (const std::exception& e) {
+        return error("%s: %s", __func__, e.what());
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef YODY_STATEPRUNING_H
+#define YODY_STATEPRUNING_H
+
+#include <libdevcore/FixedHash.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Rebuild the state and UTXO databases in dirYody with only the trie nodes of the given state and UTXO
+ * roots, which are the roots of the blocks from nFirstHeight to the tip. The nodes of the tip are counted
+ * for each place they are used in, and the journals of the blocks after nFirstHeight are kept, so the
+ * nodes replaced by those blocks are still deleted when they are pruned. With fJournal the rebuilt
+ * databases are journaled, else the reference counts and the journals are dropped.
+ */
+bool CompactYodyState(const std::string& dirYody, const std::vector<std::pair<dev::h256, dev::h256>>& roots, unsigned nFirstHeight, bool fJournal);
+
+#endif // YODY_STATEPRUNING_H
@@ -0,0 +1,343 @@
+#include <yody/statesnapshot.h>
+
+#include <libdevcore/RLP.h>
+#include <shutdown.h>
+#include <util/convert.h>
+#include <util/system.h>
+
+static constexpr uint8_t DB_SNAPSHOT_BASE{'B'};
+static constexpr uint8_t DB_SNAPSHOT_ACCOUNT{'a'};
+static constexpr uint8_t DB_SNAPSHOT_STORAGE{'s'};
+static constexpr uint8_t DB_SNAPSHOT_UNDO{'u'};
+
+/** Number of entries written in one batch by Generate */
+static constexpr size_t SNAPSHOT_GENERATE_BATCH = 10000;
+
+namespace {
+
+struct SnapshotHeightKey {
+    uint32_t height;
+
+    SERIALIZE_METHODS(SnapshotHeightKey, obj) { READWRITE(Using<BigEndianFormatter<4>>(obj.height)); }
+};
+
+std::pair<uint8_t, std::pair<uint160, uint256>> StorageKey(const dev::Address& address, const dev::u256& key)
+{
+    return std::make_pair(DB_SNAPSHOT_STORAGE, std::make_pair(h160Touint(address), u256Touint(key)));
+}
+
+} // namespace
+
+StateSnapshot::StateSnapshot(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe) :
+    CDBWrapper(path, nCacheSize, fMemory, fWipe)
+{
+    std::pair<uint256, int> base;
+    if (Read(DB_SNAPSHOT_BASE, base)) {
+        m_base = uintToh256(base.first);
+        m_baseHeight = base.second;
+    }
+}
+
+dev::h256 StateSnapshot::root() const
+{
+    return m_pending.empty() ? m_base : m_pending.back().root;
+}
+
+std::string StateSnapshot::account(dev::Address const& _address) const
+{
+    for (auto it = m_pending.rbegin(); it != m_pending.rend(); ++it) {
+        auto account = it->accounts.find(_address);
+        if (account != it->accounts.end())
+            return account->second;
+    }
+
+    std::vector<unsigned char> rlp;
+    if (!Read(std::make_pair(DB_SNAPSHOT_ACCOUNT, h160Touint(_address)), rlp))
+        return std::string();
+    return std::string(rlp.begin(), rlp.end());
+}
+
+dev::u256 StateSnapshot::storage(dev::Address const& _address, dev::u256 const& _key) const
+{
+    for (auto it = m_pending.rbegin(); it != m_pending.rend(); ++it) {
+        auto value = it->storage.find(std::make_pair(_address, _key));
+        if (value != it->storage.end())
+            return value->second;
+        if (it->cleared.count(_address))
+            return 0;
+    }
+
+    uint256 value;
+    if (!Read(StorageKey(_address, _key), value))
+        return 0;
+    return uintTou256(value);
+}
+
+void StateSnapshot::commit(dev::h256 const& _root, std::unordered_map<dev::Address, dev::eth::Account> const& _cache, dev::eth::SecureTrieDB<dev::Address, dev::OverlayDB> const& _state)
+{
+    Layer layer;
+    layer.root = _root;
+    for (auto const& i : _cache) {
+        if (!i.second.isDirty())
+            continue;
+
+        // A removed account, or one with a new storage, has none of its previous slots
+        if (!i.second.isAlive()) {
+            layer.accounts[i.first] = std::string();
+            layer.cleared.insert(i.first);
+            continue;
+        }
+        layer.accounts[i.first] = _state.at(i.first);
+        if (i.second.baseRoot() == dev::EmptyTrie)
+            layer.cleared.insert(i.first);
+        for (auto const& j : i.second.storageOverlay())
+            layer.storage[std::make_pair(i.first, j.first)] = j.second;
+    }
+    m_pending.push_back(std::move(layer));
+}
+
+void StateSnapshot::setRoot(dev::h256 const& _root)
+{
+    if (_root == m_base) {
+        m_pending.clear();
+        return;
+    }
+    for (size_t i = 0; i < m_pending.size(); i++) {
+        if (m_pending[i].root == _root) {
+            m_pending.resize(i + 1);
+            return;
+        }
+    }
+}
+
+bool StateSnapshot::GetPending(const dev::h256& root, std::vector<Layer>& layers) const
+{
+    size_t i = 0;
+    if (root != m_base) {
+        while (i < m_pending.size() && m_pending[i].root != root)
+            i++;
+        if (i == m_pending.size())
+            return false;
+        i++;
+    }
+    layers.assign(m_pending.begin() + i, m_pending.end());
+    return true;
+}
+
+void StateSnapshot::AddPending(const std::vector<Layer>& layers)
+{
+    m_pending.insert(m_pending.end(), layers.begin(), layers.end());
+}
+
+bool StateSnapshot::Flush(int nHeight, int nPruneHeight)
+{
+    if (m_pending.empty())
+        return true;
+
+    // Merge the commits of the block, the later ones replace the earlier ones
+    std::map<dev::Address, std::string> accounts;
+    std::set<dev::Address> cleared;
+    std::map<std::pair<dev::Address, dev::u256>, dev::u256> storage;
+    for (const Layer& layer : m_pending) {
+        for (const dev::Address& address : layer.cleared) {
+            cleared.insert(address);
+            storage.erase(storage.lower_bound(std::make_pair(address, dev::u256())), storage.upper_bound(std::make_pair(address, ~dev::u256())));
+        }
+        for (const auto& account : layer.accounts)
+            accounts[account.first] = account.second;
+        for (const auto& slot : layer.storage)
+            storage[slot.first] = slot.second;
+    }
+
+    CDBBatch batch(*this);
+    StateSnapshotUndo undo;
+    undo.root = h256Touint(root());
+    undo.parent = h256Touint(m_base);
+    undo.parentHeight = m_baseHeight;
+
+    // Remove the slots of the cleared accounts, keeping their values for the undo
+    std::set<std::pair<uint160, uint256>> saved;
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    for (const dev::Address& address : cleared) {
+        const uint160 addr = h160Touint(address);
+        pcursor->Seek(std::make_pair(DB_SNAPSHOT_STORAGE, std::make_pair(addr, uint256())));
+        std::pair<uint8_t, std::pair<uint160, uint256>> key;
+        while (pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_SNAPSHOT_STORAGE && key.second.first == addr) {
+            uint256 value;
+            if (!pcursor->GetValue(value))
+                return error("%s: failed to read a storage value", __func__);
+            undo.storage.emplace_back(key.second, value);
+            saved.insert(key.second);
+            batch.Erase(key);
+            pcursor->Next();
+        }
+    }
+
+    for (const auto& slot : storage) {
+        const auto key = StorageKey(slot.first.first, slot.first.second);
+        if (!saved.count(key.second)) {
+            uint256 previous;
+            Read(key, previous);
+            undo.storage.emplace_back(key.second, previous);
+        }
+        if (slot.second == 0)
+            batch.Erase(key);
+        else
+            batch.Write(key, u256Touint(slot.second));
+    }
+
+    for (const auto& account : accounts) {
+        const auto key = std::make_pair(DB_SNAPSHOT_ACCOUNT, h160Touint(account.first));
+        std::vector<unsigned char> previous;
+        Read(key, previous);
+        undo.accounts.emplace_back(key.second, previous);
+        if (account.second.empty())
+            batch.Erase(key);
+        else
+            batch.Write(key, std::vector<unsigned char>(account.second.begin(), account.second.end()));
+    }
+
+    batch.Write(std::make_pair(DB_SNAPSHOT_UNDO, SnapshotHeightKey{uint32_t(nHeight)}), undo);
+    batch.Write(DB_SNAPSHOT_BASE, std::make_pair(undo.root, nHeight));
+
+    // The blocks below the checkpoint span can not be disconnected
+    pcursor->Seek(std::make_pair(DB_SNAPSHOT_UNDO, SnapshotHeightKey{0}));
+    std::pair<uint8_t, SnapshotHeightKey> key;
+    while (pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_SNAPSHOT_UNDO && int(key.second.height) < nPruneHeight) {
+        batch.Erase(key);
+        pcursor->Next();
+    }
+
+    if (!WriteBatch(batch))
+        return false;
+
+    m_base = root();
+    m_baseHeight = nHeight;
+    m_pending.clear();
+    return true;
+}
+
+bool StateSnapshot::Disconnect(int nHeight)
+{
+    m_pending.clear();
+    if (m_baseHeight < nHeight)
+        return true;
+
+    StateSnapshotUndo undo;
+    if (m_baseHeight > nHeight || !Read(std::make_pair(DB_SNAPSHOT_UNDO, SnapshotHeightKey{uint32_t(nHeight)}), undo) || uintToh256(undo.root) != m_base)
+        return error("%s: no undo data for the block at height %d", __func__, nHeight);
+
+    CDBBatch batch(*this);
+    for (const auto& slot : undo.storage) {
+        const auto key = std::make_pair(DB_SNAPSHOT_STORAGE, slot.first);
+        if (slot.second.IsNull())
+            batch.Erase(key);
+        else
+            batch.Write(key, slot.second);
+    }
+    for (const auto& account : undo.accounts) {
+        const auto key = std::make_pair(DB_SNAPSHOT_ACCOUNT, account.first);
+        if (account.second.empty())
+            batch.Erase(key);
+        else
+            batch.Write(key, account.second);
+    }
+    batch.Erase(std::make_pair(DB_SNAPSHOT_UNDO, SnapshotHeightKey{uint32_t(nHeight)}));
+    batch.Write(DB_SNAPSHOT_BASE, std::make_pair(undo.parent, undo.parentHeight));
+    if (!WriteBatch(batch))
+        return false;
+
+    m_base = uintToh256(undo.parent);
+    m_baseHeight = undo.parentHeight;
+    return true;
+}
+
+bool StateSnapshot::Rewind(int nHeight)
+{
+    while (m_baseHeight > nHeight) {
+        if (!Disconnect(m_baseHeight))
+            return false;
+    }
+    return true;
+}
+
+bool StateSnapshot::Generate(const dev::OverlayDB& db, const dev::h256& root, int nHeight)
+{
+    LogPrintf("Generating the state snapshot at height %d...\n", nHeight);
+    m_pending.clear();
+
+    // Clear the previous snapshot, its base first so an interrupted generation leaves a snapshot which is not used
+    m_base = dev::h256();
+    m_baseHeight = -1;
+    {
+        std::unique_ptr<CDBIterator> pcursor(NewIterator());
+        CDBBatch batch(*this);
+        batch.Erase(DB_SNAPSHOT_BASE);
+        if (!WriteBatch(batch, true))
+            return false;
+        batch.Clear();
+
+        auto wipe = [&](auto key) {
+            const uint8_t prefix = key.first;
+            pcursor->Seek(prefix);
+            while (pcursor->Valid() && pcursor->GetKey(key) && key.first == prefix) {
+                batch.Erase(key);
+                if (batch.SizeEstimate() > SNAPSHOT_GENERATE_BATCH * 64) {
+                    if (!WriteBatch(batch))
+                        return false;
+                    batch.Clear();
+                }
+                pcursor->Next();
+            }
+            return true;
+        };
+        if (!wipe(std::make_pair(DB_SNAPSHOT_ACCOUNT, uint160())) ||
+            !wipe(std::make_pair(DB_SNAPSHOT_STORAGE, std::make_pair(uint160(), uint256()))) ||
+            !wipe(std::make_pair(DB_SNAPSHOT_UNDO, SnapshotHeightKey{0})) ||
+            !WriteBatch(batch))
+            return false;
+        batch.Clear();
+    }
+
+    dev::OverlayDB* pdb = const_cast<dev::OverlayDB*>(&db); // only read
+    dev::eth::SecureTrieDB<dev::Address, dev::OverlayDB> state(pdb, root);
+    CDBBatch batch(*this);
+    size_t count = 0;
+    auto written = [&]() {
+        if (++count % SNAPSHOT_GENERATE_BATCH != 0)
+            return true;
+        bool ret = WriteBatch(batch);
+        batch.Clear();
+        return ret;
+    };
+    for (auto it = state.hashedBegin(); it != state.hashedEnd(); ++it) {
+        const dev::Address address(it.key());
+        const std::string rlp = (*it).second.toString();
+        batch.Write(std::make_pair(DB_SNAPSHOT_ACCOUNT, h160Touint(address)), std::vector<unsigned char>(rlp.begin(), rlp.end()));
+        if (!written())
+            return false;
+
+        const dev::h256 storageRoot = dev::RLP(rlp)[2].toHash<dev::h256>();
+        if (storageRoot != dev::EmptyTrie) {
+            dev::eth::SecureTrieDB<dev::h256, dev::OverlayDB> storage(pdb, storageRoot);
+            for (auto slot = storage.hashedBegin(); slot != storage.hashedEnd(); ++slot) {
+                const dev::u256 key = dev::h256(slot.key());
+                batch.Write(StorageKey(address, key), u256Touint(dev::RLP((*slot).second).toInt<dev::u256>()));
+                if (!written())
+                    return false;
+            }
+        }
+
+        if (ShutdownRequested())
+            return false;
+    }
+
+    batch.Write(DB_SNAPSHOT_BASE, std::make_pair(h256Touint(root), nHeight));
+    if (!WriteBatch(batch, true))
+        return false;
+
+    m_base = root;
+    m_baseHeight = nHeight;
+    LogPrintf("Generated the state snapshot with %u entries\n", count);
+    return true;
+}
@@ -0,0 +1,82 @@
+#ifndef YODY_STATESNAPSHOT_H
+#define YODY_STATESNAPSHOT_H
+
+#include <dbwrapper.h>
+#include <fs.h>
+#include <serialize.h>
+#include <uint256.h>
+#include <libethereum/StateSnapshotFace.h>
+
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+/** Cache of the state snapshot database, in MiB */
+static constexpr int64_t nStateSnapshotDBCache = 16;
+
+/** Entries replaced by a flushed block, restored when the block is disconnected */
+struct StateSnapshotUndo
+{
+    uint256 root;
+    uint256 parent;
+    int parentHeight = 0;
+    std::vector<std::pair<uint160, std::vector<unsigned char>>> accounts; // empty when the account did not exist
+    std::vector<std::pair<std::pair<uint160, uint256>, uint256>> storage; // zero when the slot was not set
+
+    SERIALIZE_METHODS(StateSnapshotUndo, obj) { READWRITE(obj.root, obj.parent, obj.parentHeight, obj.accounts, obj.storage); }
+};
+
+/**
+ * Flat copy of the accounts and storage of the contract state at the tip, keyed by address and by
+ * address and slot, so reading an account or a slot takes one lookup instead of a walk of the state trie.
+ *
+ * The commits of the block being connected are kept in memory until the block is flushed, or dropped when
+ * the state is set back to a root before them. A flushed block keeps the entries it replaced for the
+ * checkpoint span so it can be disconnected. The snapshot is only read while it is at the same root as
+ * the state, any other root is read from the trie.
+ */
+class StateSnapshot : public dev::eth::StateSnapshotFace, public CDBWrapper
+{
+public:
+    /** Changes of one commit of the state, kept in memory until the block is flushed */
+    struct Layer {
+        dev::h256 root;
+        std::unordered_map<dev::Address, std::string> accounts;
+        std::set<dev::Address> cleared;
+        std::map<std::pair<dev::Address, dev::u256>, dev::u256> storage;
+    };
+
+    explicit StateSnapshot(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    dev::h256 root() const override;
+    std::string account(dev::Address const& _address) const override;
+    dev::u256 storage(dev::Address const& _address, dev::u256 const& _key) const override;
+    void commit(dev::h256 const& _root, std::unordered_map<dev::Address, dev::eth::Account> const& _cache, dev::eth::SecureTrieDB<dev::Address, dev::OverlayDB> const& _state) override;
+    void setRoot(dev::h256 const& _root) override;
+
+    /** Write the commits of the block connected at nHeight, and drop the undo data of the blocks below nPruneHeight */
+    bool Flush(int nHeight, int nPruneHeight);
+
+    /** Restore the entries replaced by the block at nHeight, if it changed the state */
+    bool Disconnect(int nHeight);
+
+    /** Disconnect the blocks flushed above nHeight, after an unclean shutdown */
+    bool Rewind(int nHeight);
+
+    /** Copy the accounts and storage of the state trie at root, for the block at nHeight */
+    bool Generate(const dev::OverlayDB& db, const dev::h256& root, int nHeight);
+
+    /** Get the commits made after the snapshot was at root, false if it did not go through root */
+    bool GetPending(const dev::h256& root, std::vector<Layer>& layers) const;
+
+    /** Add commits made from the current root without going through the snapshot, like reused executions */
+    void AddPending(const std::vector<Layer>& layers);
+
+private:
+    dev::h256 m_base;
+    int m_baseHeight = -1;
+    std::vector<Layer> m_pending;
+};
+
+#endif // YODY_STATESNAPSHOT_H
@@ -1,5 +1,127 @@
 #include <yody/storageresults.h>
 #include <util/convert.h>
+#include <clientversion.h>
+#include <shutdown.h>
+#include <streams.h>
+#include <leveldb/write_batch.h>
+
+#include <algorithm>
+
+/** Key of the format version, results are keyed by the 64 character hex transaction hash. */
+static const std::string DB_RESULTS_VERSION = "version";
+static const char RESULTS_VERSION_COLUMNAR = 1;
+
+/** First byte of a result in the columnar format, legacy results are RLP lists starting at 0xc0. */
+static const uint8_t RESULT_FORMAT_COLUMNAR = 1;
+
+/** How the bloom of a receipt is stored in the columnar format. */
+enum : uint8_t {
+    BLOOM_FROM_LOGS = 0,
+    BLOOM_EMPTY = 1,
+    BLOOM_EXPLICIT = 2,
+};
+
+static dev::eth::LogBloom logsBloom(dev::eth::LogEntries const& _logs){
+    dev::eth::LogBloom bloom;
+    for(dev::eth::LogEntry const& log : _logs)
+        bloom |= log.bloom();
+    return bloom;
+}
+
+/** Log data is mostly ABI encoded words, runs of zero bytes are stored as a single control byte. */
+static std::vector<unsigned char> compressLogData(dev::bytes const& _data){
+    std::vector<unsigned char> result;
+    size_t i = 0;
+    while(i < _data.size()){
+        size_t zeros = 0;
+        while(i + zeros < _data.size() && _data[i + zeros] == 0 && zeros < 128)
+            zeros++;
+        if(zeros >= 2 || (zeros == 1 && i + 1 == _data.size())){
+            result.push_back(0x80 | (zeros - 1));
+            i += zeros;
+            continue;
+        }
+        size_t start = i;
+        while(i < _data.size() && i - start < 128 && !(_data[i] == 0 && i + 1 < _data.size() && _data[i + 1] == 0))
+            i++;
+        result.push_back(i - start - 1);
+        result.insert(result.end(), _data.begin() + start, _data.begin() + i);
+    }
+    return result;
+}
+
+static dev::bytes decompressLogData(std::vector<unsigned char> const& _data){
+    dev::bytes result;
+    size_t i = 0;
+    while(i < _data.size()){
+        unsigned char control = _data[i++];
+        size_t size = (control & 0x7f) + 1;
+        if(control & 0x80){
+            result.insert(result.end(), size, 0);
+        } else {
+            if(i + size > _data.size())
+                throw std::ios_base::failure("Invalid compressed log data");
+            result.insert(result.end(), _data.begin() + i, _data.begin() + i + size);
+            i += size;
+        }
+    }
+    return result;
+}
+
+static void writeColumn(CDataStream& _out, CDataStream const& _column){
+    WriteCompactSize(_out, _column.size());
+    _out.write((const char*)_column.data(), _column.size());
+}
+
+template <typename T>
+static T const& dictionaryEntry(std::vector<T> const& _dictionary, uint32_t _id){
+    if(_id >= _dictionary.size())
+        throw std::ios_base::failure("Invalid dictionary reference in result");
+    return _dictionary[_id];
+}
+
+/** Approximate memory used by an entry of the pending results. */
+static size_t pendingEntryUsage(std::optional<std::vector<TransactionReceiptInfo>> const& _result){
+    size_t usage = sizeof(dev::h256) + sizeof(std::optional<std::vector<TransactionReceiptInfo>>);
+    if(_result){
+        for(TransactionReceiptInfo const& tri : *_result){
+            usage += sizeof(TransactionReceiptInfo) + tri.exceptedMessage.size();
+            for(dev::eth::LogEntry const& log : tri.logs)
+                usage += sizeof(dev::eth::LogEntry) + log.topics.size() * sizeof(dev::h256) + log.data.size();
+        }
+    }
+    return usage;
+}
+
+/** Reset the parts of in memory results which were not requested, as if they were decoded from the database. */
+static void selectFields(std::vector<TransactionReceiptInfo>& _result, uint32_t fields){
+    for(TransactionReceiptInfo& tri : _result){
+        if(!(fields & RECEIPT_LOGS))
+            tri.logs.clear();
+        if(!(fields & RECEIPT_BLOOM))
+            tri.bloom = dev::eth::LogBloom();
+        if(!(fields & RECEIPT_ROOTS)){
+            tri.stateRoot = dev::h256();
+            tri.utxoRoot = dev::h256();
+        }
+    }
+}
+
+bool MatchLogTopics(dev::eth::LogEntries const& logs, std::vector<std::optional<dev::h256>> const& topics){
+    if(logs.empty())
+        return false;
+    if(topics.empty())
+        return true;
+    for(size_t i = 0; i < topics.size(); i++){
+        if(!topics[i])
+            continue;
+        for(dev::eth::LogEntry const& log : logs){
+            if(i < log.topics.size() && *topics[i] == log.topics[i])
+                return true;
+        }
+    }
+    return false;
+}
 
 StorageResults::StorageResults(std::string const& _path){
 	path = _path + "/resultsDB";
@@ -12,19 +134,27 @@ StorageResults::StorageResults(std::string const& _path){
 
 StorageResults::~StorageResults()
 {
+    flushResults();
     delete db;
     db = NULL;
 }
 
-void StorageResults::addResult(dev::h256 hashTx, std::vector<TransactionReceiptInfo>& result){
-	m_cache_result.insert(std::make_pair(hashTx, result));
+void StorageResults::addResult(dev::h256 hashTx, std::vector<TransactionReceiptInfo> result){
+    LOCK(cs_results);
+	m_cache_result.insert(std::make_pair(hashTx, std::move(result)));
 }
 
 void StorageResults::clearCacheResult(){
+    LOCK(cs_results);
     m_cache_result.clear();
 }
 
 void StorageResults::wipeResults(){
+    LOCK(cs_results);
+    m_cache_result.clear();
+    m_pending_results.clear();
+    m_pending_usage = 0;
+
     LogPrintf("Wiping LevelDB in %s\n", path);
     bool opened = db;
     if (opened) {
@@ -40,78 +170,172 @@ void StorageResults::wipeResults(){
 }
 
 void StorageResults::deleteResults(std::vector<CTransactionRef> const& txs){
-
+    LOCK(cs_results);
     for(CTransactionRef tx : txs){
         dev::h256 hashTx = uintToh256(tx->GetHash());
         m_cache_result.erase(hashTx);
 
-        std::string keyTemp = hashTx.hex();
-	    leveldb::Slice key(keyTemp);
-        leveldb::Status status = db->Delete(leveldb::WriteOptions(), key);
-        assert(status.ok());
+        auto it = m_pending_results.find(hashTx);
+        if(it == m_pending_results.end()){
+            m_pending_results.emplace(hashTx, std::nullopt);
+            m_pending_usage += pendingEntryUsage(std::nullopt);
+        } else if(it->second) {
+            m_pending_usage -= pendingEntryUsage(it->second) - pendingEntryUsage(std::nullopt);
+            it->second.reset();
+        }
     }
 }
 
-std::vector<TransactionReceiptInfo> StorageResults::getResult(dev::h256 const& hashTx){
+bool StorageResults::getCachedResult(dev::h256 const& hashTx, std::vector<TransactionReceiptInfo>& result){
+    LOCK(cs_results);
+    auto it = m_cache_result.find(hashTx);
+    if(it != m_cache_result.end()){
+        result = it->second;
+        return true;
+    }
+    auto itPending = m_pending_results.find(hashTx);
+    if(itPending != m_pending_results.end()){
+        if(itPending->second)
+            result = *itPending->second;
+        return true;
+    }
+    return false;
+}
+
+std::vector<TransactionReceiptInfo> StorageResults::getResult(dev::h256 const& hashTx, uint32_t fields){
     std::vector<TransactionReceiptInfo> result;
-	auto it = m_cache_result.find(hashTx);
-	if (it == m_cache_result.end()){
-		if(readResult(hashTx, result))
-			m_cache_result.insert(std::make_pair(hashTx, result));
-    } else {
-		result = it->second;
+    if(getCachedResult(hashTx, result)){
+        selectFields(result, fields);
+        return result;
     }
+    // Pending results are only dropped once they are written, so a miss can be read from the database
+    readResult(hashTx, result, fields);
 	return result;
 }
 
+bool StorageResults::searchLogs(dev::h256 const& hashTx, std::vector<std::optional<dev::h256>> const& topics, LogMatchFn const& fn){
+    std::vector<TransactionReceiptInfo> result;
+    if(!getCachedResult(hashTx, result))
+        readResult(hashTx, result, RECEIPT_LOGS, &topics);
+    for(TransactionReceiptInfo const& tri : result){
+        if(!MatchLogTopics(tri.logs, topics))
+            continue;
+        for(dev::eth::LogEntry const& log : tri.logs){
+            if(!fn(tri, log))
+                return false;
+        }
+    }
+    return true;
+}
+
 void StorageResults::commitResults(){
-    if(m_cache_result.size()){
-
-        for (auto const& i: m_cache_result){
-            std::string valueTemp;
-            std::string keyTemp = i.first.hex();
-            leveldb::Slice key(keyTemp);
-            leveldb::Status status = db->Get(leveldb::ReadOptions(), key, &valueTemp);
-
-            if(status.IsNotFound()){
-
-                TransactionReceiptInfoSerialized tris;
-
-                for(size_t j = 0; j < i.second.size(); j++){
-                    tris.blockHashes.push_back(uintToh256(i.second[j].blockHash));
-                    tris.blockNumbers.push_back(i.second[j].blockNumber);
-                    tris.transactionHashes.push_back(uintToh256(i.second[j].transactionHash));
-                    tris.transactionIndexes.push_back(i.second[j].transactionIndex);
-                    tris.senders.push_back(i.second[j].from);
-                    tris.receivers.push_back(i.second[j].to);
-                    tris.cumulativeGasUsed.push_back(dev::u256(i.second[j].cumulativeGasUsed));
-                    tris.gasUsed.push_back(dev::u256(i.second[j].gasUsed));
-                    tris.contractAddresses.push_back(i.second[j].contractAddress);
-                    tris.logs.push_back(logEntriesSerialization(i.second[j].logs));
-                    tris.excepted.push_back(uint32_t(static_cast<int>(i.second[j].excepted)));
-                    tris.exceptedMessage.push_back(i.second[j].exceptedMessage);
-                    tris.outputIndexes.push_back(i.second[j].outputIndex);
-                    tris.blooms.push_back(i.second[j].bloom);
-                    tris.stateRoots.push_back(i.second[j].stateRoot);
-                    tris.utxoRoots.push_back(i.second[j].utxoRoot);
-                }
-
-                dev::RLPStream streamRLP(16);
-                streamRLP << tris.blockHashes << tris.blockNumbers << tris.transactionHashes << tris.transactionIndexes << tris.senders;
-                streamRLP << tris.receivers << tris.cumulativeGasUsed << tris.gasUsed << tris.contractAddresses << tris.logs << tris.excepted << tris.exceptedMessage << tris.outputIndexes << tris.blooms << tris.stateRoots << tris.utxoRoots;
-
-                dev::bytes data = streamRLP.out();
-                std::string stringData(data.begin(), data.end());
-                leveldb::Slice value(stringData);
-                status = db->Put(leveldb::WriteOptions(), key, value);
-                assert(status.ok());
-            }
+    LOCK(cs_results);
+    for(auto& i : m_cache_result){
+        addPendingResult(i.first, std::move(i.second));
+    }
+    m_cache_result.clear();
+}
+
+void StorageResults::addReplayedResults(std::vector<std::pair<dev::h256, std::vector<TransactionReceiptInfo>>> results){
+    LOCK(cs_results);
+    for(auto& i : results){
+        addPendingResult(i.first, std::move(i.second));
+    }
+}
+
+void StorageResults::addPendingResult(dev::h256 const& hashTx, std::vector<TransactionReceiptInfo>&& result){
+    auto it = m_pending_results.find(hashTx);
+    if(it == m_pending_results.end()){
+        it = m_pending_results.emplace(hashTx, std::nullopt).first;
+    } else {
+        m_pending_usage -= pendingEntryUsage(it->second);
+    }
+    it->second = std::move(result);
+    m_pending_usage += pendingEntryUsage(it->second);
+}
+
+bool StorageResults::flushResults(){
+    LOCK(cs_results);
+    if(m_pending_results.empty())
+        return true;
+
+    leveldb::WriteBatch batch;
+    for(auto const& i : m_pending_results){
+        if(i.second)
+            batch.Put(i.first.hex(), encodeResult(*i.second));
+        else
+            batch.Delete(i.first.hex());
+    }
+    leveldb::WriteOptions options;
+    options.sync = true;
+    leveldb::Status status = db->Write(options, &batch);
+    if(!status.ok()){
+        LogPrintf("Failed to write %u results to %s: %s\n", m_pending_results.size(), path, status.ToString());
+        return false;
+    }
+    LogPrint(BCLog::BENCH, "Wrote %u results (%.2fkB)\n", m_pending_results.size(), m_pending_usage / 1000.0);
+    m_pending_results.clear();
+    m_pending_usage = 0;
+    return true;
+}
+
+size_t StorageResults::pendingResultsUsage(){
+    LOCK(cs_results);
+    return m_pending_usage;
+}
+
+bool StorageResults::upgradeResults(){
+    std::string version;
+    leveldb::Status status = db->Get(leveldb::ReadOptions(), DB_RESULTS_VERSION, &version);
+    if(status.ok() && version.size() == 1 && version[0] >= RESULTS_VERSION_COLUMNAR)
+        return true;
+    if(!status.ok() && !status.IsNotFound())
+        return false;
+
+    LogPrintf("Upgrading receipts database to the columnar format...\n");
+    size_t count = 0;
+    size_t skipped = 0;
+    leveldb::WriteBatch batch;
+    std::unique_ptr<leveldb::Iterator> it(db->NewIterator(leveldb::ReadOptions()));
+    for(it->SeekToFirst(); it->Valid(); it->Next()){
+        if(ShutdownRequested()){
+            LogPrintf("Receipts database upgrade interrupted, it will resume on the next start\n");
+            return db->Write(leveldb::WriteOptions(), &batch).ok();
+        }
+
+        leveldb::Slice value = it->value();
+        if(it->key().size() != 64 || value.empty() || (uint8_t)value[0] == RESULT_FORMAT_COLUMNAR)
+            continue;
+
+        // A corrupt record is left as it is, readResult reports it when it is read
+        std::vector<TransactionReceiptInfo> result;
+        try {
+            decodeLegacyResult(value.ToString(), result);
+        } catch(const std::exception& e) {
+            LogPrintf("Failed to decode the result of %s, skipping it: %s\n", it->key().ToString(), e.what());
+            skipped++;
+            continue;
+        }
+        batch.Put(it->key(), encodeResult(result));
+        count++;
+
+        if(batch.ApproximateSize() > (1 << 24)){
+            if(!db->Write(leveldb::WriteOptions(), &batch).ok())
+                return false;
+            batch.Clear();
         }
-        m_cache_result.clear();
     }
+    if(!it->status().ok())
+        return false;
+
+    batch.Put(DB_RESULTS_VERSION, std::string(1, RESULTS_VERSION_COLUMNAR));
+    if(!db->Write(leveldb::WriteOptions(), &batch).ok())
+        return false;
+    LogPrintf("Upgraded %u results in the receipts database, skipped %u corrupt results\n", count, skipped);
+    return true;
 }
 
-bool StorageResults::readResult(dev::h256 const& _key, std::vector<TransactionReceiptInfo>& _result){
+bool StorageResults::readResult(dev::h256 const& _key, std::vector<TransactionReceiptInfo>& _result, uint32_t fields, std::vector<std::optional<dev::h256>> const* _topics){
 
     std::string value;
     std::string keyTemp = _key.hex();;
@@ -119,10 +343,208 @@ bool StorageResults::readResult(dev::h256 const& _key, std::vector<TransactionRe
     leveldb::Status s = db->Get(leveldb::ReadOptions(), key, &value);
 
 	if(!s.IsNotFound() && s.ok()){
-        
+        try {
+            if(!value.empty() && (uint8_t)value[0] == RESULT_FORMAT_COLUMNAR){
+                decodeResult(value, _result, fields, _topics);
+                for(TransactionReceiptInfo& tri : _result)
+                    tri.transactionHash = h256Touint(_key);
+            } else {
+                decodeLegacyResult(value, _result);
+            }
+        } catch(const std::exception& e) {
+            LogPrintf("Failed to decode the result of %s: %s\n", keyTemp, e.what());
+            _result.clear();
+            return false;
+        }
+		return true;
+	}
+	return false;
+}
+
+std::string StorageResults::encodeResult(std::vector<TransactionReceiptInfo> const& _result){
+    // Addresses and topics are written once per transaction and referenced by position
+    std::vector<dev::Address> addresses;
+    std::map<dev::Address, uint32_t> addressIds;
+    auto addressId = [&](dev::Address const& address){
+        auto it = addressIds.emplace(address, addresses.size());
+        if(it.second)
+            addresses.push_back(address);
+        return it.first->second;
+    };
+    std::vector<dev::h256> topics;
+    std::map<dev::h256, uint32_t> topicIds;
+    auto topicId = [&](dev::h256 const& topic){
+        auto it = topicIds.emplace(topic, topics.size());
+        if(it.second)
+            topics.push_back(topic);
+        return it.first->second;
+    };
+
+    CDataStream receipts(SER_DISK, CLIENT_VERSION);
+    CDataStream roots(SER_DISK, CLIENT_VERSION);
+    CDataStream logs(SER_DISK, CLIENT_VERSION);
+    for(TransactionReceiptInfo const& tri : _result){
+        receipts << VARINT(addressId(tri.from)) << VARINT(addressId(tri.to)) << VARINT(addressId(tri.contractAddress));
+        receipts << VARINT(tri.cumulativeGasUsed) << VARINT(tri.gasUsed) << VARINT(uint32_t(static_cast<int>(tri.excepted)));
+        receipts << tri.exceptedMessage << VARINT(tri.outputIndex);
+
+        // The bloom is derived from the logs, it is only kept for results which were stored with another one
+        uint8_t bloomFormat = BLOOM_FROM_LOGS;
+        if(tri.bloom != logsBloom(tri.logs))
+            bloomFormat = tri.bloom ? BLOOM_EXPLICIT : BLOOM_EMPTY;
+        receipts << bloomFormat;
+        if(bloomFormat == BLOOM_EXPLICIT)
+            receipts.write((const char*)tri.bloom.data(), dev::eth::LogBloom::size);
+
+        roots.write((const char*)tri.stateRoot.data(), dev::h256::size);
+        roots.write((const char*)tri.utxoRoot.data(), dev::h256::size);
+
+        WriteCompactSize(logs, tri.logs.size());
+        for(dev::eth::LogEntry const& log : tri.logs){
+            logs << VARINT(addressId(log.address));
+            WriteCompactSize(logs, log.topics.size());
+            for(dev::h256 const& topic : log.topics)
+                logs << VARINT(topicId(topic));
+            logs << compressLogData(log.data);
+        }
+    }
+
+    // All the receipts of a transaction share the block and the transaction position
+    CDataStream out(SER_DISK, CLIENT_VERSION);
+    out << RESULT_FORMAT_COLUMNAR;
+    out << (_result.empty() ? uint256() : _result[0].blockHash);
+    out << VARINT(_result.empty() ? 0 : _result[0].blockNumber) << VARINT(_result.empty() ? 0 : _result[0].transactionIndex);
+    WriteCompactSize(out, _result.size());
+    WriteCompactSize(out, addresses.size());
+    for(dev::Address const& address : addresses)
+        out.write((const char*)address.data(), dev::Address::size);
+    WriteCompactSize(out, topics.size());
+    for(dev::h256 const& topic : topics)
+        out.write((const char*)topic.data(), dev::h256::size);
+    writeColumn(out, receipts);
+    writeColumn(out, roots);
+    writeColumn(out, logs);
+    return out.str();
+}
+
+void StorageResults::decodeResult(std::string const& _value, std::vector<TransactionReceiptInfo>& _result, uint32_t fields, std::vector<std::optional<dev::h256>> const* _topics){
+    bool decodeLogs = fields & (RECEIPT_LOGS | RECEIPT_BLOOM);
+    CDataStream in(MakeUCharSpan(_value), SER_DISK, CLIENT_VERSION);
+
+    uint8_t format;
+    uint256 blockHash;
+    uint32_t blockNumber, transactionIndex;
+    in >> format >> blockHash >> VARINT(blockNumber) >> VARINT(transactionIndex);
+    size_t count = ReadCompactSize(in);
+
+    std::vector<dev::Address> addresses(ReadCompactSize(in));
+    for(dev::Address& address : addresses)
+        in.read((char*)address.data(), dev::Address::size);
+    size_t topicsCount = ReadCompactSize(in);
+    std::vector<dev::h256> topics;
+    if(decodeLogs){
+        topics.resize(topicsCount);
+        for(dev::h256& topic : topics)
+            in.read((char*)topic.data(), dev::h256::size);
+    } else {
+        in.ignore(topicsCount * dev::h256::size);
+    }
+
+    std::vector<uint8_t> bloomFormats;
+    ReadCompactSize(in);
+    for(size_t i = 0; i < count; i++){
+        TransactionReceiptInfo tri{};
+        tri.blockHash = blockHash;
+        tri.blockNumber = blockNumber;
+        tri.transactionIndex = transactionIndex;
+        uint32_t from, to, contractAddress, excepted;
+        in >> VARINT(from) >> VARINT(to) >> VARINT(contractAddress);
+        tri.from = dictionaryEntry(addresses, from);
+        tri.to = dictionaryEntry(addresses, to);
+        tri.contractAddress = dictionaryEntry(addresses, contractAddress);
+        in >> VARINT(tri.cumulativeGasUsed) >> VARINT(tri.gasUsed) >> VARINT(excepted);
+        tri.excepted = static_cast<dev::eth::TransactionException>(excepted);
+        in >> tri.exceptedMessage >> VARINT(tri.outputIndex);
+        uint8_t bloomFormat;
+        in >> bloomFormat;
+        if(bloomFormat == BLOOM_EXPLICIT)
+            in.read((char*)tri.bloom.data(), dev::eth::LogBloom::size);
+        bloomFormats.push_back(bloomFormat);
+        _result.push_back(tri);
+    }
+
+    size_t rootsSize = ReadCompactSize(in);
+    if(fields & RECEIPT_ROOTS){
+        for(TransactionReceiptInfo& tri : _result){
+            in.read((char*)tri.stateRoot.data(), dev::h256::size);
+            in.read((char*)tri.utxoRoot.data(), dev::h256::size);
+        }
+    } else {
+        in.ignore(rootsSize);
+    }
+
+    if(!decodeLogs)
+        return;
+
+    // Without any of the searched topics in the transaction none of its receipts match
+    if(_topics){
+        bool searched = false;
+        bool found = false;
+        for(auto const& topic : *_topics){
+            searched |= bool(topic);
+            found |= topic && std::find(topics.begin(), topics.end(), *topic) != topics.end();
+        }
+        if(searched && !found)
+            return;
+    }
+
+    ReadCompactSize(in);
+    for(size_t i = 0; i < _result.size(); i++){
+        TransactionReceiptInfo& tri = _result[i];
+        tri.logs.resize(ReadCompactSize(in));
+        std::vector<std::pair<size_t, size_t>> dataPos;
+        for(dev::eth::LogEntry& log : tri.logs){
+            uint32_t address;
+            in >> VARINT(address);
+            log.address = dictionaryEntry(addresses, address);
+            log.topics.resize(ReadCompactSize(in));
+            for(dev::h256& topic : log.topics){
+                uint32_t id;
+                in >> VARINT(id);
+                topic = dictionaryEntry(topics, id);
+            }
+            if(_topics){
+                // The data is decoded once the receipt is known to match
+                size_t size = ReadCompactSize(in);
+                dataPos.emplace_back(_value.size() - in.size(), size);
+                in.ignore(size);
+                continue;
+            }
+            std::vector<unsigned char> data;
+            in >> data;
+            log.data = decompressLogData(data);
+        }
+        if(_topics){
+            if(!MatchLogTopics(tri.logs, *_topics)){
+                tri.logs.clear();
+                continue;
+            }
+            for(size_t j = 0; j < tri.logs.size(); j++){
+                auto begin = _value.begin() + dataPos[j].first;
+                tri.logs[j].data = decompressLogData(std::vector<unsigned char>(begin, begin + dataPos[j].second));
+            }
+        }
+        if((fields & RECEIPT_BLOOM) && bloomFormats[i] == BLOOM_FROM_LOGS)
+            tri.bloom = logsBloom(tri.logs);
+        if(!(fields & RECEIPT_LOGS))
+            tri.logs.clear();
+    }
+}
+
+void StorageResults::decodeLegacyResult(std::string const& _value, std::vector<TransactionReceiptInfo>& _result){
         TransactionReceiptInfoSerialized tris;
 
-		dev::RLP state(value);
+		dev::RLP state(_value);
         tris.blockHashes = state[0].toVector<dev::h256>();
 		tris.blockNumbers = state[1].toVector<uint32_t>();
 		tris.transactionHashes = state[2].toVector<dev::h256>();
@@ -167,17 +589,6 @@ bool StorageResults::readResult(dev::h256 const& _key, std::vector<TransactionRe
             };
             _result.push_back(tri);
         }
-		return true;
-	}
-	return false;
-}
-
-logEntriesSerialize StorageResults::logEntriesSerialization(dev::eth::LogEntries const& _logs){
-	logEntriesSerialize result;
-	for(dev::eth::LogEntry i : _logs){
-		result.push_back(std::make_pair(i.address, std::make_pair(i.topics, i.data)));
-	}
-	return result;
 }
 
 dev::eth::LogEntries StorageResults::logEntriesDeserialize(logEntriesSerialize const& _logs){
@@ -1,10 +1,18 @@
+#ifndef YODY_STORAGERESULTS_H
+#define YODY_STORAGERESULTS_H
+
 #include <uint256.h>
 #include <primitives/transaction.h>
 #include <libethereum/State.h>
 #include <libethereum/Transaction.h>
 #include <leveldb/db.h>
+#include <sync.h>
 #include <util/system.h>
 
+#include <functional>
+#include <optional>
+#include <set>
+
 using logEntriesSerialize = std::vector<std::pair<dev::Address, std::pair<dev::h256s, dev::bytes>>>;
 
 struct TransactionReceiptInfo{
@@ -45,6 +53,47 @@ struct TransactionReceiptInfoSerialized{
     std::vector<dev::h256> utxoRoots;
 };
 
+/**
+ * Typed filter of a log search, with the parameters of searchlogs. The transactions with logs sent from one
+ * of the addresses (any without addresses) in the blocks from fromBlock to toBlock (the tip if -1) with at
+ * least minconf confirmations are searched. Their receipts match when one of their logs has one of the
+ * topics at its position, all of them match without topics.
+ */
+struct LogFilter {
+    int fromBlock{0};
+    int toBlock{-1};
+    int minconf{0};
+    std::set<dev::h160> addresses;
+    std::vector<std::optional<dev::h256>> topics;
+};
+
+/** Called for each log of the receipts matching a log search, in block order, until it returns false. */
+using LogMatchFn = std::function<bool(const TransactionReceiptInfo& receipt, const dev::eth::LogEntry& log)>;
+
+/** Whether one of the logs has one of the topics at its position, any logs match without topics. */
+bool MatchLogTopics(dev::eth::LogEntries const& logs, std::vector<std::optional<dev::h256>> const& topics);
+
+/** Parts of the receipts decoded by StorageResults::getResult, the rest is left default initialized. */
+enum ReceiptFields : uint32_t {
+    RECEIPT_BASE  = 0,      // block, transaction, addresses, gas and exception
+    RECEIPT_LOGS  = 1 << 0, // log entries
+    RECEIPT_BLOOM = 1 << 1, // bloom, recomputed from the logs for the columnar format
+    RECEIPT_ROOTS = 1 << 2, // state and UTXO roots
+    RECEIPT_ALL   = RECEIPT_LOGS | RECEIPT_BLOOM | RECEIPT_ROOTS,
+};
+
+/** Memory used by results waiting to be written, above which they are written without waiting for a chainstate flush. */
+static const size_t MAX_PENDING_RESULTS_USAGE = 32 << 20;
+
+/**
+ * Receipts of the contract transactions, stored when -logevents is enabled.
+ *
+ * The results of the block being connected are staged by addResult and moved to
+ * a pending buffer by commitResults once the block is connected. The pending
+ * results and deletions of disconnected blocks are written in one batch by
+ * flushResults, which is called from CChainState::FlushStateToDisk before the
+ * coins are flushed, so the receipts database is never behind the chainstate.
+ */
 class StorageResults{
 
 public:
@@ -52,23 +101,55 @@ public:
 	StorageResults(std::string const& _path);
     ~StorageResults();
 
-	void addResult(dev::h256 hashTx, std::vector<TransactionReceiptInfo>& result);
+	void addResult(dev::h256 hashTx, std::vector<TransactionReceiptInfo> result);
 
     void deleteResults(std::vector<CTransactionRef> const& txs);
 
-    std::vector<TransactionReceiptInfo> getResult(dev::h256 const& hashTx);
+    std::vector<TransactionReceiptInfo> getResult(dev::h256 const& hashTx, uint32_t fields = RECEIPT_ALL);
 
+    /**
+     * Pass the logs of the receipts of a transaction matching the topics to fn, until it returns false.
+     * The log data of the other receipts is not decoded. Returns false if fn stopped the search.
+     */
+    bool searchLogs(dev::h256 const& hashTx, std::vector<std::optional<dev::h256>> const& topics, LogMatchFn const& fn);
+
+    /** Move the staged results of the connected block to the pending buffer. */
 	void commitResults();
 
+    /**
+     * Add the results of a block connected before -logevents was enabled, replayed by the
+     * receipt index, to the pending buffer. They are not staged as the block being connected.
+     */
+    void addReplayedResults(std::vector<std::pair<dev::h256, std::vector<TransactionReceiptInfo>>> results);
+
+    /** Drop the staged results of a block which failed to connect. */
     void clearCacheResult();
 
+    /** Write the pending results and deletions in one synchronous batch. */
+    bool flushResults();
+
+    /** Approximate memory used by the pending results. */
+    size_t pendingResultsUsage();
+
     void wipeResults();
 
+    /** Rewrite the results stored in the legacy RLP format into the columnar format. */
+    bool upgradeResults();
+
 private:
 
-	bool readResult(dev::h256 const& _key, std::vector<TransactionReceiptInfo>& _result);
+	bool readResult(dev::h256 const& _key, std::vector<TransactionReceiptInfo>& _result, uint32_t fields = RECEIPT_ALL, std::vector<std::optional<dev::h256>> const* _topics = nullptr);
+
+    /** Copy the result of the block being connected or waiting to be written, returns false if it is not in memory. */
+    bool getCachedResult(dev::h256 const& hashTx, std::vector<TransactionReceiptInfo>& result);
+
+    void addPendingResult(dev::h256 const& hashTx, std::vector<TransactionReceiptInfo>&& result) EXCLUSIVE_LOCKS_REQUIRED(cs_results);
 
-	logEntriesSerialize logEntriesSerialization(dev::eth::LogEntries const& _logs);
+    std::string encodeResult(std::vector<TransactionReceiptInfo> const& _result);
+
+    void decodeResult(std::string const& _value, std::vector<TransactionReceiptInfo>& _result, uint32_t fields, std::vector<std::optional<dev::h256>> const* _topics = nullptr);
+
+    void decodeLegacyResult(std::string const& _value, std::vector<TransactionReceiptInfo>& _result);
 
 	dev::eth::LogEntries logEntriesDeserialize(logEntriesSerialize const& _logs);
 
@@ -76,5 +157,14 @@ private:
 
     leveldb::DB* db;
 
-	std::unordered_map<dev::h256, std::vector<TransactionReceiptInfo>> m_cache_result;
+    Mutex cs_results;
+
+    /** Results of the block being connected. */
+	std::unordered_map<dev::h256, std::vector<TransactionReceiptInfo>> m_cache_result GUARDED_BY(cs_results);
+
+    /** Results of connected blocks not written yet, no value marks the result of a disconnected block to delete. */
+    std::unordered_map<dev::h256, std::optional<std::vector<TransactionReceiptInfo>>> m_pending_results GUARDED_BY(cs_results);
+
+    size_t m_pending_usage GUARDED_BY(cs_results) = 0;
 };
+#endif
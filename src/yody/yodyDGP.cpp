@@ -1,6 +1,90 @@
 #include <yody/yodyDGP.h>
 #include <chainparams.h>
 
+YodyDGPCache g_dgp_cache;
+
+/** Bound on the number of state roots the account versions are memoized for. */
+static const size_t MAX_DGP_CACHE_ROOTS = 32;
+/** Bound on the number of contract versions kept, DGP parameters change rarely. */
+static const size_t MAX_DGP_CACHE_ENTRIES = 256;
+
+YodyDGPCache::AccountVersion YodyDGPCache::getAccountVersion(const YodyState& state, const dev::Address& addr){
+    dev::h256 root = state.rootHash();
+    {
+        LOCK(cs);
+        auto itRoot = accountVersions.find(root);
+        if(itRoot != accountVersions.end()){
+            auto it = itRoot->second.find(addr);
+            if(it != itRoot->second.end())
+                return it->second;
+        }
+    }
+
+    AccountVersion version = std::make_pair(state.storageRoot(addr), state.codeHash(addr));
+
+    LOCK(cs);
+    if(accountVersions.size() >= MAX_DGP_CACHE_ROOTS && !accountVersions.count(root))
+        accountVersions.clear();
+    accountVersions[root][addr] = version;
+    return version;
+}
+
+bool YodyDGPCache::getParamsInstance(const dev::Address& addr, const AccountVersion& version, DGPParamsInstance& paramsInstance){
+    LOCK(cs);
+    auto it = paramsInstances.find(std::make_pair(addr, version));
+    if(it == paramsInstances.end())
+        return false;
+    paramsInstance = it->second;
+    return true;
+}
+
+void YodyDGPCache::setParamsInstance(const dev::Address& addr, const AccountVersion& version, const DGPParamsInstance& paramsInstance){
+    LOCK(cs);
+    if(paramsInstances.size() >= MAX_DGP_CACHE_ENTRIES)
+        paramsInstances.clear();
+    paramsInstances[std::make_pair(addr, version)] = paramsInstance;
+}
+
+bool YodyDGPCache::getStorageTemplate(const dev::Address& addr, const AccountVersion& version, std::map<dev::h256, std::pair<dev::u256, dev::u256>>& storage){
+    LOCK(cs);
+    auto it = storageTemplates.find(std::make_pair(addr, version));
+    if(it == storageTemplates.end())
+        return false;
+    storage = it->second;
+    return true;
+}
+
+void YodyDGPCache::setStorageTemplate(const dev::Address& addr, const AccountVersion& version, const std::map<dev::h256, std::pair<dev::u256, dev::u256>>& storage){
+    LOCK(cs);
+    if(storageTemplates.size() >= MAX_DGP_CACHE_ENTRIES)
+        storageTemplates.clear();
+    storageTemplates[std::make_pair(addr, version)] = storage;
+}
+
+bool YodyDGPCache::getDataTemplate(const dev::Address& addr, const AccountVersion& version, const std::vector<unsigned char>& data, std::vector<unsigned char>& output){
+    LOCK(cs);
+    auto it = dataTemplates.find(std::make_pair(std::make_pair(addr, version), data));
+    if(it == dataTemplates.end())
+        return false;
+    output = it->second;
+    return true;
+}
+
+void YodyDGPCache::setDataTemplate(const dev::Address& addr, const AccountVersion& version, const std::vector<unsigned char>& data, const std::vector<unsigned char>& output){
+    LOCK(cs);
+    if(dataTemplates.size() >= MAX_DGP_CACHE_ENTRIES)
+        dataTemplates.clear();
+    dataTemplates[std::make_pair(std::make_pair(addr, version), data)] = output;
+}
+
+void YodyDGPCache::clear(){
+    LOCK(cs);
+    accountVersions.clear();
+    paramsInstances.clear();
+    storageTemplates.clear();
+    dataTemplates.clear();
+}
+
 std::vector<uint32_t> createDataSchedule(const dev::eth::EVMSchedule& schedule)
 {
     std::vector<uint32_t> tempData = {schedule.tierStepGas[0], schedule.tierStepGas[1], schedule.tierStepGas[2],
@@ -98,8 +182,12 @@ uint64_t YodyDGP::getBlockGasLimit(unsigned int blockHeight){
 }
 
 bool YodyDGP::initStorages(const dev::Address& addr, unsigned int blockHeight, std::vector<unsigned char> data){
-    initStorageDGP(addr);
-    createParamsInstance();
+    YodyDGPCache::AccountVersion version = g_dgp_cache.getAccountVersion(*state, addr);
+    if(!g_dgp_cache.getParamsInstance(addr, version, paramsInstance)){
+        initStorageDGP(addr);
+        createParamsInstance();
+        g_dgp_cache.setParamsInstance(addr, version, paramsInstance);
+    }
     dev::Address address = getAddressForBlock(blockHeight);
     if(address != dev::Address()){
         if(!dgpevm){
@@ -117,14 +205,28 @@ void YodyDGP::initStorageDGP(const dev::Address& addr){
 }
 
 void YodyDGP::initStorageTemplate(const dev::Address& addr){
-    storageTemplate = state->storage(addr);
+    YodyDGPCache::AccountVersion version = g_dgp_cache.getAccountVersion(*state, addr);
+    if(!g_dgp_cache.getStorageTemplate(addr, version, storageTemplate)){
+        storageTemplate = state->storage(addr);
+        g_dgp_cache.setStorageTemplate(addr, version, storageTemplate);
+    }
 }
 
 void YodyDGP::initDataTemplate(const dev::Address& addr, std::vector<unsigned char>& data){
-    dataTemplate = CallContract(addr, data, chainstate)[0].execRes.output;
+    YodyDGPCache::AccountVersion version = g_dgp_cache.getAccountVersion(*state, addr);
+    if(!g_dgp_cache.getDataTemplate(addr, version, data, dataTemplate)){
+        if(callContext){
+            // Call the template on the state the DGP is read from, which is not the tip when replaying a past block
+            dataTemplate = CallContractSnapshot(callContext, callGasLimit, state->rootHash(), state->rootHashUTXO()).Call(addr, data)[0].execRes.output;
+        } else {
+            dataTemplate = CallContract(addr, data, chainstate)[0].execRes.output;
+        }
+        g_dgp_cache.setDataTemplate(addr, version, data, dataTemplate);
+    }
 }
 
 void YodyDGP::createParamsInstance(){
+    DGPParamsInstance proposals;
     dev::h256 paramsInstanceHash = sha3(dev::h256("0000000000000000000000000000000000000000000000000000000000000000"));
     if(storageDGP.count(paramsInstanceHash)){
         dev::u256 paramsInstanceSize = storageDGP.find(paramsInstanceHash)->second.second;
@@ -134,17 +236,33 @@ void YodyDGP::createParamsInstance(){
             ++paramsInstanceHash;
             params.second = dev::right160(dev::h256(storageDGP.find(sha3(paramsInstanceHash))->second.second));
             ++paramsInstanceHash;
-            paramsInstance.push_back(params);
+            proposals.push_back(params);
+        }
+    }
+
+    // The last proposal with an activation height not above the block wins, store the
+    // resulting schedule sorted by activation height so getAddressForBlock can bisect it
+    std::vector<unsigned int> heights;
+    for(const auto& params : proposals)
+        heights.push_back(params.first);
+    std::sort(heights.begin(), heights.end());
+    heights.erase(std::unique(heights.begin(), heights.end()), heights.end());
+    for(unsigned int height : heights){
+        for(auto i = proposals.rbegin(); i != proposals.rend(); i++){
+            if(i->first <= height){
+                paramsInstance.push_back(std::make_pair(height, i->second));
+                break;
+            }
         }
     }
 }
 
 dev::Address YodyDGP::getAddressForBlock(unsigned int blockHeight){
-    for(auto i = paramsInstance.rbegin(); i != paramsInstance.rend(); i++){
-        if(i->first <= blockHeight)
-            return i->second;
-    }
-    return dev::Address();
+    auto it = std::upper_bound(paramsInstance.begin(), paramsInstance.end(), blockHeight,
+        [](unsigned int height, const std::pair<unsigned int, dev::Address>& params){ return height < params.first; });
+    if(it == paramsInstance.begin())
+        return dev::Address();
+    return std::prev(it)->second;
 }
 
 static inline bool sortPairs(const std::pair<dev::u256, dev::u256>& a, const std::pair<dev::u256, dev::u256>& b){
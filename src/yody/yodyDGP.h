@@ -5,6 +5,7 @@
 #include <primitives/block.h>
 #include <validation.h>
 #include <util/strencodings.h>
+#include <sync.h>
 
 static const dev::Address GasScheduleDGP = dev::Address("0000000000000000000000000000000000000080");
 static const dev::Address BlockSizeDGP = dev::Address("0000000000000000000000000000000000000081");
@@ -24,12 +25,70 @@ static const uint64_t MIN_BLOCK_GAS_LIMIT_DGP = 1000000;
 static const uint64_t MAX_BLOCK_GAS_LIMIT_DGP = 1000000000;
 static const uint64_t DEFAULT_BLOCK_GAS_LIMIT_DGP = 40000000;
 
+struct CallContractContext;
+
+typedef std::vector<std::pair<unsigned int, dev::Address>> DGPParamsInstance;
+
+/**
+ * Cache for the values YodyDGP reads from the DGP and template contracts.
+ * Entries are keyed by the storage root and code hash of the contract they were read from,
+ * so they stay valid until a block writes to that contract and are picked up again when
+ * the block is disconnected. Account versions are memoized per state root, which makes
+ * repeated queries against the same state free of trie access.
+ */
+class YodyDGPCache {
+
+public:
+
+    typedef std::pair<dev::h256, dev::h256> AccountVersion;
+
+    AccountVersion getAccountVersion(const YodyState& state, const dev::Address& addr);
+
+    bool getParamsInstance(const dev::Address& addr, const AccountVersion& version, DGPParamsInstance& paramsInstance);
+
+    void setParamsInstance(const dev::Address& addr, const AccountVersion& version, const DGPParamsInstance& paramsInstance);
+
+    bool getStorageTemplate(const dev::Address& addr, const AccountVersion& version, std::map<dev::h256, std::pair<dev::u256, dev::u256>>& storage);
+
+    void setStorageTemplate(const dev::Address& addr, const AccountVersion& version, const std::map<dev::h256, std::pair<dev::u256, dev::u256>>& storage);
+
+    bool getDataTemplate(const dev::Address& addr, const AccountVersion& version, const std::vector<unsigned char>& data, std::vector<unsigned char>& output);
+
+    void setDataTemplate(const dev::Address& addr, const AccountVersion& version, const std::vector<unsigned char>& data, const std::vector<unsigned char>& output);
+
+    void clear();
+
+private:
+
+    typedef std::pair<dev::Address, AccountVersion> AccountKey;
+
+    Mutex cs;
+
+    std::map<dev::h256, std::map<dev::Address, AccountVersion>> accountVersions GUARDED_BY(cs);
+
+    std::map<AccountKey, DGPParamsInstance> paramsInstances GUARDED_BY(cs);
+
+    std::map<AccountKey, std::map<dev::h256, std::pair<dev::u256, dev::u256>>> storageTemplates GUARDED_BY(cs);
+
+    std::map<std::pair<AccountKey, std::vector<unsigned char>>, std::vector<unsigned char>> dataTemplates GUARDED_BY(cs);
+
+};
+
+extern YodyDGPCache g_dgp_cache;
+
 class YodyDGP {
     
 public:
 
     YodyDGP(YodyState* _state, CChainState& _chainstate, bool _dgpevm = true) : dgpevm(_dgpevm), state(_state), chainstate(_chainstate) { initDataSchedule(); }
 
+    /**
+     * DGP read from a state that is not the tip, the state after the block of the context.
+     * The templates are called on top of that block with the given block gas limit.
+     */
+    YodyDGP(YodyState* _state, CChainState& _chainstate, bool _dgpevm, std::shared_ptr<const CallContractContext> _callContext, uint64_t _callGasLimit) :
+        dgpevm(_dgpevm), state(_state), chainstate(_chainstate), callContext(std::move(_callContext)), callGasLimit(_callGasLimit) { initDataSchedule(); }
+
     dev::eth::EVMSchedule getGasSchedule(int blockHeight);
 
     uint32_t getBlockSize(unsigned int blockHeight);
@@ -78,6 +137,10 @@ private:
 
     CChainState& chainstate;
 
+    std::shared_ptr<const CallContractContext> callContext;
+
+    uint64_t callGasLimit = 0;
+
     dev::Address templateContract;
 
     std::map<dev::h256, std::pair<dev::u256, dev::u256>> storageDGP;
@@ -86,7 +149,7 @@ private:
 
     std::vector<unsigned char> dataTemplate;
 
-    std::vector<std::pair<unsigned int, dev::Address>> paramsInstance;
+    DGPParamsInstance paramsInstance;
 
     std::vector<uint32_t> dataSchedule;
 
@@ -189,11 +189,8 @@ bool YodyDelegation::GetDelegation(const uint160 &address, Delegation &delegatio
         return error("Failed to serialize get delegation input parameters");
 
     // Get delegation for address
-    std::vector<ResultExecute> execResults;
-    {
-        LOCK(cs_main);
-        execResults = CallContract(priv->delegationsAddress, ParseHex(inputData), chainstate);
-    }
+    std::unique_ptr<CallContractSnapshot> snapshot = WITH_LOCK(cs_main, return std::make_unique<CallContractSnapshot>(chainstate));
+    std::vector<ResultExecute> execResults = snapshot->Call(priv->delegationsAddress, ParseHex(inputData));
     if(execResults.size() < 1)
         return error("Failed to CallContract to get delegation for address");
 
@@ -297,7 +294,7 @@ bool YodyDelegation::FilterDelegationEvents(std::vector<DelegationEvent> &events
             }
             dupes.insert(e);
 
-            std::vector<TransactionReceiptInfo> receipts = pstorageresult->getResult(uintToh256(e));
+            std::vector<TransactionReceiptInfo> receipts = pstorageresult->getResult(uintToh256(e), RECEIPT_LOGS);
             for(const auto& receipt : receipts) {
                 if(receipt.logs.empty()) {
                     continue;
@@ -318,6 +315,71 @@ bool YodyDelegation::FilterDelegationEvents(std::vector<DelegationEvent> &events
     return true;
 }
 
+bool YodyDelegation::GetDelegationEvent(const dev::eth::LogEntry& log, DelegationEvent& event) const
+{
+    return priv->GetDelegationEvent(log, event);
+}
+
+bool YodyDelegation::GetDelegationsForStaker(const uint160& staker, std::map<uint160, Delegation>& delegations) const
+{
+    // The delegation index is maintained with the log events
+    if(!fLogEvents)
+        return error("Events indexing disabled");
+
+    LOCK(cs_main);
+    return pblocktree->ReadStakerDelegations(staker, delegations);
+}
+
+bool YodyDelegation::GetDelegationForDelegate(const uint160& delegate, Delegation& delegation) const
+{
+    // The delegation index is maintained with the log events
+    if(!fLogEvents)
+        return error("Events indexing disabled");
+
+    LOCK(cs_main);
+    return pblocktree->ReadDelegation(delegate, delegation);
+}
+
+bool YodyDelegation::BuildDelegationIndex(ChainstateManager& chainman) const
+{
+    class AllDelegations : public IDelegationFilter
+    {
+    public:
+        bool Match(const DelegationEvent&) const override { return true; }
+    } filter;
+
+    LOCK(cs_main);
+    if(!pblocktree->WipeDelegationIndex())
+        return error("Failed to wipe the delegation index");
+
+    int nHeight = chainman.ActiveChain().Height();
+    if(ExistDelegationContract() && nHeight > 0)
+    {
+        // Blocks older than the sync checkpoint can not be disconnected, so they are
+        // written without undo data, the recent ones are added block by block
+        int cpsHeight = std::max(0, nHeight - Params().GetConsensus().MaxCheckpointSpan());
+        if(cpsHeight > 0)
+        {
+            std::vector<DelegationEvent> events;
+            if(!FilterDelegationEvents(events, filter, chainman, 0, cpsHeight))
+                return false;
+            if(!pblocktree->UpdateDelegationIndex(cpsHeight, events, false))
+                return error("Failed to write the delegation index");
+        }
+
+        for(int height = cpsHeight + 1; height <= nHeight; height++)
+        {
+            std::vector<DelegationEvent> events;
+            if(!FilterDelegationEvents(events, filter, chainman, height, height))
+                return false;
+            if(!events.empty() && !pblocktree->UpdateDelegationIndex(height, events))
+                return error("Failed to write the delegation index");
+        }
+    }
+
+    return pblocktree->WriteFlag("delegationindex", true);
+}
+
 std::map<uint160, Delegation> YodyDelegation::DelegationsFromEvents(const std::vector<DelegationEvent> &events)
 {
     std::map<uint160, Delegation> delegations;
@@ -4,12 +4,14 @@
 #include <vector>
 #include <map>
 #include <stdint.h>
+#include <serialize.h>
 #include <uint256.h>
 
 class YodyDelegationPriv;
 class ContractABI;
 class ChainstateManager;
 class CChainState;
+namespace dev { namespace eth { struct LogEntry; } }
 
 extern const std::string strDelegationsABI;
 const ContractABI &DelegationABI();
@@ -32,6 +34,8 @@ struct Delegation
     uint8_t fee;
     uint32_t blockHeight;
     std::vector<unsigned char> PoD; //Proof Of Delegation
+
+    SERIALIZE_METHODS(Delegation, obj) { READWRITE(obj.staker, obj.fee, obj.blockHeight, obj.PoD); }
 };
 
 inline bool operator==(const Delegation& lhs, const Delegation& rhs)
@@ -131,6 +135,38 @@ public:
      */
     bool FilterDelegationEvents(std::vector<DelegationEvent>& events, const IDelegationFilter& filter, ChainstateManager &chainman, int fromBlock = 0, int toBlock = -1, int minconf = 0) const;
 
+    /**
+     * @brief GetDelegationEvent Decode delegation event from log entry
+     * @param log Log entry emitted by a contract
+     * @param event Output delegation event
+     * @return true if the log is a delegation event, false otherwise
+     */
+    bool GetDelegationEvent(const dev::eth::LogEntry& log, DelegationEvent& event) const;
+
+    /**
+     * @brief GetDelegationsForStaker Get the current delegations to a staker from the delegation index
+     * @param staker Staker address
+     * @param delegations Output list of delegations for the staker
+     * @return true/false
+     */
+    bool GetDelegationsForStaker(const uint160& staker, std::map<uint160, Delegation>& delegations) const;
+
+    /**
+     * @brief GetDelegationForDelegate Get the current delegation of a delegate from the delegation index
+     * @param delegate Delegate address
+     * @param delegation Output delegation
+     * @return true if the delegate has a delegation, false otherwise
+     */
+    bool GetDelegationForDelegate(const uint160& delegate, Delegation& delegation) const;
+
+    /**
+     * @brief BuildDelegationIndex Build the delegation index from the delegation events,
+     * needed when the block tree database was created before the index existed
+     * @param chainman Chain state manager
+     * @return true/false
+     */
+    bool BuildDelegationIndex(ChainstateManager& chainman) const;
+
     /**
      * @brief DelegationsFromEvents Get the delegations from the events
      * @param events Delegation event list
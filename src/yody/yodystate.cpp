@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <sstream>
 #include <util/system.h>
 #include <validation.h>
@@ -17,19 +18,28 @@ YodyState::YodyState(u256 const& _accountStartNonce, OverlayDB const& _db, const
 	        stateUTXO = SecureTrieDB<Address, OverlayDB>(&dbUTXO);
 }
 
+YodyState::YodyState(YodyState const& _state, h256 const& _root, h256 const& _rootUTXO) :
+        State(_state.accountStartNonce(), _state.db(), BaseState::PreExisting),
+        dbUTXO(_state.dbUTXO),
+        stateUTXO(&dbUTXO) {
+    setRoot(_root);
+    setRootUTXO(_rootUTXO);
+}
+
 YodyState::YodyState() : dev::eth::State(dev::Invalid256, dev::OverlayDB(), dev::eth::BaseState::PreExisting) {
     dbUTXO = OverlayDB();
     stateUTXO = SecureTrieDB<Address, OverlayDB>(&dbUTXO);
 }
 
 ResultExecute YodyState::execute(EnvInfo const& _envInfo, SealEngineFace const& _sealEngine, YodyTransaction const& _t, CChain& _chain, Permanence _p, OnOpFunc const& _onOp){
+    return execute(_envInfo, _sealEngine, _t, _chain.Height(), _p, _onOp);
+}
 
-    assert(_t.getVersion().toRaw() == VersionVM::GetEVMDefault().toRaw());
+ResultExecute YodyState::execute(EnvInfo const& _envInfo, SealEngineFace const& _sealEngine, YodyTransaction const& _t, int _chainHeight, Permanence _p, OnOpFunc const& _onOp){
 
-    addBalance(_t.sender(), _t.value() + (_t.gas() * _t.gasPrice()));
-    newAddress = _t.isCreation() ? createYodyAddress(_t.getHashWith(), _t.getNVout()) : dev::Address();
+    assert(_t.getVersion().toRaw() == VersionVM::GetEVMDefault().toRaw());
 
-    _sealEngine.deleteAddresses.insert({_t.sender(), _envInfo.author()});
+    beginExecution(_envInfo, _sealEngine, _t);
 
     h256 oldStateRoot = rootHash();
     h256 oldUTXORoot = rootHashUTXO();
@@ -47,72 +57,168 @@ ResultExecute YodyState::execute(EnvInfo const& _envInfo, SealEngineFace const&
 	e.setResultRecipient(res);
 
     CTransactionRef tx;
+    std::vector<dev::Address> changedAccounts;
     u256 startGasUsed;
     const Consensus::Params& consensusParams = Params().GetConsensus();
     try{
-        if (_t.isCreation() && _t.value())
-            BOOST_THROW_EXCEPTION(CreateWithValue());
-
-        e.initialize(_t);
-        // OK - transaction looks valid - execute.
-        startGasUsed = _envInfo.gasUsed();
-        if (!e.execute()){
-            e.go(onOp);
-            if(_chain.Height() >= consensusParams.QIP7Height){
-            	validateTransfersWithChangeLog();
-            }
-        } else {
-            e.revert();
-            throw Exception();
-        }
-        e.finalize();
+        runExecutive(e, _envInfo, _t, _chainHeight, onOp, startGasUsed);
         if (_p == Permanence::Reverted){
+            noteAccess();
             m_cache.clear();
             cacheUTXO.clear();
             m_changeLog.clear();
             m_unchangedCacheEntries.clear();
-        } else {
-            deleteAccounts(_sealEngine.deleteAddresses);
-            if(res.excepted == TransactionException::None){
-                CondensingTX ctx(this, transfers, _t, _sealEngine.deleteAddresses);
-                tx = MakeTransactionRef(ctx.createCondensingTX());
-                if(ctx.reachedVoutLimit()){
-                    voutLimit = true;
-                    e.revert();
-                    throw Exception();
-                }
-                std::unordered_map<dev::Address, Vin> vins = ctx.createVin(*tx);
-                updateUTXO(vins);
-            } else {
-                printfErrorLog(res.excepted);
-            }
-
-            yody::commit(cacheUTXO, stateUTXO, m_cache);
-            cacheUTXO.clear();
-            bool removeEmptyAccounts = _envInfo.number() >= _sealEngine.chainParams().EIP158ForkBlock;
-            commit(removeEmptyAccounts ? State::CommitBehaviour::RemoveEmptyAccounts : State::CommitBehaviour::KeepEmptyAccounts);
+        } else if(!commitExecution(_envInfo, _sealEngine, _t, res, tx, changedAccounts)){
+            voutLimit = true;
+            e.revert();
+            throw Exception();
         }
     }
     catch(Exception const& _e){
         printfErrorLog(dev::eth::toTransactionException(_e));
         res.excepted = dev::eth::toTransactionException(_e);
         res.gasUsed = _t.gas();
-        if(_chain.Height() < consensusParams.nFixUTXOCacheHFHeight  && _p != Permanence::Reverted){
+        if(_chainHeight < consensusParams.nFixUTXOCacheHFHeight  && _p != Permanence::Reverted){
             deleteAccounts(_sealEngine.deleteAddresses);
+            addChangedAccounts(changedAccounts);
             commit(CommitBehaviour::RemoveEmptyAccounts);
         } else {
+            if(_p == Permanence::Reverted)
+                noteAccess();
             m_cache.clear();
             cacheUTXO.clear();
         }
     }
 
+    const u256 gasUsed = startGasUsed + e.gasUsed();
+    return executionResult(_t, res, voutLimit, oldStateRoot, oldUTXORoot, gasUsed, e.takeLogs(), tx, changedAccounts);
+}
+
+void YodyState::executeSpeculative(EnvInfo const& _envInfo, SealEngineFace const& _sealEngine, YodyTransaction const& _t, int _chainHeight, SpeculativeExecution& _out){
+
+    assert(_t.getVersion().toRaw() == VersionVM::GetEVMDefault().toRaw());
+
+    recordAccessedAccounts(true);
+    beginExecution(_envInfo, _sealEngine, _t);
+
+	Executive e(*this, _envInfo, _sealEngine);
+	e.setResultRecipient(_out.execRes);
+    try{
+        runExecutive(e, _envInfo, _t, _chainHeight, OnOpFunc(), _out.startGasUsed);
+        // The changes are committed by commitSpeculative, as commitExecution would commit them here
+        _out.cache = std::move(m_cache);
+        _out.cacheUTXO = std::move(cacheUTXO);
+        _out.transfers = transfers;
+        _out.deleteAddresses = _sealEngine.deleteAddresses;
+    }
+    catch(Exception const& _e){
+        _out.thrown = true;
+        _out.execRes.excepted = dev::eth::toTransactionException(_e);
+        _out.execRes.gasUsed = _t.gas();
+    }
+    _out.gasUsed = e.gasUsed();
+    _out.logs = e.takeLogs();
+    _out.accessed = accessedAccounts();
+
+    recordAccessedAccounts(false);
+    m_cache.clear();
+    cacheUTXO.clear();
+    m_changeLog.clear();
+    m_unchangedCacheEntries.clear();
+    newAddress = dev::Address();
+    transfers.clear();
+}
+
+ResultExecute YodyState::commitSpeculative(EnvInfo const& _envInfo, SealEngineFace const& _sealEngine, YodyTransaction const& _t, SpeculativeExecution&& _spec){
+    h256 oldStateRoot = rootHash();
+    h256 oldUTXORoot = rootHashUTXO();
+    bool voutLimit = false;
+
+    ExecutionResult res = _spec.execRes;
+    CTransactionRef tx;
+    std::vector<dev::Address> changedAccounts;
+    if(!_spec.thrown){
+        for(auto& i : _spec.cache){
+            m_nonExistingAccountsCache.erase(i.first);
+            m_cache.insert_or_assign(i.first, std::move(i.second));
+        }
+        for(auto const& i : _spec.cacheUTXO)
+            cacheUTXO.insert_or_assign(i.first, i.second);
+        transfers = std::move(_spec.transfers);
+        _sealEngine.deleteAddresses.insert(_spec.deleteAddresses.begin(), _spec.deleteAddresses.end());
+        voutLimit = !commitExecution(_envInfo, _sealEngine, _t, res, tx, changedAccounts);
+    }
+    if(_spec.thrown || voutLimit){
+        // As the exceptions of execute() above the UTXO cache fix height
+        const TransactionException excepted = voutLimit ? dev::eth::toTransactionException(Exception()) : res.excepted;
+        printfErrorLog(excepted);
+        res.excepted = excepted;
+        res.gasUsed = _t.gas();
+        m_cache.clear();
+        cacheUTXO.clear();
+        m_changeLog.clear();
+    }
+
+    return executionResult(_t, res, voutLimit, oldStateRoot, oldUTXORoot, _spec.startGasUsed + _spec.gasUsed, std::move(_spec.logs), tx, changedAccounts);
+}
+
+void YodyState::beginExecution(EnvInfo const& _envInfo, SealEngineFace const& _sealEngine, YodyTransaction const& _t){
+    addBalance(_t.sender(), _t.value() + (_t.gas() * _t.gasPrice()));
+    newAddress = _t.isCreation() ? createYodyAddress(_t.getHashWith(), _t.getNVout()) : dev::Address();
+
+    _sealEngine.deleteAddresses.insert({_t.sender(), _envInfo.author()});
+}
+
+void YodyState::runExecutive(Executive& _e, EnvInfo const& _envInfo, YodyTransaction const& _t, int _chainHeight, OnOpFunc const& _onOp, u256& _startGasUsed){
+    if (_t.isCreation() && _t.value())
+        BOOST_THROW_EXCEPTION(CreateWithValue());
+
+    _e.initialize(_t);
+    // OK - transaction looks valid - execute.
+    _startGasUsed = _envInfo.gasUsed();
+    if (!_e.execute()){
+        _e.go(_onOp);
+        if(_chainHeight >= Params().GetConsensus().QIP7Height){
+            validateTransfersWithChangeLog();
+        }
+    } else {
+        _e.revert();
+        throw Exception();
+    }
+    _e.finalize();
+}
+
+bool YodyState::commitExecution(EnvInfo const& _envInfo, SealEngineFace const& _sealEngine, YodyTransaction const& _t, ExecutionResult const& _res, CTransactionRef& _tx, std::vector<dev::Address>& _changedAccounts){
+    deleteAccounts(_sealEngine.deleteAddresses);
+    if(_res.excepted == TransactionException::None){
+        CondensingTX ctx(this, transfers, _t, _sealEngine.deleteAddresses);
+        _tx = MakeTransactionRef(ctx.createCondensingTX());
+        if(ctx.reachedVoutLimit()){
+            return false;
+        }
+        std::unordered_map<dev::Address, Vin> vins = ctx.createVin(*_tx);
+        updateUTXO(vins);
+    } else {
+        printfErrorLog(_res.excepted);
+    }
+
+    AddressHash committedUTXO = yody::commit(cacheUTXO, stateUTXO, m_cache);
+    if(m_recordCommitted)
+        m_committedAccounts.insert(committedUTXO.begin(), committedUTXO.end());
+    cacheUTXO.clear();
+    addChangedAccounts(_changedAccounts);
+    bool removeEmptyAccounts = _envInfo.number() >= _sealEngine.chainParams().EIP158ForkBlock;
+    commit(removeEmptyAccounts ? State::CommitBehaviour::RemoveEmptyAccounts : State::CommitBehaviour::KeepEmptyAccounts);
+    return true;
+}
+
+ResultExecute YodyState::executionResult(YodyTransaction const& _t, ExecutionResult& _res, bool _voutLimit, h256 const& _oldStateRoot, h256 const& _oldUTXORoot, u256 const& _gasUsed, LogEntries&& _logs, CTransactionRef const& _tx, std::vector<dev::Address>& _changedAccounts){
     if(!_t.isCreation())
-        res.newAddress = _t.receiveAddress();
+        _res.newAddress = _t.receiveAddress();
     newAddress = dev::Address();
     transfers.clear();
-    if(voutLimit){
+    if(_voutLimit){
         //use old and empty states to create virtual Out Of Gas exception
-        LogEntries logs;
         u256 gas = _t.gas();
         ExecutionResult ex;
         ex.gasRefunded=0;
@@ -127,9 +233,9 @@ ResultExecute YodyState::execute(EnvInfo const& _envInfo, SealEngineFace const&
             refund.vout.push_back(CTxOut(CAmount(_t.value().convert_to<uint64_t>()), script));
         }
         //make sure to use empty transaction if no vouts made
-        return ResultExecute{ex, YodyTransactionReceipt(oldStateRoot, oldUTXORoot, gas, e.logs()), refund.vout.empty() ? CTransaction() : CTransaction(refund)};
+        return ResultExecute{ex, YodyTransactionReceipt(_oldStateRoot, _oldUTXORoot, gas, std::move(_logs)), refund.vout.empty() ? CTransaction() : CTransaction(refund), _changedAccounts};
     }else{
-        return ResultExecute{res, YodyTransactionReceipt(rootHash(), rootHashUTXO(), startGasUsed + e.gasUsed(), e.logs()), tx ? *tx : CTransaction()};
+        return ResultExecute{_res, YodyTransactionReceipt(rootHash(), rootHashUTXO(), _gasUsed, std::move(_logs)), _tx ? *_tx : CTransaction(), _changedAccounts};
     }
 }
 
@@ -161,6 +267,9 @@ Vin const* YodyState::vin(dev::Address const& _a) const
 
 Vin* YodyState::vin(dev::Address const& _addr)
 {
+    if (m_recordAccessed)
+        m_accessedAccounts.insert(_addr);
+
     auto it = cacheUTXO.find(_addr);
     if (it == cacheUTXO.end()){
         std::string stateBack = stateUTXO.at(_addr);
@@ -243,6 +352,23 @@ void YodyState::deleteAccounts(std::set<dev::Address>& addrs){
     }
 }
 
+void YodyState::addChangedAccounts(std::vector<dev::Address>& addrs) const{
+    for(auto const& i : m_cache){
+        if(i.second.isDirty())
+            addrs.push_back(i.first);
+    }
+}
+
+void YodyState::noteAccess(){
+    if(!m_recordAccess)
+        return;
+    // The accounts read, including the missing ones, are recorded by account()
+    for(auto const& i : m_cache){
+        if(i.second.isDirty())
+            m_accessWritten.insert(i.first);
+    }
+}
+
 void YodyState::updateUTXO(const std::unordered_map<dev::Address, Vin>& vins){
     for(auto& v : vins){
         Vin* vi = const_cast<Vin*>(vin(v.first));
@@ -303,7 +429,6 @@ void YodyState::deployDelegationsContract(){
 ///////////////////////////////////////////////////////////////////////////////////////////
 CTransaction CondensingTX::createCondensingTX(){
     selectionVin();
-    calculatePlusAndMinus();
     if(!createNewBalances())
         return CTransaction();
     CMutableTransaction tx;
@@ -314,72 +439,88 @@ CTransaction CondensingTX::createCondensingTX(){
 
 std::unordered_map<dev::Address, Vin> CondensingTX::createVin(const CTransaction& tx){
     std::unordered_map<dev::Address, Vin> vins;
-    for(auto& b : balances){
-        if(b.first == transaction.sender())
+    vins.reserve(deltas.size());
+    for(const AddressDelta& d : deltas){
+        if(!d.hasBalance || d.address == transaction.sender())
             continue;
 
-        if(b.second > 0){
-            vins[b.first] = Vin{uintToh256(tx.GetHash()), nVouts[b.first], b.second, 1};
+        if(d.balance > 0){
+            vins[d.address] = Vin{uintToh256(tx.GetHash()), d.nVout, d.balance, 1};
         } else {
-            vins[b.first] = Vin{uintToh256(tx.GetHash()), 0, 0, 0};
+            vins[d.address] = Vin{uintToh256(tx.GetHash()), 0, 0, 0};
         }
     }
     return vins;
 }
 
+CondensingTX::AddressDelta& CondensingTX::delta(dev::Address const& addr){
+    auto it = std::lower_bound(deltas.begin(), deltas.end(), addr, [](AddressDelta const& d, dev::Address const& a){ return d.address < a; });
+    assert(it != deltas.end() && it->address == addr);
+    return *it;
+}
+
 void CondensingTX::selectionVin(){
+    // The addresses of the transfers, sorted and unique
+    deltas.reserve(transfers.size() * 2);
     for(const TransferInfo& ti : transfers){
-        if(!vins.count(ti.from)){
-            if(auto a = state->vin(ti.from))
-                vins[ti.from] = *a;
-            if(ti.from == transaction.sender() && transaction.value() > 0){
-                vins[ti.from] = Vin{transaction.getHashWith(), transaction.getNVout(), transaction.value(), 1};
-            }
-        }
-
-        if(!vins.count(ti.to)){
-            if(auto a = state->vin(ti.to))
-                vins[ti.to] = *a;
+        deltas.emplace_back();
+        deltas.back().address = ti.from;
+        deltas.emplace_back();
+        deltas.back().address = ti.to;
+    }
+    std::sort(deltas.begin(), deltas.end(), [](AddressDelta const& a, AddressDelta const& b){ return a.address < b.address; });
+    deltas.erase(std::unique(deltas.begin(), deltas.end(), [](AddressDelta const& a, AddressDelta const& b){ return a.address == b.address; }), deltas.end());
+
+    // Read the UTXOs of all the addresses at once, each one once
+    for(AddressDelta& d : deltas){
+        if(auto a = state->vin(d.address)){
+            d.vin = *a;
+            d.stateVin = true;
         }
+        d.deleted = deleteAddresses.count(d.address) != 0;
     }
-}
 
-void CondensingTX::calculatePlusAndMinus(){
+    // The coins sent with the transaction are spent instead of the UTXO of the sender when it is
+    // first seen as the source of a transfer
     for(const TransferInfo& ti : transfers){
-        if(!plusMinusInfo.count(ti.from)){
-            plusMinusInfo[ti.from] = std::make_pair(0, ti.value);
-        } else {
-            plusMinusInfo[ti.from] = std::make_pair(plusMinusInfo[ti.from].first, plusMinusInfo[ti.from].second + ti.value);
+        AddressDelta& from = delta(ti.from);
+        if(!from.selected){
+            from.selected = from.stateVin;
+            if(ti.from == transaction.sender() && transaction.value() > 0){
+                from.vin = Vin{transaction.getHashWith(), transaction.getNVout(), transaction.value(), 1};
+                from.selected = true;
+            }
         }
+        from.minus += ti.value;
 
-        if(!plusMinusInfo.count(ti.to)){
-            plusMinusInfo[ti.to] = std::make_pair(ti.value, 0);
-        } else {
-            plusMinusInfo[ti.to] = std::make_pair(plusMinusInfo[ti.to].first + ti.value, plusMinusInfo[ti.to].second);
-        }
+        AddressDelta& to = delta(ti.to);
+        if(!to.selected)
+            to.selected = to.stateVin;
+        to.plus += ti.value;
     }
 }
 
 bool CondensingTX::createNewBalances(){
-    for(auto& p : plusMinusInfo){
+    for(AddressDelta& d : deltas){
         dev::u256 balance = 0;
-        if((vins.count(p.first) && vins[p.first].alive) || (!vins[p.first].alive && !checkDeleteAddress(p.first))){
-            balance = vins[p.first].value;
+        if((d.selected && d.vin.alive) || (!d.vin.alive && !d.deleted)){
+            balance = d.vin.value;
         }
-        balance += p.second.first;
-        if(balance < p.second.second)
+        balance += d.plus;
+        if(balance < d.minus)
             return false;
-        balance -= p.second.second;
-        balances[p.first] = balance;
+        balance -= d.minus;
+        d.balance = balance;
+        d.hasBalance = true;
     }
     return true;
 }
 
 std::vector<CTxIn> CondensingTX::createVins(){
     std::vector<CTxIn> ins;
-    for(auto& v : vins){
-        if((v.second.value > 0 && v.second.alive) || (v.second.value > 0 && !vins[v.first].alive && !checkDeleteAddress(v.first)))
-            ins.push_back(CTxIn(h256Touint(v.second.hash), v.second.nVout, CScript() << OP_SPEND));
+    for(const AddressDelta& d : deltas){
+        if(d.selected && d.vin.value > 0 && (d.vin.alive || !d.deleted))
+            ins.push_back(CTxIn(h256Touint(d.vin.hash), d.vin.nVout, CScript() << OP_SPEND));
     }
     return ins;
 }
@@ -387,18 +528,19 @@ std::vector<CTxIn> CondensingTX::createVins(){
 std::vector<CTxOut> CondensingTX::createVout(){
     size_t count = 0;
     std::vector<CTxOut> outs;
-    for(auto& b : balances){
-        if(b.second > 0){
+    outs.reserve(std::min(deltas.size(), MAX_CONTRACT_VOUTS + 1));
+    for(AddressDelta& d : deltas){
+        if(d.balance > 0){
             CScript script;
-            auto* a = state->account(b.first);
+            auto* a = state->account(d.address);
             if(a && a->isAlive()){
                 //create a no-exec contract output
-                script = CScript() << valtype{0} << valtype{0} << valtype{0} << valtype{0} << b.first.asBytes() << OP_CALL;
+                script = CScript() << valtype{0} << valtype{0} << valtype{0} << valtype{0} << d.address.asBytes() << OP_CALL;
             } else {
-                script = CScript() << OP_DUP << OP_HASH160 << b.first.asBytes() << OP_EQUALVERIFY << OP_CHECKSIG;
+                script = CScript() << OP_DUP << OP_HASH160 << d.address.asBytes() << OP_EQUALVERIFY << OP_CHECKSIG;
             }
-            outs.push_back(CTxOut(CAmount(b.second), script));
-            nVouts[b.first] = count;
+            outs.push_back(CTxOut(CAmount(d.balance), script));
+            d.nVout = count;
             count++;
         }
         if(count > MAX_CONTRACT_VOUTS){
@@ -408,8 +550,4 @@ std::vector<CTxOut> CondensingTX::createVout(){
     }
     return outs;
 }
-
-bool CondensingTX::checkDeleteAddress(dev::Address addr){
-    return deleteAddresses.count(addr) != 0;
-}
 ///////////////////////////////////////////////////////////////////////////////////////////
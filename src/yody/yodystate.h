@@ -17,7 +17,6 @@ class CChain;
 
 using OnOpFunc = std::function<void(uint64_t, uint64_t, dev::eth::Instruction, dev::bigint, dev::bigint, 
     dev::bigint, dev::eth::VMFace const*, dev::eth::ExtVMFace const*)>;
-using plusAndMinus = std::pair<dev::u256, dev::u256>;
 using valtype = std::vector<unsigned char>;
 
 struct TransferInfo{
@@ -35,7 +34,7 @@ struct Vin{
 
 class YodyTransactionReceipt: public dev::eth::TransactionReceipt {
 public:
-    YodyTransactionReceipt(dev::h256 const& state_root, dev::h256 const& utxo_root, dev::u256 const& gas_used, dev::eth::LogEntries const& log) : dev::eth::TransactionReceipt(state_root, gas_used, log), m_utxoRoot(utxo_root) {}
+    YodyTransactionReceipt(dev::h256 const& state_root, dev::h256 const& utxo_root, dev::u256 const& gas_used, dev::eth::LogEntries log) : dev::eth::TransactionReceipt(state_root, gas_used, std::move(log)), m_utxoRoot(utxo_root) {}
 
     dev::h256 const& utxoRoot() const {
         return m_utxoRoot;
@@ -48,6 +47,23 @@ struct ResultExecute{
     dev::eth::ExecutionResult execRes;
     YodyTransactionReceipt txRec;
     CTransaction tx;
+    /// Accounts written to the state trie by the execution, created, changed or removed
+    std::vector<dev::Address> changedAccounts;
+};
+
+/// Changes of a transaction executed on a copy of the state before its block, see YodyState::executeSpeculative
+struct SpeculativeExecution{
+    bool thrown = false;
+    dev::eth::ExecutionResult execRes;
+    dev::u256 startGasUsed;
+    dev::u256 gasUsed;
+    dev::eth::LogEntries logs;
+    std::unordered_map<dev::Address, dev::eth::Account> cache;
+    std::unordered_map<dev::Address, Vin> cacheUTXO;
+    std::vector<TransferInfo> transfers;
+    std::set<dev::Address> deleteAddresses;
+    /// Accounts and UTXOs read or written by the execution
+    std::set<dev::Address> accessed;
 };
 
 namespace yody{
@@ -79,9 +95,24 @@ public:
 
     YodyState(dev::u256 const& _accountStartNonce, dev::OverlayDB const& _db, const std::string& _path, dev::eth::BaseState _bs = dev::eth::BaseState::PreExisting);
 
+    /// Copy of _state pinned to the given state and UTXO roots. The copy shares the databases of _state
+    /// but has its own caches, it is meant for read-only execution and must never be committed.
+    YodyState(YodyState const& _state, dev::h256 const& _root, dev::h256 const& _rootUTXO);
+
     ResultExecute execute(dev::eth::EnvInfo const& _envInfo, dev::eth::SealEngineFace const& _sealEngine, YodyTransaction const& _t, CChain& _chain, dev::eth::Permanence _p = dev::eth::Permanence::Committed, dev::eth::OnOpFunc const& _onOp = OnOpFunc());
 
-    void setRootUTXO(dev::h256 const& _r) { cacheUTXO.clear(); stateUTXO.setRoot(_r); }
+    /// Same as above for a chain of the given height, for callers that do not hold cs_main.
+    ResultExecute execute(dev::eth::EnvInfo const& _envInfo, dev::eth::SealEngineFace const& _sealEngine, YodyTransaction const& _t, int _chainHeight, dev::eth::Permanence _p = dev::eth::Permanence::Committed, dev::eth::OnOpFunc const& _onOp = OnOpFunc());
+
+    /// Executes _t on this state without committing it and moves its changes to _out. The state must be
+    /// a copy used for this execution only, see executeSpeculative.
+    void executeSpeculative(dev::eth::EnvInfo const& _envInfo, dev::eth::SealEngineFace const& _sealEngine, YodyTransaction const& _t, int _chainHeight, SpeculativeExecution& _out);
+
+    /// Commits _spec like execute() with Permanence::Committed would commit _t, from a state where none of
+    /// the accounts accessed by _spec changed since the state it was executed on.
+    ResultExecute commitSpeculative(dev::eth::EnvInfo const& _envInfo, dev::eth::SealEngineFace const& _sealEngine, YodyTransaction const& _t, SpeculativeExecution&& _spec);
+
+    void setRootUTXO(dev::h256 const& _r) { if (m_recordCommitted && _r != stateUTXO.root()) m_rootReplaced = true; cacheUTXO.clear(); stateUTXO.setRoot(_r); }
 
     void setCacheUTXO(dev::Address const& address, Vin const& vin) { cacheUTXO.insert(std::make_pair(address, vin)); }
 
@@ -112,6 +143,20 @@ public:
 
     void deployDelegationsContract();
 
+    /// Records the accounts read and changed by the executions with Permanence::Reverted from now on,
+    /// dropping the accounts recorded before.
+    void recordAccess(bool _record) { m_recordAccess = _record; recordAccessedAccounts(_record); m_accessWritten.clear(); }
+
+    std::set<dev::Address> const& accessRead() const { return accessedAccounts(); }
+
+    std::set<dev::Address> const& accessWritten() const { return m_accessWritten; }
+
+    /// @returns the hash of the account RLP at the current root, the hash of an empty string when it does not exist.
+    dev::h256 accountHash(dev::Address const& _addr) const { return dev::sha3(m_state.at(_addr)); }
+
+    /// @returns the hash of the UTXO RLP at the current UTXO root, the hash of an empty string when it does not exist.
+    dev::h256 vinHash(dev::Address const& _addr) const { return dev::sha3(stateUTXO.at(_addr)); }
+
     virtual ~YodyState(){}
 
     friend CondensingTX;
@@ -136,6 +181,18 @@ private:
 
     void printfErrorLog(const dev::eth::TransactionException er);
 
+    void addChangedAccounts(std::vector<dev::Address>& addrs) const;
+
+    void noteAccess();
+
+    void beginExecution(dev::eth::EnvInfo const& _envInfo, dev::eth::SealEngineFace const& _sealEngine, YodyTransaction const& _t);
+
+    void runExecutive(dev::eth::Executive& _e, dev::eth::EnvInfo const& _envInfo, YodyTransaction const& _t, int _chainHeight, dev::eth::OnOpFunc const& _onOp, dev::u256& _startGasUsed);
+
+    bool commitExecution(dev::eth::EnvInfo const& _envInfo, dev::eth::SealEngineFace const& _sealEngine, YodyTransaction const& _t, dev::eth::ExecutionResult const& _res, CTransactionRef& _tx, std::vector<dev::Address>& _changedAccounts);
+
+    ResultExecute executionResult(YodyTransaction const& _t, dev::eth::ExecutionResult& _res, bool _voutLimit, dev::h256 const& _oldStateRoot, dev::h256 const& _oldUTXORoot, dev::u256 const& _gasUsed, dev::eth::LogEntries&& _logs, CTransactionRef const& _tx, std::vector<dev::Address>& _changedAccounts);
+
     dev::Address newAddress;
 
     std::vector<TransferInfo> transfers;
@@ -147,6 +204,10 @@ private:
 	std::unordered_map<dev::Address, Vin> cacheUTXO;
 
 	void validateTransfersWithChangeLog();
+
+    bool m_recordAccess = false;
+
+    std::set<dev::Address> m_accessWritten;
 };
 
 
@@ -183,7 +244,7 @@ class CondensingTX{
 
 public:
 
-    CondensingTX(YodyState* _state, const std::vector<TransferInfo>& _transfers, const YodyTransaction& _transaction, std::set<dev::Address> _deleteAddresses = std::set<dev::Address>()) : transfers(_transfers), deleteAddresses(_deleteAddresses), transaction(_transaction), state(_state){}
+    CondensingTX(YodyState* _state, const std::vector<TransferInfo>& _transfers, const YodyTransaction& _transaction, const std::set<dev::Address>& _deleteAddresses) : transfers(_transfers), deleteAddresses(_deleteAddresses), transaction(_transaction), state(_state){}
 
     CTransaction createCondensingTX();
 
@@ -193,9 +254,24 @@ public:
 
 private:
 
-    void selectionVin();
+    /// Balance changes of an address made by the transfers, with its UTXO
+    struct AddressDelta{
+        dev::Address address;
+        dev::u256 plus;
+        dev::u256 minus;
+        /// UTXO spent by the condensing transaction, zero when there is none
+        Vin vin{};
+        /// Whether the address has a UTXO in the state, and whether vin is spent
+        bool stateVin = false;
+        bool selected = false;
+        bool deleted = false;
+        /// New balance, set in address order until an address can not pay its transfers
+        bool hasBalance = false;
+        dev::u256 balance;
+        uint32_t nVout = 0;
+    };
 
-    void calculatePlusAndMinus();
+    void selectionVin();
 
     bool createNewBalances();
 
@@ -203,21 +279,16 @@ private:
 
     std::vector<CTxOut> createVout();
 
-    bool checkDeleteAddress(dev::Address addr);
-
-    std::map<dev::Address, plusAndMinus> plusMinusInfo;
-
-    std::map<dev::Address, dev::u256> balances;
-
-    std::map<dev::Address, uint32_t> nVouts;
+    AddressDelta& delta(dev::Address const& addr);
 
-    std::map<dev::Address, Vin> vins;
+    /// One entry per address of the transfers, sorted by address which is the order of the inputs and outputs
+    std::vector<AddressDelta> deltas;
 
     const std::vector<TransferInfo>& transfers;
 
     //We don't need the ordered nature of "set" here, but unordered_set's theoretical worst complexity is O(n), whereas set is O(log n)
     //So, making this unordered_set could be an attack vector
-    const std::set<dev::Address> deleteAddresses;
+    const std::set<dev::Address>& deleteAddresses;
 
     const YodyTransaction& transaction;
 
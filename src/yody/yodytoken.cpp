@@ -668,6 +668,58 @@ void YodyToken::addTokenEvent(std::vector<TokenEvent> &tokenEvents, TokenEvent t
         tokenEvents.push_back(tokenEvent);
 }
 
+bool YodyToken::searchTokenEvents(const LogSearchFn& search, int64_t fromBlock, int64_t toBlock, int64_t minconf, const std::string& eventName, const std::string& contractAddress, const std::string& senderAddress, int numTopics, std::vector<TokenEvent>& result)
+{
+    // Check parameters
+    if(eventName.size() != 64 || !IsHex(eventName) ||
+       contractAddress.size() != 40 || !IsHex(contractAddress) ||
+       senderAddress.size() != 64 || !IsHex(senderAddress))
+        return false;
+
+    // Match the logs of the contract with the sender address as sender or receiver, skip the event type check
+    LogFilter filter;
+    filter.fromBlock = fromBlock;
+    filter.toBlock = toBlock;
+    filter.minconf = minconf;
+    filter.addresses.insert(dev::h160(contractAddress));
+    filter.topics.push_back(std::nullopt);
+    if(numTopics > 1)
+        filter.topics.push_back(dev::h256(senderAddress));
+    if(numTopics > 2)
+        filter.topics.push_back(dev::h256(senderAddress));
+
+    const dev::h256 eventTopic(eventName);
+    return search(filter, [&](const TransactionReceiptInfo& receipt, const dev::eth::LogEntry& log) {
+        // Skip the not needed events
+        if(log.topics.size() < (size_t)numTopics || log.topics[0] != eventTopic)
+            return true;
+
+        // Create new event
+        TokenEvent tokenEvent;
+        tokenEvent.address = receipt.contractAddress.hex();
+        if(numTopics > 1)
+        {
+            tokenEvent.sender = log.topics[1].hex().substr(24);
+            ToYodyAddress(tokenEvent.sender, tokenEvent.sender);
+        }
+        if(numTopics > 2)
+        {
+            tokenEvent.receiver = log.topics[2].hex().substr(24);
+            ToYodyAddress(tokenEvent.receiver, tokenEvent.receiver);
+        }
+        tokenEvent.blockHash = receipt.blockHash;
+        tokenEvent.blockNumber = receipt.blockNumber;
+        tokenEvent.transactionHash = receipt.transactionHash;
+
+        // Parse data
+        dev::bytesConstRef data(&log.data);
+        tokenEvent.value = u256Touint(dev::eth::ABIDeserialiser<dev::u256>::deserialise(data));
+
+        result.push_back(tokenEvent);
+        return true;
+    });
+}
+
 bool YodyToken::execEvents(int64_t fromBlock, int64_t toBlock, int64_t minconf, int func, std::vector<TokenEvent> &tokenEvents)
 {
     // Check parameters
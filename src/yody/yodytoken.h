@@ -3,9 +3,13 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <functional>
 #include <uint256.h>
 
 struct YodyTokenData;
+struct LogFilter;
+struct TransactionReceiptInfo;
+namespace dev { namespace eth { struct LogEntry; } }
 
 struct TokenEvent{
     std::string address;
@@ -92,6 +96,11 @@ public:
     static uint256 ToUint256(const std::string& data);
     static void addTokenEvent(std::vector<TokenEvent> &tokenEvents, TokenEvent tokenEvent);
 
+    // Search the logs matching a filter, passing each log to the callback until it returns false
+    using LogSearchFn = std::function<bool(const LogFilter& filter, const std::function<bool(const TransactionReceiptInfo&, const dev::eth::LogEntry&)>& fn)>;
+    // Search the token events with the typed log search of the node, used by the token executors
+    static bool searchTokenEvents(const LogSearchFn& search, int64_t fromBlock, int64_t toBlock, int64_t minconf, const std::string& eventName, const std::string& contractAddress, const std::string& senderAddress, int numTopics, std::vector<TokenEvent>& result);
+
     // Get param functions
     static const char* paramAddress();
     static const char* paramDatahex();
@@ -6,11 +6,14 @@
 """
 
 from test_framework.blocktools import COINBASE_MATURITY
+from test_framework.messages import deser_compact_size
 from test_framework.test_framework import BitcoinTestFramework
 from test_framework.util import assert_equal, assert_raises_rpc_error
 from test_framework.yodyconfig import *
 import hashlib
+from io import BytesIO
 from pathlib import Path
+import struct
 
 
 class DumptxoutsetTest(BitcoinTestFramework):
@@ -39,15 +42,48 @@ class DumptxoutsetTest(BitcoinTestFramework):
             out['base_hash'],
             '5cf28d0f3d2322b7594be92408643b32d2242066bbb90a31e11f58628f5d5ec4')
 
+        # The contract state at the roots of the base block follows the coins
+        assert out['state_nodes_written'] > 0
+        header = node.getblockheader(out['base_hash'])
+        roots = bytes.fromhex(header['hashStateRoot'])[::-1] + bytes.fromhex(header['hashUTXORoot'])[::-1]
         with open(str(expected_path), 'rb') as f:
-            digest = hashlib.sha256(f.read()).hexdigest()
-            # UTXO snapshot hash should be deterministic based on mocked time.
-            assert_equal(
-                digest, '12e37167d364af7aec152785c26fef2ad17f1869ec28f63a46f535cc8d2e6621')
+            snapshot = f.read()
+        state_offset = snapshot.index(roots)
+
+        # UTXO snapshot hash should be deterministic based on mocked time.
+        digest = hashlib.sha256(snapshot[:state_offset]).hexdigest()
+        assert_equal(
+            digest, '12e37167d364af7aec152785c26fef2ad17f1869ec28f63a46f535cc8d2e6621')
+
+        # The state and the UTXO databases are written in chunks ending with an empty one
+        state = BytesIO(snapshot[state_offset + len(roots):])
+        entries = {0: 0, 1: 0}
+        for _ in range(2):
+            count = struct.unpack('<I', state.read(4))[0]
+            while count:
+                for _ in range(count):
+                    entry_type = state.read(1)[0]
+                    state.read(32)
+                    state.read(deser_compact_size(state))
+                    entries[entry_type] += 1
+                count = struct.unpack('<I', state.read(4))[0]
+        assert_equal(state.read(), b'')
+        assert_equal(entries[0], out['state_nodes_written'])
+        assert_equal(entries[1], out['state_preimages_written'])
+
+        # The contract state is walked in a deterministic order, so the whole snapshot is too
+        out2 = node.dumptxoutset('txoutset2.dat')
+        with open(out2['path'], 'rb') as f:
+            assert_equal(hashlib.sha256(f.read()).hexdigest(), hashlib.sha256(snapshot).hexdigest())
 
         # Specifying a path to an existing file will fail.
         assert_raises_rpc_error(
             -8, '{} already exists'.format(FILENAME),  node.dumptxoutset, FILENAME)
 
+        # The contract state could be pruned while it is dumped
+        self.restart_node(0, extra_args=['-statepruning=10000'])
+        assert_raises_rpc_error(
+            -1, 'Unable to dump the contract state with -statepruning', node.dumptxoutset, 'txoutset3.dat')
+
 if __name__ == '__main__':
     DumptxoutsetTest().main()
@@ -42,6 +42,11 @@ class RpcMiscTest(BitcoinTestFramework):
         assert_greater_than(memory['chunks_free'], 0)
         assert_equal(memory['used'] + memory['free'], memory['total'])
 
+        node_cache = node.getmemoryinfo()['statenodecache']
+        assert_greater_than(node_cache['max'], 0)
+        assert_greater_than_or_equal(node_cache['max'], node_cache['used'])
+        assert_greater_than(node_cache['nodes'], 0)
+
         self.log.info("test mallocinfo")
         try:
             mallocinfo = node.getmemoryinfo(mode="mallocinfo")
@@ -340,6 +340,8 @@ BASE_SCRIPTS = [
     'yody_soft_block_gas_limits.py',
     'yody_dgp_block_size_restart.py',
     'yody_searchlog_restart_node.py',
+    'yody_searchlog_logindex.py',
+    'yody_mempool_preexec.py',
     'yody_immature_coinstake_spend.py',
     'yody_transaction_prioritization.py',
     'yody_assign_mpos_fees_to_gas_refund.py',
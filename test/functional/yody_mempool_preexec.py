@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+# Copyright (c) 2015-2016 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import *
+from test_framework.script import *
+from test_framework.p2p import *
+from test_framework.yodyconfig import *
+
+class YodyMempoolPreExecTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+        self.extra_args = [["-mempoolpreexec"]]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def wait_for_preexecution(self, txid):
+        node = self.nodes[0]
+        tip = node.getbestblockhash()
+        self.wait_until(lambda: node.getmempoolentry(txid).get('preexecution', {}).get('tip') == tip)
+        return node.getmempoolentry(txid)['preexecution']
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(COINBASE_MATURITY+100)
+        """
+        pragma solidity ^0.4.12;
+        contract Test {
+            uint x = 13;
+            function () payable {
+                x *= 2;
+            }
+            function add(uint y) returns (uint) {
+                x += y;
+                return x;
+            }
+        }
+        """
+        contract_address = node.createcontract("6060604052600d600055341561001457600080fd5b61017e806100236000396000f30060606040526004361061004c576000357c0100000000000000000000000000000000000000000000000000000000900463ffffffff168063027c1aaf1461004e5780635b9af12b14610058575b005b61005661008f565b005b341561006357600080fd5b61007960048080359060200190919050506100a1565b6040518082815260200191505060405180910390f35b60026000808282540292505081905550565b60007fc5c442325655248f6bccf5c6181738f8755524172cea2a8bd1e38e43f833e7f282600054016000548460405180848152602001838152602001828152602001935050505060405180910390a17fc5c442325655248f6bccf5c6181738f8755524172cea2a8bd1e38e43f833e7f282600054016000548460405180848152602001838152602001828152602001935050505060405180910390a1816000540160008190555060005490509190505600a165627a7a7230582015732bfa66bdede47ecc05446bf4c1e8ed047efac25478cb13b795887df70f290029")['address']
+        node.generate(1)
+
+        # A call to add is executed on the tip with the gas it uses and the contract in its read and write sets
+        add_txid = node.sendtocontract(contract_address, "5b9af12b0000000000000000000000000000000000000000000000000000000000000001")['txid']
+        preexecution = self.wait_for_preexecution(add_txid)
+        assert_equal(preexecution['failed'], False)
+        assert_equal(len(preexecution['gasused']), 1)
+        assert 21000 < preexecution["gasused"][0] < 250000
+        assert contract_address in preexecution['read']
+        assert contract_address in preexecution['written']
+
+        # Sending coins to add reverts
+        revert_txid = node.sendtocontract(contract_address, "5b9af12b0000000000000000000000000000000000000000000000000000000000000001", 1)['txid']
+        assert_equal(self.wait_for_preexecution(revert_txid)['failed'], True)
+
+        # The staker skips the call known to fail
+        block = node.getblock(node.generate(1)[0])
+        assert add_txid in block['tx']
+        assert revert_txid not in block['tx']
+        assert_equal(node.getrawmempool(), [revert_txid])
+
+        # The new block changed the contract, so the call is executed again on the new tip
+        assert_equal(self.wait_for_preexecution(revert_txid)['failed'], True)
+
+if __name__ == '__main__':
+    YodyMempoolPreExecTest().main()
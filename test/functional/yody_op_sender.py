@@ -169,6 +169,13 @@ class YodyOpSenderTest(BitcoinTestFramework):
         assert_equal(len(self.nodes[0].listcontracts().keys()), num_contracts+len(HASHTYPES))
         assert_equal(self.nodes[0].listcontracts(), self.nodes[1].listcontracts())
 
+        # Pages continued after the last account of the previous page cover the whole list
+        contracts = self.nodes[0].listcontracts(1, 1000)
+        first_page = self.nodes[0].listcontracts(1, 2)
+        next_pages = self.nodes[0].listcontracts(1, 1000, list(first_page.keys())[-1])
+        assert_equal(list(first_page.keys()) + list(next_pages.keys()), list(contracts.keys()))
+        assert_equal(list(self.nodes[0].listcontracts(2, 1).keys()), list(contracts.keys())[1:2])
+
     def single_op_sender_op_call_tx_test(self):
         contract_address = sorted(self.nodes[0].listcontracts().keys())[-1]
         key = ECKey()
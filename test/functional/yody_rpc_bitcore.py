@@ -100,6 +100,13 @@ class YodyBitcoreTest(BitcoinTestFramework):
         assert_equal(ret, {"txid": expected_address_txids[0], "index": 0, "height": 4002})
         self.sync_all()
 
+        # The address index is built in the background when it is enabled, without a reindex
+        self.restart_node(1, ['-addrindex=1'])
+        self.wait_until(lambda: self.nodes[1].getindexinfo('addressindex').get('addressindex', {}).get('synced'))
+        assert_equal(set(self.nodes[1].getaddresstxids({'addresses': [confirmed_address]})), set(expected_address_txids))
+        assert_equal(self.nodes[1].getaddressbalance({'addresses': [confirmed_address]}), node.getaddressbalance({'addresses': [confirmed_address]}))
+        assert_equal(self.nodes[1].getspentinfo({"txid": spent_prevout['txid'], "index": spent_prevout['vout']}), ret)
+
 
 if __name__ == '__main__':
     YodyBitcoreTest().main()
\ No newline at end of file
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+# Copyright (c) 2015-2016 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import *
+from test_framework.script import *
+from test_framework.p2p import *
+from test_framework.yody import generatesynchronized
+
+class YodyRPCSearchlogsLogIndexTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+        self.extra_args = [["-logevents"], ["-logindex"]]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def check_searchlogs(self, *args):
+        assert_equal(self.nodes[0].searchlogs(*args), self.nodes[1].searchlogs(*args))
+        return self.nodes[1].searchlogs(*args)
+
+    def run_test(self):
+        generatesynchronized(self.nodes[0], COINBASE_MATURITY+100, None, self.nodes)
+        contract_address1 = self.nodes[0].createcontract("6060604052600d600055341561001457600080fd5b61017e806100236000396000f30060606040526004361061004c576000357c0100000000000000000000000000000000000000000000000000000000900463ffffffff168063027c1aaf1461004e5780635b9af12b14610058575b005b61005661008f565b005b341561006357600080fd5b61007960048080359060200190919050506100a1565b6040518082815260200191505060405180910390f35b60026000808282540292505081905550565b60007fc5c442325655248f6bccf5c6181738f8755524172cea2a8bd1e38e43f833e7f282600054016000548460405180848152602001838152602001828152602001935050505060405180910390a17fc5c442325655248f6bccf5c6181738f8755524172cea2a8bd1e38e43f833e7f282600054016000548460405180848152602001838152602001828152602001935050505060405180910390a1816000540160008190555060005490509190505600a165627a7a7230582015732bfa66bdede47ecc05446bf4c1e8ed047efac25478cb13b795887df70f290029")['address']
+        self.nodes[0].generate(1)
+        self.nodes[0].sendtocontract(contract_address1, "5b9af12b")
+        self.nodes[0].generate(1)
+
+        contract_address2 = self.nodes[0].createcontract("6060604052341561000f57600080fd5b61029b8061001e6000396000f300606060405260043610610062576000357c0100000000000000000000000000000000000000000000000000000000900463ffffffff16806394e8767d14610067578063b717cfe6146100a6578063d3b57be9146100bb578063f7e52d58146100d0575b600080fd5b341561007257600080fd5b61008860048080359060200190919050506100e5565b60405180826000191660001916815260200191505060405180910390f35b34156100b157600080fd5b6100b961018e565b005b34156100c657600080fd5b6100ce6101a9565b005b34156100db57600080fd5b6100e36101b3565b005b600080821415610117577f30000000000000000000000000000000000000000000000000000000000000009050610186565b5b600082111561018557610100816001900481151561013257fe5b0460010290507f01000000000000000000000000000000000000000000000000000000000000006030600a8481151561016757fe5b06010260010281179050600a8281151561017d57fe5b049150610118565b5b809050919050565b60008081548092919060010191905055506101a76101b3565b565b6101b161018e565b565b7f746f7069632034000000000000000000000000000000000000000000000000007f746f7069632033000000000000000000000000000000000000000000000000007f746f7069632032000000000000000000000000000000000000000000000000007f746f70696320310000000000000000000000000000000000000000000000000060405180807f3700000000000000000000000000000000000000000000000000000000000000815250600101905060405180910390a45600a165627a7a72305820262764914338437fc49c9f752503904820534b24092308961bc10cd851985ae50029")['address']
+        self.nodes[0].generate(1)
+        self.nodes[0].sendtocontract(contract_address2, "d3b57be9")
+        self.nodes[0].sendtocontract(contract_address1, "5b9af12b")
+        self.nodes[0].generate(1)
+        self.nodes[0].generate(10)
+        self.sync_all()
+
+        height = self.nodes[0].getblockcount()
+        both = {"addresses": [contract_address1, contract_address2]}
+        topic1 = "c5c442325655248f6bccf5c6181738f8755524172cea2a8bd1e38e43f833e7f2"
+        topic2 = "746f706963203200000000000000000000000000000000000000000000000000"
+
+        # Topic only queries are served by the topic index
+        assert_equal(len(self.check_searchlogs(0, height, None, {"topics": [topic1]})), 2)
+        assert_equal(len(self.check_searchlogs(0, height, None, {"topics": [None, topic2]})), 1)
+        assert_equal(self.check_searchlogs(0, height, None, {"topics": [topic2]}), [])
+        self.check_searchlogs(0, height, None, {"topics": [topic1, topic2]})
+        self.check_searchlogs(0, -1, None, {"topics": [topic1]}, 5)
+
+        # Address and topic queries
+        self.check_searchlogs(0, height, {"addresses": [contract_address1]}, {"topics": [topic1]})
+        assert_equal(self.check_searchlogs(0, height, {"addresses": [contract_address2]}, {"topics": [topic1]}), [])
+        self.check_searchlogs(0, height, both, {"topics": [topic1, topic2]})
+
+        # Address only queries are served by the bloom index
+        assert_equal(len(self.check_searchlogs(0, height, {"addresses": [contract_address1]})), 2)
+        self.check_searchlogs(0, height, both)
+        self.check_searchlogs(height - 10, height, both)
+        self.check_searchlogs(0, height)
+
+        # Disconnected blocks are dropped from the index
+        block_hash = self.nodes[0].getblockhash(height - 10)
+        for node in self.nodes:
+            node.invalidateblock(block_hash)
+        assert_equal(self.check_searchlogs(0, -1, None, {"topics": [topic1]}), self.check_searchlogs(0, height - 11, None, {"topics": [topic1]}))
+        self.check_searchlogs(0, -1, both)
+        for node in self.nodes:
+            node.reconsiderblock(block_hash)
+        assert_equal(len(self.check_searchlogs(0, -1, None, {"topics": [topic1]})), 2)
+        self.check_searchlogs(0, -1, both)
+
+if __name__ == '__main__':
+    YodyRPCSearchlogsLogIndexTest().main()
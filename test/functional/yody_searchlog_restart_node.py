@@ -145,5 +145,12 @@ class YodyRPCSearchlogsTestModified(BitcoinTestFramework):
         self.start_nodes()               #start node again
         self.check_logs(contract_addresses, first_output, False)
 
+        # The receipts are replayed in the background when the log events are enabled again, without a reindex
+        self.restart_node(0, ['-logevents=0', '-londonheight=1000000'])
+        self.restart_node(0, ['-logevents', '-londonheight=1000000'])
+        self.wait_until(lambda: self.nodes[0].getindexinfo('receiptindex').get('receiptindex', {}).get('synced'))
+        self.check_searchlogs(contract_addresses, send_result, block_hashes)
+        self.check_logs(contract_addresses, first_output, False)
+
 if __name__ == '__main__':
     YodyRPCSearchlogsTestModified().main()
\ No newline at end of file